@@ -190,6 +190,9 @@ package core_v_mini_mcu_pkg;
   
   localparam int unsigned DMA_CH_PORT_SEL_WIDTH = DMA_CH_NUM > 1 ? $clog2(DMA_CH_NUM) : 32'd1;
 
+  // Relative address of the interrupt summary registers, right after the last channel
+  localparam logic [7:0] DMA_INTR_SUMMARY_START_ADDRESS = 8'h${hex((dma.get_ch_length() * dma.get_num_channels()) >> 8)[2:]};
+
 ######################################################################
 ## Automatically add all user peripherals listed
 ######################################################################
@@ -101,6 +101,7 @@ module spi_subsystem
   obi_spimemio obi_spimemio_i (
       .clk_i,
       .rst_ni,
+      .use_spimemio_i,
       .flash_csb_o(yo_spi_csb[0]),
       .flash_clk_o(yo_spi_sck),
       .flash_io0_oe_o(yo_spi_sd_en[0]),
@@ -59,6 +59,9 @@ module dma_subsystem
 
   localparam RVALID_FIFO_DEPTH = 4;
 
+  /* Number of 32-bit words of each interrupt summary register */
+  localparam int unsigned SUMMARY_WORDS = (core_v_mini_mcu_pkg::DMA_CH_NUM + 31) / 32;
+
   /*_________________________________________________________________________________________________________________________________ */
 
   /* Signals declaration */
@@ -77,6 +80,17 @@ module dma_subsystem
   logic [core_v_mini_mcu_pkg::DMA_CH_NUM-1:0] dma_trans_done;
   logic [core_v_mini_mcu_pkg::DMA_CH_NUM-1:0] dma_window_done;
 
+  /* Interrupt summary registers */
+  logic [SUMMARY_WORDS*32-1:0] trans_done_summary;
+  logic [SUMMARY_WORDS*32-1:0] window_done_summary;
+  logic summary_sel;
+  logic [2:0] summary_word;
+  reg_pkg::reg_rsp_t summary_rsp;
+
+  /* Register interface of the channels */
+  reg_pkg::reg_req_t channels_req;
+  reg_pkg::reg_rsp_t channels_rsp;
+
   /* Register interfaces from register demux to DMAs */
   reg_pkg::reg_req_t [core_v_mini_mcu_pkg::DMA_CH_NUM-1:0] submodules_req;
   reg_pkg::reg_rsp_t [core_v_mini_mcu_pkg::DMA_CH_NUM-1:0] submodules_rsp;
@@ -224,7 +238,7 @@ module dma_subsystem
           .addr_t(logic [7:0]),
           .rule_t(addr_map_rule_pkg::addr_map_rule_8bit_t)
       ) addr_dec_i (
-          .addr_i(reg_req_i.addr[15:8]),
+          .addr_i(channels_req.addr[15:8]),
           .addr_map_i(core_v_mini_mcu_pkg::DMA_ADDR_RULES),
           .idx_o(submodules_select),
           .dec_valid_o(),
@@ -242,8 +256,8 @@ module dma_subsystem
           .clk_i,
           .rst_ni,
           .in_select_i(submodules_select),
-          .in_req_i(reg_req_i),
-          .in_rsp_o(reg_rsp_o),
+          .in_req_i(channels_req),
+          .in_rsp_o(channels_rsp),
           .out_req_o(submodules_req),
           .out_rsp_i(submodules_rsp)
       );
@@ -257,13 +271,49 @@ module dma_subsystem
       assign xbar_write_resp[0] = dma_write_resp_i[0];
       assign dma_addr_req_o[0] = xbar_address_req[0];
       assign xbar_address_resp[0] = dma_addr_resp_i[0];
-      assign submodules_req[0] = reg_req_i;
-      assign reg_rsp_o = submodules_rsp[0];
+      assign submodules_req[0] = channels_req;
+      assign channels_rsp = submodules_rsp[0];
     end
   endgenerate
 
   /*_________________________________________________________________________________________________________________________________ */
 
+  /* Interrupt summary registers */
+
+  /*
+   * Read-only registers after the last channel, with a bit per channel set while
+   * its IFR is set: the interrupt handlers read them to find the channels to serve
+   * without reading the IFR of all the channels.
+   * Offset 0x00 + 4*k: transaction done of the channels 32*k to 32*k+31
+   * Offset 0x20 + 4*k: window done of the channels 32*k to 32*k+31
+   */
+  always_comb begin
+    trans_done_summary = '0;
+    window_done_summary = '0;
+    trans_done_summary[core_v_mini_mcu_pkg::DMA_CH_NUM-1:0] = dma_trans_done;
+    window_done_summary[core_v_mini_mcu_pkg::DMA_CH_NUM-1:0] = dma_window_done;
+  end
+
+  assign summary_sel  = reg_req_i.addr[15:8] == core_v_mini_mcu_pkg::DMA_INTR_SUMMARY_START_ADDRESS;
+  assign summary_word = reg_req_i.addr[4:2];
+
+  always_comb begin
+    summary_rsp = '0;
+    summary_rsp.ready = 1'b1;
+    if (reg_req_i.addr[7:6] == 2'b00 && 32'(summary_word) < SUMMARY_WORDS) begin
+      summary_rsp.rdata = reg_req_i.addr[5] ? window_done_summary[32*summary_word+:32] :
+                                              trans_done_summary[32*summary_word+:32];
+    end
+  end
+
+  /* The channels do not see the accesses to the summary registers */
+  always_comb begin
+    channels_req = reg_req_i;
+    channels_req.valid = reg_req_i.valid & ~summary_sel;
+  end
+
+  assign reg_rsp_o = summary_sel ? summary_rsp : channels_rsp;
+
   /* Signal assignments */
 
   assign dma_done_intr_o   = |(dma_trans_done);
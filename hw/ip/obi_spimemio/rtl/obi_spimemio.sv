@@ -7,9 +7,18 @@
 module obi_spimemio
   import obi_pkg::*;
   import reg_pkg::*;
-(
+#(
+    // Line buffer of the code executed from the flash, see spimemio_prefetch
+    parameter int unsigned PREFETCH_LINES      = 2,
+    parameter int unsigned PREFETCH_LINE_WORDS = 8,
+    parameter bit          PREFETCH_NEXT       = 1'b1
+) (
     input  logic clk_i,
     input  logic rst_ni,
+
+    // The pads are driven by spimemio (soc_ctrl USE_SPIMEMIO)
+    input logic use_spimemio_i,
+
     output logic flash_csb_o,
     output logic flash_clk_o,
 
@@ -38,8 +47,8 @@ module obi_spimemio
   import picorv32_pkg::*;
   import obi_spimemio_reg_pkg::*;
 
-  picorv32_req_t  picorv32_req;
-  picorv32_resp_t picorv32_resp;
+  picorv32_req_t picorv32_req, spimemio_req;
+  picorv32_resp_t picorv32_resp, spimemio_resp;
 
   reg_rsp_t reg_rsp_reg, reg_rsp_spimem;
 
@@ -57,6 +66,22 @@ module obi_spimemio
       .obi_resp_o(spimemio_resp_o)
   );
 
+  // Flushed while spimemio is stopped or does not drive the pads, as the flash
+  // may be written by the SPI host meanwhile, and when it is reconfigured
+  spimemio_prefetch #(
+      .NUM_LINES(PREFETCH_LINES),
+      .LINE_WORDS(PREFETCH_LINE_WORDS),
+      .PREFETCH_NEXT(PREFETCH_NEXT)
+  ) spimemio_prefetch_i (
+      .clk_i,
+      .rst_ni,
+      .flush_i(cfgreg_we | ~reg2hw.start_spimem.q | ~use_spimemio_i),
+      .req_i(picorv32_req),
+      .resp_o(picorv32_resp),
+      .mem_req_o(spimemio_req),
+      .mem_resp_i(spimemio_resp)
+  );
+
   obi_spimemio_reg_top #(
       .reg_req_t(reg_req_t),
       .reg_rsp_t(reg_rsp_t)
@@ -88,10 +113,10 @@ module obi_spimemio
       .clk(clk_i),
       .resetn(rst_ni),
       .start_spi_i(reg2hw.start_spimem.q),
-      .valid(picorv32_req.valid),
-      .ready(picorv32_resp.ready),
-      .addr({picorv32_req.addr[23:2], 2'b00}),
-      .rdata(picorv32_resp.rdata),
+      .valid(spimemio_req.valid),
+      .ready(spimemio_resp.ready),
+      .addr({spimemio_req.addr[23:2], 2'b00}),
+      .rdata(spimemio_resp.rdata),
 
       .flash_csb(flash_csb_o),
       .flash_clk(flash_clk_o),
@@ -0,0 +1,182 @@
+/*
+*  Copyright 2025 EPFL
+*  Solderpad Hardware License, Version 2.1, see LICENSE.md for details.
+*  SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+*/
+
+// Line buffer with next-line prefetch between the OBI bridge and spimemio,
+// for the code executed in place from the flash.
+//
+// A miss fills its line from the requested word up to the end of the line,
+// keeping the request to spimemio asserted so that it streams the words
+// without a new flash command. Once the fill is over, the line following the
+// last one accessed by the CPU is prefetched into another line, which again
+// continues the same flash command. A new miss interrupts a fill at the next
+// word boundary unless the fill is about to deliver the requested word.
+//
+// NUM_LINES = 0 removes the buffer. Prefetching needs at least two lines.
+
+module spimemio_prefetch
+  import picorv32_pkg::*;
+#(
+    parameter int unsigned NUM_LINES     = 2,
+    parameter int unsigned LINE_WORDS    = 8,  // Power of two, at least 2
+    parameter bit          PREFETCH_NEXT = 1'b1
+) (
+    input logic clk_i,
+    input logic rst_ni,
+
+    // Drops the content, e.g. when the flash is reconfigured
+    input logic flush_i,
+
+    input  picorv32_req_t  req_i,
+    output picorv32_resp_t resp_o,
+
+    output picorv32_req_t  mem_req_o,
+    input  picorv32_resp_t mem_resp_i
+);
+
+  if (NUM_LINES == 0) begin : gen_bypass
+
+    assign mem_req_o = req_i;
+    assign resp_o    = mem_resp_i;
+
+  end else begin : gen_buffer
+
+    localparam int unsigned OffsetW = $clog2(LINE_WORDS);
+    localparam int unsigned TagW = 22 - OffsetW;
+    localparam int unsigned LineW = NUM_LINES > 1 ? $clog2(NUM_LINES) : 1;
+    localparam bit Prefetch = PREFETCH_NEXT && NUM_LINES > 1;
+
+    logic [NUM_LINES-1:0] line_valid_q;
+    logic [TagW-1:0] tag_q[NUM_LINES];
+    logic [LINE_WORDS-1:0] word_valid_q[NUM_LINES];
+    logic [31:0] data_q[NUM_LINES][LINE_WORDS];
+
+    logic fill_q, drop_q;
+    logic [LineW-1:0] fill_line_q, repl_q;
+    logic [OffsetW-1:0] fill_word_q;
+
+    // Line of the last access of the CPU
+    logic last_valid_q;
+    logic [TagW-1:0] last_tag_q;
+
+    logic [TagW-1:0] req_tag, next_tag;
+    logic [OffsetW-1:0] req_word;
+    logic hit, present, next_present, fwd, miss, fill_covers, fill_next;
+    logic [LineW-1:0] hit_line, present_line, prefetch_line;
+
+    assign req_tag  = req_i.addr[23:OffsetW+2];
+    assign req_word = req_i.addr[OffsetW+1:2];
+    assign next_tag = last_tag_q + 1'b1;
+
+    always_comb begin : lookup
+      hit = 1'b0;
+      hit_line = '0;
+      present = 1'b0;
+      present_line = '0;
+      next_present = 1'b0;
+      for (int unsigned i = 0; i < NUM_LINES; i++) begin
+        if (line_valid_q[i] && tag_q[i] == req_tag) begin
+          present = 1'b1;
+          present_line = LineW'(i);
+          if (word_valid_q[i][req_word]) begin
+            hit = 1'b1;
+            hit_line = LineW'(i);
+          end
+        end
+        if (line_valid_q[i] && tag_q[i] == next_tag) next_present = 1'b1;
+      end
+    end
+
+    // The word being filled is forwarded to the CPU
+    assign fwd = fill_q && !drop_q && mem_resp_i.ready && tag_q[fill_line_q] == req_tag &&
+                 fill_word_q == req_word;
+    assign miss = req_i.valid && !hit && !fwd;
+    // The fill delivers the requested word later
+    assign fill_covers = tag_q[fill_line_q] == req_tag && req_word > fill_word_q;
+    assign fill_next = !drop_q && !flush_i && fill_word_q != OffsetW'(LINE_WORDS - 1) &&
+                       !(miss && !fill_covers);
+
+    // The prefetch must not evict the line in use
+    assign prefetch_line = (line_valid_q[repl_q] && tag_q[repl_q] == last_tag_q) ?
+                           ((repl_q == LineW'(NUM_LINES - 1)) ? '0 : repl_q + 1'b1) : repl_q;
+
+    assign resp_o.ready = req_i.valid && (hit || fwd);
+    assign resp_o.rdata = fwd ? mem_resp_i.rdata : data_q[hit_line][req_word];
+
+    assign mem_req_o.valid = fill_q;
+    assign mem_req_o.addr = {8'h00, tag_q[fill_line_q], fill_word_q, 2'b00};
+    assign mem_req_o.wstrb = '0;
+    assign mem_req_o.wdata = '0;
+
+    always_ff @(posedge clk_i or negedge rst_ni) begin : fill_fsm
+      if (!rst_ni) begin
+        line_valid_q <= '0;
+        fill_q       <= 1'b0;
+        drop_q       <= 1'b0;
+        fill_line_q  <= '0;
+        fill_word_q  <= '0;
+        repl_q       <= '0;
+        last_valid_q <= 1'b0;
+        last_tag_q   <= '0;
+        for (int unsigned i = 0; i < NUM_LINES; i++) begin
+          tag_q[i] <= '0;
+          word_valid_q[i] <= '0;
+        end
+      end else begin
+        if (req_i.valid) begin
+          last_valid_q <= 1'b1;
+          last_tag_q   <= req_tag;
+        end
+
+        if (fill_q) begin
+          if (mem_resp_i.ready) begin
+            if (!drop_q) word_valid_q[fill_line_q][fill_word_q] <= 1'b1;
+            if (fill_next) begin
+              fill_word_q <= fill_word_q + 1'b1;
+            end else begin
+              fill_q <= 1'b0;
+              drop_q <= 1'b0;
+            end
+          end
+        end else if (miss && !flush_i) begin
+          fill_q      <= 1'b1;
+          fill_word_q <= req_word;
+          if (present) begin
+            fill_line_q <= present_line;
+          end else begin
+            fill_line_q          <= repl_q;
+            tag_q[repl_q]        <= req_tag;
+            word_valid_q[repl_q] <= '0;
+            line_valid_q[repl_q] <= 1'b1;
+            repl_q               <= (repl_q == LineW'(NUM_LINES - 1)) ? '0 : repl_q + 1'b1;
+          end
+        end else if (Prefetch && last_valid_q && !next_present && !flush_i) begin
+          fill_q                      <= 1'b1;
+          fill_word_q                 <= '0;
+          fill_line_q                 <= prefetch_line;
+          tag_q[prefetch_line]        <= next_tag;
+          word_valid_q[prefetch_line] <= '0;
+          line_valid_q[prefetch_line] <= 1'b1;
+          repl_q <= (prefetch_line == LineW'(NUM_LINES - 1)) ? '0 : prefetch_line + 1'b1;
+        end
+
+        // The word in flight is still awaited, but not stored
+        if (flush_i) begin
+          line_valid_q <= '0;
+          last_valid_q <= 1'b0;
+          if (fill_q && !mem_resp_i.ready) drop_q <= 1'b1;
+        end
+      end
+    end
+
+    always_ff @(posedge clk_i) begin : line_data
+      if (fill_q && mem_resp_i.ready && !drop_q) begin
+        data_q[fill_line_q][fill_word_q] <= mem_resp_i.rdata;
+      end
+    end
+
+  end
+
+endmodule
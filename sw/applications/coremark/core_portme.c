@@ -35,6 +35,7 @@ Original Author: Shay Gal-on
 
 #include "csr.h"
 #include "x-heep.h"
+#include "perf_sdk.h"
 
 #include "coremark.h"
 
@@ -72,15 +73,17 @@ portable_init(core_portable *p, int *argc, char *argv[])
 void
 portable_fini(core_portable *p)
 {
-    // Don't need to do anything here atm.
     (void)p;
+    // Stall breakdown of the timed section, where the examples print
+    PERF_PRINT_SUMMARY();
 }
 
 void
 start_time(void)
 {
-    // Enable mcycle counter and read value
-    CSR_CLEAR_BITS(CSR_REG_MCOUNTINHIBIT, 0x1);
+    // Enable mcycle, minstret and the stall counters, then read mcycle
+    perf_init();
+    PERF_REGION_BEGIN("coremark");
 
     CSR_READ(CSR_REG_MCYCLE, &start_time_val);
 }
@@ -89,6 +92,7 @@ void
 stop_time(void)
 {
     CSR_READ(CSR_REG_MCYCLE, &stop_time_val);
+    PERF_REGION_END("coremark");
 }
 
 CORE_TICKS
@@ -0,0 +1,93 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+//
+// Boot time, to be built with each linker script (on_chip, flash_load,
+// flash_exec) and compared, e.g. with util/xip_bench.py. The cycles from
+// reset to main are saved by the crt0 (see heep_boot_cycles_main; build with
+// COMPILER_FLAGS=-DHEEP_BOOT_TIME on the cores that inhibit mcycle at reset).
+// The application carries a 16 KiB table in its code and 1 KiB of initialized
+// data, so that with flash_load most of the image is loaded by the crt0, and
+// checks that both were loaded and that the bss was cleared.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "x-heep.h"
+#include "core_v_mini_mcu.h"
+
+/* Printfs are also activated for simulation, the results are read from the UART log. */
+#define PRINTF_IN_FPGA  1
+#define PRINTF_IN_SIM   1
+
+#if TARGET_SIM && PRINTF_IN_SIM
+        #define PRINTF(fmt, ...)    printf(fmt, ## __VA_ARGS__)
+#elif PRINTF_IN_FPGA && !TARGET_SIM
+    #define PRINTF(fmt, ...)    printf(fmt, ## __VA_ARGS__)
+#else
+    #define PRINTF(...)
+#endif
+
+#if defined(FLASH_EXEC)
+#define LINK_MODE "flash_exec"
+#elif defined(FLASH_LOAD)
+#define LINK_MODE "flash_load"
+#else
+#define LINK_MODE "on_chip"
+#endif
+
+#define VALUE(k)    ((uint32_t)(k) * 2654435761u)
+
+#define V(k)        VALUE(k),
+#define V4(k)       V(k) V((k) + 1) V((k) + 2) V((k) + 3)
+#define V16(k)      V4(k) V4((k) + 4) V4((k) + 8) V4((k) + 12)
+#define V64(k)      V16(k) V16((k) + 16) V16((k) + 32) V16((k) + 48)
+#define V256(k)     V64(k) V64((k) + 64) V64((k) + 128) V64((k) + 192)
+#define V1024(k)    V256(k) V256((k) + 256) V256((k) + 512) V256((k) + 768)
+#define V4096(k)    V1024(k) V1024((k) + 1024) V1024((k) + 2048) V1024((k) + 3072)
+
+#define TABLE_WORDS 4096
+#define DATA_WORDS  256
+#define BSS_WORDS   256
+
+// Linked with the code
+const uint32_t table[TABLE_WORDS] = { V4096(0) };
+
+// Linked in .data, the values are offset to tell them from the table
+uint32_t data[DATA_WORDS] = { V256(TABLE_WORDS) };
+
+uint32_t bss[BSS_WORDS];
+
+int main(int argc, char *argv[])
+{
+    uint32_t boot_cycles = heep_boot_cycles_main;
+    uint32_t crt0_cycles = heep_boot_cycles_main - heep_boot_cycles_start;
+    int errors = 0;
+
+    // Read through volatile pointers so that the compiler cannot fold the checks
+    const volatile uint32_t *t = table;
+    volatile uint32_t *d = data;
+    volatile uint32_t *b = bss;
+
+    for (int i = 0; i < TABLE_WORDS; i++) {
+        if (t[i] != VALUE(i)) errors++;
+    }
+    for (int i = 0; i < DATA_WORDS; i++) {
+        if (d[i] != VALUE(TABLE_WORDS + i)) errors++;
+    }
+    for (int i = 0; i < BSS_WORDS; i++) {
+        if (b[i] != 0) errors++;
+    }
+
+    PRINTF("boot_time %s\n", LINK_MODE);
+    PRINTF("Boot cycles: %u\n", boot_cycles);
+    PRINTF("crt0 cycles: %u\n", crt0_cycles);
+
+    if (errors) {
+        PRINTF("%d words not loaded\n", errors);
+        return EXIT_FAILURE;
+    }
+    PRINTF("All tests passed!\n");
+    return EXIT_SUCCESS;
+}
@@ -12,6 +12,7 @@
 #include <stdlib.h>
 
 #include "dma.h"
+#include "dma_sdk.h"
 #include "core_v_mini_mcu.h"
 #include "x-heep.h"
 #include "csr.h"
@@ -25,10 +26,12 @@
  *  
  * 0: Test the dLC tighly-coupled accelerator with the DMA in single transaction mode
  * 1: Test the dLC tighly-coupled accelerator with the DMA in circular transaction mode
+ * 2: Same as 0 through a DMA pipeline of the SDK, and compare the cycles taken
  */
 
 #define TEST_ID_0
 #define TEST_ID_1
+#define TEST_ID_2
 
 #define PRINTF_IN_SIM 0
 #define PRINTF_IN_FPGA 1
@@ -68,6 +71,15 @@ dma *peri = dma_peri(0);
 
 volatile char trans_count = 0;
 
+dma_pipe_t pipe;
+
+static inline uint32_t get_cycles(void)
+{
+    uint32_t cycles;
+    CSR_READ(CSR_REG_MCYCLE, &cycles);
+    return cycles;
+}
+
 /* Strong transaction ISR implementation */
 void dma_intr_handler_trans_done(uint8_t channel)
 {
@@ -86,6 +98,9 @@ void dma_intr_handler_trans_done(uint8_t channel)
 
 int main() {
  
+    uint32_t cycles_direct = 0;
+
+    CSR_CLEAR_BITS(CSR_REG_MCOUNTINHIBIT, 0x1);
     CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
     CSR_SET_BITS(CSR_REG_MIE, (1 << 19) | (1 << 30) | (1 << 31));
 
@@ -131,6 +146,7 @@ int main() {
 
     dma_init(NULL);
 
+    cycles_direct = get_cycles();
     if(dma_validate_transaction(&trans, DMA_ENABLE_REALIGN, DMA_PERFORM_CHECKS_INTEGRITY) != DMA_CONFIG_OK){
         PRINTF("Error: dma_validate_transaction\n");
         return EXIT_FAILURE;
@@ -151,6 +167,7 @@ int main() {
         }
         CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
     }
+    cycles_direct = get_cycles() - cycles_direct;
 
     // Checking  the results
     for (int i = 0; i < LC_STATS_CROSSINGS; i++)
@@ -240,5 +257,53 @@ int main() {
 
     #endif
 
+    #ifdef TEST_ID_2
+
+    PRINTF("Starting dLC test 2...\n\r");
+
+    *dlc_size = DATA_SIZE;
+
+    /*
+     * The DMA may write as many results as there are samples before the dLC
+     * signals the end: the buffers of test 1 are large enough.
+     */
+    int16_t *pipe_results = &dlc_circular_mode_results_buffer[0][0];
+    for (int i = 0; i < DLC_WINDOWS * DLC_BUFFER_SIZE; i++)
+    {
+        pipe_results[i] = 0;
+    }
+
+    dma_init(NULL);
+
+    pipe = (dma_pipe_t){
+        .kind       = DMA_PIPE_HW_FIFO,
+        .in_type    = DMA_DATA_TYPE_HALF_WORD,
+        .out_type   = DMA_DATA_TYPE_HALF_WORD,
+        .tx_channel = 0,
+    };
+    if(dma_pipe_init(&pipe) != DMA_CONFIG_OK){
+        PRINTF("Error: dma_pipe_init\n");
+        return EXIT_FAILURE;
+    }
+    if(dma_pipe_run(&pipe, ecg_data, DATA_SIZE, pipe_results, DLC_WINDOWS * DLC_BUFFER_SIZE) != DMA_CONFIG_OK){
+        PRINTF("Error: dma_pipe_run\n");
+        return EXIT_FAILURE;
+    }
+
+    // Checking  the results
+    for (int i = 0; i < LC_STATS_CROSSINGS; i++)
+    {
+        if(pipe_results[i] != lc_data_for_storage_data[i])
+        {
+            PRINTF("Error at position %d: dlc result is %d, golden result is %d\n", i, pipe_results[i], lc_data_for_storage_data[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    PRINTF("Cycles: direct %u, pipeline %u\n\r", cycles_direct, pipe.stats.cycles);
+    PRINTF("Success test 2!\n\r");
+
+    #endif
+
     return EXIT_SUCCESS;
 }
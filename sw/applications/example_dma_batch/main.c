@@ -0,0 +1,243 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+//
+// Many small copies, as issued by kernels that move rows of a tile or pieces
+// of a buffer one at a time. Each workload is performed first with one DMA
+// transaction per copy (validate, load, launch and wait for each of them),
+// then through a batch of the DMA SDK, which merges the copies that line up
+// into a single 1D or 2D transaction. The destinations of the two are
+// compared, and the launches saved by the batch are reported.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dma.h"
+#include "dma_sdk.h"
+#include "core_v_mini_mcu.h"
+#include "x-heep.h"
+#include "csr.h"
+
+/* Matrix the rows are gathered from, in words */
+#define MAT_D1 32
+#define MAT_D2 32
+
+/* Rows of a tile: ROW_LEN words every MAT_D1 words */
+#define ROW_LEN 8
+
+/* Pieces of a buffer: PIECES contiguous copies of PIECE_LEN words */
+#define PIECES    32
+#define PIECE_LEN 4
+
+#define OUT_LEN (MAT_D1 * MAT_D2)
+
+/* By default, printfs are activated for FPGA and disabled for simulation. */
+#define PRINTF_IN_FPGA 1
+#define PRINTF_IN_SIM 0
+
+#if TARGET_SIM && PRINTF_IN_SIM
+#define PRINTF(fmt, ...) printf(fmt, ##__VA_ARGS__)
+#elif PRINTF_IN_FPGA && !TARGET_SIM
+#define PRINTF(fmt, ...) printf(fmt, ##__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+typedef enum
+{
+    WL_ROWS,        // The rows of a tile, into a contiguous tile
+    WL_PIECES,      // Contiguous pieces, into a contiguous buffer
+    WL_SCATTER,     // Copies of different lengths that do not line up
+} workload_t;
+
+typedef struct
+{
+    const char *name;
+    workload_t wl;
+    uint32_t threshold_du;
+    uint32_t launches;      // Expected launches of the batch
+} test_t;
+
+static const test_t tests[] = {
+    {"rows   ", WL_ROWS, 0, 1},
+    {"rows/64", WL_ROWS, 64, MAT_D2 * ROW_LEN / 64},
+    {"pieces ", WL_PIECES, 0, 1},
+    {"scatter", WL_SCATTER, 0, 8},
+};
+
+#define N_TESTS (sizeof(tests) / sizeof(tests[0]))
+
+uint32_t mat[MAT_D2][MAT_D1] __attribute__((aligned(4)));
+uint32_t out_single[OUT_LEN] __attribute__((aligned(4)));
+uint32_t out_batch[OUT_LEN] __attribute__((aligned(4)));
+
+static dma_target_t tgt_src;
+static dma_target_t tgt_dst;
+static dma_trans_t trans;
+
+static dma_batch_t batch;
+
+static inline uint32_t get_cycles(void)
+{
+    uint32_t cycles;
+    CSR_READ(CSR_REG_MCYCLE, &cycles);
+    return cycles;
+}
+
+// One transaction per copy
+static dma_config_flags_t copy_single(uint32_t *dst, const uint32_t *src, uint32_t len)
+{
+    dma_config_flags_t res;
+
+    tgt_src.ptr = (uint8_t *)src;
+    tgt_dst.ptr = (uint8_t *)dst;
+    trans.size_d1_du = len;
+
+    res = dma_validate_transaction(&trans, DMA_ENABLE_REALIGN, DMA_PERFORM_CHECKS_INTEGRITY);
+    res |= dma_load_transaction(&trans);
+    res |= dma_launch(&trans);
+    if (res != DMA_CONFIG_OK)
+    {
+        return res;
+    }
+    DMA_WAIT(0);
+    return res;
+}
+
+static dma_config_flags_t copy_batch(uint32_t *dst, const uint32_t *src, uint32_t len)
+{
+    return dma_batch_copy(&batch, dst, src, len);
+}
+
+// Issue the copies of a workload, return the number of words copied
+static uint32_t run(workload_t wl, dma_config_flags_t (*copy)(uint32_t *, const uint32_t *, uint32_t),
+                    uint32_t *out, dma_config_flags_t *p_res)
+{
+    uint32_t n = 0;
+
+    *p_res = DMA_CONFIG_OK;
+    switch (wl)
+    {
+    case WL_ROWS:
+        for (int r = 0; r < MAT_D2; r++)
+        {
+            *p_res |= copy(&out[r * ROW_LEN], &mat[r][4], ROW_LEN);
+        }
+        n = MAT_D2 * ROW_LEN;
+        break;
+    case WL_PIECES:
+        for (int p = 0; p < PIECES; p++)
+        {
+            *p_res |= copy(&out[p * PIECE_LEN], &mat[0][0] + p * PIECE_LEN, PIECE_LEN);
+        }
+        n = PIECES * PIECE_LEN;
+        break;
+    case WL_SCATTER:
+        for (int i = 0; i < 8; i++)
+        {
+            /* Lengths 3, 4, 5, ... from every third row */
+            *p_res |= copy(&out[n], &mat[3 * i][i], 3 + i);
+            n += 3 + i;
+        }
+        break;
+    }
+    return n;
+}
+
+int main(void)
+{
+    uint32_t cycles_single, cycles_batch, start, words;
+    dma_config_flags_t res;
+    int errors = 0;
+
+    for (int i = 0; i < MAT_D2; i++)
+    {
+        for (int j = 0; j < MAT_D1; j++)
+        {
+            mat[i][j] = (i << 16) | j;
+        }
+    }
+
+    CSR_CLEAR_BITS(CSR_REG_MCOUNTINHIBIT, 0x1);
+    dma_sdk_init();
+
+    tgt_src = (dma_target_t){
+        .inc_d1_du = 1,
+        .type = DMA_DATA_TYPE_WORD,
+        .trig = DMA_TRIG_MEMORY,
+    };
+    tgt_dst = tgt_src;
+    trans = (dma_trans_t){
+        .src = &tgt_src,
+        .dst = &tgt_dst,
+        .src_type = DMA_DATA_TYPE_WORD,
+        .dst_type = DMA_DATA_TYPE_WORD,
+        .mode = DMA_TRANS_MODE_SINGLE,
+        .dim = DMA_DIM_CONF_1D,
+        .end = DMA_TRANS_END_INTR,
+        .channel = 0,
+    };
+
+    PRINTF("workload  single   batch  requests launches saved\n\r");
+    for (uint32_t t = 0; t < N_TESTS; t++)
+    {
+        memset(out_single, 0, sizeof(out_single));
+        memset(out_batch, 0xff, sizeof(out_batch));
+
+        start = get_cycles();
+        words = run(tests[t].wl, copy_single, out_single, &res);
+        cycles_single = get_cycles() - start;
+        if (res != DMA_CONFIG_OK)
+        {
+            PRINTF("%s: single copy failed: %x\n\r", tests[t].name, res);
+            errors++;
+        }
+
+        batch = (dma_batch_t){
+            .type = DMA_DATA_TYPE_WORD,
+            .channel = 0,
+            .threshold_du = tests[t].threshold_du,
+        };
+        if (dma_batch_init(&batch) != DMA_CONFIG_OK)
+        {
+            PRINTF("Batch init failed\n\r");
+            return EXIT_FAILURE;
+        }
+
+        start = get_cycles();
+        run(tests[t].wl, copy_batch, out_batch, &res);
+        res |= dma_batch_barrier(&batch);
+        cycles_batch = get_cycles() - start;
+        if (res != DMA_CONFIG_OK)
+        {
+            PRINTF("%s: batch failed: %x\n\r", tests[t].name, res);
+            errors++;
+        }
+
+        if (memcmp(out_single, out_batch, words * sizeof(uint32_t)) != 0)
+        {
+            PRINTF("%s: mismatch\n\r", tests[t].name);
+            errors++;
+        }
+        if (batch.stats.launches != tests[t].launches)
+        {
+            PRINTF("%s: %u launches, expected %u\n\r", tests[t].name,
+                   batch.stats.launches, tests[t].launches);
+            errors++;
+        }
+
+        PRINTF("%s  %6u  %6u  %8u %8u %5u\n\r", tests[t].name, cycles_single, cycles_batch,
+               batch.stats.requests, batch.stats.launches,
+               batch.stats.requests - batch.stats.launches);
+    }
+
+    if (errors)
+    {
+        PRINTF("FAILED: %d errors\n\r", errors);
+        return EXIT_FAILURE;
+    }
+
+    PRINTF("SUCCESS\n\r");
+    return EXIT_SUCCESS;
+}
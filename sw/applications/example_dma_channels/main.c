@@ -0,0 +1,161 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+//
+// Sharing the DMA channels with the channel manager of the DMA driver. Every
+// channel is acquired and used for a copy. A request made while all the
+// channels are busy is granted the first channel that is released, and then
+// does its own copy. The utilization of each channel is printed at the end.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "dma.h"
+#include "core_v_mini_mcu.h"
+#include "x-heep.h"
+#include "csr.h"
+
+#define COPY_LEN 64
+
+/* By default, printfs are activated for FPGA and disabled for simulation. */
+#define PRINTF_IN_FPGA 1
+#define PRINTF_IN_SIM 0
+
+#if TARGET_SIM && PRINTF_IN_SIM
+#define PRINTF(fmt, ...) printf(fmt, ##__VA_ARGS__)
+#elif PRINTF_IN_FPGA && !TARGET_SIM
+#define PRINTF(fmt, ...) printf(fmt, ##__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+uint32_t src[COPY_LEN] __attribute__((aligned(4)));
+uint32_t dst[DMA_CH_NUM + 1][COPY_LEN] __attribute__((aligned(4)));
+
+dma_target_t tgt_src;
+dma_target_t tgt_dst;
+dma_trans_t trans;
+
+dma_ch_req_t req;
+volatile int granted = -1;
+
+static void on_grant(uint8_t channel, void *p_arg)
+{
+    granted = channel;
+}
+
+/* Copy src into buf on a channel and wait for the end */
+static int copy(uint8_t channel, uint32_t *buf)
+{
+    tgt_src = (dma_target_t){
+        .ptr = (uint8_t *)src,
+        .inc_d1_du = 1,
+        .type = DMA_DATA_TYPE_WORD,
+        .trig = DMA_TRIG_MEMORY,
+    };
+    tgt_dst = (dma_target_t){
+        .ptr = (uint8_t *)buf,
+        .inc_d1_du = 1,
+        .type = DMA_DATA_TYPE_WORD,
+        .trig = DMA_TRIG_MEMORY,
+    };
+    trans = (dma_trans_t){
+        .src = &tgt_src,
+        .dst = &tgt_dst,
+        .size_d1_du = COPY_LEN,
+        .src_type = DMA_DATA_TYPE_WORD,
+        .dst_type = DMA_DATA_TYPE_WORD,
+        .mode = DMA_TRANS_MODE_SINGLE,
+        .end = DMA_TRANS_END_POLLING,
+        .channel = channel,
+    };
+
+    if (dma_validate_transaction(&trans, DMA_ENABLE_REALIGN, DMA_PERFORM_CHECKS_INTEGRITY) != DMA_CONFIG_OK ||
+        dma_load_transaction(&trans) != DMA_CONFIG_OK ||
+        dma_launch(&trans) != DMA_CONFIG_OK)
+    {
+        return 1;
+    }
+    while (!dma_is_ready(channel))
+        ;
+
+    for (int i = 0; i < COPY_LEN; i++)
+    {
+        if (buf[i] != src[i])
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(void)
+{
+    uint8_t channels[DMA_CH_NUM];
+    int acquired = 0;
+    uint8_t ch;
+    dma_ch_stats_t stats;
+
+    for (int i = 0; i < COPY_LEN; i++)
+    {
+        src[i] = 0xA5000000 | i;
+    }
+
+    CSR_CLEAR_BITS(CSR_REG_MCOUNTINHIBIT, 0x1);
+    dma_init(NULL);
+
+    /* Take every channel a high priority user can get */
+    while (dma_channel_acquire(DMA_CH_PRIO_HIGH, 0, &ch) == DMA_CONFIG_OK)
+    {
+        channels[acquired++] = ch;
+    }
+    if (acquired != DMA_CH_NUM)
+    {
+        PRINTF("Acquired %d channels out of %d\n\r", acquired, DMA_CH_NUM);
+        return EXIT_FAILURE;
+    }
+
+    /* All the channels are busy: the request waits */
+    req = (dma_ch_req_t){
+        .prio = DMA_CH_PRIO_NORMAL,
+        .affinity = 0,
+        .cb = on_grant,
+        .arg = NULL,
+    };
+    if (dma_channel_request(&req) != DMA_CONFIG_CHANNEL_BUSY || granted != -1)
+    {
+        PRINTF("Request not pending\n\r");
+        return EXIT_FAILURE;
+    }
+
+    for (int i = acquired - 1; i >= 0; i--)
+    {
+        if (copy(channels[i], dst[i]))
+        {
+            PRINTF("Copy on channel %d failed\n\r", channels[i]);
+            return EXIT_FAILURE;
+        }
+        dma_channel_release(channels[i]);
+    }
+
+    /*
+     * The last channel is never reserved to high priority users, so the
+     * request got it as soon as it was released.
+     */
+    if (granted != channels[acquired - 1] || copy(granted, dst[DMA_CH_NUM]))
+    {
+        PRINTF("Copy on the granted channel failed\n\r");
+        return EXIT_FAILURE;
+    }
+    dma_channel_release(granted);
+
+    for (int i = 0; i < DMA_CH_NUM; i++)
+    {
+        dma_channel_get_stats(i, &stats);
+        PRINTF("Channel %d: %u grants, %u waited (max %u cycles), busy %u of %u cycles\n\r",
+               i, stats.grants, stats.waits, stats.max_wait_cycles,
+               stats.busy_cycles, stats.window_cycles);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,231 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+//
+// Latency of the dispatch of the DMA transaction done interrupt, for each of
+// the DMA_CH_NUM channels.
+// A copy is launched on a channel with its interrupt masked in MIE and, once
+// it is over, the interrupt is unmasked: the latency is measured from there
+// to the user handler (dma_intr_handler_trans_done()), and to the return of
+// the interrupt.
+// fic_irq_dma_done() reads the interrupt summary register of the DMA
+// subsystem and then only the IFR of the pending channel, so the latency is
+// the same on every channel and for any DMA_CH_NUM. For comparison, the cost
+// of reading the IFR of the channels up to the pending one, as a scan of the
+// channels does, is measured too: it grows with the channel.
+// The copies are launched both by writing the registers directly, without
+// the driver, and through the driver. Generate the MCU with more channels
+// (num_channels of the dma in the configuration) to check that the latency
+// stays flat.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "dma.h"
+#include "core_v_mini_mcu.h"
+#include "x-heep.h"
+#include "csr.h"
+
+#define COPY_LEN 16
+
+#define DMA_DONE_CSR_REG_MIE_MASK ( 1 << 19 ) // DMA fast interrupt bit in MIE CSR
+
+/* By default, printfs are activated for FPGA and disabled for simulation. */
+#define PRINTF_IN_FPGA 1
+#define PRINTF_IN_SIM 0
+
+#if TARGET_SIM && PRINTF_IN_SIM
+#define PRINTF(fmt, ...) printf(fmt, ##__VA_ARGS__)
+#elif PRINTF_IN_FPGA && !TARGET_SIM
+#define PRINTF(fmt, ...) printf(fmt, ##__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+uint32_t src[COPY_LEN] __attribute__((aligned(4)));
+uint32_t dst[COPY_LEN] __attribute__((aligned(4)));
+
+dma_target_t tgt_src;
+dma_target_t tgt_dst;
+dma_trans_t trans;
+
+volatile uint32_t handler_cycles;
+volatile int handler_channel;
+
+uint32_t direct_latency[DMA_CH_NUM], direct_total[DMA_CH_NUM];
+uint32_t driver_latency[DMA_CH_NUM], driver_total[DMA_CH_NUM];
+uint32_t scan_cycles[DMA_CH_NUM];
+
+static inline uint32_t get_cycles(void)
+{
+    uint32_t cycles;
+    CSR_READ(CSR_REG_MCYCLE, &cycles);
+    return cycles;
+}
+
+void dma_intr_handler_trans_done(uint8_t channel)
+{
+    handler_cycles = get_cycles();
+    handler_channel = channel;
+}
+
+static void launch_direct(uint8_t channel)
+{
+    volatile dma *peri = dma_peri(channel);
+
+    peri->INTERRUPT_EN   = 1 << DMA_INTERRUPT_EN_TRANSACTION_DONE_BIT;
+    peri->SRC_PTR        = (uint32_t)src;
+    peri->DST_PTR        = (uint32_t)dst;
+    peri->SRC_PTR_INC_D1 = 4;
+    peri->DST_PTR_INC_D1 = 4;
+    peri->SRC_DATA_TYPE  = DMA_DATA_TYPE_WORD;
+    peri->DST_DATA_TYPE  = DMA_DATA_TYPE_WORD;
+    peri->MODE           = DMA_TRANS_MODE_SINGLE;
+    peri->SIZE_D1        = COPY_LEN;
+}
+
+static int launch_driver(uint8_t channel)
+{
+    trans.channel = channel;
+    if (dma_validate_transaction(&trans, DMA_ENABLE_REALIGN, DMA_PERFORM_CHECKS_INTEGRITY) != DMA_CONFIG_OK
+        || dma_load_transaction(&trans) != DMA_CONFIG_OK)
+    {
+        return -1;
+    }
+    /* Loading the transaction unmasked the interrupt */
+    CSR_CLEAR_BITS(CSR_REG_MIE, DMA_DONE_CSR_REG_MIE_MASK);
+    return dma_launch(&trans) == DMA_CONFIG_OK ? 0 : -1;
+}
+
+/*
+ * Wait for the end of the copy on the channel, then let the pending
+ * interrupt in and measure its dispatch.
+ */
+static int measure(uint8_t channel, uint32_t *p_latency, uint32_t *p_total)
+{
+    uint32_t start, end;
+
+    while (!dma_is_ready(channel))
+    {
+    }
+
+    handler_channel = -1;
+    start = get_cycles();
+    CSR_SET_BITS(CSR_REG_MIE, DMA_DONE_CSR_REG_MIE_MASK);
+    end = get_cycles();
+    CSR_CLEAR_BITS(CSR_REG_MIE, DMA_DONE_CSR_REG_MIE_MASK);
+
+    if (handler_channel != channel)
+    {
+        return -1;
+    }
+    *p_latency = handler_cycles - start;
+    *p_total = end - start;
+    return 0;
+}
+
+/*
+ * Cycles to read the IFR of the channels 0 to channel, none of them being set.
+ */
+static uint32_t measure_scan(uint8_t channel)
+{
+    uint32_t start, end;
+    uint32_t flags = 0;
+
+    start = get_cycles();
+    for (int i = 0; i <= channel; i++)
+    {
+        flags |= dma_peri(i)->TRANSACTION_IFR;
+    }
+    end = get_cycles();
+    return flags ? 0 : end - start;
+}
+
+int main(void)
+{
+    tgt_src = (dma_target_t){
+        .ptr = (uint8_t *)src,
+        .inc_d1_du = 1,
+        .type = DMA_DATA_TYPE_WORD,
+        .trig = DMA_TRIG_MEMORY,
+    };
+    tgt_dst = (dma_target_t){
+        .ptr = (uint8_t *)dst,
+        .inc_d1_du = 1,
+        .type = DMA_DATA_TYPE_WORD,
+        .trig = DMA_TRIG_MEMORY,
+    };
+    trans = (dma_trans_t){
+        .src = &tgt_src,
+        .dst = &tgt_dst,
+        .size_d1_du = COPY_LEN,
+        .dim = DMA_DIM_CONF_1D,
+        .src_type = DMA_DATA_TYPE_WORD,
+        .dst_type = DMA_DATA_TYPE_WORD,
+        .mode = DMA_TRANS_MODE_SINGLE,
+        .win_du = 0,
+        .end = DMA_TRANS_END_INTR,
+    };
+
+    for (int i = 0; i < COPY_LEN; i++)
+    {
+        src[i] = i;
+    }
+
+    CSR_CLEAR_BITS(CSR_REG_MCOUNTINHIBIT, 0x1);
+    CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+
+    /* Registers written directly, without the driver */
+    dma_init(NULL);
+    for (int ch = 0; ch < DMA_CH_NUM; ch++)
+    {
+        launch_direct(ch);
+        if (measure(ch, &direct_latency[ch], &direct_total[ch]))
+        {
+            PRINTF("Direct copy on channel %d not dispatched\n\r", ch);
+            return EXIT_FAILURE;
+        }
+        dma_shadow_invalidate(ch);
+    }
+
+    /* Through the driver */
+    dma_init(NULL);
+    for (int ch = 0; ch < DMA_CH_NUM; ch++)
+    {
+        if (launch_driver(ch) || measure(ch, &driver_latency[ch], &driver_total[ch]))
+        {
+            PRINTF("Driver copy on channel %d failed\n\r", ch);
+            return EXIT_FAILURE;
+        }
+        scan_cycles[ch] = measure_scan(ch);
+    }
+
+    for (int i = 0; i < COPY_LEN; i++)
+    {
+        if (dst[i] != src[i])
+        {
+            PRINTF("Copy error at %d\n\r", i);
+            return EXIT_FAILURE;
+        }
+    }
+
+    uint32_t min = driver_latency[0];
+    uint32_t max = driver_latency[0];
+    for (int ch = 1; ch < DMA_CH_NUM; ch++)
+    {
+        min = driver_latency[ch] < min ? driver_latency[ch] : min;
+        max = driver_latency[ch] > max ? driver_latency[ch] : max;
+    }
+
+    PRINTF("DMA_CH_NUM = %d, cycles to handler / to return\n\r", DMA_CH_NUM);
+    PRINTF("channel     direct     driver  IFR scan\n\r");
+    for (int ch = 0; ch < DMA_CH_NUM; ch++)
+    {
+        PRINTF("%7d  %4u / %4u  %4u / %4u  %8u\n\r", ch,
+               direct_latency[ch], direct_total[ch],
+               driver_latency[ch], driver_total[ch], scan_cycles[ch]);
+    }
+    PRINTF("Latency to handler: %u to %u cycles\n\r", min, max);
+
+    return EXIT_SUCCESS;
+}
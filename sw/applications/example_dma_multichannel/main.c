@@ -1124,14 +1124,15 @@ int main()
     PRINTF("laun: %u \t%s\n\r", res_launch, res_launch == DMA_CONFIG_OK ?  "Ok!" : "Error!");
     #endif
 
-    /* Wait for CH0 to end, since the SPI will be slower than the DMA */
-    while(!dma_is_ready(0)) {
+    /* Wait for the flash channel to end, since the SPI will be slower than the DMA */
+    uint8_t flash_ch = w25q128jw_dma_channel();
+    while(!dma_is_ready(flash_ch)) {
         #if !EN_PERF
         /* Disable_interrupts */
         /* This does not prevent waking up the core as this is controlled by the MIP register */
         
         CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
-        if ( dma_is_ready(0) == 0 ) {
+        if ( dma_is_ready(flash_ch) == 0 ) {
             wait_for_interrupt();
             /* From here the core wakes up even if we did not jump to the ISR */
         }
@@ -1150,6 +1151,9 @@ int main()
     CSR_CLEAR_BITS(CSR_REG_MCOUNTINHIBIT, 0x1);
     #endif
 
+    /* Give the flash channel back to the DMA channel manager */
+    w25q128jw_dma_release();
+
     #if EN_VERIF
 
     /* Run the same computation on the CPU */
@@ -0,0 +1,260 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+//
+// Tiled copy of a matrix with many small 2D DMA transactions, as done by the
+// tiled kernels (im2col, matmul). The tiles are first copied one at a time
+// (validate, load, launch and wait for each of them), then with the
+// transaction queue of the DMA driver, where the transaction done interrupt
+// launches the next tile without waiting for the application, and finally by
+// relaunching a compiled transaction with the pointers of each tile, which
+// only writes the two pointer registers.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "dma.h"
+#include "core_v_mini_mcu.h"
+#include "x-heep.h"
+#include "csr.h"
+
+/* Size of the matrix and of the tiles, in words */
+#define MAT_D1  32
+#define MAT_D2  32
+#define TILE_D1 4
+#define TILE_D2 4
+
+#define TILES_D1 (MAT_D1 / TILE_D1)
+#define TILES_D2 (MAT_D2 / TILE_D2)
+#define TILES    (TILES_D1 * TILES_D2)
+#define TILE_LEN (TILE_D1 * TILE_D2)
+
+/* By default, printfs are activated for FPGA and disabled for simulation. */
+#define PRINTF_IN_FPGA 1
+#define PRINTF_IN_SIM 0
+
+#if TARGET_SIM && PRINTF_IN_SIM
+#define PRINTF(fmt, ...) printf(fmt, ##__VA_ARGS__)
+#elif PRINTF_IN_FPGA && !TARGET_SIM
+#define PRINTF(fmt, ...) printf(fmt, ##__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+uint32_t mat[MAT_D2][MAT_D1] __attribute__((aligned(4)));
+uint32_t tiles[TILES][TILE_LEN] __attribute__((aligned(4)));
+
+dma_target_t tgt_src[TILES];
+dma_target_t tgt_dst[TILES];
+dma_trans_t trans[TILES];
+
+volatile uint32_t tiles_done;
+
+static void tile_done(dma_trans_t *p_trans, void *p_arg)
+{
+    tiles_done++;
+}
+
+static void setup_tiles(dma_trans_end_evt_t end)
+{
+    for (int t = 0; t < TILES; t++)
+    {
+        int r = (t / TILES_D1) * TILE_D2;
+        int c = (t % TILES_D1) * TILE_D1;
+
+        tgt_src[t] = (dma_target_t){
+            .ptr = (uint8_t *)&mat[r][c],
+            .inc_d1_du = 1,
+            .inc_d2_du = MAT_D1 - TILE_D1 + 1,
+            .type = DMA_DATA_TYPE_WORD,
+            .trig = DMA_TRIG_MEMORY,
+        };
+        tgt_dst[t] = (dma_target_t){
+            .ptr = (uint8_t *)tiles[t],
+            .inc_d1_du = 1,
+            .inc_d2_du = 1,
+            .type = DMA_DATA_TYPE_WORD,
+            .trig = DMA_TRIG_MEMORY,
+        };
+        trans[t] = (dma_trans_t){
+            .src = &tgt_src[t],
+            .dst = &tgt_dst[t],
+            .size_d1_du = TILE_D1,
+            .size_d2_du = TILE_D2,
+            .dim = DMA_DIM_CONF_2D,
+            .src_type = DMA_DATA_TYPE_WORD,
+            .dst_type = DMA_DATA_TYPE_WORD,
+            .mode = DMA_TRANS_MODE_SINGLE,
+            .win_du = 0,
+            .end = end,
+            .channel = 0,
+        };
+    }
+}
+
+static int check_tiles(void)
+{
+    int errors = 0;
+    for (int t = 0; t < TILES; t++)
+    {
+        int r = (t / TILES_D1) * TILE_D2;
+        int c = (t % TILES_D1) * TILE_D1;
+        for (int i = 0; i < TILE_LEN; i++)
+        {
+            if (tiles[t][i] != mat[r + i / TILE_D1][c + i % TILE_D1])
+            {
+                errors++;
+            }
+        }
+        for (int i = 0; i < TILE_LEN; i++)
+        {
+            tiles[t][i] = 0;
+        }
+    }
+    return errors;
+}
+
+static void wait_dma(void)
+{
+    while (!dma_is_ready(0))
+    {
+        CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+        if (!dma_is_ready(0))
+        {
+            wait_for_interrupt();
+        }
+        CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+    }
+}
+
+static inline uint32_t get_cycles(void)
+{
+    uint32_t cycles;
+    CSR_READ(CSR_REG_MCYCLE, &cycles);
+    return cycles;
+}
+
+int main(void)
+{
+    uint32_t cycles_seq, cycles_queue, cycles_relaunch, start;
+    dma_queue_stats_t stats;
+    dma_trans_image_t img;
+    dma_config_flags_t res;
+    int errors;
+
+    for (int r = 0; r < MAT_D2; r++)
+    {
+        for (int c = 0; c < MAT_D1; c++)
+        {
+            mat[r][c] = (r << 16) | c;
+        }
+    }
+
+    CSR_CLEAR_BITS(CSR_REG_MCOUNTINHIBIT, 0x1);
+    dma_init(NULL);
+
+    /* One tile at a time */
+    setup_tiles(DMA_TRANS_END_INTR);
+    start = get_cycles();
+    for (int t = 0; t < TILES; t++)
+    {
+        res = dma_validate_transaction(&trans[t], DMA_ENABLE_REALIGN, DMA_PERFORM_CHECKS_INTEGRITY);
+        res |= dma_load_transaction(&trans[t]);
+        res |= dma_launch(&trans[t]);
+        if (res != DMA_CONFIG_OK)
+        {
+            PRINTF("Tile %d failed: %x\n\r", t, res);
+            return EXIT_FAILURE;
+        }
+        wait_dma();
+    }
+    cycles_seq = get_cycles() - start;
+
+    errors = check_tiles();
+    if (errors)
+    {
+        PRINTF("Sequential copy: %d errors\n\r", errors);
+        return EXIT_FAILURE;
+    }
+
+    /* Queued: the transactions are validated once, outside of the loop */
+    setup_tiles(DMA_TRANS_END_INTR);
+    for (int t = 0; t < TILES; t++)
+    {
+        if (dma_validate_transaction(&trans[t], DMA_ENABLE_REALIGN, DMA_PERFORM_CHECKS_INTEGRITY) != DMA_CONFIG_OK)
+        {
+            PRINTF("Tile %d not valid\n\r", t);
+            return EXIT_FAILURE;
+        }
+    }
+
+    tiles_done = 0;
+    dma_queue_reset_stats(0);
+    start = get_cycles();
+    for (int t = 0; t < TILES; t++)
+    {
+        while ((res = dma_queue_push(&trans[t], tile_done, NULL)) == DMA_CONFIG_QUEUE_FULL)
+        {
+            /* Wait for a free entry */
+            CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+            if (dma_queue_pending(0) == DMA_QUEUE_LEN)
+            {
+                wait_for_interrupt();
+            }
+            CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+        }
+        if (res != DMA_CONFIG_OK)
+        {
+            PRINTF("Tile %d not queued: %x\n\r", t, res);
+            return EXIT_FAILURE;
+        }
+    }
+    dma_queue_wait(0);
+    cycles_queue = get_cycles() - start;
+
+    dma_queue_get_stats(0, &stats);
+    errors = check_tiles();
+    if (errors || tiles_done != TILES || stats.completed != TILES)
+    {
+        PRINTF("Queued copy: %d errors, %u callbacks\n\r", errors, tiles_done);
+        return EXIT_FAILURE;
+    }
+
+    /* Relaunched: all the tiles share everything but the pointers */
+    setup_tiles(DMA_TRANS_END_INTR_WAIT);
+    if (dma_validate_transaction(&trans[0], DMA_ENABLE_REALIGN, DMA_PERFORM_CHECKS_INTEGRITY) != DMA_CONFIG_OK
+        || dma_compile_transaction(&trans[0], &img) != DMA_CONFIG_OK)
+    {
+        PRINTF("Tile 0 not compiled\n\r");
+        return EXIT_FAILURE;
+    }
+
+    start = get_cycles();
+    for (int t = 0; t < TILES; t++)
+    {
+        res = dma_relaunch_ptrs(&img, tgt_src[t].ptr, tgt_dst[t].ptr);
+        if (res != DMA_CONFIG_OK)
+        {
+            PRINTF("Tile %d not relaunched: %x\n\r", t, res);
+            return EXIT_FAILURE;
+        }
+    }
+    cycles_relaunch = get_cycles() - start;
+
+    errors = check_tiles();
+    if (errors)
+    {
+        PRINTF("Relaunched copy: %d errors\n\r", errors);
+        return EXIT_FAILURE;
+    }
+
+    PRINTF("%d tiles of %dx%d words\n\r", TILES, TILE_D1, TILE_D2);
+    PRINTF("One at a time: %u cycles\n\r", cycles_seq);
+    PRINTF("Queued:        %u cycles\n\r", cycles_queue);
+    PRINTF("Relaunched:    %u cycles\n\r", cycles_relaunch);
+    PRINTF("Queue: %u pushed, %u rejected, max depth %u, avg depth %u\n\r",
+           stats.pushed, stats.rejected, stats.max_depth,
+           stats.pushed ? stats.depth_sum / stats.pushed : 0);
+
+    return EXIT_SUCCESS;
+}
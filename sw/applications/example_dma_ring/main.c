@@ -0,0 +1,186 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+//
+// Continuous acquisition of an I2S microphone with a DMA ring: the DMA copies
+// the samples into a buffer of N_WINDOWS windows in circular mode and never
+// stops, while the CPU processes each window in place as soon as it is filled.
+// The consumer is then made too slow on purpose, to check that the windows
+// overwritten before being released are reported as overruns.
+//
+// In simulation, the microphone of the testbench alternately sends
+// 0x8765431 and 0xfedcba9 (or zeros if it is not connected), which is checked.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "core_v_mini_mcu.h"
+#include "x-heep.h"
+#include "i2s.h"
+#include "dma.h"
+#include "dma_sdk.h"
+#include "csr.h"
+#include "hart.h"
+
+#ifdef TARGET_IS_FPGA
+#define I2S_CLK_DIV     8
+#define WIN_SAMPLES     256
+#define WINDOWS_TO_READ 64
+#else
+#define I2S_CLK_DIV     32
+#define WIN_SAMPLES     16
+#define WINDOWS_TO_READ 8
+#endif
+
+#define N_WINDOWS 4
+
+#define TB_SAMPLE_L 0x8765431
+#define TB_SAMPLE_R 0xfedcba9
+
+/* By default, printfs are activated for FPGA and disabled for simulation. */
+#define PRINTF_IN_FPGA 1
+#define PRINTF_IN_SIM 0
+
+#if TARGET_SIM && PRINTF_IN_SIM
+#define PRINTF(fmt, ...) printf(fmt, ##__VA_ARGS__)
+#elif PRINTF_IN_FPGA && !TARGET_SIM
+#define PRINTF(fmt, ...) printf(fmt, ##__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+int32_t ring_buf[N_WINDOWS * WIN_SAMPLES] __attribute__((aligned(4)));
+
+static dma_ring_t ring;
+
+volatile uint32_t windows_filled;
+
+static void on_window(const void *p_window, uint32_t window, void *p_arg)
+{
+    windows_filled = window + 1;
+}
+
+// Check the samples of the testbench, return the peak amplitude
+static int32_t process(const int32_t *samples, int *p_errors)
+{
+    int32_t peak = 0;
+
+    for (int i = 0; i < WIN_SAMPLES; i++)
+    {
+        /* The samples are left-aligned 18-bit values */
+        int32_t s = samples[i] >> 14;
+        peak = (s > peak) ? s : (-s > peak) ? -s : peak;
+
+#ifndef TARGET_IS_FPGA
+        if (samples[i] != 0 && samples[i] != TB_SAMPLE_L && samples[i] != TB_SAMPLE_R)
+        {
+            (*p_errors)++;
+        }
+        else if (i > 0 && samples[i] != 0 && samples[i] == samples[i - 1])
+        {
+            (*p_errors)++;
+        }
+#endif
+    }
+    return peak;
+}
+
+int main(void)
+{
+    int errors = 0;
+    uint32_t overruns = 0;
+    dma_config_flags_t res;
+    const int32_t *window;
+
+    dma_init(NULL);
+    CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+
+    ring = (dma_ring_t){
+        .src = (uint8_t *)I2S_RX_DATA_ADDRESS,
+        .trig = DMA_TRIG_SLOT_I2S,
+        .type = DMA_DATA_TYPE_WORD,
+        .buf = (uint8_t *)ring_buf,
+        .win_du = WIN_SAMPLES,
+        .n_windows = N_WINDOWS,
+        .channel = 0,
+        .cb = on_window,
+    };
+    res = dma_ring_init(&ring);
+    if (res != DMA_CONFIG_OK)
+    {
+        PRINTF("Ring init failed: %x\n\r", res);
+        return EXIT_FAILURE;
+    }
+
+    if (i2s_init(I2S_CLK_DIV, I2S_32_BITS) != kI2sOk)
+    {
+        PRINTF("I2S init failed\n\r");
+        return EXIT_FAILURE;
+    }
+
+    res = dma_ring_start(&ring);
+    if (res != DMA_CONFIG_OK || i2s_rx_start(I2S_BOTH_CH) != kI2sOk)
+    {
+        PRINTF("Start failed: %x\n\r", res);
+        return EXIT_FAILURE;
+    }
+
+    /* A consumer that keeps up: no window is lost */
+    for (int w = 0; w < WINDOWS_TO_READ; w++)
+    {
+        window = dma_ring_acquire(&ring, 1);
+        int32_t peak = process(window, &errors);
+        if (dma_ring_release(&ring) == DMA_CONFIG_OVERRUN)
+        {
+            overruns++;
+        }
+        PRINTF("%d: %d\n\r", w, peak);
+    }
+
+    if (overruns != 0 || ring.stats.overruns != 0)
+    {
+        PRINTF("Unexpected overruns: %u\n\r", ring.stats.overruns);
+        errors++;
+    }
+
+    /*
+     * A consumer that falls behind: while it sleeps the DMA fills all the
+     * windows and goes on, the oldest ones are lost.
+     */
+    uint32_t target = windows_filled + N_WINDOWS + 1;
+    while (windows_filled < target)
+    {
+        CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+        if (windows_filled < target)
+        {
+            wait_for_interrupt();
+        }
+        CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+    }
+
+    window = dma_ring_acquire(&ring, 0);
+    if (window == NULL || ring.stats.overruns == 0)
+    {
+        PRINTF("Overrun not detected\n\r");
+        errors++;
+    }
+    dma_ring_release(&ring);
+
+    /* The microphone keeps sending until the end of the buffer */
+    dma_ring_stop(&ring);
+    i2s_rx_stop();
+
+    PRINTF("windows %u, released %u, overruns %u, max fill %u\n\r",
+           ring.stats.windows, ring.stats.released,
+           ring.stats.overruns, ring.stats.max_fill);
+
+    if (errors)
+    {
+        PRINTF("FAILED: %d errors\n\r", errors);
+        return EXIT_FAILURE;
+    }
+
+    PRINTF("SUCCESS\n\r");
+    return EXIT_SUCCESS;
+}
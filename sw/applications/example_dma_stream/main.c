@@ -0,0 +1,157 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+//
+// Matrix multiplication C = A * B where A and C do not have to fit in the
+// working memory of the kernel: A is streamed through the DMA SDK a block of
+// rows at a time while the CPU multiplies the previous block by B, and the
+// blocks of C are written back by a second channel. The stream runs with
+// double and triple buffering and the time spent in each stage is printed.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "dma.h"
+#include "dma_sdk.h"
+#include "core_v_mini_mcu.h"
+#include "x-heep.h"
+
+/* Size of the matrices and rows of A and C per tile */
+#define N       16
+#define ROWS    2
+#define TILES   (N / ROWS)
+
+/* By default, printfs are activated for FPGA and disabled for simulation. */
+#define PRINTF_IN_FPGA 1
+#define PRINTF_IN_SIM 0
+
+#if TARGET_SIM && PRINTF_IN_SIM
+#define PRINTF(fmt, ...) printf(fmt, ##__VA_ARGS__)
+#elif PRINTF_IN_FPGA && !TARGET_SIM
+#define PRINTF(fmt, ...) printf(fmt, ##__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+int32_t mat_a[N][N] __attribute__((aligned(4)));
+int32_t mat_b[N][N] __attribute__((aligned(4)));
+int32_t mat_c[N][N] __attribute__((aligned(4)));
+
+int32_t in_buf[DMA_STREAM_MAX_BUFS][ROWS][N] __attribute__((aligned(4)));
+int32_t out_buf[DMA_STREAM_MAX_BUFS][ROWS][N] __attribute__((aligned(4)));
+
+dma_stream_t stream;
+
+static void matmul_rows(const void *p_in, void *p_out, uint32_t tile, void *p_arg)
+{
+    const int32_t(*a)[N] = p_in;
+    int32_t(*c)[N] = p_out;
+
+    for (int i = 0; i < ROWS; i++)
+    {
+        for (int j = 0; j < N; j++)
+        {
+            int32_t acc = 0;
+            for (int k = 0; k < N; k++)
+            {
+                acc += a[i][k] * mat_b[k][j];
+            }
+            c[i][j] = acc;
+        }
+    }
+}
+
+static int check_c(void)
+{
+    int errors = 0;
+    for (int i = 0; i < N; i++)
+    {
+        for (int j = 0; j < N; j++)
+        {
+            int32_t acc = 0;
+            for (int k = 0; k < N; k++)
+            {
+                acc += mat_a[i][k] * mat_b[k][j];
+            }
+            if (mat_c[i][j] != acc)
+            {
+                errors++;
+            }
+            mat_c[i][j] = 0;
+        }
+    }
+    return errors;
+}
+
+int main(void)
+{
+    dma_config_flags_t res;
+    int errors;
+
+    for (int i = 0; i < N; i++)
+    {
+        for (int j = 0; j < N; j++)
+        {
+            mat_a[i][j] = i - j;
+            mat_b[i][j] = (i * j) % 7 - 3;
+            mat_c[i][j] = 0;
+        }
+    }
+
+    dma_init(NULL);
+
+    stream.src = (dma_stream_tensor_t){
+        .ptr = (uint8_t *)mat_a,
+        .row_du = N,
+        .tile_d1_du = N,
+        .tile_d2_du = ROWS,
+        .type = DMA_DATA_TYPE_WORD,
+    };
+    stream.dst = (dma_stream_tensor_t){
+        .ptr = (uint8_t *)mat_c,
+        .row_du = N,
+        .tile_d1_du = N,
+        .tile_d2_du = ROWS,
+        .type = DMA_DATA_TYPE_WORD,
+    };
+    for (int b = 0; b < DMA_STREAM_MAX_BUFS; b++)
+    {
+        stream.in_buf[b] = (uint8_t *)in_buf[b];
+        stream.out_buf[b] = (uint8_t *)out_buf[b];
+    }
+    stream.in_channel = 0;
+    stream.out_channel = DMA_CH_NUM > 1 ? 1 : 0;
+    stream.compute = matmul_rows;
+    stream.arg = NULL;
+
+    for (uint8_t n_bufs = 2; n_bufs <= DMA_STREAM_MAX_BUFS; n_bufs++)
+    {
+        stream.n_bufs = n_bufs;
+        res = dma_stream_init(&stream);
+        if (res != DMA_CONFIG_OK)
+        {
+            PRINTF("Stream not valid: %x\n\r", res);
+            return EXIT_FAILURE;
+        }
+
+        res = dma_stream_run(&stream, TILES);
+        if (res != DMA_CONFIG_OK)
+        {
+            PRINTF("Stream failed: %x\n\r", res);
+            return EXIT_FAILURE;
+        }
+
+        errors = check_c();
+        if (errors || stream.stats.tiles != TILES)
+        {
+            PRINTF("%d buffers: %d errors\n\r", n_bufs, errors);
+            return EXIT_FAILURE;
+        }
+
+        PRINTF("%d buffers: %u cycles, compute %u, input stall %u, output stall %u\n\r",
+               n_bufs, stream.stats.total_cycles, stream.stats.compute_cycles,
+               stream.stats.in_stall_cycles, stream.stats.out_stall_cycles);
+    }
+
+    return EXIT_SUCCESS;
+}
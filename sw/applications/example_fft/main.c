@@ -17,6 +17,7 @@
 #include "data.h"
 #include "x-heep.h"
 #include "timer_sdk.h"
+#include "perf_sdk.h"
 #include "fft.h"
 
 /* By default, PRINTs are activated for FPGA and disabled for simulation. */
@@ -63,11 +64,15 @@ int main(void)
     // precompute bit reversed sequence
     get_bit_reversed_seq(bit_reversed_seq_radix2, FFT_LEN, log_floor(FFT_LEN, 2), 2);
 
+    perf_init();
+
     timer_cycles_init();
     timer_start();
+    PERF_REGION_BEGIN("fft_radix2");
 
     iterative_FFT_radix2(A, R_radix_2, FFT_LEN, twiddle_factors_radix2, DECIMAL_BITS, w_real_fixed, w_imag_fixed, xrev, bit_reversed_seq_radix2);
 
+    PERF_REGION_END("fft_radix2");
     radix2_cycles = timer_stop();
 
     for(int i = 0; i < 2 * FFT_LEN; i++){
@@ -94,9 +99,11 @@ int main(void)
 
     timer_cycles_init();
     timer_start();
+    PERF_REGION_BEGIN("fft_radix4");
 
     iterative_FFT_radix4(A, R_radix_4, FFT_LEN, twiddle_factors_radix4, w_real_fixed, w_imag_fixed, xrev, DECIMAL_BITS, bit_reversed_seq_radix4);
     
+    PERF_REGION_END("fft_radix4");
     radix4_cycles = timer_stop();
 
     for(int i = 0; i < 2 * FFT_LEN; i++){
@@ -107,6 +114,7 @@ int main(void)
     }   
 
     PRINTF("Radix-4 FFT took %d cycles\n", radix4_cycles);
+    PERF_PRINT_SUMMARY();
 
     return EXIT_SUCCESS;
 }
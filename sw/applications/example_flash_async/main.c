@@ -0,0 +1,175 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+//
+// A sector of the flash is erased, programmed and read back through the I/O
+// engine of the flash BSP. The three requests are submitted at once and the
+// application keeps computing (a checksum of a RAM buffer) while the engine
+// performs them in the background, moving the data with the DMA and polling
+// the flash from a timer interrupt (from w25q128jw_io_pending() if the
+// peripheral timer is not present). The callbacks record the order in which
+// the requests are done, then the data read back is checked.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "x-heep.h"
+#include "csr.h"
+#include "w25q128jw.h"
+
+/* By default, printfs are activated for FPGA and disabled for simulation. */
+#define PRINTF_IN_FPGA  1
+#define PRINTF_IN_SIM   0
+
+#if TARGET_SIM && PRINTF_IN_SIM
+        #define PRINTF(fmt, ...)    printf(fmt, ## __VA_ARGS__)
+#elif PRINTF_IN_FPGA && !TARGET_SIM
+    #define PRINTF(fmt, ...)    printf(fmt, ## __VA_ARGS__)
+#else
+    #define PRINTF(...)
+#endif
+
+/* Several pages and a few extra bytes */
+#define DATA_LEN (4 * FLASH_PAGE_SIZE + 6)
+
+#define WORK_LEN 256
+
+#ifdef FLASH_LOAD
+// A whole sector, so that the erase does not touch anything else
+uint8_t __attribute__((section(".xheep_data_flash_only"))) __attribute__ ((aligned (FLASH_SECTOR_SIZE))) area[FLASH_SECTOR_SIZE];
+#endif
+
+uint8_t data_out[DATA_LEN] __attribute__((aligned(4)));
+uint8_t data_in[DATA_LEN] __attribute__((aligned(4)));
+
+uint32_t work[WORK_LEN];
+
+static w25q_io_req_t reqs[3];
+static w25q_io_req_t *done_order[3];
+static volatile uint32_t done_count;
+
+static void on_done(w25q_io_req_t *req, void *arg)
+{
+    done_order[done_count++] = req;
+}
+
+static inline uint32_t get_cycles(void)
+{
+    uint32_t cycles;
+    CSR_READ(CSR_REG_MCYCLE, &cycles);
+    return cycles;
+}
+
+// Some computation to overlap with the flash
+static uint32_t checksum(uint32_t seed)
+{
+    uint32_t sum = seed;
+    for (int i = 0; i < WORK_LEN; i++) {
+        sum = (sum << 5 | sum >> 27) ^ work[i];
+    }
+    return sum;
+}
+
+int main(int argc, char *argv[])
+{
+#ifndef FLASH_LOAD
+    PRINTF("This application is meant to run with the FLASH_LOAD linker script\n");
+    return EXIT_SUCCESS;
+#else
+
+    soc_ctrl_t soc_ctrl;
+    soc_ctrl.base_addr = mmio_region_from_addr((uintptr_t)SOC_CTRL_START_ADDRESS);
+
+    if ( get_spi_flash_mode(&soc_ctrl) == SOC_CTRL_SPI_FLASH_MODE_SPIMEMIO ) {
+        PRINTF("This application cannot work with the memory mapped SPI FLASH"
+            "module - do not use the FLASH_EXEC linker script for this application\n");
+        return EXIT_SUCCESS;
+    }
+
+    if (w25q128jw_init(spi_flash) != FLASH_OK) {
+        PRINTF("Error initializing SPI flash\n");
+        return EXIT_FAILURE;
+    }
+    if (w25q128jw_io_init() != FLASH_OK) {
+        PRINTF("Error initializing the I/O engine\n");
+        return EXIT_FAILURE;
+    }
+    // The engine only enables its own interrupts: enable them globally
+    CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+
+    for (int i = 0; i < DATA_LEN; i++) data_out[i] = i * 7 + 3;
+    for (int i = 0; i < WORK_LEN; i++) work[i] = i * 0x9e3779b9;
+
+    uint32_t flash_addr = (uintptr_t)heep_get_flash_address_offset((uint32_t *)area);
+    uint32_t n_reqs = 0;
+    int errors = 0;
+
+    // Erase the memory only if FPGA is used
+    #ifndef TARGET_SIM
+    reqs[n_reqs++] = (w25q_io_req_t){
+        .op = W25Q_IO_ERASE_4K, .addr = flash_addr, .cb = on_done,
+    };
+    #endif
+    reqs[n_reqs++] = (w25q_io_req_t){
+        .op = W25Q_IO_PROGRAM, .addr = flash_addr, .data = data_out, .length = DATA_LEN, .cb = on_done,
+    };
+    reqs[n_reqs++] = (w25q_io_req_t){
+        .op = W25Q_IO_READ, .addr = flash_addr, .data = data_in, .length = DATA_LEN, .cb = on_done,
+    };
+
+    CSR_CLEAR_BITS(CSR_REG_MCOUNTINHIBIT, 0x1);
+    uint32_t start = get_cycles();
+
+    for (uint32_t i = 0; i < n_reqs; i++) {
+        if (w25q128jw_io_submit(&reqs[i]) != FLASH_OK) {
+            PRINTF("Error submitting request %u\n", i);
+            return EXIT_FAILURE;
+        }
+    }
+    uint32_t cycles_submit = get_cycles() - start;
+
+    // Compute while the flash is busy
+    uint32_t sum = 0, iterations = 0;
+    while (w25q128jw_io_pending()) {
+        sum = checksum(sum);
+        iterations++;
+    }
+    w25q128jw_io_wait();
+    uint32_t cycles_total = get_cycles() - start;
+    w25q128jw_io_deinit();
+
+    for (uint32_t i = 0; i < n_reqs; i++) {
+        if (!reqs[i].done || reqs[i].status != FLASH_OK) {
+            PRINTF("Request %u: done %u, status %u\n", i, reqs[i].done, reqs[i].status);
+            errors++;
+        }
+    }
+    if (done_count != n_reqs) {
+        PRINTF("%u requests done, expected %u\n", done_count, n_reqs);
+        errors++;
+    }
+    for (uint32_t i = 0; i < done_count; i++) {
+        if (done_order[i] != &reqs[i]) {
+            PRINTF("Request %u done out of order\n", i);
+            errors++;
+        }
+    }
+    if (memcmp(data_in, data_out, DATA_LEN) != 0) {
+        PRINTF("Data read back differs\n");
+        errors++;
+    }
+
+    PRINTF("Submitted in %u cycles, done in %u cycles\n", cycles_submit, cycles_total);
+    PRINTF("%u checksums computed meanwhile (%x)\n", iterations, sum);
+
+    if (errors) {
+        PRINTF("FAILED\n");
+        return EXIT_FAILURE;
+    }
+    PRINTF("All tests passed!\n");
+    return EXIT_SUCCESS;
+
+#endif
+}
@@ -0,0 +1,194 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+//
+// A lookup table stored only in the flash is read many times in small pieces,
+// first directly with the BSP (a full flash command for each read), then
+// through the flash cache. The values are compared, and the cycles and the
+// statistics of the cache are reported. Finally, a part of the flash that is
+// cached is rewritten, to check that the cache does not return stale data.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "x-heep.h"
+#include "csr.h"
+#include "w25q128jw.h"
+#include "w25q_cache.h"
+
+/* By default, printfs are activated for FPGA and disabled for simulation. */
+#define PRINTF_IN_FPGA  1
+#define PRINTF_IN_SIM   0
+
+#if TARGET_SIM && PRINTF_IN_SIM
+        #define PRINTF(fmt, ...)    printf(fmt, ## __VA_ARGS__)
+#elif PRINTF_IN_FPGA && !TARGET_SIM
+    #define PRINTF(fmt, ...)    printf(fmt, ## __VA_ARGS__)
+#else
+    #define PRINTF(...)
+#endif
+
+#define LUT_LEN  256
+#define LOOKUPS  128
+#define LOOKUP_WORDS 3
+
+/* 4 sets of 2 ways: 2 KiB of RAM */
+#define CACHE_SETS 4
+#define CACHE_WAYS 2
+
+#ifdef FLASH_LOAD
+// One period of a sine, in Q15
+int32_t __attribute__((section(".xheep_data_flash_only"))) __attribute__ ((aligned (16))) lut[LUT_LEN] = {
+         0,    804,   1608,   2410,   3212,   4011,   4808,   5602,
+      6393,   7179,   7962,   8739,   9512,  10278,  11039,  11793,
+     12539,  13279,  14010,  14732,  15446,  16151,  16846,  17530,
+     18204,  18868,  19519,  20159,  20787,  21403,  22005,  22594,
+     23170,  23731,  24279,  24811,  25329,  25832,  26319,  26790,
+     27245,  27683,  28105,  28510,  28898,  29268,  29621,  29956,
+     30273,  30571,  30852,  31113,  31356,  31580,  31785,  31971,
+     32137,  32285,  32412,  32521,  32609,  32678,  32728,  32757,
+     32767,  32757,  32728,  32678,  32609,  32521,  32412,  32285,
+     32137,  31971,  31785,  31580,  31356,  31113,  30852,  30571,
+     30273,  29956,  29621,  29268,  28898,  28510,  28105,  27683,
+     27245,  26790,  26319,  25832,  25329,  24811,  24279,  23731,
+     23170,  22594,  22005,  21403,  20787,  20159,  19519,  18868,
+     18204,  17530,  16846,  16151,  15446,  14732,  14010,  13279,
+     12539,  11793,  11039,  10278,   9512,   8739,   7962,   7179,
+      6393,   5602,   4808,   4011,   3212,   2410,   1608,    804,
+         0,   -804,  -1608,  -2410,  -3212,  -4011,  -4808,  -5602,
+     -6393,  -7179,  -7962,  -8739,  -9512, -10278, -11039, -11793,
+    -12539, -13279, -14010, -14732, -15446, -16151, -16846, -17530,
+    -18204, -18868, -19519, -20159, -20787, -21403, -22005, -22594,
+    -23170, -23731, -24279, -24811, -25329, -25832, -26319, -26790,
+    -27245, -27683, -28105, -28510, -28898, -29268, -29621, -29956,
+    -30273, -30571, -30852, -31113, -31356, -31580, -31785, -31971,
+    -32137, -32285, -32412, -32521, -32609, -32678, -32728, -32757,
+    -32767, -32757, -32728, -32678, -32609, -32521, -32412, -32285,
+    -32137, -31971, -31785, -31580, -31356, -31113, -30852, -30571,
+    -30273, -29956, -29621, -29268, -28898, -28510, -28105, -27683,
+    -27245, -26790, -26319, -25832, -25329, -24811, -24279, -23731,
+    -23170, -22594, -22005, -21403, -20787, -20159, -19519, -18868,
+    -18204, -17530, -16846, -16151, -15446, -14732, -14010, -13279,
+    -12539, -11793, -11039, -10278,  -9512,  -8739,  -7962,  -7179,
+     -6393,  -5602,  -4808,  -4011,  -3212,  -2410,  -1608,   -804
+};
+
+// Rewritten while it is cached
+int32_t __attribute__((section(".xheep_data_flash_only"))) __attribute__ ((aligned (16))) scratch[16] = {
+    1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16,
+};
+#endif
+
+uint32_t cache_lines[CACHE_SETS * CACHE_WAYS * W25Q_CACHE_LINE_SIZE / 4];
+w25q_cache_tag_t cache_tags[CACHE_SETS * CACHE_WAYS];
+
+int32_t direct[LOOKUPS][LOOKUP_WORDS];
+int32_t cached[LOOKUPS][LOOKUP_WORDS];
+
+static inline uint32_t get_cycles(void)
+{
+    uint32_t cycles;
+    CSR_READ(CSR_REG_MCYCLE, &cycles);
+    return cycles;
+}
+
+// Index of the i-th lookup: mostly close to the previous one
+static uint32_t lookup_index(uint32_t i)
+{
+    return (i * 5 + (i / 16) * 37) % (LUT_LEN - LOOKUP_WORDS);
+}
+
+int main(int argc, char *argv[])
+{
+#ifndef FLASH_LOAD
+    PRINTF("This application is meant to run with the FLASH_LOAD linker script\n");
+    return EXIT_SUCCESS;
+#else
+
+    soc_ctrl_t soc_ctrl;
+    soc_ctrl.base_addr = mmio_region_from_addr((uintptr_t)SOC_CTRL_START_ADDRESS);
+
+    if ( get_spi_flash_mode(&soc_ctrl) == SOC_CTRL_SPI_FLASH_MODE_SPIMEMIO ) {
+        PRINTF("This application cannot work with the memory mapped SPI FLASH"
+            "module - do not use the FLASH_EXEC linker script for this application\n");
+        return EXIT_SUCCESS;
+    }
+
+    if (w25q128jw_init(spi_flash) != FLASH_OK) {
+        PRINTF("Error initializing SPI flash\n");
+        return EXIT_FAILURE;
+    }
+
+    const w25q_cache_config_t config = {
+        .lines     = cache_lines,
+        .tags      = cache_tags,
+        .sets      = CACHE_SETS,
+        .ways      = CACHE_WAYS,
+        .readahead = 1,
+    };
+    if (w25q_cache_init(&config) != FLASH_OK) {
+        PRINTF("Error initializing the cache\n");
+        return EXIT_FAILURE;
+    }
+
+    CSR_CLEAR_BITS(CSR_REG_MCOUNTINHIBIT, 0x1);
+
+    uint32_t lut_addr = (uintptr_t)heep_get_flash_address_offset((uint32_t *)lut);
+    uint32_t start, cycles_direct, cycles_cached;
+    int errors = 0;
+
+    start = get_cycles();
+    for (uint32_t i = 0; i < LOOKUPS; i++) {
+        uint32_t addr = lut_addr + lookup_index(i) * 4;
+        if (w25q128jw_read(addr, direct[i], sizeof(direct[i])) != FLASH_OK) return EXIT_FAILURE;
+    }
+    cycles_direct = get_cycles() - start;
+
+    start = get_cycles();
+    for (uint32_t i = 0; i < LOOKUPS; i++) {
+        uint32_t addr = lut_addr + lookup_index(i) * 4;
+        if (w25q_cache_read(addr, cached[i], sizeof(cached[i])) != FLASH_OK) return EXIT_FAILURE;
+    }
+    cycles_cached = get_cycles() - start;
+
+    if (memcmp(direct, cached, sizeof(direct)) != 0) {
+        PRINTF("Cached lookups differ\n");
+        errors++;
+    }
+
+    w25q_cache_stats_t stats;
+    w25q_cache_get_stats(&stats);
+    PRINTF("%d lookups: direct %u cycles, cached %u cycles\n", LOOKUPS, cycles_direct, cycles_cached);
+    PRINTF("hits %u, misses %u, prefetched %u, flash reads %u\n",
+           stats.hits, stats.misses, stats.prefetched, stats.bursts);
+    if (stats.bursts >= LOOKUPS) {
+        errors++;
+    }
+
+    // A write must invalidate the cached copy
+    uint32_t scratch_addr = (uintptr_t)heep_get_flash_address_offset((uint32_t *)scratch);
+    int32_t old_values[16], new_values[16], read_back[16];
+
+    if (w25q_cache_read(scratch_addr, old_values, sizeof(old_values)) != FLASH_OK) return EXIT_FAILURE;
+    for (int i = 0; i < 16; i++) {
+        new_values[i] = ~old_values[i];
+    }
+    if (w25q128jw_write(scratch_addr, new_values, sizeof(new_values), 1) != FLASH_OK) return EXIT_FAILURE;
+    if (w25q_cache_read(scratch_addr, read_back, sizeof(read_back)) != FLASH_OK) return EXIT_FAILURE;
+
+    if (memcmp(read_back, new_values, sizeof(new_values)) != 0) {
+        PRINTF("Stale data after a write\n");
+        errors++;
+    }
+
+    if (errors) {
+        PRINTF("FAILED\n");
+        return EXIT_FAILURE;
+    }
+    PRINTF("All tests passed!\n");
+    return EXIT_SUCCESS;
+
+#endif
+}
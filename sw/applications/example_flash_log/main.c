@@ -0,0 +1,181 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+//
+// Samples of a few sensors are logged in the flash with the log-structured
+// store of the flash BSP, one record per sample, keyed by sensor. The log
+// spans a few sectors and more samples are written than fit in it, so the
+// oldest sectors are garbage collected along the way. The latest sample of
+// each sensor and the history still in the log are checked, before and after
+// mounting the log again, and the sector erases are compared with the ones
+// a read-erase-write of each sample would cost.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "x-heep.h"
+#include "w25q128jw.h"
+#include "w25q_log.h"
+
+/* By default, printfs are activated for FPGA and disabled for simulation. */
+#define PRINTF_IN_FPGA  1
+#define PRINTF_IN_SIM   0
+
+#if TARGET_SIM && PRINTF_IN_SIM
+        #define PRINTF(fmt, ...)    printf(fmt, ## __VA_ARGS__)
+#elif PRINTF_IN_FPGA && !TARGET_SIM
+    #define PRINTF(fmt, ...)    printf(fmt, ## __VA_ARGS__)
+#else
+    #define PRINTF(...)
+#endif
+
+#define LOG_SECTORS 4
+#define SENSORS     4
+#define SAMPLES     400
+#define CHANNELS    8
+
+typedef struct {
+    uint32_t seq;
+    int16_t values[CHANNELS];
+} sample_t;
+
+#ifdef FLASH_LOAD
+// Whole sectors, so that the log does not erase anything else
+uint8_t __attribute__((section(".xheep_data_flash_only"))) __attribute__ ((aligned (FLASH_SECTOR_SIZE))) area[LOG_SECTORS * FLASH_SECTOR_SIZE];
+#endif
+
+typedef struct {
+    uint32_t records[SENSORS];
+    uint32_t last_seq[SENSORS];
+    uint32_t errors;
+} history_t;
+
+static void make_sample(sample_t *s, uint32_t seq)
+{
+    s->seq = seq;
+    for (int c = 0; c < CHANNELS; c++) {
+        s->values[c] = (int16_t)(seq * 31 + c * 7);
+    }
+}
+
+// Records of a sensor must come in the order they were logged
+static void on_record(uint16_t key, uint32_t addr, uint16_t length, void *arg)
+{
+    history_t *h = (history_t *)arg;
+    sample_t s;
+
+    if (key >= SENSORS || length != sizeof(s) || w25q128jw_read(addr, &s, sizeof(s)) != FLASH_OK) {
+        h->errors++;
+        return;
+    }
+    if (h->records[key] > 0 && s.seq <= h->last_seq[key]) h->errors++;
+    if (s.seq % SENSORS != key) h->errors++;
+    h->records[key]++;
+    h->last_seq[key] = s.seq;
+}
+
+// The latest sample of each sensor, and the history
+static int check_log(w25q_log_t *log, uint32_t samples)
+{
+    history_t h = {0};
+    sample_t s, expected;
+    int errors = 0;
+
+    for (uint32_t k = 0; k < SENSORS; k++) {
+        make_sample(&expected, samples - SENSORS + k);
+        if (w25q_log_get(log, k, &s, sizeof(s), NULL) != FLASH_OK || memcmp(&s, &expected, sizeof(s)) != 0) {
+            PRINTF("Sensor %u: wrong latest sample\n", k);
+            errors++;
+        }
+    }
+
+    w25q_log_foreach(log, on_record, &h);
+    if (h.errors) {
+        PRINTF("%u errors in the history\n", h.errors);
+        errors++;
+    }
+    for (uint32_t k = 0; k < SENSORS; k++) {
+        PRINTF("Sensor %u: %u samples in the log\n", k, h.records[k]);
+        if (h.records[k] == 0 || h.last_seq[k] != samples - SENSORS + k) errors++;
+    }
+
+    return errors;
+}
+
+int main(int argc, char *argv[])
+{
+#ifndef FLASH_LOAD
+    PRINTF("This application is meant to run with the FLASH_LOAD linker script\n");
+    return EXIT_SUCCESS;
+#else
+
+    soc_ctrl_t soc_ctrl;
+    soc_ctrl.base_addr = mmio_region_from_addr((uintptr_t)SOC_CTRL_START_ADDRESS);
+
+    if ( get_spi_flash_mode(&soc_ctrl) == SOC_CTRL_SPI_FLASH_MODE_SPIMEMIO ) {
+        PRINTF("This application cannot work with the memory mapped SPI FLASH"
+            "module - do not use the FLASH_EXEC linker script for this application\n");
+        return EXIT_SUCCESS;
+    }
+
+    if (w25q128jw_init(spi_flash) != FLASH_OK) {
+        PRINTF("Error initializing SPI flash\n");
+        return EXIT_FAILURE;
+    }
+
+    static w25q_log_t log;
+    log.base = (uintptr_t)heep_get_flash_address_offset((uint32_t *)area);
+    log.sectors = LOG_SECTORS;
+
+    // Start from an empty log, whatever a previous run left
+    if (w25q_log_mount(&log) != FLASH_OK || w25q_log_format(&log) != FLASH_OK) {
+        PRINTF("Error mounting the log\n");
+        return EXIT_FAILURE;
+    }
+    uint32_t erases = log.stats.erases;
+
+    sample_t s;
+    for (uint32_t i = 0; i < SAMPLES; i++) {
+        make_sample(&s, i);
+        if (w25q_log_append(&log, i % SENSORS, &s, sizeof(s)) != FLASH_OK) {
+            PRINTF("Error logging sample %u\n", i);
+            return EXIT_FAILURE;
+        }
+    }
+    erases = log.stats.erases - erases;
+
+    int errors = check_log(&log, SAMPLES);
+
+    PRINTF("%u samples logged with %u sector erases (%u with read-erase-write)\n",
+           log.stats.appends, erases, SAMPLES);
+    PRINTF("%u sectors collected, %u records moved\n", log.stats.collections, log.stats.copied);
+    if (log.stats.collections == 0) errors++;
+
+    // Everything is found again after a reset
+    static w25q_log_t log_again;
+    log_again.base = log.base;
+    log_again.sectors = LOG_SECTORS;
+    if (w25q_log_mount(&log_again) != FLASH_OK) {
+        PRINTF("Error mounting the log again\n");
+        return EXIT_FAILURE;
+    }
+    errors += check_log(&log_again, SAMPLES);
+
+    // A removed sensor has no sample anymore
+    if (w25q_log_remove(&log_again, 0) != FLASH_OK
+        || w25q_log_get(&log_again, 0, &s, sizeof(s), NULL) == FLASH_OK) {
+        PRINTF("Sensor 0 not removed\n");
+        errors++;
+    }
+
+    if (errors) {
+        PRINTF("FAILED\n");
+        return EXIT_FAILURE;
+    }
+    PRINTF("All tests passed!\n");
+    return EXIT_SUCCESS;
+
+#endif
+}
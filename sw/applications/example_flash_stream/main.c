@@ -0,0 +1,147 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+//
+// Weights stored only in the flash are streamed directly to an accelerator,
+// without being staged in RAM: the DMA copies the flash data from the SPI RX
+// FIFO to the input register of the IFFIFO of the testharness, waiting for the
+// FIFO to have space. After each chunk of FIFO depth words, the callback of the
+// stream collects the outputs of the IFFIFO (its input + 1) and accumulates
+// them. The flash is then read into RAM, only to check the result.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "core_v_mini_mcu.h"
+#include "x-heep.h"
+#include "w25q128jw.h"
+#include "iffifo_regs.h"
+#include "mmio.h"
+#include "dma.h"
+
+/* By default, printfs are activated for FPGA and disabled for simulation. */
+#define PRINTF_IN_FPGA  1
+#define PRINTF_IN_SIM   0
+
+#if TARGET_SIM && PRINTF_IN_SIM
+        #define PRINTF(fmt, ...)    printf(fmt, ## __VA_ARGS__)
+#elif PRINTF_IN_FPGA && !TARGET_SIM
+    #define PRINTF(fmt, ...)    printf(fmt, ## __VA_ARGS__)
+#else
+    #define PRINTF(...)
+#endif
+
+#define IFFIFO_START_ADDRESS (EXT_PERIPHERAL_START_ADDRESS + 0x2000)
+#define IFFIFO_DEPTH 4
+
+#define WEIGHTS 64
+
+#ifdef FLASH_LOAD
+int32_t __attribute__((section(".xheep_data_flash_only"))) __attribute__ ((aligned (16))) weights[WEIGHTS] = {
+    0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef,
+    -0x01, -0x23, -0x45, -0x67, -0x89, -0xab, -0xcd, -0xef,
+    0x1000, 0x2000, 0x3000, 0x4000, 0x5000, 0x6000, 0x7000, 0x8000,
+    0x7fff, 0x6fff, 0x5fff, 0x4fff, 0x3fff, 0x2fff, 0x1fff, 0x0fff,
+    3, 1, 4, 1, 5, 9, 2, 6,
+    5, 3, 5, 8, 9, 7, 9, 3,
+    -2, -7, -1, -8, -2, -8, -1, -8,
+    0x12345, 0x23456, 0x34567, 0x45678, 0x56789, 0x6789a, 0x789ab, 0x89abc,
+};
+
+// Only to check the result
+int32_t weights_ram[WEIGHTS];
+#endif
+
+typedef struct {
+    int32_t sum;
+    uint32_t outputs;
+    uint32_t chunks;
+} accumulator_t;
+
+// Called after each chunk: the IFFIFO is full of its outputs
+static void on_chunk(uint32_t offset, void *arg)
+{
+    accumulator_t *acc = (accumulator_t *)arg;
+    mmio_region_t iffifo = mmio_region_from_addr((uintptr_t)IFFIFO_START_ADDRESS);
+
+    for (; acc->outputs < offset / 4; acc->outputs++) {
+        acc->sum += (int32_t)mmio_region_read32(iffifo, IFFIFO_FIFO_OUT_REG_OFFSET);
+    }
+    acc->chunks++;
+}
+
+int main(int argc, char *argv[])
+{
+#ifndef FLASH_LOAD
+    PRINTF("This application is meant to run with the FLASH_LOAD linker script\n");
+    return EXIT_SUCCESS;
+#else
+
+    #ifndef TARGET_SIM
+        PRINTF("This application needs the IFFIFO of the testharness\n");
+        return EXIT_SUCCESS;
+    #endif
+
+    soc_ctrl_t soc_ctrl;
+    soc_ctrl.base_addr = mmio_region_from_addr((uintptr_t)SOC_CTRL_START_ADDRESS);
+
+    if ( get_spi_flash_mode(&soc_ctrl) == SOC_CTRL_SPI_FLASH_MODE_SPIMEMIO ) {
+        PRINTF("This application cannot work with the memory mapped SPI FLASH"
+            "module - do not use the FLASH_EXEC linker script for this application\n");
+        return EXIT_SUCCESS;
+    }
+
+    if (w25q128jw_init(spi_flash) != FLASH_OK) {
+        PRINTF("Error initializing SPI flash\n");
+        return EXIT_FAILURE;
+    }
+
+    uint32_t flash_addr = (uintptr_t)heep_get_flash_address_offset((uint32_t *)weights);
+    accumulator_t acc = {0};
+    int errors = 0;
+
+    // The chunks fill the FIFO, the callback empties it
+    const w25q_stream_t stream = {
+        .dst      = (volatile void *)(IFFIFO_START_ADDRESS + IFFIFO_FIFO_IN_REG_OFFSET),
+        .dst_inc  = 0,
+        .dst_trig = DMA_TRIG_SLOT_EXT_TX,
+        .chunk    = IFFIFO_DEPTH * 4,
+        .cb       = on_chunk,
+        .arg      = &acc,
+        .quad     = 1,
+    };
+
+    if (w25q128jw_stream_dma(flash_addr, sizeof(weights), &stream) != FLASH_OK) {
+        PRINTF("Error streaming from flash\n");
+        return EXIT_FAILURE;
+    }
+
+    // Golden model
+    if (w25q128jw_read_quad_dma(flash_addr, weights_ram, sizeof(weights)) != FLASH_OK) {
+        PRINTF("Error reading from flash\n");
+        return EXIT_FAILURE;
+    }
+    int32_t golden = 0;
+    for (int i = 0; i < WEIGHTS; i++) {
+        golden += weights_ram[i] + 1;
+    }
+
+    if (acc.outputs != WEIGHTS || acc.chunks != WEIGHTS / IFFIFO_DEPTH) {
+        PRINTF("%u outputs in %u chunks\n", acc.outputs, acc.chunks);
+        errors++;
+    }
+    if (acc.sum != golden) {
+        PRINTF("Sum %d, expected %d\n", acc.sum, golden);
+        errors++;
+    }
+
+    if (errors) {
+        PRINTF("FAILED\n");
+        return EXIT_FAILURE;
+    }
+    PRINTF("All tests passed!\n");
+    return EXIT_SUCCESS;
+
+#endif
+}
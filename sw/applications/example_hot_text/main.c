@@ -0,0 +1,101 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+//
+// The same FIR filter is compiled twice, once marked with HOT_TEXT. Built
+// with the flash_exec linker script, the marked one is copied to the RAM by
+// the crt0 and runs from there while the other one runs from the flash. The
+// outputs are compared and the cycles of both are printed. With the other
+// linker scripts both run from the RAM.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "x-heep.h"
+#include "csr.h"
+#include "core_v_mini_mcu.h"
+#include "hot_text.h"
+
+/* By default, printfs are activated for FPGA and disabled for simulation. */
+#define PRINTF_IN_FPGA  1
+#define PRINTF_IN_SIM   0
+
+#if TARGET_SIM && PRINTF_IN_SIM
+        #define PRINTF(fmt, ...)    printf(fmt, ## __VA_ARGS__)
+#elif PRINTF_IN_FPGA && !TARGET_SIM
+    #define PRINTF(fmt, ...)    printf(fmt, ## __VA_ARGS__)
+#else
+    #define PRINTF(...)
+#endif
+
+#define TAPS        16
+#define SAMPLES     256
+
+int32_t coeffs[TAPS];
+int32_t input[SAMPLES + TAPS - 1];
+int32_t out_cold[SAMPLES];
+int32_t out_hot[SAMPLES];
+
+#define FIR_BODY                                            \
+    for (int n = 0; n < len; n++) {                         \
+        int32_t acc = 0;                                    \
+        for (int k = 0; k < TAPS; k++) {                    \
+            acc += x[n + k] * h[k];                         \
+        }                                                   \
+        y[n] = acc >> 8;                                    \
+    }
+
+static void __attribute__((noinline)) fir_cold(const int32_t* x, const int32_t* h, int32_t* y, int len)
+{
+    FIR_BODY
+}
+
+HOT_TEXT static void __attribute__((noinline)) fir_hot(const int32_t* x, const int32_t* h, int32_t* y, int len)
+{
+    FIR_BODY
+}
+
+static inline uint32_t get_cycles(void)
+{
+    uint32_t cycles;
+    CSR_READ(CSR_REG_MCYCLE, &cycles);
+    return cycles;
+}
+
+int main(int argc, char *argv[])
+{
+    CSR_CLEAR_BITS(CSR_REG_MCOUNTINHIBIT, 0x1);
+
+    for (int k = 0; k < TAPS; k++) coeffs[k] = (k + 1) * (TAPS - k);
+    for (int i = 0; i < SAMPLES + TAPS - 1; i++) input[i] = (int32_t)(i * 0x9e3779b9u) >> 20;
+
+    uint32_t start, cycles_cold, cycles_hot;
+
+    start = get_cycles();
+    fir_cold(input, coeffs, out_cold, SAMPLES);
+    cycles_cold = get_cycles() - start;
+
+    start = get_cycles();
+    fir_hot(input, coeffs, out_hot, SAMPLES);
+    cycles_hot = get_cycles() - start;
+
+    for (int i = 0; i < SAMPLES; i++) {
+        if (out_cold[i] != out_hot[i]) {
+            PRINTF("Outputs differ at %d\n", i);
+            return EXIT_FAILURE;
+        }
+    }
+
+#ifdef FLASH_EXEC
+    // The hot function must have been linked in the RAM, the cold one in the flash
+    if ((uintptr_t)fir_hot >= FLASH_MEM_START_ADDRESS || (uintptr_t)fir_cold < FLASH_MEM_START_ADDRESS) {
+        PRINTF("fir_hot at %p, fir_cold at %p\n", fir_hot, fir_cold);
+        return EXIT_FAILURE;
+    }
+#endif
+
+    PRINTF("FIR of %d samples: cold %u cycles, hot %u cycles\n", SAMPLES, cycles_cold, cycles_hot);
+    PRINTF("All tests passed!\n");
+    return EXIT_SUCCESS;
+}
@@ -24,6 +24,7 @@
 
 #include "dma.h"
 #include "dma_regs.h"
+#include "dma_sdk.h"
 #include "fast_intr_ctrl.h"
 
 
@@ -44,6 +45,16 @@ unsigned int IFFIFO_START_ADDRESS = EXT_PERIPHERAL_START_ADDRESS + 0x2000;
 int32_t to_fifo  [6]   __attribute__ ((aligned (4)))  = { 1, 2, 3, 4, 5, 6 };
 int32_t from_fifo[4]   __attribute__ ((aligned (4)))  = { 0, 0, 0, 0 };
 
+// Buffer streamed through the FIFO by the CPU and by a DMA pipeline
+#define IFFIFO_DEPTH 4
+#define PIPE_LEN     64
+
+int32_t pipe_in [PIPE_LEN] __attribute__ ((aligned (4)));
+int32_t pipe_cpu[PIPE_LEN] __attribute__ ((aligned (4)));
+int32_t pipe_dma[PIPE_LEN] __attribute__ ((aligned (4)));
+
+static dma_pipe_t pipe;
+
 int8_t dma_intr_flag = 0;
 void dma_intr_handler_trans_done(uint8_t channel)
 {
@@ -105,6 +116,63 @@ int is_iffifo_full(void)
   return status & (1 << IFFIFO_STATUS_FULL_BIT);
 }
 
+static inline uint32_t get_cycles(void)
+{
+  uint32_t cycles;
+  CSR_READ(CSR_REG_MCYCLE, &cycles);
+  return cycles;
+}
+
+int pipe_benchmark(void)
+{
+  mmio_region_t iffifo_base_addr = mmio_region_from_addr((uintptr_t)IFFIFO_START_ADDRESS);
+  uint32_t start, cycles_cpu;
+  int errors = 0;
+
+  for (int i = 0; i < PIPE_LEN; i++) {
+    pipe_in[i] = i * 3;
+  }
+
+  CSR_CLEAR_BITS(CSR_REG_MCOUNTINHIBIT, 0x1);
+
+  // CPU: fill the FIFO and drain it, one FIFO depth at a time
+  start = get_cycles();
+  for (int i = 0; i < PIPE_LEN; i += IFFIFO_DEPTH) {
+    for (int j = 0; j < IFFIFO_DEPTH; j++) {
+      mmio_region_write32(iffifo_base_addr, IFFIFO_FIFO_IN_REG_OFFSET, pipe_in[i + j]);
+    }
+    for (int j = 0; j < IFFIFO_DEPTH; j++) {
+      pipe_cpu[i + j] = mmio_region_read32(iffifo_base_addr, IFFIFO_FIFO_OUT_REG_OFFSET);
+    }
+  }
+  cycles_cpu = get_cycles() - start;
+
+  // DMA: the slots of the IFFIFO only reach channel 0, so both legs share it
+  dma_init(NULL);
+  pipe = (dma_pipe_t){
+    .kind          = DMA_PIPE_BUS_FIFO,
+    .in_type       = DMA_DATA_TYPE_WORD,
+    .out_type      = DMA_DATA_TYPE_WORD,
+    .fifo_in       = (uint8_t *)(IFFIFO_START_ADDRESS + IFFIFO_FIFO_IN_REG_OFFSET),
+    .fifo_out      = (uint8_t *)(IFFIFO_START_ADDRESS + IFFIFO_FIFO_OUT_REG_OFFSET),
+    .in_block_du   = 1,
+    .out_block_du  = 1,
+    .fifo_depth_du = IFFIFO_DEPTH,
+    .tx_channel    = 0,
+    .rx_channel    = 0,
+  };
+  if (dma_pipe_init(&pipe) != DMA_CONFIG_OK) {return -1;}
+  if (dma_pipe_run(&pipe, pipe_in, PIPE_LEN, pipe_dma, PIPE_LEN) != DMA_CONFIG_OK) {return -1;}
+
+  for (int i = 0; i < PIPE_LEN; i++) {
+    if (pipe_cpu[i] != pipe_in[i] + 1 || pipe_dma[i] != pipe_in[i] + 1) {++errors;}
+  }
+
+  PRINTF("%d words through the FIFO: CPU %u cycles, DMA pipeline %u cycles (%u transactions)\n",
+         PIPE_LEN, cycles_cpu, pipe.stats.cycles, pipe.stats.transactions);
+  return errors;
+}
+
 int main(int argc, char *argv[]) {
 
     mmio_region_t iffifo_base_addr = mmio_region_from_addr((uintptr_t)IFFIFO_START_ADDRESS);
@@ -201,6 +269,8 @@ int main(int argc, char *argv[]) {
     
     if (!iffifo_intr_flag) {return EXIT_FAILURE;};
     
+    if (pipe_benchmark() != 0) {return EXIT_FAILURE;};
+
     return EXIT_SUCCESS;
     
 }
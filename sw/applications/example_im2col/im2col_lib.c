@@ -27,7 +27,6 @@
 data_t output_data[OH_NCHW*OW_NCHW];
 data_t* input_image_ptr = &input_image_nchw[0];
 data_t* output_data_ptr = &output_data[0];
-dma *trash_peri = dma_peri(2);
 
 char im2col_done = 0;
 int ifr_status;
@@ -59,12 +58,12 @@ void dma_run(dma_trans_t * trans)
     res = dma_launch(trans);
     PRINTF_DEB("DMA launch result: %d\n\r", res);
 
-    while( ! dma_is_ready(0)) {
+    while( ! dma_is_ready(trans->channel)) {
         /* Disable_interrupts */
         /* This does not prevent waking up the core as this is controlled by the MIP register */
         
         CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
-        if ( dma_is_ready(0) == 0 ) {
+        if ( dma_is_ready(trans->channel) == 0 ) {
             asm volatile("wfi");
             /* From here the core wakes up even if we did not jump to the ISR */
         }
@@ -216,6 +215,12 @@ int im2col_nchw_int32(uint8_t test_id, unsigned int *cycles)
         /* The DMA is initialized (i.e. Any current transaction is cleaned.) */
         dma_init(NULL); 
 
+        /* Any free channel can be used */
+        if (dma_channel_acquire(DMA_CH_PRIO_NORMAL, 0, &trans.channel) != DMA_CONFIG_OK)
+        {
+            return -1;
+        }
+
         w_offset = 0;
         h_offset = 0;
         pad_min_w_offset = LEFT_PAD;
@@ -381,6 +386,8 @@ int im2col_nchw_int32(uint8_t test_id, unsigned int *cycles)
             }     
         }
 
+        dma_channel_release(trans.channel);
+
         #if TIMING  
         *cycles = timer_stop();
         #endif
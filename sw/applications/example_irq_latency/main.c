@@ -0,0 +1,244 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+// Measures the interrupt entry and exit latency, in cycles, of
+// the different interrupt paths of X-HEEP:
+//  - machine timer interrupt, through an INTERRUPT_HANDLER_ABI handler.
+//  - fast interrupt (FIC timer 1), through fast_intr_ctrl.c or through the
+//    fast-path entry if built with COMPILER_FLAGS=-DIRQ_FAST_PATH.
+//  - external interrupt (PLIC GPIO), through the GPIO driver and through a
+//    handler registered directly in the PLIC table (simulation only, GPIOs
+//    30 and 31 are connected in the testbench).
+// The entry latency is measured from right before the interrupt is triggered
+// to the first instruction of the user handler. The exit latency is measured
+// from the last instruction of the user handler to the interrupted code.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "csr.h"
+#include "hart.h"
+#include "handler.h"
+#include "core_v_mini_mcu.h"
+#include "rv_timer.h"
+#include "rv_plic.h"
+#include "gpio.h"
+#include "pad_control.h"
+#include "pad_control_regs.h"
+#include "fast_intr_ctrl.h"
+#include "x-heep.h"
+
+/* By default, printfs are activated for FPGA and simulation. */
+#define PRINTF_IN_FPGA  1
+#define PRINTF_IN_SIM   1
+
+#if TARGET_SIM && PRINTF_IN_SIM
+        #define PRINTF(fmt, ...)    printf(fmt, ## __VA_ARGS__)
+#elif PRINTF_IN_FPGA && !TARGET_SIM
+    #define PRINTF(fmt, ...)    printf(fmt, ## __VA_ARGS__)
+#else
+    #define PRINTF(...)
+#endif
+
+#ifndef RV_PLIC_IS_INCLUDED
+  #error ( "This app does NOT work as the RV_PLIC peripheral is not included" )
+#endif
+
+#define ITERATIONS 8
+
+#define MIE_TIMER_MASK      (1 << 7)
+#define MIE_EXTERNAL_MASK   (1 << 11)
+#define MIE_FIC_TIMER1_MASK (1 << 16)
+
+#ifndef TARGET_IS_FPGA
+    #define GPIO_TB_OUT 30
+    #define GPIO_TB_IN  31
+    #define GPIO_INTR  GPIO_INTR_31
+#endif
+
+typedef struct {
+    uint32_t min;
+    uint32_t max;
+    uint32_t sum;
+} lat_stat_t;
+
+static rv_timer_t timer_0_1;
+
+static volatile uint32_t t_trigger;
+static volatile uint32_t t_handler_in;
+static volatile uint32_t t_handler_out;
+static volatile uint8_t irq_done;
+
+static inline __attribute__((always_inline)) uint32_t get_cycles(void)
+{
+    uint32_t cycles;
+    CSR_READ(CSR_REG_MCYCLE, &cycles);
+    return cycles;
+}
+
+static void stat_reset(lat_stat_t *s)
+{
+    s->min = UINT32_MAX;
+    s->max = 0;
+    s->sum = 0;
+}
+
+static void stat_add(lat_stat_t *s, uint32_t v)
+{
+    if (v < s->min) s->min = v;
+    if (v > s->max) s->max = v;
+    s->sum += v;
+}
+
+static void print_stats(const char *path, lat_stat_t *entry, lat_stat_t *leave)
+{
+    PRINTF("%-14s entry min/avg/max: %4d %4d %4d | exit min/avg/max: %4d %4d %4d\n\r",
+           path,
+           entry->min, entry->sum / ITERATIONS, entry->max,
+           leave->min, leave->sum / ITERATIONS, leave->max);
+}
+
+/* Machine timer interrupt (vector 7), standard interrupt ABI. */
+void __attribute__((aligned(4), interrupt)) handler_irq_timer(void)
+{
+    t_handler_in = get_cycles();
+    rv_timer_irq_clear(&timer_0_1, 0, 0);
+    irq_done = 1;
+    t_handler_out = get_cycles();
+}
+
+/* Fast interrupt of timer 1 (vector 16). */
+void fic_irq_timer_1(void)
+{
+    t_handler_in = get_cycles();
+    rv_timer_irq_clear(&timer_0_1, 1, 0);
+    irq_done = 1;
+    t_handler_out = get_cycles();
+}
+
+#ifndef TARGET_IS_FPGA
+/* GPIO interrupt, through handler_irq_gpio(). */
+static void gpio_handler(void)
+{
+    t_handler_in = get_cycles();
+    gpio_intr_clear_stat(GPIO_TB_IN);
+    irq_done = 1;
+    t_handler_out = get_cycles();
+}
+
+/* GPIO interrupt, registered directly in the PLIC table. */
+static void gpio_handler_direct(uint32_t id)
+{
+    t_handler_in = get_cycles();
+    gpio_intr_clear_stat(GPIO_TB_IN);
+    irq_done = 1;
+    t_handler_out = get_cycles();
+}
+
+static void measure_gpio(lat_stat_t *entry, lat_stat_t *leave)
+{
+    stat_reset(entry);
+    stat_reset(leave);
+    for (int i = 0; i < ITERATIONS; i++) {
+        gpio_write(GPIO_TB_OUT, false);
+        irq_done = 0;
+        t_trigger = get_cycles();
+        gpio_write(GPIO_TB_OUT, true);
+        while (!irq_done);
+        uint32_t t_back = get_cycles();
+        stat_add(entry, t_handler_in - t_trigger);
+        stat_add(leave, t_back - t_handler_out);
+    }
+}
+#endif
+
+static void measure_timer(uint32_t hart, lat_stat_t *entry, lat_stat_t *leave)
+{
+    stat_reset(entry);
+    stat_reset(leave);
+    for (int i = 0; i < ITERATIONS; i++) {
+        irq_done = 0;
+        t_trigger = get_cycles();
+        rv_timer_irq_force(&timer_0_1, hart, 0);
+        while (!irq_done);
+        uint32_t t_back = get_cycles();
+        stat_add(entry, t_handler_in - t_trigger);
+        stat_add(leave, t_back - t_handler_out);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    lat_stat_t entry, leave;
+
+    // Enable and reset the cycle counter
+    CSR_CLEAR_BITS(CSR_REG_MCOUNTINHIBIT, 0x1);
+    CSR_WRITE(CSR_REG_MCYCLE, 0);
+
+#ifdef IRQ_FAST_PATH
+    PRINTF("IRQ latency [cycles], fast-path entry\n\r");
+#else
+    PRINTF("IRQ latency [cycles], default entry\n\r");
+#endif
+
+    // Timer 0 (machine timer) and timer 1 (fast interrupt)
+    mmio_region_t timer_0_1_reg = mmio_region_from_addr(RV_TIMER_AO_START_ADDRESS);
+    rv_timer_init(timer_0_1_reg, (rv_timer_config_t){.hart_count = 2, .comparator_count = 1}, &timer_0_1);
+    rv_timer_irq_enable(&timer_0_1, 0, 0, kRvTimerEnabled);
+    rv_timer_irq_enable(&timer_0_1, 1, 0, kRvTimerEnabled);
+    enable_fast_interrupt(kTimer_1_fic_e, true);
+
+    CSR_SET_BITS(CSR_REG_MIE, MIE_TIMER_MASK | MIE_FIC_TIMER1_MASK | MIE_EXTERNAL_MASK);
+    CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+
+    measure_timer(0, &entry, &leave);
+    print_stats("mtimer", &entry, &leave);
+
+    measure_timer(1, &entry, &leave);
+    print_stats("fic", &entry, &leave);
+
+#ifndef TARGET_IS_FPGA
+    pad_control_t pad_control;
+    pad_control.base_addr = mmio_region_from_addr((uintptr_t)PAD_CONTROL_START_ADDRESS);
+    pad_control_set_mux(&pad_control, (ptrdiff_t)(PAD_CONTROL_PAD_MUX_I2C_SCL_REG_OFFSET), 1);
+    pad_control_set_mux(&pad_control, (ptrdiff_t)(PAD_CONTROL_PAD_MUX_I2C_SDA_REG_OFFSET), 1);
+
+    if (plic_Init() != kPlicOk) {
+        PRINTF("Init PLIC failed\n\r");
+        return EXIT_FAILURE;
+    }
+    plic_irq_set_priority(GPIO_INTR, 1);
+    plic_irq_set_enabled(GPIO_INTR, kPlicToggleEnabled);
+
+    gpio_cfg_t cfg_out = {
+        .pin = GPIO_TB_OUT,
+        .mode = GpioModeOutPushPull
+    };
+    gpio_cfg_t cfg_in = {
+        .pin = GPIO_TB_IN,
+        .mode = GpioModeIn,
+        .en_input_sampling = true,
+        .en_intr = true,
+        .intr_type = GpioIntrEdgeRising
+    };
+    if (gpio_config(cfg_out) != GpioOk || gpio_config(cfg_in) != GpioOk) {
+        PRINTF("GPIO config failed\n\r");
+        return EXIT_FAILURE;
+    }
+
+    gpio_assign_irq_handler(GPIO_INTR, &gpio_handler);
+    measure_gpio(&entry, &leave);
+    print_stats("plic (gpio)", &entry, &leave);
+
+    plic_assign_irq_handler_direct(GPIO_INTR, &gpio_handler_direct);
+    measure_gpio(&entry, &leave);
+    print_stats("plic (direct)", &entry, &leave);
+
+    gpio_write(GPIO_TB_OUT, false);
+#endif
+
+    CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+
+    PRINTF("Done\n\r");
+    return EXIT_SUCCESS;
+}
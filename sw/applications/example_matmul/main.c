@@ -6,6 +6,7 @@
 #include <stdlib.h>
 #include "csr.h"
 #include "x-heep.h"
+#include "perf_sdk.h"
 
 /* By default, printfs are activated for FPGA and disabled for simulation. */
 #define PRINTF_IN_FPGA  1
@@ -70,10 +71,10 @@ int main()
         }
     }
 
-    //enable mcycle csr
-    CSR_CLEAR_BITS(CSR_REG_MCOUNTINHIBIT, 0x1);
+    // enable mcycle, minstret and the stall counters
+    perf_init();
 
-    CSR_WRITE(CSR_REG_MCYCLE, 0);
+    PERF_REGION_BEGIN("matmul");
 
 #ifdef HIGHEST_PERF
     #pragma message ( "single block MatMul is compiled" )
@@ -93,11 +94,13 @@ int main()
     matrixMul_tiled(m_a, m_b, m_c, SIZE);
 #endif
 
-    CSR_READ(CSR_REG_MCYCLE, &cycles);
+    PERF_REGION_END("matmul");
+    cycles = (uint32_t)perf_get_count("matmul", 0);
 
     errors = check_results(m_c, SIZE);
 
     PRINTF("program finished with %d errors and %d cycles\n\r", errors, cycles);
+    PERF_PRINT_SUMMARY();
     return errors;
 }
 
@@ -0,0 +1,202 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+//
+// A table stored only in the flash is read with the SPI SDK, first with the
+// CPU moving the words out of the RX FIFO from the event interrupt, then with
+// the DMA doing it, paced by the RX trigger slot of the SPI. A last read is
+// non-blocking and the application keeps computing (a checksum of a RAM
+// buffer) until its done callback. The data is checked and the cycles of the
+// blocking reads are compared.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "x-heep.h"
+#include "csr.h"
+#include "fast_intr_ctrl.h"
+#include "bitfield.h"
+#include "dma.h"
+#include "w25q128jw.h"
+#include "spi_sdk.h"
+
+/* By default, printfs are activated for FPGA and disabled for simulation. */
+#define PRINTF_IN_FPGA  1
+#define PRINTF_IN_SIM   0
+
+#if TARGET_SIM && PRINTF_IN_SIM
+        #define PRINTF(fmt, ...)    printf(fmt, ## __VA_ARGS__)
+#elif PRINTF_IN_FPGA && !TARGET_SIM
+    #define PRINTF(fmt, ...)    printf(fmt, ## __VA_ARGS__)
+#else
+    #define PRINTF(...)
+#endif
+
+#define TABLE_LEN   256
+#define WORK_LEN    64
+
+#define FC_RD       0x03                // Read Data
+#define FLASH_MAX_FREQ (133*1000*1000)  // Device max spi frequency
+
+#define V(i)   (0x9e3779b9u * ((i) + 1))
+#define V4(i)  V(i), V((i) + 1), V((i) + 2), V((i) + 3)
+#define V16(i) V4(i), V4((i) + 4), V4((i) + 8), V4((i) + 12)
+#define V64(i) V16(i), V16((i) + 16), V16((i) + 32), V16((i) + 48)
+
+#ifdef FLASH_LOAD
+uint32_t __attribute__((section(".xheep_data_flash_only"))) __attribute__ ((aligned (16))) table[TABLE_LEN] = {
+    V64(0), V64(64), V64(128), V64(192),
+};
+#endif
+
+uint32_t data_cpu[TABLE_LEN];
+uint32_t data_dma[TABLE_LEN];
+uint32_t data_dma_nb[TABLE_LEN];
+
+uint32_t work[WORK_LEN];
+
+static volatile uint8_t nb_done;
+
+static void on_done(const uint32_t* txbuffer, uint32_t txlen, uint32_t* rxbuffer, uint32_t rxlen)
+{
+    nb_done = 1;
+}
+
+static inline uint32_t get_cycles(void)
+{
+    uint32_t cycles;
+    CSR_READ(CSR_REG_MCYCLE, &cycles);
+    return cycles;
+}
+
+// Some computation to overlap with the read
+static uint32_t checksum(uint32_t seed)
+{
+    uint32_t sum = seed;
+    for (int i = 0; i < WORK_LEN; i++) {
+        sum = (sum << 5 | sum >> 27) ^ work[i];
+    }
+    return sum;
+}
+
+static int check(uint32_t data[TABLE_LEN])
+{
+    int errors = 0;
+    for (uint32_t i = 0; i < TABLE_LEN; i++) {
+        if (data[i] != V(i)) errors++;
+    }
+    return errors;
+}
+
+int main(int argc, char *argv[])
+{
+#ifndef FLASH_LOAD
+    PRINTF("This application is meant to run with the FLASH_LOAD linker script\n");
+    return EXIT_SUCCESS;
+#else
+
+    soc_ctrl_t soc_ctrl;
+    soc_ctrl.base_addr = mmio_region_from_addr((uintptr_t)SOC_CTRL_START_ADDRESS);
+
+    if ( get_spi_flash_mode(&soc_ctrl) == SOC_CTRL_SPI_FLASH_MODE_SPIMEMIO ) {
+        PRINTF("This application cannot work with the memory mapped SPI FLASH"
+            "module - do not use the FLASH_EXEC linker script for this application\n");
+        return EXIT_SUCCESS;
+    }
+
+    // The flash BSP wakes up the flash, the SDK then configures the SPI
+    if (w25q128jw_init(spi_flash) != FLASH_OK) {
+        PRINTF("Error initializing SPI flash\n");
+        return EXIT_FAILURE;
+    }
+    uint32_t table_addr = (uintptr_t)heep_get_flash_address_offset((uint32_t *)table);
+
+    spi_t spi = spi_init(SPI_IDX_FLASH, SPI_SLAVE(0, FLASH_MAX_FREQ));
+    if (!spi.init) {
+        PRINTF("Failed to initialize spi\n");
+        return EXIT_FAILURE;
+    }
+    // Init DMA, the integrated DMA is used (peri == NULL)
+    dma_init(NULL);
+
+    CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+    CSR_SET_BITS(CSR_REG_MIE, 1 << (16 + kSpiFlash_fic_e));
+    CSR_CLEAR_BITS(CSR_REG_MCOUNTINHIBIT, 0x1);
+
+    for (int i = 0; i < WORK_LEN; i++) work[i] = i * 0x9e3779b9;
+
+    static const spi_segment_t segments[2] = { SPI_SEG_TX(4), SPI_SEG_RX(sizeof(data_cpu)) };
+    // Flash uses Big Endian, CPU Little Endian, hence swap bytes
+    static uint32_t read_byte_cmd;
+    read_byte_cmd = bitfield_byteswap32(table_addr & 0x00ffffff) | FC_RD;
+
+    uint32_t start, cycles_cpu, cycles_dma;
+    int errors = 0;
+
+    // The CPU moves the words
+    start = get_cycles();
+    if (spi_execute(&spi, segments, 2, &read_byte_cmd, data_cpu) != SPI_CODE_OK
+        || spi_get_state(&spi) != SPI_STATE_DONE) return EXIT_FAILURE;
+    cycles_cpu = get_cycles() - start;
+
+    // The DMA moves the words
+    if (spi_set_dma(&spi, true) != SPI_CODE_OK) {
+        PRINTF("Error enabling the DMA\n");
+        return EXIT_FAILURE;
+    }
+    start = get_cycles();
+    if (spi_execute(&spi, segments, 2, &read_byte_cmd, data_dma) != SPI_CODE_OK
+        || spi_get_state(&spi) != SPI_STATE_DONE) return EXIT_FAILURE;
+    cycles_dma = get_cycles() - start;
+
+    // The DMA moves the words while the CPU computes
+    nb_done = 0;
+    if (spi_execute_nb(&spi, segments, 2, &read_byte_cmd, data_dma_nb,
+                       (spi_callbacks_t) { .done_cb = on_done }) != SPI_CODE_OK) {
+        PRINTF("Error launching the non-blocking read\n");
+        return EXIT_FAILURE;
+    }
+    uint32_t sum = 0, iterations = 0;
+    while (!nb_done) {
+        sum = checksum(sum);
+        iterations++;
+    }
+    if (spi_get_state(&spi) != SPI_STATE_DONE) {
+        PRINTF("Non-blocking read failed\n");
+        errors++;
+    }
+
+    // SPI HOST2 has no DMA trigger slots
+    spi_t spi2 = spi_init(SPI_IDX_HOST_2, SPI_SLAVE(0, FLASH_MAX_FREQ));
+    if (spi2.init && spi_set_dma(&spi2, true) != SPI_CODE_DMA_INVAL) {
+        PRINTF("DMA mode accepted on SPI HOST2\n");
+        errors++;
+    }
+
+    if (check(data_cpu)) {
+        PRINTF("CPU read differs\n");
+        errors++;
+    }
+    if (check(data_dma)) {
+        PRINTF("DMA read differs\n");
+        errors++;
+    }
+    if (check(data_dma_nb)) {
+        PRINTF("Non-blocking DMA read differs\n");
+        errors++;
+    }
+
+    PRINTF("Read of %d bytes: CPU %u cycles, DMA %u cycles\n", TABLE_LEN * 4, cycles_cpu, cycles_dma);
+    PRINTF("%u checksums computed during the non-blocking read (%x)\n", iterations, sum);
+
+    if (errors) {
+        PRINTF("FAILED\n");
+        return EXIT_FAILURE;
+    }
+    PRINTF("All tests passed!\n");
+    return EXIT_SUCCESS;
+
+#endif
+}
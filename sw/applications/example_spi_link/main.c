@@ -0,0 +1,166 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+//
+// SPI HOST 1 drives the SPI slave of this same X-HEEP (wired as for
+// example_spi_slave) through the streaming link layer. A buffer larger than
+// what a single command of the SPI slave SDK can move is written and read
+// back, with the CRC-32 trailer, then without restoring the byte order. The
+// CRC written by the link is checked with spi_link_crc32(), as the software of
+// the slave side would do, and a corrupted trailer must make the read fail.
+// The cycles are compared with the word by word transfers of the SPI slave
+// SDK, read in chunks that fit in the RX FIFO.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "x-heep.h"
+#include "csr.h"
+#include "dma.h"
+#include "spi_host.h"
+#include "spi_slave_sdk.h"
+#include "spi_slave_link.h"
+
+/* By default, printfs are activated for FPGA and disabled for simulation. */
+#define PRINTF_IN_FPGA  1
+#define PRINTF_IN_SIM   0
+
+#if TARGET_SIM && PRINTF_IN_SIM
+        #define PRINTF(fmt, ...)    printf(fmt, ## __VA_ARGS__)
+#elif PRINTF_IN_FPGA && !TARGET_SIM
+    #define PRINTF(fmt, ...)    printf(fmt, ## __VA_ARGS__)
+#else
+    #define PRINTF(...)
+#endif
+
+#define DATA_LEN_W      1024
+#define LEGACY_CHUNK_W  32
+#define DUMMY_CYCLES    32
+
+#define V(i) (0x9e3779b9u * ((i) + 1))
+
+uint32_t src[DATA_LEN_W];
+// The data written through the link, followed by its CRC
+uint32_t slave_mem[DATA_LEN_W + 1];
+uint32_t dst[DATA_LEN_W];
+
+static spi_link_t link;
+
+static inline uint32_t get_cycles(void)
+{
+    uint32_t cycles;
+    CSR_READ(CSR_REG_MCYCLE, &cycles);
+    return cycles;
+}
+
+static int check(const uint32_t* data, uint32_t len_w)
+{
+    int errors = 0;
+    for (uint32_t i = 0; i < len_w; i++) {
+        if (data[i] != V(i)) errors++;
+    }
+    return errors;
+}
+
+int main(int argc, char *argv[])
+{
+    if (spi_link_init(&link, spi_host1, 0) != SPI_FLAG_SUCCESS) {
+        PRINTF("Failed to initialize the link\n");
+        return EXIT_FAILURE;
+    }
+    // Init DMA, the integrated DMA is used (peri == NULL)
+    dma_init(NULL);
+
+    CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+    CSR_CLEAR_BITS(CSR_REG_MCOUNTINHIBIT, 0x1);
+
+    for (uint32_t i = 0; i < DATA_LEN_W; i++) src[i] = V(i);
+
+    uint32_t start, cycles_link_wr, cycles_link_rd, cycles_legacy_wr, cycles_legacy_rd;
+    spi_flags_e flag;
+    int errors = 0;
+
+    // Link, byte order restored, with the CRC
+    link.crc = true;
+    start = get_cycles();
+    flag = spi_link_write(&link, (uint8_t*)slave_mem, src, DATA_LEN_W);
+    cycles_link_wr = get_cycles() - start;
+    if (flag != SPI_FLAG_SUCCESS || check(slave_mem, DATA_LEN_W)) {
+        PRINTF("Link write failed (%x)\n", flag);
+        errors++;
+    }
+    if (slave_mem[DATA_LEN_W] != spi_link_crc32(0, src, DATA_LEN_W)) {
+        PRINTF("Wrong CRC written\n");
+        errors++;
+    }
+
+    memset(dst, 0, sizeof(dst));
+    start = get_cycles();
+    flag = spi_link_read(&link, (uint8_t*)slave_mem, dst, DATA_LEN_W);
+    cycles_link_rd = get_cycles() - start;
+    if (flag != SPI_FLAG_SUCCESS || check(dst, DATA_LEN_W)) {
+        PRINTF("Link read failed (%x)\n", flag);
+        errors++;
+    }
+
+    // A corrupted CRC must be detected
+    slave_mem[DATA_LEN_W] ^= 1;
+    if (spi_link_read(&link, (uint8_t*)slave_mem, dst, DATA_LEN_W) != SPI_LINK_FLAG_CRC_MISMATCH) {
+        PRINTF("CRC mismatch not detected\n");
+        errors++;
+    }
+
+    // Link, the DMA moves the user buffers, whose words reach the slave memory byte-reversed
+    link.swap = false;
+    link.crc = false;
+    link.chunk_w = 512;
+    memset(slave_mem, 0, sizeof(slave_mem));
+    memset(dst, 0, sizeof(dst));
+    if (spi_link_write(&link, (uint8_t*)slave_mem, src, DATA_LEN_W) != SPI_FLAG_SUCCESS
+        || slave_mem[1] != REVERT_ENDIANNESS(src[1])
+        || spi_link_read(&link, (uint8_t*)slave_mem, dst, DATA_LEN_W) != SPI_FLAG_SUCCESS
+        || check(dst, DATA_LEN_W)) {
+        PRINTF("Raw link transfers failed\n");
+        errors++;
+    }
+
+    // A misaligned address is refused
+    if (spi_link_write(&link, (uint8_t*)slave_mem + 2, src, 1) != SPI_SLAVE_FLAG_ADDRESS_INVALID) {
+        PRINTF("Misaligned address accepted\n");
+        errors++;
+    }
+
+    // SPI slave SDK, word by word
+    memset(slave_mem, 0, sizeof(slave_mem));
+    memset(dst, 0, sizeof(dst));
+    start = get_cycles();
+    if (spi_slave_write(spi_host1, (uint8_t*)slave_mem, (uint8_t*)src, sizeof(src)) != SPI_FLAG_SUCCESS) {
+        PRINTF("Legacy write failed\n");
+        errors++;
+    }
+    cycles_legacy_wr = get_cycles() - start;
+
+    start = get_cycles();
+    for (uint32_t i = 0; i < DATA_LEN_W; i += LEGACY_CHUNK_W) {
+        spi_slave_request_read(spi_host1, (uint8_t*)&slave_mem[i], LEGACY_CHUNK_W * 4, DUMMY_CYCLES);
+        while (spi_get_status(spi_host1).rxqd < LEGACY_CHUNK_W);
+        spi_copy_words(spi_host1, &dst[i], LEGACY_CHUNK_W);
+    }
+    cycles_legacy_rd = get_cycles() - start;
+    if (check(slave_mem, DATA_LEN_W) || check(dst, DATA_LEN_W)) {
+        PRINTF("Legacy transfers differ\n");
+        errors++;
+    }
+
+    PRINTF("%d words written: link %u cycles, SDK %u cycles\n", DATA_LEN_W, cycles_link_wr, cycles_legacy_wr);
+    PRINTF("%d words read: link %u cycles, SDK %u cycles\n", DATA_LEN_W, cycles_link_rd, cycles_legacy_rd);
+
+    if (errors) {
+        PRINTF("FAILED\n");
+        return EXIT_FAILURE;
+    }
+    PRINTF("All tests passed!\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,180 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+//
+// A table stored only in the flash is read in small pieces, where the time
+// between the segments of each flash command dominates. The pieces are read
+// with the flash BSP, whose reads replay prebuilt SPI programs, then with the
+// SPI SDK, first building the segments of each read with spi_execute(), then
+// replaying a single SPI program built once with spi_program_run(). The data
+// is checked and the cycles of the SDK reads are compared.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "x-heep.h"
+#include "csr.h"
+#include "fast_intr_ctrl.h"
+#include "bitfield.h"
+#include "w25q128jw.h"
+#include "spi_sdk.h"
+
+/* By default, printfs are activated for FPGA and disabled for simulation. */
+#define PRINTF_IN_FPGA  1
+#define PRINTF_IN_SIM   0
+
+#if TARGET_SIM && PRINTF_IN_SIM
+        #define PRINTF(fmt, ...)    printf(fmt, ## __VA_ARGS__)
+#elif PRINTF_IN_FPGA && !TARGET_SIM
+    #define PRINTF(fmt, ...)    printf(fmt, ## __VA_ARGS__)
+#else
+    #define PRINTF(...)
+#endif
+
+#define TABLE_LEN   32
+#define READS       64
+#define READ_WORDS  2
+
+#define FC_RD       0x03                // Read Data
+#define FLASH_MAX_FREQ (133*1000*1000)  // Device max spi frequency
+
+#define V(i) (0x9e3779b9u * ((i) + 1))
+
+#ifdef FLASH_LOAD
+uint32_t __attribute__((section(".xheep_data_flash_only"))) __attribute__ ((aligned (16))) table[TABLE_LEN] = {
+    V(0), V(1), V(2), V(3), V(4), V(5), V(6), V(7),
+    V(8), V(9), V(10), V(11), V(12), V(13), V(14), V(15),
+    V(16), V(17), V(18), V(19), V(20), V(21), V(22), V(23),
+    V(24), V(25), V(26), V(27), V(28), V(29), V(30), V(31),
+};
+#endif
+
+uint32_t data_bsp[READS][READ_WORDS];
+uint32_t data_execute[READS][READ_WORDS];
+uint32_t data_program[READS][READ_WORDS];
+
+static inline uint32_t get_cycles(void)
+{
+    uint32_t cycles;
+    CSR_READ(CSR_REG_MCYCLE, &cycles);
+    return cycles;
+}
+
+// Index of the i-th read in the table
+static uint32_t read_index(uint32_t i)
+{
+    return (i * 7) % (TABLE_LEN - READ_WORDS + 1);
+}
+
+static int check(uint32_t data[READS][READ_WORDS])
+{
+    int errors = 0;
+    for (uint32_t i = 0; i < READS; i++) {
+        for (uint32_t j = 0; j < READ_WORDS; j++) {
+            if (data[i][j] != V(read_index(i) + j)) errors++;
+        }
+    }
+    return errors;
+}
+
+int main(int argc, char *argv[])
+{
+#ifndef FLASH_LOAD
+    PRINTF("This application is meant to run with the FLASH_LOAD linker script\n");
+    return EXIT_SUCCESS;
+#else
+
+    soc_ctrl_t soc_ctrl;
+    soc_ctrl.base_addr = mmio_region_from_addr((uintptr_t)SOC_CTRL_START_ADDRESS);
+
+    if ( get_spi_flash_mode(&soc_ctrl) == SOC_CTRL_SPI_FLASH_MODE_SPIMEMIO ) {
+        PRINTF("This application cannot work with the memory mapped SPI FLASH"
+            "module - do not use the FLASH_EXEC linker script for this application\n");
+        return EXIT_SUCCESS;
+    }
+
+    if (w25q128jw_init(spi_flash) != FLASH_OK) {
+        PRINTF("Error initializing SPI flash\n");
+        return EXIT_FAILURE;
+    }
+
+    CSR_CLEAR_BITS(CSR_REG_MCOUNTINHIBIT, 0x1);
+
+    uint32_t table_addr = (uintptr_t)heep_get_flash_address_offset((uint32_t *)table);
+    uint32_t start, cycles_bsp, cycles_execute, cycles_program;
+    int errors = 0;
+
+    // Flash BSP
+    start = get_cycles();
+    for (uint32_t i = 0; i < READS; i++) {
+        uint32_t addr = table_addr + read_index(i) * 4;
+        if (w25q128jw_read(addr, data_bsp[i], sizeof(data_bsp[i])) != FLASH_OK) return EXIT_FAILURE;
+    }
+    cycles_bsp = get_cycles() - start;
+
+    // The SDK configures the SPI for its own slave from now on
+    spi_t spi = spi_init(SPI_IDX_FLASH, SPI_SLAVE(0, FLASH_MAX_FREQ));
+    if (!spi.init) {
+        PRINTF("Failed to initialize spi\n");
+        return EXIT_FAILURE;
+    }
+    CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+    CSR_SET_BITS(CSR_REG_MIE, 1 << (16 + kSpiFlash_fic_e));
+
+    // SDK, the segments are validated and encoded at each read
+    start = get_cycles();
+    for (uint32_t i = 0; i < READS; i++) {
+        uint32_t addr = table_addr + read_index(i) * 4;
+        spi_segment_t segments[2] = { SPI_SEG_TX(4), SPI_SEG_RX(sizeof(data_execute[i])) };
+        // Flash uses Big Endian, CPU Little Endian, hence swap bytes
+        uint32_t read_byte_cmd = bitfield_byteswap32(addr & 0x00ffffff) | FC_RD;
+        if (spi_execute(&spi, segments, 2, &read_byte_cmd, data_execute[i]) != SPI_CODE_OK
+            || spi_get_state(&spi) != SPI_STATE_DONE) return EXIT_FAILURE;
+    }
+    cycles_execute = get_cycles() - start;
+
+    // SDK, one program built once and replayed with a new address
+    static spi_program_t program;
+    const spi_segment_t segments[2] = { SPI_SEG_TX(4), SPI_SEG_RX(sizeof(data_program[0])) };
+    const uint32_t read_byte_cmd = FC_RD;
+    if (spi_program_build(&program, segments, 2, &read_byte_cmd, 1) != SPI_CODE_OK) {
+        PRINTF("Error building the program\n");
+        return EXIT_FAILURE;
+    }
+
+    start = get_cycles();
+    for (uint32_t i = 0; i < READS; i++) {
+        uint32_t addr = table_addr + read_index(i) * 4;
+        spi_program_set_word(&program, 0, bitfield_byteswap32(addr & 0x00ffffff) | FC_RD);
+        if (spi_program_run(&spi, &program, NULL, data_program[i]) != SPI_CODE_OK
+            || spi_get_state(&spi) != SPI_STATE_DONE) return EXIT_FAILURE;
+    }
+    cycles_program = get_cycles() - start;
+
+    if (check(data_bsp)) {
+        PRINTF("BSP reads differ\n");
+        errors++;
+    }
+    if (check(data_execute)) {
+        PRINTF("spi_execute reads differ\n");
+        errors++;
+    }
+    if (check(data_program)) {
+        PRINTF("spi_program_run reads differ\n");
+        errors++;
+    }
+
+    PRINTF("%d reads of %d bytes: BSP %u cycles\n", READS, READ_WORDS * 4, cycles_bsp);
+    PRINTF("spi_execute %u cycles, spi_program_run %u cycles\n", cycles_execute, cycles_program);
+
+    if (errors) {
+        PRINTF("FAILED\n");
+        return EXIT_FAILURE;
+    }
+    PRINTF("All tests passed!\n");
+    return EXIT_SUCCESS;
+
+#endif
+}
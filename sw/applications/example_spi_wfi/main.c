@@ -0,0 +1,196 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+//
+// Benchmark of the blocking transactions of the SPI SDK, which sleep (wfi)
+// until the SPI events end them. A table stored only in the flash is read
+// with reads of several sizes, timed with the always-on timer (timer_sdk),
+// which keeps counting while the core sleeps, and with mcycle, which does
+// not as the clock of the core is gated. Their difference gives the share of
+// the call the CPU was idle.
+// The wake-up latency is the time from the end of a transaction to the
+// return of the blocking call: the same read is done non-blocking, its done
+// callback marking the end, and its duration is subtracted from the one of
+// the blocking call.
+// Finally, a read given a null timeout must end with SPI_STATE_TIMEOUT.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "x-heep.h"
+#include "csr.h"
+#include "fast_intr_ctrl.h"
+#include "bitfield.h"
+#include "timer_sdk.h"
+#include "w25q128jw.h"
+#include "spi_sdk.h"
+
+/* By default, printfs are activated for FPGA and disabled for simulation. */
+#define PRINTF_IN_FPGA  1
+#define PRINTF_IN_SIM   0
+
+#if TARGET_SIM && PRINTF_IN_SIM
+        #define PRINTF(fmt, ...)    printf(fmt, ## __VA_ARGS__)
+#elif PRINTF_IN_FPGA && !TARGET_SIM
+    #define PRINTF(fmt, ...)    printf(fmt, ## __VA_ARGS__)
+#else
+    #define PRINTF(...)
+#endif
+
+#define TABLE_LEN   1024
+#define RUNS        4
+
+#define FC_RD       0x03                // Read Data
+#define FLASH_MAX_FREQ (133*1000*1000)  // Device max spi frequency
+
+#define V(i)    (0x9e3779b9u * ((i) + 1))
+#define V4(i)   V(i), V((i) + 1), V((i) + 2), V((i) + 3)
+#define V16(i)  V4(i), V4((i) + 4), V4((i) + 8), V4((i) + 12)
+#define V64(i)  V16(i), V16((i) + 16), V16((i) + 32), V16((i) + 48)
+#define V256(i) V64(i), V64((i) + 64), V64((i) + 128), V64((i) + 192)
+
+#ifdef FLASH_LOAD
+uint32_t __attribute__((section(".xheep_data_flash_only"))) __attribute__ ((aligned (16))) table[TABLE_LEN] = {
+    V256(0), V256(256), V256(512), V256(768),
+};
+#endif
+
+// Sizes of the reads, in bytes
+static const uint32_t sizes[] = { 16, 256, 1024, TABLE_LEN * 4 };
+
+uint32_t data[TABLE_LEN];
+
+static volatile uint32_t t_done;
+static volatile uint8_t nb_done;
+
+static void on_done(const uint32_t* txbuffer, uint32_t txlen, uint32_t* rxbuffer, uint32_t rxlen)
+{
+    t_done = timer_get_cycles();
+    nb_done = 1;
+}
+
+static inline uint32_t get_cycles(void)
+{
+    uint32_t cycles;
+    CSR_READ(CSR_REG_MCYCLE, &cycles);
+    return cycles;
+}
+
+static int check(uint32_t len)
+{
+    int errors = 0;
+    for (uint32_t i = 0; i < len / 4; i++) {
+        if (data[i] != V(i)) errors++;
+    }
+    return errors;
+}
+
+int main(int argc, char *argv[])
+{
+#ifndef FLASH_LOAD
+    PRINTF("This application is meant to run with the FLASH_LOAD linker script\n");
+    return EXIT_SUCCESS;
+#else
+
+    soc_ctrl_t soc_ctrl;
+    soc_ctrl.base_addr = mmio_region_from_addr((uintptr_t)SOC_CTRL_START_ADDRESS);
+
+    if ( get_spi_flash_mode(&soc_ctrl) == SOC_CTRL_SPI_FLASH_MODE_SPIMEMIO ) {
+        PRINTF("This application cannot work with the memory mapped SPI FLASH"
+            "module - do not use the FLASH_EXEC linker script for this application\n");
+        return EXIT_SUCCESS;
+    }
+
+    // The flash BSP wakes up the flash, the SDK then configures the SPI
+    if (w25q128jw_init(spi_flash) != FLASH_OK) {
+        PRINTF("Error initializing SPI flash\n");
+        return EXIT_FAILURE;
+    }
+    uint32_t table_addr = (uintptr_t)heep_get_flash_address_offset((uint32_t *)table);
+
+    spi_t spi = spi_init(SPI_IDX_FLASH, SPI_SLAVE(0, FLASH_MAX_FREQ));
+    if (!spi.init) {
+        PRINTF("Failed to initialize spi\n");
+        return EXIT_FAILURE;
+    }
+    CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+    CSR_SET_BITS(CSR_REG_MIE, 1 << (16 + kSpiFlash_fic_e));
+    CSR_CLEAR_BITS(CSR_REG_MCOUNTINHIBIT, 0x1);
+
+    // Wall-clock time, counted by the always-on timer in clock cycles
+    timer_cycles_init();
+    timer_start();
+
+    // Flash uses Big Endian, CPU Little Endian, hence swap bytes
+    static uint32_t read_byte_cmd;
+    read_byte_cmd = bitfield_byteswap32(table_addr & 0x00ffffff) | FC_RD;
+    static spi_segment_t segments[2];
+    int errors = 0;
+
+    PRINTF("bytes | wall cycles | active cycles | idle %% | wake-up latency\n");
+    for (uint32_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        uint32_t wall = 0, active = 0, wall_nb = 0;
+        segments[0] = SPI_SEG_TX(4);
+        segments[1] = SPI_SEG_RX(sizes[s]);
+
+        for (uint32_t r = 0; r < RUNS; r++) {
+            // Blocking read
+            memset(data, 0, sizeof(data));
+            uint32_t t_start = timer_get_cycles();
+            uint32_t c_start = get_cycles();
+            if (spi_execute(&spi, segments, 2, &read_byte_cmd, data) != SPI_CODE_OK
+                || spi_get_state(&spi) != SPI_STATE_DONE) return EXIT_FAILURE;
+            active += get_cycles() - c_start;
+            wall += timer_get_cycles() - t_start;
+            if (check(sizes[s])) {
+                PRINTF("Blocking read of %u bytes differs\n", sizes[s]);
+                errors++;
+            }
+
+            // Same read, non-blocking, to know when the transaction ends
+            memset(data, 0, sizeof(data));
+            nb_done = 0;
+            t_start = timer_get_cycles();
+            if (spi_execute_nb(&spi, segments, 2, &read_byte_cmd, data,
+                               (spi_callbacks_t) { .done_cb = on_done }) != SPI_CODE_OK) return EXIT_FAILURE;
+            while (!nb_done);
+            wall_nb += t_done - t_start;
+            if (check(sizes[s])) {
+                PRINTF("Non-blocking read of %u bytes differs\n", sizes[s]);
+                errors++;
+            }
+        }
+
+        uint32_t idle_permille = wall > active ? (uint64_t)(wall - active) * 1000 / wall : 0;
+        int32_t latency = ((int32_t)wall - (int32_t)wall_nb) / RUNS;
+        PRINTF("%5u | %11u | %13u | %3u.%u | %d cycles\n", sizes[s], wall / RUNS, active / RUNS,
+               idle_permille / 10, idle_permille % 10, latency);
+    }
+
+    // A null timeout cannot be met
+    if (spi_set_timeout(&spi, 0) != SPI_CODE_OK) return EXIT_FAILURE;
+    segments[1] = SPI_SEG_RX(sizeof(data));
+    if (spi_execute(&spi, segments, 2, &read_byte_cmd, data) != SPI_CODE_OK
+        || spi_get_state(&spi) != SPI_STATE_TIMEOUT) {
+        PRINTF("Read did not time out\n");
+        errors++;
+    }
+    // And the SPI is usable again once reset by the timeout
+    if (spi_set_timeout(&spi, SPI_TIMEOUT_DEFAULT) != SPI_CODE_OK) return EXIT_FAILURE;
+    if (spi_execute(&spi, segments, 2, &read_byte_cmd, data) != SPI_CODE_OK
+        || spi_get_state(&spi) != SPI_STATE_DONE || check(sizeof(data))) {
+        PRINTF("Read after the timeout failed\n");
+        errors++;
+    }
+
+    if (errors) {
+        PRINTF("FAILED\n");
+        return EXIT_FAILURE;
+    }
+    PRINTF("All tests passed!\n");
+    return EXIT_SUCCESS;
+
+#endif
+}
@@ -150,10 +150,11 @@ int main(int argc, char *argv[])
     if (status != FLASH_OK) exit(EXIT_FAILURE);
 
     //wait for the DMA to finish in DEEP SLEEP mode
-    while (!dma_is_ready(0))
+    uint8_t channel = w25q128jw_dma_channel();
+    while (!dma_is_ready(channel))
     {
         CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
-        if (dma_is_ready(0) == 0)
+        if (dma_is_ready(channel) == 0)
         {
                 PRINTF("Going to sleep...\r\n");
                 if (power_gate_core(&power_manager, kDma_pm_e, &power_manager_counters) != kPowerManagerOk_e)
@@ -166,6 +167,7 @@ int main(int argc, char *argv[])
         }
         CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
     }
+    w25q128jw_dma_release();
 
 
     PRINTF("Check results...\r\n");
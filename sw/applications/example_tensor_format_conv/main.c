@@ -30,21 +30,14 @@
  *        - Copy the element (4) 
  *        And so on.
  * 
- *        To speed the conversion up, the application makes use of the DMA.
- *        Its transposition function is used in an unconventional way: the d1 increment is set to #channels, while the d2 increment
- *        is set to 1. 
- *        In this way, the DMA will copy H*W elements with a C stride, then start the next copy from the first element + 1, 
- *        and repeat until completion.
- *        This behaviour is similar to a 3D copy, because it performs a copy of a matrix (H*W) with a stride (C), even if 
- *        using just 2 counters. 
- * 
- *        The conversion chw -> hwc is performed in a similar way, but it needs H loops, making it a lot slower than the other type
- *        of conversion.  
+ *        The conversions are performed by the tensor SDK, which uses the transposition function of the DMA:
+ *        a HWC tensor is a (H*W) x C matrix whose transposition is the CHW tensor, and viceversa.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include "dma.h"
+#include "tensor_sdk.h"
 #include "core_v_mini_mcu.h"
 #include "x-heep.h"
 #include "csr.h"
@@ -115,6 +108,9 @@ int hwc_array[36] = {
 
 int convert_hwc_to_chw_int32(int *src, int *dst)
 {
+    int cycles_dma = 0;
+    dma_config_flags_t res;
+
     #ifdef EN_PERF
 
     /* Reset the counter to evaluate the performance of the DMA */
@@ -122,62 +118,25 @@ int convert_hwc_to_chw_int32(int *src, int *dst)
     CSR_WRITE(CSR_REG_MCYCLE, 0);
     #endif
 
-    static dma_target_t tgt_src;
-    static dma_target_t tgt_dst;
-    static dma_trans_t trans;
-    int res_valid, res_load, res_launch, cycles_dma;
-
-    /* Initialize the targets */
-    tgt_src.ptr = (uint8_t *) src;
-    tgt_src.inc_d1_du = 1;
-    tgt_src.inc_d2_du = C;
-    tgt_src.trig = DMA_TRIG_MEMORY;
-    tgt_src.type = DMA_DATA_TYPE_WORD;
-    
-    tgt_dst.ptr = (uint8_t *)  dst;
-    tgt_dst.inc_d1_du = 1;
-    tgt_dst.inc_d2_du = 1;
-    tgt_dst.trig = DMA_TRIG_MEMORY;
-    tgt_dst.type = DMA_DATA_TYPE_WORD;
-
-    trans.src = &tgt_src;
-    trans.dst = &tgt_dst;
-    trans.mode = DMA_TRANS_MODE_SINGLE;
-    trans.dim = DMA_DIM_CONF_2D;
-    trans.dim_inv        = 1; // Enable transposition function
-    trans.size_d1_du     = H * W;
-    trans.size_d2_du     = C;
-    trans.win_du         = 0,
-    trans.end            = DMA_TRANS_END_INTR_WAIT;
-
-    dma_init(NULL);
-
-    res_valid = dma_validate_transaction(&trans, DMA_ENABLE_REALIGN, DMA_PERFORM_CHECKS_INTEGRITY);
-    res_load = dma_load_transaction(&trans);
-    res_launch = dma_launch(&trans);
-    if (res_launch | res_load | res_valid) {
-        PRINTF("Error in the DMA transaction! %d - %d - %d\n", res_valid, res_load, res_launch);
+    res = tensor_hwc_to_chw(src, dst, H, W, C, DMA_DATA_TYPE_WORD);
+    if (res != DMA_CONFIG_OK) {
+        PRINTF("Error in the DMA transaction! %d\n", res);
         exit(1);
     }
-    
+
     #ifdef EN_PERF
 
     /* Read the cycles count after the DMA run */
     CSR_READ(CSR_REG_MCYCLE, &cycles_dma);
-    return cycles_dma;
     #endif
 
-    return 0;
+    return cycles_dma;
 }
 
 int convert_chw_to_hwc_int32(int *src, int *dst)
 {
-    static dma_target_t tgt_src;
-    static dma_target_t tgt_dst;
-    static dma_trans_t trans;
-    int res_valid, res_load, res_launch, cycles_dma;
-    int * src_ptr = src;
-    int * dst_ptr = dst;
+    int cycles_dma = 0;
+    dma_config_flags_t res;
 
     #ifdef EN_PERF
 
@@ -186,53 +145,19 @@ int convert_chw_to_hwc_int32(int *src, int *dst)
     CSR_WRITE(CSR_REG_MCYCLE, 0);
     #endif
 
-    dma_init(NULL);
-
-    for (int i=0; i < H; i++) {
-
-      /* Initialize the targets */
-      tgt_src.ptr = (uint8_t *) src_ptr;
-      tgt_src.inc_d1_du = 1;
-      tgt_src.inc_d2_du = H * W;
-      tgt_src.trig = DMA_TRIG_MEMORY;
-      tgt_src.type = DMA_DATA_TYPE_WORD;
-
-      tgt_dst.ptr = (uint8_t *) dst_ptr;
-      tgt_dst.inc_d1_du = 1;
-      tgt_dst.inc_d2_du = 1;
-      tgt_dst.trig = DMA_TRIG_MEMORY;
-      tgt_dst.type = DMA_DATA_TYPE_WORD;
-
-      trans.src = &tgt_src;
-      trans.dst = &tgt_dst;
-      trans.mode = DMA_TRANS_MODE_SINGLE;
-      trans.dim = DMA_DIM_CONF_2D;
-      trans.dim_inv        = 1; // Enable transposition function
-      trans.size_d1_du     = C;
-      trans.size_d2_du     = W;
-      trans.win_du         = 0,
-      trans.end            = DMA_TRANS_END_INTR_WAIT;
-
-      res_valid = dma_validate_transaction(&trans, DMA_ENABLE_REALIGN, DMA_PERFORM_CHECKS_INTEGRITY);
-      res_load = dma_load_transaction(&trans);
-      res_launch = dma_launch(&trans);
-      if (res_launch | res_load | res_valid) {
-        PRINTF("Error in the DMA transaction! %d - %d - %d\n", res_valid, res_load, res_launch);
+    res = tensor_chw_to_hwc(src, dst, H, W, C, DMA_DATA_TYPE_WORD);
+    if (res != DMA_CONFIG_OK) {
+        PRINTF("Error in the DMA transaction! %d\n", res);
         exit(1);
-      }
-
-      src_ptr += W;
-      dst_ptr += W * C;
     }
 
     #ifdef EN_PERF
 
     /* Read the cycles count after the DMA run */
     CSR_READ(CSR_REG_MCYCLE, &cycles_dma);
-    return cycles_dma;
     #endif
 
-    return 0;
+    return cycles_dma;
 }
 
 int main()
@@ -242,6 +167,9 @@ int main()
     int passed_chw = 1;
     int passed_hwc = 1;
 
+    dma_init(NULL);
+    tensor_init(0, TENSOR_BACKEND_AUTO);
+
     /* Convert HWC to CHW */
     cycles_dma = convert_hwc_to_chw_int32(hwc_array, dst_array);
 
@@ -0,0 +1,168 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+//
+// Cycles taken by the layout operations of the tensor SDK on the layer shapes
+// of a small CNN, performed by the CPU and by the DMA (with the CPU fallback
+// for the blocks that the DMA cannot perform). The results of the two are
+// compared.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tensor_sdk.h"
+#include "dma.h"
+#include "core_v_mini_mcu.h"
+#include "x-heep.h"
+#include "csr.h"
+
+/* Input feature map */
+#define IN_H 12
+#define IN_W 12
+#define IN_C 4
+
+#define IN_LEN  (IN_H * IN_W * IN_C)
+#define OUT_LEN (IN_C * 3 * 3 * IN_H * IN_W)    // im2col 3x3, padding 1
+
+/* By default, printfs are activated for FPGA and disabled for simulation. */
+#define PRINTF_IN_FPGA 1
+#define PRINTF_IN_SIM 0
+
+#if TARGET_SIM && PRINTF_IN_SIM
+#define PRINTF(fmt, ...) printf(fmt, ##__VA_ARGS__)
+#elif PRINTF_IN_FPGA && !TARGET_SIM
+#define PRINTF(fmt, ...) printf(fmt, ##__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+typedef enum
+{
+    OP_HWC_TO_CHW,
+    OP_CHW_TO_HWC,
+    OP_PAD,
+    OP_SLICE,
+    OP_IM2COL,
+} op_t;
+
+typedef struct
+{
+    const char *name;
+    op_t op;
+    dma_data_type_t type;
+} layer_t;
+
+static const layer_t layers[] = {
+    {"HWC->CHW 12x12x4 int32", OP_HWC_TO_CHW, DMA_DATA_TYPE_WORD},
+    {"CHW->HWC 12x12x4 int32", OP_CHW_TO_HWC, DMA_DATA_TYPE_WORD},
+    {"HWC->CHW 12x12x4 int8 ", OP_HWC_TO_CHW, DMA_DATA_TYPE_BYTE},
+    {"pad 1    48x12   int32", OP_PAD, DMA_DATA_TYPE_WORD},
+    {"slice /2 48x12   int32", OP_SLICE, DMA_DATA_TYPE_WORD},
+    {"im2col 3x3 p1 4x12x12 ", OP_IM2COL, DMA_DATA_TYPE_WORD},
+    {"im2col 3x3 p1 int16   ", OP_IM2COL, DMA_DATA_TYPE_HALF_WORD},
+};
+
+#define N_LAYERS (sizeof(layers) / sizeof(layers[0]))
+
+uint32_t input[IN_LEN] __attribute__((aligned(4)));
+uint32_t out_cpu[OUT_LEN] __attribute__((aligned(4)));
+uint32_t out_dma[OUT_LEN] __attribute__((aligned(4)));
+
+static const tensor_im2col_t conv = {
+    .kernel_h = 3,
+    .kernel_w = 3,
+    .stride_h = 1,
+    .stride_w = 1,
+    .pad_top = 1,
+    .pad_bottom = 1,
+    .pad_left = 1,
+    .pad_right = 1,
+};
+
+static inline uint32_t get_cycles(void)
+{
+    uint32_t cycles;
+    CSR_READ(CSR_REG_MCYCLE, &cycles);
+    return cycles;
+}
+
+// Run a layer, return the cycles taken and the size of the output in bytes
+static uint32_t run(const layer_t *l, uint32_t *out, uint32_t *p_bytes)
+{
+    uint32_t size = DMA_DATA_TYPE_2_SIZE(l->type);
+    uint32_t start = get_cycles();
+    dma_config_flags_t res = DMA_CONFIG_OK;
+
+    /* The matrices of the 2D operations are IN_H * IN_C rows of IN_W */
+    switch (l->op)
+    {
+    case OP_HWC_TO_CHW:
+        res = tensor_hwc_to_chw(input, out, IN_H, IN_W, IN_C, l->type);
+        *p_bytes = IN_LEN * size;
+        break;
+    case OP_CHW_TO_HWC:
+        res = tensor_chw_to_hwc(input, out, IN_H, IN_W, IN_C, l->type);
+        *p_bytes = IN_LEN * size;
+        break;
+    case OP_PAD:
+        res = tensor_pad(input, out, IN_H * IN_C, IN_W, 1, 1, 1, 1, l->type);
+        *p_bytes = (IN_H * IN_C + 2) * (IN_W + 2) * size;
+        break;
+    case OP_SLICE:
+        res = tensor_slice(input, out, IN_W, IN_H * IN_C / 2, IN_W / 2, 2, 2, l->type);
+        *p_bytes = (IN_H * IN_C / 2) * (IN_W / 2) * size;
+        break;
+    case OP_IM2COL:
+        res = tensor_im2col(input, out, IN_H, IN_W, IN_C, &conv, l->type);
+        *p_bytes = OUT_LEN * size;
+        break;
+    }
+
+    if (res != DMA_CONFIG_OK)
+    {
+        PRINTF("%s failed: %x\n\r", l->name, res);
+        *p_bytes = 0;
+    }
+    return get_cycles() - start;
+}
+
+int main(void)
+{
+    uint32_t cycles_cpu, cycles_dma, bytes;
+    tensor_stats_t stats;
+    int errors = 0;
+
+    for (int i = 0; i < IN_LEN; i++)
+    {
+        input[i] = i * 2654435761u;
+    }
+
+    CSR_CLEAR_BITS(CSR_REG_MCOUNTINHIBIT, 0x1);
+    dma_init(NULL);
+
+    PRINTF("layer                      CPU     DMA  blocks (DMA/CPU)\n\r");
+    for (uint32_t l = 0; l < N_LAYERS; l++)
+    {
+        memset(out_cpu, 0, sizeof(out_cpu));
+        memset(out_dma, 0xff, sizeof(out_dma));
+
+        tensor_init(0, TENSOR_BACKEND_CPU);
+        cycles_cpu = run(&layers[l], out_cpu, &bytes);
+
+        tensor_init(0, TENSOR_BACKEND_AUTO);
+        cycles_dma = run(&layers[l], out_dma, &bytes);
+        tensor_get_stats(&stats);
+
+        if (bytes == 0 || memcmp(out_cpu, out_dma, bytes) != 0)
+        {
+            PRINTF("%s: mismatch\n\r", layers[l].name);
+            errors++;
+        }
+
+        PRINTF("%s %6u  %6u  %u/%u\n\r", layers[l].name, cycles_cpu, cycles_dma,
+               stats.dma_blocks, stats.cpu_blocks);
+    }
+
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
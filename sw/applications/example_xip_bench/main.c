@@ -0,0 +1,145 @@
+// Copyright EPFL contributors.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+//
+// Instruction fetch benchmark, to be built with each linker script (on_chip,
+// flash_load, flash_exec) and compared, e.g. with util/xip_bench.py. With
+// flash_exec every instruction is fetched through obi_spimemio and its
+// prefetch buffer, so the three kernels stress it differently:
+//  - straight: a long function without branches, fetched sequentially,
+//  - loop: a small loop that fits in a line of the buffer,
+//  - calls: calls to functions placed on different lines, in a random order.
+// Each kernel is run twice, the first run (cold) also fetching its code for
+// the first time. The results are checked against their closed form.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "x-heep.h"
+#include "csr.h"
+
+/* Printfs are also activated for simulation, the results are read from the UART log. */
+#define PRINTF_IN_FPGA  1
+#define PRINTF_IN_SIM   1
+
+#if TARGET_SIM && PRINTF_IN_SIM
+        #define PRINTF(fmt, ...)    printf(fmt, ## __VA_ARGS__)
+#elif PRINTF_IN_FPGA && !TARGET_SIM
+    #define PRINTF(fmt, ...)    printf(fmt, ## __VA_ARGS__)
+#else
+    #define PRINTF(...)
+#endif
+
+#if defined(FLASH_EXEC)
+#define LINK_MODE "flash_exec"
+#elif defined(FLASH_LOAD)
+#define LINK_MODE "flash_load"
+#else
+#define LINK_MODE "on_chip"
+#endif
+
+#define LOOP_ITERATIONS 1024
+#define CALLS           256
+#define RUNS            2
+
+// Keeps the compiler from folding the steps of the straight kernel
+#define BARRIER(x)  __asm__ volatile("" : "+r"(x))
+
+#define S(k)    acc += (k) * x; BARRIER(acc);
+#define S4(k)   S(k) S((k) + 1) S((k) + 2) S((k) + 3)
+#define S16(k)  S4(k) S4((k) + 4) S4((k) + 8) S4((k) + 12)
+#define S64(k)  S16(k) S16((k) + 16) S16((k) + 32) S16((k) + 48)
+#define S256(k) S64(k) S64((k) + 64) S64((k) + 128) S64((k) + 192)
+
+// Sum of 1..256
+#define STRAIGHT_SUM    32896
+
+static volatile uint32_t seed = 7;
+
+static inline uint32_t get_cycles(void)
+{
+    uint32_t cycles;
+    CSR_READ(CSR_REG_MCYCLE, &cycles);
+    return cycles;
+}
+
+static uint32_t __attribute__((noinline)) straight(uint32_t x)
+{
+    uint32_t acc = 0;
+    S256(1)
+    return acc;
+}
+
+static uint32_t __attribute__((noinline)) loop(uint32_t n)
+{
+    uint32_t acc = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        acc += i;
+        BARRIER(acc);
+    }
+    return acc;
+}
+
+// One function per line of the prefetch buffer
+#define F(k) static uint32_t __attribute__((noinline, aligned(64))) f##k(uint32_t x) { return x + (k); }
+F(0) F(1) F(2) F(3) F(4) F(5) F(6) F(7)
+F(8) F(9) F(10) F(11) F(12) F(13) F(14) F(15)
+
+static uint32_t (* const functions[16])(uint32_t) = {
+    f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15,
+};
+
+static uint32_t __attribute__((noinline)) calls(uint32_t x, uint32_t* expected)
+{
+    uint32_t lcg = seed;
+    *expected = x;
+    for (int i = 0; i < CALLS; i++) {
+        lcg = lcg * 1664525 + 1013904223;
+        uint32_t k = lcg >> 28;
+        *expected += k;
+        x = functions[k](x);
+    }
+    return x;
+}
+
+int main(int argc, char *argv[])
+{
+    CSR_CLEAR_BITS(CSR_REG_MCOUNTINHIBIT, 0x1);
+
+    uint32_t x = seed;
+    uint32_t start, cycles[3][RUNS];
+    int errors = 0;
+
+    for (int r = 0; r < RUNS; r++) {
+        uint32_t result, expected;
+
+        start = get_cycles();
+        result = straight(x);
+        cycles[0][r] = get_cycles() - start;
+        if (result != STRAIGHT_SUM * x) errors++;
+
+        start = get_cycles();
+        result = loop(LOOP_ITERATIONS);
+        cycles[1][r] = get_cycles() - start;
+        if (result != LOOP_ITERATIONS * (LOOP_ITERATIONS - 1) / 2) errors++;
+
+        start = get_cycles();
+        result = calls(x, &expected);
+        cycles[2][r] = get_cycles() - start;
+        if (result != expected) errors++;
+    }
+
+    PRINTF("xip_bench %s\n", LINK_MODE);
+    PRINTF("kernel   |       cold |       warm\n");
+    PRINTF("straight | %10u | %10u\n", cycles[0][0], cycles[0][RUNS - 1]);
+    PRINTF("loop     | %10u | %10u\n", cycles[1][0], cycles[1][RUNS - 1]);
+    PRINTF("calls    | %10u | %10u\n", cycles[2][0], cycles[2][RUNS - 1]);
+
+    if (errors) {
+        PRINTF("FAILED\n");
+        return EXIT_FAILURE;
+    }
+    PRINTF("All tests passed!\n");
+    return EXIT_SUCCESS;
+}
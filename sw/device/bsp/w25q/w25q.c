@@ -42,6 +42,7 @@ extern "C" {
 
 /* To manage interrupts. */
 #include "fast_intr_ctrl.h"
+#include "handler.h"
 #include "csr.h"
 #include "stdasm.h"
 
@@ -52,6 +53,8 @@ extern "C" {
 #include "spi_host_regs.h"
 /* To get SPI functions */
 #include "spi_host.h"
+/* To get the prebuilt SPI programs */
+#include "spi_sdk.h"
 
 /* To get the target of the compilation (sim or pynq) */
 #include "x-heep.h"
@@ -59,6 +62,10 @@ extern "C" {
 /* To get the soc_ctrl base address */
 #include "soc_ctrl_structs.h"
 
+/* To poll the flash from the timer interrupt */
+#include "core_v_mini_mcu.h"
+#include "rv_timer.h"
+
 /* For word swap operations*/
 #include "bitfield.h"
 
@@ -75,6 +82,43 @@ extern "C" {
 */
 #define REVERT_24b_ADDR(addr) (bitfield_byteswap32(addr) >> 8)
 
+/**
+ * @brief Largest read of the I/O engine, limited by the size of a DMA transaction.
+*/
+#define IO_MAX_READ (0xffff*4)
+
+/**
+ * @brief Hart of the peripheral timer used by the I/O engine, and its mie bit.
+*/
+#define IO_TIMER_HART 1
+#define IO_TIMER_MIE_MASK (1 << (16 + kTimer_3_fic_e))
+
+/**
+ * @brief The I/O engine polls the flash from the timer interrupt when the
+ * peripheral timer exists. Its handler is registered with fic_set_handler()
+ * while the engine is initialized.
+*/
+#if RV_TIMER_START_ADDRESS != 0
+#define IO_TIMER 1
+#else
+#define IO_TIMER 0
+#endif
+
+/**
+ * @brief Quad reads of the boot copy, when the QE bit of the flash is set.
+ *
+ * Verilator does not model the high-impedance states of the quad reads, so
+ * the simulations read a single lane unless it is set to 1 (e.g. with
+ * Questasim or VCS).
+*/
+#ifndef W25Q_BOOT_QUAD
+#ifdef TARGET_SIM
+#define W25Q_BOOT_QUAD 0
+#else
+#define W25Q_BOOT_QUAD 1
+#endif
+#endif
+
 /****************************************************************************/
 /**                                                                        **/
 /*                      PROTOTYPES OF LOCAL FUNCTIONS                       */
@@ -106,11 +150,26 @@ static void configure_spi(void);
 */
 static void flash_wait(void);
 
+/**
+ * @brief Read the BUSY bit in the flash status register once.
+ *
+ * @return true if a program or an erase is ongoing.
+*/
+static bool flash_busy(void);
+
 /**
  * @brief Reset the flash.
 */
 static void flash_reset(void);
 
+/**
+ * @brief Build the SPI programs of the reads and of the page programs.
+ *
+ * Their segments are encoded once, each read or page program then only sets
+ * the address and the length and queues all the segments at once.
+*/
+static void build_programs(void);
+
 /**
  * @brief Erase the flash and write the data.
  *
@@ -164,6 +223,22 @@ static w25q_error_codes_t page_write(uint32_t addr, uint8_t *data, uint32_t leng
 */
 static w25q_error_codes_t dma_send_toflash(uint8_t *data, uint32_t length);
 
+/**
+ * @brief Get a DMA channel for a read or a write of the BSP.
+ *
+ * It waits for the end of the previous asynchronous read of the BSP and keeps
+ * its channel, otherwise it acquires a channel from the channel manager,
+ * trying W25Q_DMA_ACQUIRE_TRIES times while all of them are owned.
+ *
+ * @return FLASH_OK if a channel is held, FLASH_ERROR_DMA otherwise.
+*/
+static w25q_error_codes_t dma_channel_get(void);
+
+/**
+ * @brief Release the DMA channel held by the BSP, if any.
+*/
+static void dma_channel_put(void);
+
 /**
  * @brief Enable flash write.
  *
@@ -186,6 +261,75 @@ static void flash_write_enable(void);
 */
 static w25q_error_codes_t w25q128jw_sanity_checks(uint32_t addr, uint8_t *data, uint32_t length);
 
+/**
+ * @brief Start a stream of flash data to a peripheral.
+ *
+ * @param addr 24-bit address to read from.
+ * @param length number of bytes to stream, at most W25Q_STREAM_MAX_LEN.
+ * @param stream destination of the stream.
+ * @param base bytes of the stream already streamed by previous reads.
+ * @return FLASH_OK if the stream started, @ref error_codes otherwise.
+*/
+static w25q_error_codes_t stream_start(uint32_t addr, uint32_t length, const w25q_stream_t *stream, uint32_t base);
+
+/**
+ * @brief Send a read command of length bytes, at standard or quad speed.
+ *
+ * The data is left in the SPI RX FIFO.
+ *
+ * @param addr 24-bit address to read from.
+ * @param length number of bytes to read.
+ * @param quad if 1, the read is performed at quad speed.
+*/
+static void read_command(uint32_t addr, uint32_t length, uint8_t quad);
+
+/**
+ * @brief Window interrupt of the DMA during a stream: report the chunk.
+*/
+static void stream_window_done(uint8_t channel, void *arg);
+
+/**
+ * @brief Start the next step of the request at the head of the I/O queue:
+ * the next read or page program, or the erase.
+*/
+static void io_start(void);
+
+/**
+ * @brief DMA interrupt at the end of a read or of the data of a page program.
+*/
+static void io_dma_done(dma_trans_t *trans, void *arg);
+
+/**
+ * @brief Poll the flash until the ongoing program or erase is done, then
+ * go on with the request.
+*/
+static void io_poll(void);
+
+/**
+ * @brief The flash is done with the ongoing program or erase: go on with
+ * the request.
+*/
+static void io_flash_ready(void);
+
+/**
+ * @brief Check the flash again after W25Q_IO_POLL_US.
+*/
+static void io_poll_later(void);
+
+/**
+ * @brief End the request at the head of the I/O queue, and start the next one.
+ *
+ * @param status status of the request.
+*/
+static void io_complete(w25q_error_codes_t status);
+
+#if IO_TIMER
+/**
+ * @brief Interrupt of the timer of the I/O engine: poll the flash.
+*/
+static void io_timer_irq(void);
+#endif
+
 /**
  * @brief Return the minimum between two numbers.
  *
@@ -211,6 +355,16 @@ static int32_t MIN(int32_t a, int32_t b) {
 */
 spi_host_t* __attribute__((section(".xheep_init_data_crt0"))) spi; //this variable is also used by the crt0, thus keep it in this section
 
+/**
+ * @brief State of the boot copy, used by the crt0 before the .data section is
+ * loaded, thus kept in the same section as spi.
+*/
+static struct {
+    uint8_t *data;              // Destination of the next DMA transaction
+    uint32_t length;            // Bytes not handed to the DMA yet
+    uint8_t lanes;              // 1 or 4, 0 until the QE bit has been read
+} boot_copy __attribute__((section(".xheep_init_data_crt0")));
+
 /**
  * @brief Static vector used in the erase_and_write function.
  *
@@ -220,6 +374,61 @@ spi_host_t* __attribute__((section(".xheep_init_data_crt0"))) spi; //this variab
 */
 uint8_t sector_data[FLASH_SECTOR_SIZE];
 
+/**
+ * @brief DMA channel held by the BSP. The asynchronous reads keep it after
+ * returning, until they are waited for or until the next DMA transaction.
+*/
+static struct {
+    uint8_t channel;
+    uint8_t held;
+} flash_dma;
+
+/**
+ * @brief State of the ongoing stream.
+*/
+static struct {
+    w25q_stream_cb_t cb;
+    void *arg;
+    uint32_t chunk;
+    uint32_t base;              // Bytes streamed by the previous reads
+    uint32_t length;            // Bytes of the current read
+    volatile uint32_t offset;   // Bytes of the current read reported
+} stream_state;
+
+/**
+ * @brief Queue of the I/O engine.
+*/
+static struct {
+    w25q_io_req_t *reqs[W25Q_IO_QUEUE_LEN];
+    uint8_t head;
+    volatile uint8_t count;
+    volatile uint8_t busy;      // Waiting for the flash to end a program or an erase
+    uint8_t channel;            // DMA channel, owned from w25q128jw_io_init() to w25q128jw_io_deinit()
+    uint8_t ready;
+} io;
+
+/**
+ * @brief DMA transaction of the I/O engine, between the SPI FIFOs and memory.
+*/
+static dma_target_t io_tgt_mem;
+static dma_target_t io_tgt_fifo;
+static dma_trans_t io_trans;
+
+/**
+ * @brief SPI programs of the reads and of the page programs.
+*/
+static spi_program_t prog_read;         // Read: opcode + address, data
+static spi_program_t prog_read_quad;    // Quad I/O read: opcode, address, dummy cycles, data
+static spi_program_t prog_write;        // Page program: opcode + address, data
+static spi_program_t prog_write_quad;   // Quad page program: opcode + address, data
+
+#if IO_TIMER
+/**
+ * @brief Peripheral timer, only its hart IO_TIMER_HART is used.
+*/
+static rv_timer_t io_timer;
+#endif
+
 
 /****************************************************************************/
 /**                                                                        **/
@@ -234,6 +443,103 @@ void w25q128jw_init_crt0() {
     return;
 }
 
+/*
+ * The boot copy runs before the bootrom has loaded more than the .init section,
+ * so it only calls the functions kept there by link_flash_load.ld and programs
+ * the DMA registers itself. The driver state of the DMA is in the .bss, cleared
+ * by the crt0, so the driver writes all the registers on its first launch.
+ */
+static inline __attribute__((always_inline)) void boot_command(uint32_t len, bool csaat, uint8_t speed, uint8_t direction) {
+    spi_wait_for_ready(spi);
+    spi_set_command(spi, spi_create_command((spi_command_t){
+        .len        = len,
+        .csaat      = csaat,
+        .speed      = speed,
+        .direction  = direction
+    }));
+}
+
+static inline __attribute__((always_inline)) uint8_t boot_lanes(void) {
+    #if W25Q_BOOT_QUAD && !defined(TARGET_SIM)
+    // Read Status Register 2, the quad reads need the QE bit
+    uint32_t reg2 = 0;
+    spi_set_rx_watermark(spi, 1);
+    spi_write_word(spi, FC_RSR2);
+    boot_command(0, true, SPI_SPEED_STANDARD, SPI_DIR_TX_ONLY);
+    boot_command(0, false, SPI_SPEED_STANDARD, SPI_DIR_RX_ONLY);
+    spi_wait_for_rx_watermark(spi);
+    spi_read_word(spi, &reg2);
+    return (reg2 & 0x2) ? 4 : 1;
+    #else
+    return W25Q_BOOT_QUAD ? 4 : 1;
+    #endif
+}
+
+static inline __attribute__((always_inline)) void boot_dma_launch(void) {
+    volatile dma *peri = dma_peri(0);
+    uint32_t size = boot_copy.length < IO_MAX_READ ? boot_copy.length : IO_MAX_READ;
+
+    // From the RX FIFO, at the pace of the SPI, to the RAM
+    peri->INTERRUPT_EN = 0;
+    peri->SRC_PTR = (uint32_t)spi + SPI_HOST_RXDATA_REG_OFFSET;
+    peri->DST_PTR = (uint32_t)boot_copy.data;
+    peri->SRC_PTR_INC_D1 = 0;
+    peri->DST_PTR_INC_D1 = 4;
+    peri->SLOT = (DMA_TRIG_SLOT_SPI_FLASH_RX & DMA_SLOT_RX_TRIGGER_SLOT_MASK) << DMA_SLOT_RX_TRIGGER_SLOT_OFFSET;
+    peri->MODE = DMA_TRANS_MODE_SINGLE;
+    peri->SRC_DATA_TYPE = DMA_DATA_TYPE_WORD;
+    peri->DST_DATA_TYPE = DMA_DATA_TYPE_WORD;
+    peri->SIZE_D1 = size >> 2;
+
+    boot_copy.data += size;
+    boot_copy.length -= size;
+}
+
+w25q_error_codes_t w25q128jw_boot_read_dma(uint32_t addr, void *data, uint32_t length) {
+    // Sanity checks, the DMA moves words
+    if (w25q128jw_sanity_checks(addr, data, length) != FLASH_OK) return FLASH_ERROR;
+    if (length % 4 != 0 || (uint32_t)data % 4 != 0) return FLASH_ERROR;
+
+    // The copies share the RX FIFO and the DMA channel
+    w25q128jw_boot_wait_dma();
+
+    if (boot_copy.lanes == 0) boot_copy.lanes = boot_lanes();
+
+    if (boot_copy.lanes == 4) {
+        // Quad I/O read: command, address and mode bits (Fxh), dummy cycles, data
+        spi_write_word(spi, FC_RDQIO);
+        spi_write_word(spi, REVERT_24b_ADDR(addr) | (0xFF << 24));
+        boot_command(0, true, SPI_SPEED_STANDARD, SPI_DIR_TX_ONLY);
+        boot_command(3, true, SPI_SPEED_QUAD, SPI_DIR_TX_ONLY);
+        #ifndef TARGET_SIM
+        boot_command(DUMMY_CLOCKS_FAST_READ_QUAD_IO - 1, true, SPI_SPEED_STANDARD, SPI_DIR_DUMMY);
+        #else
+        boot_command(DUMMY_CLOCKS_SIM - 1, true, SPI_SPEED_STANDARD, SPI_DIR_DUMMY);
+        #endif
+        boot_command(length - 1, false, SPI_SPEED_QUAD, SPI_DIR_RX_ONLY);
+    } else {
+        // Read: address + command, data
+        spi_write_word(spi, (REVERT_24b_ADDR(addr & 0x00ffffff) << 8) | FC_RD);
+        boot_command(3, true, SPI_SPEED_STANDARD, SPI_DIR_TX_ONLY);
+        boot_command(length - 1, false, SPI_SPEED_STANDARD, SPI_DIR_RX_ONLY);
+    }
+
+    // A single read, emptied by as many DMA transactions as needed
+    boot_copy.data = (uint8_t *)data;
+    boot_copy.length = length;
+    boot_dma_launch();
+
+    return FLASH_OK;
+}
+
+void w25q128jw_boot_wait_dma(void) {
+    while (1) {
+        while (!(dma_peri(0)->STATUS & (1 << DMA_STATUS_READY_BIT)));
+        if (boot_copy.length == 0) return;
+        boot_dma_launch();
+    }
+}
+
 w25q_error_codes_t w25q128jw_init(spi_host_t* spi_host) {
     /*
      * Check if memory mapped SPI is enabled. Current version of the bsp
@@ -261,6 +567,13 @@ w25q_error_codes_t w25q128jw_init(spi_host_t* spi_host) {
     // Set CSID
     spi_set_csid(spi, 0);
 
+    // Encode the commands used by the reads and writes
+    build_programs();
+
+    // Init DMA, the integrated DMA is used (peri == NULL). The channels
+    // owned by other users are left untouched.
+    dma_init(NULL);
+
     // Power up flash
     flash_power_up();
 
@@ -283,8 +596,6 @@ w25q_error_codes_t w25q128jw_read(uint32_t addr, void *data, uint32_t length) {
         status = w25q128jw_read_quad(addr, data, length);
         if (status != FLASH_OK) return status;
     } else {
-        // Wait DMA to be free
-        while(!dma_is_ready(0));
         status = w25q128jw_read_quad_dma(addr, data, length);
         if (status != FLASH_OK) return status;
     }
@@ -302,8 +613,6 @@ w25q_error_codes_t w25q128jw_write(uint32_t addr, void *data, uint32_t length, u
     if (erase_before_write == 1) {
         status = erase_and_write(addr, data, length);
     } else {
-        // Wait DMA to be free
-        while(!dma_is_ready(0));
         status = w25q128jw_write_quad_dma(addr, data, length);
     }
 
@@ -327,32 +636,8 @@ uint32_t* w25q128jw_read_standard_setup(uint32_t addr, void *data, uint32_t leng
     // SPI and SPI_FLASH are the same IP so same register map
     uint32_t *fifo_ptr_rx = (uint32_t *)((uintptr_t)spi + SPI_HOST_RXDATA_REG_OFFSET);
 
-    // Address + Read command
-    uint32_t read_byte_cmd = ((REVERT_24b_ADDR(addr & 0x00ffffff) << 8) | FC_RD);
-    // Load command to TX FIFO
-    spi_write_word(spi, read_byte_cmd);
-    spi_wait_for_ready(spi);
-
-    // Set up segment parameters -> send command and address
-    const uint32_t cmd_read_1 = spi_create_command((spi_command_t){
-        .len        = 3,                 // 4 Bytes
-        .csaat      = true,              // Command not finished
-        .speed      = SPI_SPEED_STANDARD, // Single speed
-        .direction  = SPI_DIR_TX_ONLY      // Write only
-    });
-    // Load segment parameters to COMMAND register
-    spi_set_command(spi, cmd_read_1);
-    spi_wait_for_ready(spi);
-
-    // Set up segment parameters -> read length bytes
-    const uint32_t cmd_read_2 = spi_create_command((spi_command_t){
-        .len        = length-1,          // len bytes
-        .csaat      = false,             // End command
-        .speed      = SPI_SPEED_STANDARD, // Single speed
-        .direction  = SPI_DIR_RX_ONLY      // Read only
-    });
-    spi_set_command(spi, cmd_read_2);
-    spi_wait_for_ready(spi);
+    // Address + Read command, then read length bytes, queued at once
+    read_command(addr, length, 0);
 
     
     return fifo_ptr_rx;
@@ -490,8 +775,8 @@ w25q_error_codes_t w25q128jw_read_standard_dma(uint32_t addr, void *data, uint32
     // SPI and SPI_FLASH are the same IP so same register map
     uint32_t *fifo_ptr_rx = (uint32_t *)((uintptr_t)spi + SPI_HOST_RXDATA_REG_OFFSET);
 
-    // Init DMA, the integrated DMA is used (peri == NULL)
-    if(!no_wait_init_dma)    dma_init(NULL);
+    // Get a DMA channel, kept until the end of the transaction if it is not waited for here
+    if (dma_channel_get() != FLASH_OK) return FLASH_ERROR_DMA;
 
     // The DMA will wait for the SPI FLASH RX FIFO valid signal
     uint8_t slot = DMA_TRIG_SLOT_SPI_FLASH_RX;
@@ -522,6 +807,7 @@ w25q_error_codes_t w25q128jw_read_standard_dma(uint32_t addr, void *data, uint32
     };
     // Size is in data units (words in this case)
     trans.size_d1_du = length>>2;
+    trans.channel = flash_dma.channel;
 
     // Validate, load and launch DMA transaction
 
@@ -530,35 +816,14 @@ w25q_error_codes_t w25q128jw_read_standard_dma(uint32_t addr, void *data, uint32
     res = dma_load_transaction(&trans);
     res = dma_launch(&trans);
 
-    // Address + Read command
-    uint32_t read_byte_cmd = ((REVERT_24b_ADDR(addr & 0x00ffffff) << 8) | FC_RD);
-    // Load command to TX FIFO
-    spi_write_word(spi, read_byte_cmd);
-    spi_wait_for_ready(spi);
-
-    // Set up segment parameters -> send command and address
-    const uint32_t cmd_read_1 = spi_create_command((spi_command_t){
-        .len        = 3,                 // 4 Bytes
-        .csaat      = true,              // Command not finished
-        .speed      = SPI_SPEED_STANDARD, // Single speed
-        .direction  = SPI_DIR_TX_ONLY      // Write only
-    });
-    // Load segment parameters to COMMAND register
-    spi_set_command(spi, cmd_read_1);
-    spi_wait_for_ready(spi);
-
-    // Set up segment parameters -> read length bytes
-    const uint32_t cmd_read_2 = spi_create_command((spi_command_t){
-        .len        = length-1,          // len bytes
-        .csaat      = false,             // End command
-        .speed      = SPI_SPEED_STANDARD, // Single speed
-        .direction  = SPI_DIR_RX_ONLY      // Read only
-    });
-    spi_set_command(spi, cmd_read_2);
-    spi_wait_for_ready(spi);
+    // Address + Read command, then read length bytes, queued at once
+    read_command(addr, length, 0);
 
     // Wait for DMA to finish transaction
-    if(!no_wait_init_dma) while(!dma_is_ready(0));
+    if(!no_wait_init_dma) {
+        while(!dma_is_ready(flash_dma.channel));
+        dma_channel_put();
+    }
 
     // Take into account the extra bytes (if any)
     if (length % 4 != 0) {
@@ -592,8 +857,8 @@ w25q_error_codes_t w25q128jw_read_standard_dma_async(uint32_t addr, void *data,
     // SPI and SPI_FLASH are the same IP so same register map
     uint32_t *fifo_ptr_rx = (uint32_t *)((uintptr_t)spi + SPI_HOST_RXDATA_REG_OFFSET);
 
-    // Init DMA, the integrated DMA is used (peri == NULL)
-    dma_init(NULL);
+    // Get a DMA channel, kept until the transaction is waited for
+    if (dma_channel_get() != FLASH_OK) return FLASH_ERROR_DMA;
 
     // The DMA will wait for the SPI FLASH RX FIFO valid signal
     uint8_t slot = DMA_TRIG_SLOT_SPI_FLASH_RX;
@@ -624,40 +889,18 @@ w25q_error_codes_t w25q128jw_read_standard_dma_async(uint32_t addr, void *data,
     };
     // Size is in data units (words in this case)
     trans.size_d1_du = length>>2;
+    trans.channel = flash_dma.channel;
     // Validate, load and launch DMA transaction
     dma_config_flags_t res;
     res = dma_validate_transaction(&trans, DMA_ENABLE_REALIGN, DMA_PERFORM_CHECKS_INTEGRITY );
     res = dma_load_transaction(&trans);
     res = dma_launch(&trans);
 
-    // Address + Read command
-    uint32_t read_byte_cmd = ((REVERT_24b_ADDR(addr & 0x00ffffff) << 8) | FC_RD);
-    // Load command to TX FIFO
-    spi_write_word(spi, read_byte_cmd);
-    spi_wait_for_ready(spi);
-
-    // Set up segment parameters -> send command and address
-    const uint32_t cmd_read_1 = spi_create_command((spi_command_t){
-        .len        = 3,                 // 4 Bytes
-        .csaat      = true,              // Command not finished
-        .speed      = SPI_SPEED_STANDARD, // Single speed
-        .direction  = SPI_DIR_TX_ONLY      // Write only
-    });
-    // Load segment parameters to COMMAND register
-    spi_set_command(spi, cmd_read_1);
-    spi_wait_for_ready(spi);
-
-    // Set up segment parameters -> read length bytes
-    const uint32_t cmd_read_2 = spi_create_command((spi_command_t){
-        .len        = length-1,          // len bytes
-        .csaat      = false,             // End command
-        .speed      = SPI_SPEED_STANDARD, // Single speed
-        .direction  = SPI_DIR_RX_ONLY      // Read only
-    });
-    spi_set_command(spi, cmd_read_2);
-    spi_wait_for_ready(spi);
+    // Address + Read command, then read length bytes, queued at once
+    read_command(addr, length, 0);
 
-    // Wait for DMA to finish transaction outside this function, the DMA generates also an interrupt
+    // Wait for DMA to finish transaction outside this function, on the channel given by
+    // w25q128jw_dma_channel(), the DMA generates also an interrupt
     // However, you need to enable the interrupt in the INT controllers, and CPU
 
     return FLASH_OK;
@@ -714,56 +957,8 @@ uint32_t* w25q128jw_read_quad_setup(uint32_t addr, void *data, uint32_t length)
     // Sanity checks
     if (w25q128jw_sanity_checks(addr, data, length) != FLASH_OK) return NULL;
 
-    // Send quad read command at standard speed
-    uint32_t cmd_read_quadIO = FC_RDQIO;
-    spi_write_word(spi, cmd_read_quadIO);
-    const uint32_t cmd_read = spi_create_command((spi_command_t){
-        .len        = 0,                 // 1 Byte
-        .csaat      = true,              // Command not finished
-        .speed      = SPI_SPEED_STANDARD, // Single speed
-        .direction  = SPI_DIR_TX_ONLY      // Write only
-    });
-    spi_set_command(spi, cmd_read);
-    spi_wait_for_ready(spi);
-
-    /*
-     * Send address at quad speed.
-     * Last byte is Fxh (here FFh) required by W25Q128JW
-    */
-    uint32_t read_byte_cmd = (REVERT_24b_ADDR(addr) | (0xFF << 24));
-    spi_write_word(spi, read_byte_cmd);
-    const uint32_t cmd_address = spi_create_command((spi_command_t){
-        .len        = 3,                // 3 Byte
-        .csaat      = true,             // Command not finished
-        .speed      = SPI_SPEED_QUAD,    // Quad speed
-        .direction  = SPI_DIR_TX_ONLY     // Write only
-    });
-    spi_set_command(spi, cmd_address);
-    spi_wait_for_ready(spi);
-
-    // Quad read requires dummy clocks
-    const uint32_t dummy_clocks_cmd = spi_create_command((spi_command_t){
-        #ifndef TARGET_SIM
-        .len        = DUMMY_CLOCKS_FAST_READ_QUAD_IO-1, // W25Q128JW flash needs 4 dummy cycles
-        #else
-        .len        = DUMMY_CLOCKS_SIM-1, // SPI flash simulation model needs 8 dummy cycles
-        #endif
-        .csaat      = true,              // Command not finished
-        .speed      = SPI_SPEED_QUAD,     // Quad speed
-        .direction  = SPI_DIR_DUMMY       // Dummy
-    });
-    spi_set_command(spi, dummy_clocks_cmd);
-    spi_wait_for_ready(spi);
-
-    // Read back the requested data at quad speed
-    const uint32_t cmd_read_rx = spi_create_command((spi_command_t){
-        .len        = length-1,        // length bytes
-        .csaat      = false,           // End command
-        .speed      = SPI_SPEED_QUAD,   // Quad speed
-        .direction  = SPI_DIR_RX_ONLY    // Read only
-    });
-    spi_set_command(spi, cmd_read_rx);
-    spi_wait_for_ready(spi);
+    // Quad read command, address, dummy cycles and read, queued at once
+    read_command(addr, length, 1);
 
     /* COMMAND FINISHED */
 
@@ -776,56 +971,8 @@ w25q_error_codes_t w25q128jw_read_quad(uint32_t addr, void *data, uint32_t lengt
     // Sanity checks
     if (w25q128jw_sanity_checks(addr, data, length) != FLASH_OK) return FLASH_ERROR;
 
-    // Send quad read command at standard speed
-    uint32_t cmd_read_quadIO = FC_RDQIO;
-    spi_write_word(spi, cmd_read_quadIO);
-    const uint32_t cmd_read = spi_create_command((spi_command_t){
-        .len        = 0,                 // 1 Byte
-        .csaat      = true,              // Command not finished
-        .speed      = SPI_SPEED_STANDARD, // Single speed
-        .direction  = SPI_DIR_TX_ONLY      // Write only
-    });
-    spi_set_command(spi, cmd_read);
-    spi_wait_for_ready(spi);
-
-    /*
-     * Send address at quad speed.
-     * Last byte is Fxh (here FFh) required by W25Q128JW
-    */
-    uint32_t read_byte_cmd = (REVERT_24b_ADDR(addr) | (0xFF << 24));
-    spi_write_word(spi, read_byte_cmd);
-    const uint32_t cmd_address = spi_create_command((spi_command_t){
-        .len        = 3,                // 3 Byte
-        .csaat      = true,             // Command not finished
-        .speed      = SPI_SPEED_QUAD,    // Quad speed
-        .direction  = SPI_DIR_TX_ONLY     // Write only
-    });
-    spi_set_command(spi, cmd_address);
-    spi_wait_for_ready(spi);
-
-    // Quad read requires dummy clocks
-    const uint32_t dummy_clocks_cmd = spi_create_command((spi_command_t){
-        #ifndef TARGET_SIM
-        .len        = DUMMY_CLOCKS_FAST_READ_QUAD_IO-1,
-        #else
-        .len        = DUMMY_CLOCKS_SIM-1,
-        #endif
-        .csaat      = true,            // Command not finished
-        .speed      = SPI_SPEED_QUAD,   // Quad speed
-        .direction  = SPI_DIR_DUMMY     // Dummy
-    });
-    spi_set_command(spi, dummy_clocks_cmd);
-    spi_wait_for_ready(spi);
-
-    // Read back the requested data at quad speed
-    const uint32_t cmd_read_rx = spi_create_command((spi_command_t){
-        .len        = length-1,        // 32 Byte
-        .csaat      = false,           // End command
-        .speed      = SPI_SPEED_QUAD,   // Quad speed
-        .direction  = SPI_DIR_RX_ONLY    // Read only
-    });
-    spi_set_command(spi, cmd_read_rx);
-    spi_wait_for_ready(spi);
+    // Quad read command, address, dummy cycles and read, queued at once
+    read_command(addr, length, 1);
 
     /* COMMAND FINISHED */
 
@@ -924,56 +1071,14 @@ w25q_error_codes_t w25q128jw_read_quad_dma(uint32_t addr, void *data, uint32_t l
     // Sanity checks
     if (w25q128jw_sanity_checks(addr, data, length) != FLASH_OK) return FLASH_ERROR;
 
-    // Send quad read command at standard speed
-    uint32_t cmd_read_quadIO = FC_RDQIO;
-    spi_write_word(spi, cmd_read_quadIO);
-    const uint32_t cmd_read = spi_create_command((spi_command_t){
-        .len        = 0,                 // 1 Byte
-        .csaat      = true,              // Command not finished
-        .speed      = SPI_SPEED_STANDARD, // Single speed
-        .direction  = SPI_DIR_TX_ONLY      // Write only
-    });
-    spi_set_command(spi, cmd_read);
-    spi_wait_for_ready(spi);
-
     /*
-     * Send address at quad speed.
-     * Last byte is Fxh (here FFh) required by W25Q128JW
+     * Get a DMA channel, kept until the transaction is waited for. It is done
+     * before the command, which must not be issued if the read cannot be done.
     */
-    uint32_t read_byte_cmd = (REVERT_24b_ADDR(addr) | (0xFF << 24));
-    spi_write_word(spi, read_byte_cmd);
-    const uint32_t cmd_address = spi_create_command((spi_command_t){
-        .len        = 3,                // 3 Byte
-        .csaat      = true,             // Command not finished
-        .speed      = SPI_SPEED_QUAD,    // Quad speed
-        .direction  = SPI_DIR_TX_ONLY     // Write only
-    });
-    spi_set_command(spi, cmd_address);
-    spi_wait_for_ready(spi);
+    if (dma_channel_get() != FLASH_OK) return FLASH_ERROR_DMA;
 
-    // Quad read requires dummy clocks
-    const uint32_t dummy_clocks_cmd = spi_create_command((spi_command_t){
-        #ifndef TARGET_SIM
-        .len        = DUMMY_CLOCKS_FAST_READ_QUAD_IO-1, // W25Q128JW flash needs 4 dummy cycles
-        #else
-        .len        = DUMMY_CLOCKS_SIM-1, // SPI flash simulation model needs 8 dummy cycles
-        #endif
-        .csaat      = true,              // Command not finished
-        .speed      = SPI_SPEED_QUAD,     // Quad speed
-        .direction  = SPI_DIR_DUMMY       // Dummy
-    });
-    spi_set_command(spi, dummy_clocks_cmd);
-    spi_wait_for_ready(spi);
-
-    // Read back the requested data at quad speed
-    const uint32_t cmd_read_rx = spi_create_command((spi_command_t){
-        .len        = length-1,        // length bytes
-        .csaat      = false,           // End command
-        .speed      = SPI_SPEED_QUAD,   // Quad speed
-        .direction  = SPI_DIR_RX_ONLY    // Read only
-    });
-    spi_set_command(spi, cmd_read_rx);
-    spi_wait_for_ready(spi);
+    // Quad read command, address, dummy cycles and read, queued at once
+    read_command(addr, length, 1);
 
     /* COMMAND FINISHED */
 
@@ -983,9 +1088,6 @@ w25q_error_codes_t w25q128jw_read_quad_dma(uint32_t addr, void *data, uint32_t l
     // SPI and SPI_FLASH are the same IP so same register map
     uint32_t *fifo_ptr_rx = (uint32_t *)((uintptr_t)spi + SPI_HOST_RXDATA_REG_OFFSET);
 
-    // Init DMA, the integrated DMA is used (peri == NULL)
-    dma_init(NULL);
-
     // The DMA will wait for the SPI FLASH RX FIFO valid signal
     uint8_t slot = DMA_TRIG_SLOT_SPI_FLASH_RX;
 
@@ -1015,6 +1117,7 @@ w25q_error_codes_t w25q128jw_read_quad_dma(uint32_t addr, void *data, uint32_t l
     };
     // Size is in data units (words in this case)
     trans.size_d1_du = length>>2;
+    trans.channel = flash_dma.channel;
 
     // Validate, load and launch DMA transaction
     dma_config_flags_t res;
@@ -1023,7 +1126,8 @@ w25q_error_codes_t w25q128jw_read_quad_dma(uint32_t addr, void *data, uint32_t l
     res = dma_launch(&trans);
 
     // Wait for DMA to finish transaction
-    while(!dma_is_ready(0));
+    while(!dma_is_ready(flash_dma.channel));
+    dma_channel_put();
 
     // Take into account the extra bytes (if any)
     if (length % 4 != 0) {
@@ -1046,56 +1150,14 @@ w25q_error_codes_t w25q128jw_read_quad_dma_async(uint32_t addr, void *data, uint
     // Sanity checks
     if (w25q128jw_sanity_checks(addr, data, length) != FLASH_OK) return FLASH_ERROR;
 
-    // Send quad read command at standard speed
-    uint32_t cmd_read_quadIO = FC_RDQIO;
-    spi_write_word(spi, cmd_read_quadIO);
-    const uint32_t cmd_read = spi_create_command((spi_command_t){
-        .len        = 0,                 // 1 Byte
-        .csaat      = true,              // Command not finished
-        .speed      = SPI_SPEED_STANDARD, // Single speed
-        .direction  = SPI_DIR_TX_ONLY      // Write only
-    });
-    spi_set_command(spi, cmd_read);
-    spi_wait_for_ready(spi);
-
     /*
-     * Send address at quad speed.
-     * Last byte is Fxh (here FFh) required by W25Q128JW
+     * Get a DMA channel, kept until the transaction is waited for. It is done
+     * before the command, which must not be issued if the read cannot be done.
     */
-    uint32_t read_byte_cmd = (REVERT_24b_ADDR(addr) | (0xFF << 24));
-    spi_write_word(spi, read_byte_cmd);
-    const uint32_t cmd_address = spi_create_command((spi_command_t){
-        .len        = 3,                // 3 Byte
-        .csaat      = true,             // Command not finished
-        .speed      = SPI_SPEED_QUAD,    // Quad speed
-        .direction  = SPI_DIR_TX_ONLY     // Write only
-    });
-    spi_set_command(spi, cmd_address);
-    spi_wait_for_ready(spi);
+    if (dma_channel_get() != FLASH_OK) return FLASH_ERROR_DMA;
 
-    // Quad read requires dummy clocks
-    const uint32_t dummy_clocks_cmd = spi_create_command((spi_command_t){
-        #ifndef TARGET_SIM
-        .len        = DUMMY_CLOCKS_FAST_READ_QUAD_IO-1, // W25Q128JW flash needs 4 dummy cycles
-        #else
-        .len        = DUMMY_CLOCKS_SIM-1, // SPI flash simulation model needs 8 dummy cycles
-        #endif
-        .csaat      = true,              // Command not finished
-        .speed      = SPI_SPEED_QUAD,     // Quad speed
-        .direction  = SPI_DIR_DUMMY       // Dummy
-    });
-    spi_set_command(spi, dummy_clocks_cmd);
-    spi_wait_for_ready(spi);
-
-    // Read back the requested data at quad speed
-    const uint32_t cmd_read_rx = spi_create_command((spi_command_t){
-        .len        = length-1,        // length bytes
-        .csaat      = false,           // End command
-        .speed      = SPI_SPEED_QUAD,   // Quad speed
-        .direction  = SPI_DIR_RX_ONLY    // Read only
-    });
-    spi_set_command(spi, cmd_read_rx);
-    spi_wait_for_ready(spi);
+    // Quad read command, address, dummy cycles and read, queued at once
+    read_command(addr, length, 1);
 
     /* COMMAND FINISHED */
 
@@ -1105,9 +1167,6 @@ w25q_error_codes_t w25q128jw_read_quad_dma_async(uint32_t addr, void *data, uint
     // SPI and SPI_FLASH are the same IP so same register map
     uint32_t *fifo_ptr_rx = (uint32_t *)((uintptr_t)spi + SPI_HOST_RXDATA_REG_OFFSET);
 
-    // Init DMA, the integrated DMA is used (peri == NULL)
-    dma_init(NULL);
-
     // The DMA will wait for the SPI FLASH RX FIFO valid signal
     uint8_t slot = DMA_TRIG_SLOT_SPI_FLASH_RX;
 
@@ -1137,6 +1196,7 @@ w25q_error_codes_t w25q128jw_read_quad_dma_async(uint32_t addr, void *data, uint
     };
     // Size is in data units (words in this case)
     trans.size_d1_du = length>>2;
+    trans.channel = flash_dma.channel;
 
     // Validate, load and launch DMA transaction
     dma_config_flags_t res;
@@ -1149,7 +1209,8 @@ w25q_error_codes_t w25q128jw_read_quad_dma_async(uint32_t addr, void *data, uint
 
 void w25q128jw_wait_quad_dma_async(void *data, uint32_t length){
     // Wait for DMA to finish transaction
-    while(!dma_is_ready(0));
+    while(!dma_is_ready(flash_dma.channel));
+    dma_channel_put();
 
     // Take into account the extra bytes (if any)
     if (length % 4 != 0) {
@@ -1166,6 +1227,17 @@ void w25q128jw_wait_quad_dma_async(void *data, uint32_t length){
     }
 }
 
+uint8_t w25q128jw_dma_channel(void) {
+    return flash_dma.channel;
+}
+
+void w25q128jw_dma_release(void) {
+    if (flash_dma.held) {
+        while(!dma_is_ready(flash_dma.channel));
+        dma_channel_put();
+    }
+}
+
 w25q_error_codes_t w25q128jw_write_quad_dma(uint32_t addr, void *data, uint32_t length) {
     // Call the wrapper with quad = 1, dma = 1
     return page_write_wrapper(addr, (uint8_t *)data, length, 1, 1);
@@ -1212,6 +1284,67 @@ w25q_error_codes_t w25q128jw_erase_and_write_quad_dma(uint32_t addr, void *data,
 
 }
 
+w25q_error_codes_t w25q128jw_stream_dma_async(uint32_t addr, uint32_t length, const w25q_stream_t *stream) {
+    return stream_start(addr, length, stream, 0);
+}
+
+w25q_error_codes_t w25q128jw_wait_stream_dma(void) {
+    // Wait for DMA to finish transaction
+    while (!dma_is_ready(flash_dma.channel)) {
+        CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+        if (!dma_is_ready(flash_dma.channel)) {
+            wait_for_interrupt();
+        }
+        CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+    }
+
+    // From now on, only this function reports the chunks
+    dma_set_window_callback(flash_dma.channel, NULL, NULL);
+    dma_channel_put();
+
+    if (stream_state.cb != NULL) {
+        while (stream_state.offset + stream_state.chunk <= stream_state.length) {
+            stream_state.offset += stream_state.chunk;
+            stream_state.cb(stream_state.base + stream_state.offset, stream_state.arg);
+        }
+        // Last chunk, shorter than the others
+        if (stream_state.offset < stream_state.length) {
+            stream_state.offset = stream_state.length;
+            stream_state.cb(stream_state.base + stream_state.offset, stream_state.arg);
+        }
+    }
+
+    return FLASH_OK;
+}
+
+w25q_error_codes_t w25q128jw_stream_dma(uint32_t addr, uint32_t length, const w25q_stream_t *stream) {
+    // Split on chunk boundaries, so that the chunks have the same size
+    uint32_t max_length = W25Q_STREAM_MAX_LEN;
+    if (stream->chunk != 0 && stream->chunk <= W25Q_STREAM_MAX_LEN) {
+        max_length -= W25Q_STREAM_MAX_LEN % stream->chunk;
+    }
+
+    w25q_stream_t segment = *stream;
+    uint32_t done = 0;
+
+    while (done < length) {
+        uint32_t segment_length = MIN(length - done, max_length);
+
+        if (stream_start(addr + done, segment_length, &segment, done) != FLASH_OK) return FLASH_ERROR;
+        w25q128jw_wait_stream_dma();
+
+        // A memory destination goes on where the previous read stopped
+        segment.dst = (volatile uint8_t *)segment.dst + segment.dst_inc * segment_length;
+        done += segment_length;
+    }
+
+    return FLASH_OK;
+}
+
+void __attribute__((weak)) w25q128jw_modified(uint32_t addr, uint32_t length) {
+    return;
+}
+
 w25q_error_codes_t w25q128jw_4k_erase(uint32_t addr) {
     // Sanity checks
     if (addr > MAX_FLASH_ADDR || addr < 0) return FLASH_ERROR;
@@ -1237,6 +1370,8 @@ w25q_error_codes_t w25q128jw_4k_erase(uint32_t addr) {
 
     // Wait for the erase operation to be finished
     flash_wait();
+
+    w25q128jw_modified(addr & 0x00fff000, FLASH_SECTOR_SIZE);
 }
 
 w25q_error_codes_t w25q128jw_32k_erase(uint32_t addr) {
@@ -1264,6 +1399,8 @@ w25q_error_codes_t w25q128jw_32k_erase(uint32_t addr) {
 
     // Wait for the erase operation to be finished
     flash_wait();
+
+    w25q128jw_modified(addr & 0x00ff8000, 0x8000);
 }
 
 w25q_error_codes_t w25q128jw_64k_erase(uint32_t addr) {
@@ -1291,6 +1428,8 @@ w25q_error_codes_t w25q128jw_64k_erase(uint32_t addr) {
 
     // Wait for the erase operation to be finished
     flash_wait();
+
+    w25q128jw_modified(addr & 0x00ff0000, 0x10000);
 }
 
 void w25q128jw_chip_erase(void) {
@@ -1314,6 +1453,8 @@ void w25q128jw_chip_erase(void) {
 
     // Wait for the erase operation to be finished
     flash_wait();
+
+    w25q128jw_modified(0, MAX_FLASH_ADDR + 1);
 }
 
 void w25q128jw_reset(void) {
@@ -1349,6 +1490,118 @@ void w25q128jw_power_down(void) {
 }
 
 
+w25q_error_codes_t w25q128jw_io_init(void) {
+    // Set up again: start from an idle engine
+    if (io.ready) w25q128jw_io_deinit();
+
+    io.head = 0;
+    io.count = 0;
+    io.busy = 0;
+
+    // The transactions go through the queue of a channel owned by the engine
+    if (dma_channel_acquire(DMA_CH_PRIO_NORMAL, 0, &io.channel) != DMA_CONFIG_OK) {
+        return FLASH_ERROR_DMA;
+    }
+    io.ready = 1;
+
+#if IO_TIMER
+    /*
+     * rv_timer_init() would reset the counters of both harts: set up the
+     * driver structure by hand and only touch the hart of the engine.
+     * The counter ticks every microsecond.
+    */
+    io_timer.base_addr = mmio_region_from_addr(RV_TIMER_START_ADDRESS);
+    io_timer.config = (rv_timer_config_t){.hart_count = 2, .comparator_count = 1};
+    uint32_t prescale = soc_ctrl_peri->SYSTEM_FREQUENCY_HZ / 1000000 - 1;
+    if (rv_timer_set_tick_params(&io_timer, IO_TIMER_HART,
+            (rv_timer_tick_params_t){.prescale = prescale, .tick_step = 1}) != kRvTimerOk) {
+        return FLASH_ERROR;
+    }
+    rv_timer_arm(&io_timer, IO_TIMER_HART, 0, UINT64_MAX);
+    rv_timer_irq_clear(&io_timer, IO_TIMER_HART, 0);
+    rv_timer_irq_enable(&io_timer, IO_TIMER_HART, 0, kRvTimerEnabled);
+
+    fic_set_handler(kTimer_3_fic_e, io_timer_irq);
+    enable_fast_interrupt(kTimer_3_fic_e, true);
+    CSR_SET_BITS(CSR_REG_MIE, IO_TIMER_MIE_MASK);
+#endif
+
+    return FLASH_OK;
+}
+
+w25q_error_codes_t w25q128jw_io_submit(w25q_io_req_t *req) {
+    // Sanity checks
+    if (req == NULL || req->addr > MAX_FLASH_ADDR) return FLASH_ERROR;
+    if (req->op == W25Q_IO_READ || req->op == W25Q_IO_PROGRAM) {
+        if (w25q128jw_sanity_checks(req->addr, req->data, req->length) != FLASH_OK) return FLASH_ERROR;
+        if ((uintptr_t)req->data % 4 != 0) return FLASH_ERROR;
+    } else if (req->op > W25Q_IO_ERASE_64K) {
+        return FLASH_ERROR;
+    }
+
+    req->done = 0;
+    req->status = FLASH_OK;
+    req->progress = 0;
+    req->segment = 0;
+
+    // The queue is also modified from the interrupts, and callbacks may submit
+    uint32_t mstatus;
+    CSR_READ(CSR_REG_MSTATUS, &mstatus);
+    CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+
+    w25q_error_codes_t ret = FLASH_OK;
+    if (io.count == W25Q_IO_QUEUE_LEN) {
+        ret = FLASH_ERROR;
+    } else {
+        io.reqs[(io.head + io.count) % W25Q_IO_QUEUE_LEN] = req;
+        io.count++;
+        if (io.count == 1) io_start();
+    }
+
+    CSR_WRITE(CSR_REG_MSTATUS, mstatus);
+    return ret;
+}
+
+void w25q128jw_io_deinit(void) {
+    if (!io.ready) return;
+
+#if IO_TIMER
+    CSR_CLEAR_BITS(CSR_REG_MIE, IO_TIMER_MIE_MASK);
+    enable_fast_interrupt(kTimer_3_fic_e, false);
+    rv_timer_irq_enable(&io_timer, IO_TIMER_HART, 0, kRvTimerDisabled);
+    rv_timer_arm(&io_timer, IO_TIMER_HART, 0, UINT64_MAX);
+    rv_timer_irq_clear(&io_timer, IO_TIMER_HART, 0);
+    fic_set_handler(kTimer_3_fic_e, NULL);
+#endif
+
+    dma_channel_release(io.channel);
+    io.ready = 0;
+}
+
+uint32_t w25q128jw_io_pending(void) {
+#if !IO_TIMER
+    // No timer to poll the flash
+    if (io.busy) {
+        uint32_t mstatus;
+        CSR_READ(CSR_REG_MSTATUS, &mstatus);
+        CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+        if (io.busy) io_poll();
+        CSR_WRITE(CSR_REG_MSTATUS, mstatus);
+    }
+#endif
+    return io.count;
+}
+
+void w25q128jw_io_wait(void) {
+    while (w25q128jw_io_pending()) {
+#if IO_TIMER
+        CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+        if (io.count) wait_for_interrupt();
+        CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+#endif
+    }
+}
+
 /****************************************************************************/
 /**                                                                        **/
 /*                            LOCAL FUNCTIONS                               */
@@ -1474,33 +1727,34 @@ static void configure_spi(void) {
 }
 
 static void flash_wait(void) {
+    while(flash_busy());
+}
+
+static bool flash_busy(void) {
     spi_set_rx_watermark(spi,1);
-    bool flash_busy = true;
     uint8_t flash_resp[4] = {0xff,0xff,0xff,0xff};
 
-    while(flash_busy){
-        uint32_t flash_cmd = FC_RSR1; // [CMD] Read status register 1
-        spi_write_word(spi, flash_cmd); // Push TX buffer
-        uint32_t spi_status_cmd = spi_create_command((spi_command_t){
-            .len        = 0,
-            .csaat      = true,
-            .speed      = SPI_SPEED_STANDARD,
-            .direction  = SPI_DIR_TX_ONLY
-        });
-        uint32_t spi_status_read_cmd = spi_create_command((spi_command_t){
-            .len        = 0,
-            .csaat      = false,
-            .speed      = SPI_SPEED_STANDARD,
-            .direction  = SPI_DIR_RX_ONLY
-        });
-        spi_set_command(spi, spi_status_cmd);
-        spi_wait_for_ready(spi);
-        spi_set_command(spi, spi_status_read_cmd);
-        spi_wait_for_ready(spi);
-        spi_wait_for_rx_watermark(spi);
-        spi_read_word(spi, (uint32_t *)flash_resp);
-        if ((flash_resp[0] & 0x01) == 0) flash_busy = false;
-    }
+    uint32_t flash_cmd = FC_RSR1; // [CMD] Read status register 1
+    spi_write_word(spi, flash_cmd); // Push TX buffer
+    uint32_t spi_status_cmd = spi_create_command((spi_command_t){
+        .len        = 0,
+        .csaat      = true,
+        .speed      = SPI_SPEED_STANDARD,
+        .direction  = SPI_DIR_TX_ONLY
+    });
+    uint32_t spi_status_read_cmd = spi_create_command((spi_command_t){
+        .len        = 0,
+        .csaat      = false,
+        .speed      = SPI_SPEED_STANDARD,
+        .direction  = SPI_DIR_RX_ONLY
+    });
+    spi_set_command(spi, spi_status_cmd);
+    spi_wait_for_ready(spi);
+    spi_set_command(spi, spi_status_read_cmd);
+    spi_wait_for_ready(spi);
+    spi_wait_for_rx_watermark(spi);
+    spi_read_word(spi, (uint32_t *)flash_resp);
+    return (flash_resp[0] & 0x01) != 0;
 }
 
 static void flash_reset(void) {
@@ -1618,22 +1872,16 @@ static w25q_error_codes_t page_write(uint32_t addr, uint8_t *data, uint32_t leng
     flash_write_enable();
 
     /*
-     * Build and send write command (24bit address + command).
-     * The command is picked based on the quad flag.
+     * Queue write command (24bit address + command) and data segment.
+     * The program is picked based on the quad flag.
     */
-    const uint32_t write_byte_cmd = ((REVERT_24b_ADDR(addr & 0x00ffffff) << 8) | (quad ? FC_PPQ : FC_PP));
-    spi_write_word(spi, write_byte_cmd);
-    const uint32_t cmd_write = spi_create_command((spi_command_t){
-        .len        = 3,
-        .csaat      = true,
-        .speed      = SPI_SPEED_STANDARD,
-        .direction  = SPI_DIR_TX_ONLY
-    });
-    spi_set_command(spi, cmd_write);
-    spi_wait_for_ready(spi);
+    spi_program_t *prog = quad ? &prog_write_quad : &prog_write;
+    spi_program_set_word(prog, 0, (REVERT_24b_ADDR(addr & 0x00ffffff) << 8) | (quad ? FC_PPQ : FC_PP));
+    spi_program_set_len(prog, 1, length);
+    spi_program_issue(spi, prog);
 
     /*
-     * Place data in TX FIFO
+     * Place data in TX FIFO, the SPI waits for it.
      * In simulation it do not wait for the flash to be ready, so we must check
      * if the FIFO is full before writing.
     */
@@ -1653,31 +1901,20 @@ static w25q_error_codes_t page_write(uint32_t addr, uint8_t *data, uint32_t leng
         }
     }
 
-    /*
-     * Set up segment parameters -> send data.
-     * Speed is quad if quad flag is set, standard otherwise.
-    */
-    const uint32_t cmd_write_2 = spi_create_command((spi_command_t){
-        .len        = length-1,
-        .csaat      = false,
-        .speed      = quad ? SPI_SPEED_QUAD : SPI_SPEED_STANDARD,
-        .direction  = SPI_DIR_TX_ONLY
-    });
-    spi_set_command(spi, cmd_write_2);
-    spi_wait_for_ready(spi);
-
     // Wait for flash to be ready again (FPGA only)
     #ifndef TARGET_SIM
     flash_wait();
     #endif // TARGET_SIM
+
+    w25q128jw_modified(addr, length);
 }
 
 static w25q_error_codes_t dma_send_toflash(uint8_t *data, uint32_t length) {
     // SPI and SPI_FLASH are the same IP so same register map
     uint32_t *fifo_ptr_tx = (uint32_t *)((uintptr_t)spi + SPI_HOST_TXDATA_REG_OFFSET);
 
-    // Init DMA, the integrated DMA is used (peri == NULL)
-    dma_init(NULL);
+    // Get a DMA channel
+    if (dma_channel_get() != FLASH_OK) return FLASH_ERROR_DMA;
 
     // The DMA will wait for the SPI FLASH TX FIFO valid signal
     uint8_t slot = DMA_TRIG_SLOT_SPI_FLASH_TX;
@@ -1710,18 +1947,21 @@ static w25q_error_codes_t dma_send_toflash(uint8_t *data, uint32_t length) {
     };
     // Size is in data units (words in this case)
     trans.size_d1_du = length>>2;
+    trans.channel = flash_dma.channel;
 
     // Validate, load and launch DMA transaction
     dma_config_flags_t res;
     res = dma_validate_transaction(&trans, DMA_ENABLE_REALIGN, DMA_PERFORM_CHECKS_INTEGRITY );
-    if (res != DMA_CONFIG_OK) return FLASH_ERROR_DMA;
-    res = dma_load_transaction(&trans);
-    if (res != DMA_CONFIG_OK) return FLASH_ERROR_DMA;
-    res = dma_launch(&trans);
-    if (res != DMA_CONFIG_OK) return FLASH_ERROR_DMA;
+    if (res == DMA_CONFIG_OK) res = dma_load_transaction(&trans);
+    if (res == DMA_CONFIG_OK) res = dma_launch(&trans);
+    if (res != DMA_CONFIG_OK) {
+        dma_channel_put();
+        return FLASH_ERROR_DMA;
+    }
 
     // Wait for DMA to finish transaction
-    while(!dma_is_ready(0));
+    while(!dma_is_ready(flash_dma.channel));
+    dma_channel_put();
 
     // Take into account the extra bytes (if any)
     if (length % 4 != 0) {
@@ -1733,6 +1973,31 @@ static w25q_error_codes_t dma_send_toflash(uint8_t *data, uint32_t length) {
     return FLASH_OK;
 }
 
+static w25q_error_codes_t dma_channel_get(void) {
+    // The previous asynchronous read keeps its channel
+    if (flash_dma.held) {
+        while(!dma_is_ready(flash_dma.channel));
+        return FLASH_OK;
+    }
+
+    // The owners may be waiting for the BSP, do not wait for them forever
+    dma_config_flags_t res = DMA_CONFIG_CHANNEL_BUSY;
+    for (uint32_t i = 0; i < W25Q_DMA_ACQUIRE_TRIES && res == DMA_CONFIG_CHANNEL_BUSY; i++) {
+        res = dma_channel_acquire(DMA_CH_PRIO_NORMAL, 0, &flash_dma.channel);
+    }
+    if (res != DMA_CONFIG_OK) return FLASH_ERROR_DMA;
+
+    flash_dma.held = 1;
+    return FLASH_OK;
+}
+
+static void dma_channel_put(void) {
+    if (flash_dma.held) {
+        dma_channel_release(flash_dma.channel);
+        flash_dma.held = 0;
+    }
+}
+
 static void flash_write_enable(void) {
     spi_write_word(spi, FC_WE);
     const uint32_t cmd_write_en = spi_create_command((spi_command_t){
@@ -1745,6 +2010,372 @@ static void flash_write_enable(void) {
     spi_wait_for_ready(spi);
 }
 
+static w25q_error_codes_t stream_start(uint32_t addr, uint32_t length, const w25q_stream_t *stream, uint32_t base) {
+    // Sanity checks
+    if (w25q128jw_sanity_checks(addr, (uint8_t *)stream->dst, length) != FLASH_OK) return FLASH_ERROR;
+
+    // The DMA moves whole words, a chunk must end on a window
+    if (length % 4 != 0 || length > W25Q_STREAM_MAX_LEN) return FLASH_ERROR;
+    if ((uintptr_t)stream->dst % 4 != 0 || stream->chunk % 4 != 0) return FLASH_ERROR;
+    if ((stream->chunk >> 2) > DMA_WINDOW_SIZE_WINDOW_SIZE_MASK) return FLASH_ERROR;
+
+    stream_state.cb = stream->cb;
+    stream_state.arg = stream->arg;
+    stream_state.chunk = (stream->chunk != 0 && stream->chunk < length) ? stream->chunk : length;
+    stream_state.base = base;
+    stream_state.length = length;
+    stream_state.offset = 0;
+
+    /*
+     * SET UP DMA
+    */
+    // SPI and SPI_FLASH are the same IP so same register map
+    uint32_t *fifo_ptr_rx = (uint32_t *)((uintptr_t)spi + SPI_HOST_RXDATA_REG_OFFSET);
+
+    // Get a DMA channel, kept until the end of the stream
+    if (dma_channel_get() != FLASH_OK) return FLASH_ERROR_DMA;
+
+    // Set up DMA source target
+    static dma_target_t tgt_src = {
+        .inc_d1_du = 0, // Target is peripheral, no increment
+        .type = DMA_DATA_TYPE_WORD, // Data type is word
+        .trig = DMA_TRIG_SLOT_SPI_FLASH_RX, // Wait for the SPI FLASH RX FIFO valid signal
+    };
+    // Target is SPI RX FIFO
+    tgt_src.ptr = (uint8_t*)fifo_ptr_rx;
+
+    // Set up DMA destination target, a peripheral instead of a RAM buffer
+    static dma_target_t tgt_dst = {
+        .type = DMA_DATA_TYPE_WORD, // Data type is word
+    };
+    tgt_dst.ptr = (uint8_t*)stream->dst;
+    tgt_dst.inc_d1_du = stream->dst_inc;
+    tgt_dst.trig = (dma_trigger_slot_mask_t)stream->dst_trig;
+
+    // Set up DMA transaction, a window interrupt after each chunk
+    static dma_trans_t trans = {
+        .src = &tgt_src,
+        .dst = &tgt_dst,
+        .end = DMA_TRANS_END_INTR,
+    };
+    // Size is in data units (words in this case)
+    trans.size_d1_du = length>>2;
+    trans.win_du = stream->cb != NULL ? stream_state.chunk>>2 : 0;
+    trans.channel = flash_dma.channel;
+
+    // Validate, load and launch DMA transaction
+    dma_config_flags_t res;
+    res = dma_validate_transaction(&trans, DMA_ENABLE_REALIGN, DMA_PERFORM_CHECKS_INTEGRITY );
+    if (res & DMA_CONFIG_CRITICAL_ERROR) {
+        dma_channel_put();
+        return FLASH_ERROR_DMA;
+    }
+
+    if (stream->cb != NULL) {
+        dma_set_window_callback(flash_dma.channel, stream_window_done, NULL);
+    }
+    res = dma_load_transaction(&trans);
+    res |= dma_launch(&trans);
+    if (res != DMA_CONFIG_OK) {
+        dma_set_window_callback(flash_dma.channel, NULL, NULL);
+        dma_channel_put();
+        return FLASH_ERROR_DMA;
+    }
+
+    // The callbacks and the wait need the interrupts
+    CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+
+    read_command(addr, length, stream->quad);
+
+    return FLASH_OK;
+}
+
+static void read_command(uint32_t addr, uint32_t length, uint8_t quad) {
+    if (!quad) {
+        // Address + Read command
+        spi_program_set_word(&prog_read, 0, (REVERT_24b_ADDR(addr & 0x00ffffff) << 8) | FC_RD);
+        spi_program_set_len(&prog_read, 1, length);
+        spi_program_issue(spi, &prog_read);
+    } else {
+        // Address at quad speed, last byte is Fxh (here FFh) required by W25Q128JW
+        spi_program_set_word(&prog_read_quad, 1, REVERT_24b_ADDR(addr) | (0xFF << 24));
+        spi_program_set_len(&prog_read_quad, 3, length);
+        spi_program_issue(spi, &prog_read_quad);
+    }
+}
+
+static void build_programs(void) {
+    // The address word is set by each read or page program
+    const uint32_t address_word[] = { 0 };
+
+    // Read: address + read command at standard speed, then length bytes
+    const spi_segment_t read[] = {
+        SPI_SEG_TX(4),
+        SPI_SEG_RX(4),
+    };
+    spi_program_build(&prog_read, read, 2, address_word, 1);
+
+    // Quad I/O read: command at standard speed, address and dummy cycles, then length bytes at quad speed
+    const spi_segment_t read_quad[] = {
+        SPI_SEG_TX(1),
+        SPI_SEG_TX_QUAD(4),
+        #ifndef TARGET_SIM
+        SPI_SEG_DUMMY(DUMMY_CLOCKS_FAST_READ_QUAD_IO), // W25Q128JW flash needs 4 dummy cycles
+        #else
+        SPI_SEG_DUMMY(DUMMY_CLOCKS_SIM), // SPI flash simulation model needs 8 dummy cycles
+        #endif
+        SPI_SEG_RX_QUAD(4),
+    };
+    const uint32_t read_quad_words[] = { FC_RDQIO, 0 };
+    spi_program_build(&prog_read_quad, read_quad, 4, read_quad_words, 2);
+
+    // Page program: address + command at standard speed, then the data
+    const spi_segment_t write[] = {
+        SPI_SEG_TX(4),
+        SPI_SEG_TX(4),
+    };
+    const spi_segment_t write_quad[] = {
+        SPI_SEG_TX(4),
+        SPI_SEG_TX_QUAD(4),
+    };
+    spi_program_build(&prog_write, write, 2, address_word, 1);
+    spi_program_build(&prog_write_quad, write_quad, 2, address_word, 1);
+}
+
+static void stream_window_done(uint8_t channel, void *arg) {
+    stream_state.offset += stream_state.chunk;
+    stream_state.cb(stream_state.base + stream_state.offset, stream_state.arg);
+}
+
+static void io_start(void) {
+    w25q_io_req_t *req = io.reqs[io.head];
+    uint32_t addr = req->addr + req->progress;
+    uint8_t *data = (uint8_t *)req->data + req->progress;
+    uint32_t remaining = req->length - req->progress;
+    uint32_t erase_cmd;
+
+    switch (req->op) {
+    case W25Q_IO_READ:
+        req->segment = MIN(remaining, IO_MAX_READ);
+
+        // A read shorter than a word is done right away
+        if (req->segment < 4) {
+            io_complete(w25q128jw_read_quad(addr, data, req->segment));
+            return;
+        }
+
+        // The DMA empties the RX FIFO while the flash is read
+        io_tgt_fifo = (dma_target_t){
+            .ptr = (uint8_t *)((uintptr_t)spi + SPI_HOST_RXDATA_REG_OFFSET),
+            .inc_d1_du = 0,
+            .type = DMA_DATA_TYPE_WORD,
+            .trig = DMA_TRIG_SLOT_SPI_FLASH_RX,
+        };
+        io_tgt_mem = (dma_target_t){
+            .ptr = data,
+            .inc_d1_du = 1,
+            .type = DMA_DATA_TYPE_WORD,
+            .trig = DMA_TRIG_MEMORY,
+        };
+        io_trans = (dma_trans_t){
+            .src = &io_tgt_fifo,
+            .dst = &io_tgt_mem,
+            .size_d1_du = req->segment >> 2,
+            .mode = DMA_TRANS_MODE_SINGLE,
+            .end = DMA_TRANS_END_INTR,
+            .channel = io.channel,
+        };
+        if (dma_validate_transaction(&io_trans, DMA_ENABLE_REALIGN, DMA_PERFORM_CHECKS_INTEGRITY) != DMA_CONFIG_OK
+            || dma_queue_push(&io_trans, io_dma_done, NULL) != DMA_CONFIG_OK) {
+            io_complete(FLASH_ERROR_DMA);
+            return;
+        }
+        read_command(addr, req->segment, 1);
+        break;
+
+    case W25Q_IO_PROGRAM:
+        // Up to the end of the page
+        req->segment = MIN(remaining, FLASH_PAGE_SIZE - addr % FLASH_PAGE_SIZE);
+
+        // The DMA fills the TX FIFO once the command is sent, the SPI waits for it
+        if (req->segment >= 4) {
+            io_tgt_mem = (dma_target_t){
+                .ptr = data,
+                .inc_d1_du = 1,
+                .type = DMA_DATA_TYPE_WORD,
+                .trig = DMA_TRIG_MEMORY,
+            };
+            io_tgt_fifo = (dma_target_t){
+                .ptr = (uint8_t *)((uintptr_t)spi + SPI_HOST_TXDATA_REG_OFFSET),
+                .inc_d1_du = 0,
+                .type = DMA_DATA_TYPE_WORD,
+                .trig = DMA_TRIG_SLOT_SPI_FLASH_TX,
+            };
+            io_trans = (dma_trans_t){
+                .src = &io_tgt_mem,
+                .dst = &io_tgt_fifo,
+                .size_d1_du = req->segment >> 2,
+                .mode = DMA_TRANS_MODE_SINGLE,
+                .end = DMA_TRANS_END_INTR,
+                .channel = io.channel,
+            };
+            if (dma_validate_transaction(&io_trans, DMA_ENABLE_REALIGN, DMA_PERFORM_CHECKS_INTEGRITY) != DMA_CONFIG_OK) {
+                io_complete(FLASH_ERROR_DMA);
+                return;
+            }
+        }
+
+        flash_write_enable();
+        spi_program_set_word(&prog_write_quad, 0, (REVERT_24b_ADDR(addr & 0x00ffffff) << 8) | FC_PPQ);
+        spi_program_set_len(&prog_write_quad, 1, req->segment);
+        spi_program_issue(spi, &prog_write_quad);
+
+        if (req->segment >= 4) {
+            // The channel is idle, the push cannot fail
+            dma_queue_push(&io_trans, io_dma_done, NULL);
+        } else {
+            uint32_t last_word = 0;
+            memcpy(&last_word, data, req->segment);
+            spi_write_word(spi, last_word);
+            io_dma_done(NULL, NULL);
+        }
+        break;
+
+    default:
+        flash_write_enable();
+
+        // Build and send erase command
+        erase_cmd = req->op == W25Q_IO_ERASE_4K ? FC_SE :
+                    req->op == W25Q_IO_ERASE_32K ? FC_BE32 : FC_BE64;
+        spi_write_word(spi, (REVERT_24b_ADDR(addr & 0x00ffffff) << 8) | erase_cmd);
+        spi_wait_for_ready(spi);
+        const uint32_t cmd_erase = spi_create_command((spi_command_t){
+            .len        = 3,                 // 4 Bytes
+            .csaat      = false,             // End command
+            .speed      = SPI_SPEED_STANDARD, // Single speed
+            .direction  = SPI_DIR_TX_ONLY      // Write only
+        });
+        spi_set_command(spi, cmd_erase);
+        spi_wait_for_ready(spi);
+
+        io.busy = 1;
+        io_poll_later();
+        break;
+    }
+}
+
+static void io_dma_done(dma_trans_t *trans, void *arg) {
+    w25q_io_req_t *req = io.reqs[io.head];
+    uint8_t *data = (uint8_t *)req->data + req->progress;
+    uint32_t extra = req->segment % 4;
+
+    if (req->op == W25Q_IO_READ) {
+        // Take into account the extra bytes (if any)
+        if (extra != 0) {
+            uint32_t last_word = 0;
+            spi_wait_for_rx_not_empty(spi);
+            spi_read_word(spi, &last_word);
+            memcpy(&data[req->segment - extra], &last_word, extra);
+        }
+        req->progress += req->segment;
+
+        if (req->progress < req->length) io_start();
+        else io_complete(FLASH_OK);
+        return;
+    }
+
+    // Program: the last bytes go after the words moved by the DMA
+    if (extra != 0 && req->segment >= 4) {
+        uint32_t last_word = 0;
+        memcpy(&last_word, &data[req->segment - extra], extra);
+        spi_wait_for_tx_not_full(spi);
+        spi_write_word(spi, last_word);
+    }
+    spi_wait_for_idle(spi);
+
+    // Wait for flash to be ready again (FPGA only), as in page_write()
+    #ifndef TARGET_SIM
+    io.busy = 1;
+    io_poll_later();
+    #else
+    io_flash_ready();
+    #endif // TARGET_SIM
+}
+
+static void io_poll(void) {
+    if (flash_busy()) {
+        io_poll_later();
+        return;
+    }
+    io.busy = 0;
+    io_flash_ready();
+}
+
+static void io_flash_ready(void) {
+    w25q_io_req_t *req = io.reqs[io.head];
+
+    switch (req->op) {
+    case W25Q_IO_PROGRAM:
+        w25q128jw_modified(req->addr + req->progress, req->segment);
+        req->progress += req->segment;
+        if (req->progress < req->length) io_start();
+        else io_complete(FLASH_OK);
+        break;
+    case W25Q_IO_ERASE_4K:
+        w25q128jw_modified(req->addr & 0x00fff000, FLASH_SECTOR_SIZE);
+        io_complete(FLASH_OK);
+        break;
+    case W25Q_IO_ERASE_32K:
+        w25q128jw_modified(req->addr & 0x00ff8000, 0x8000);
+        io_complete(FLASH_OK);
+        break;
+    default:
+        w25q128jw_modified(req->addr & 0x00ff0000, 0x10000);
+        io_complete(FLASH_OK);
+        break;
+    }
+}
+
+static void io_poll_later(void) {
+#if IO_TIMER
+    uint64_t now;
+
+    // The counter may have been stopped by a reset of the timer
+    rv_timer_counter_set_enabled(&io_timer, IO_TIMER_HART, kRvTimerEnabled);
+    rv_timer_counter_read(&io_timer, IO_TIMER_HART, &now);
+    rv_timer_arm(&io_timer, IO_TIMER_HART, 0, now + W25Q_IO_POLL_US);
+#endif
+}
+
+static void io_complete(w25q_error_codes_t status) {
+    w25q_io_req_t *req = io.reqs[io.head];
+
+    io.head = (io.head + 1) % W25Q_IO_QUEUE_LEN;
+    io.count--;
+
+    /*
+     * If the queue is empty, a request submitted by the callback is started
+     * by w25q128jw_io_submit(), otherwise the next one is started here.
+    */
+    uint8_t next = io.count > 0;
+
+    req->status = status;
+    req->done = 1;
+    if (req->cb != NULL) req->cb(req, req->arg);
+
+    if (next) io_start();
+}
+
+#if IO_TIMER
+static void io_timer_irq(void) {
+    // Disarm before clearing, as the interrupt stays asserted above the threshold
+    rv_timer_arm(&io_timer, IO_TIMER_HART, 0, UINT64_MAX);
+    rv_timer_irq_clear(&io_timer, IO_TIMER_HART, 0);
+
+    if (io.busy) io_poll();
+}
+#endif
+
 static w25q_error_codes_t w25q128jw_sanity_checks(uint32_t addr, uint8_t *data, uint32_t length) {
     // Check if address is out of range
     if (addr > MAX_FLASH_ADDR || addr < 0) return FLASH_ERROR;
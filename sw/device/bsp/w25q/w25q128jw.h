@@ -144,6 +144,33 @@
 */
 #define MAX_FLASH_ADDR 0x00ffffff
 
+/**
+ * @brief Largest number of bytes streamed by a single call to
+ * w25q128jw_stream_dma_async(), limited by the size of a DMA transaction.
+*/
+#define W25Q_STREAM_MAX_LEN (0xffff*4)
+
+/**
+ * @brief Maximum number of requests in the queue of the I/O engine.
+*/
+#define W25Q_IO_QUEUE_LEN 8
+
+/**
+ * @brief Period at which the I/O engine polls the BUSY bit of the flash
+ * during a page program or an erase, in microseconds.
+*/
+#ifndef W25Q_IO_POLL_US
+#define W25Q_IO_POLL_US 50
+#endif
+
+/**
+ * @brief Number of attempts to acquire a DMA channel while all of them are
+ * owned by other users, before a DMA read or write returns FLASH_ERROR_DMA.
+*/
+#ifndef W25Q_DMA_ACQUIRE_TRIES
+#define W25Q_DMA_ACQUIRE_TRIES 10000
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -159,6 +186,74 @@ extern "C" {
 */
 typedef uint8_t w25q_error_codes_t;
 
+/**
+ * @brief Function called each time a chunk of a stream has been written
+ * to its destination.
+ *
+ * It is called from the DMA window interrupt, except for the chunks that
+ * are reported by w25q128jw_wait_stream_dma().
+ *
+ * @param offset bytes of the stream written so far.
+ * @param arg argument of the stream.
+*/
+typedef void (*w25q_stream_cb_t)(uint32_t offset, void *arg);
+
+/**
+ * @brief Destination of a stream of flash data.
+*/
+typedef struct {
+    volatile void *dst;   /** Register or memory of the peripheral written. */
+    uint8_t dst_inc;      /** Words between two writes: 0 for a register, 1 for a memory. */
+    uint8_t dst_trig;     /** DMA trigger slot of the destination, 0 (DMA_TRIG_MEMORY) if it never stalls. */
+    uint32_t chunk;       /** Bytes between two calls of cb, multiple of 4. 0 for no calls. */
+    w25q_stream_cb_t cb;  /** Function called after each chunk, or NULL. */
+    void *arg;            /** Argument of cb. */
+    uint8_t quad;         /** 1 to read at quad speed, 0 at standard speed. */
+} w25q_stream_t;
+
+/**
+ * @brief Operations of the requests of the I/O engine.
+*/
+typedef enum {
+    W25Q_IO_READ,       /** Read at quad speed, with DMA. */
+    W25Q_IO_PROGRAM,    /** Program at quad speed, with DMA, split in pages. */
+    W25Q_IO_ERASE_4K,   /** Erase the 4kb sector that contains addr. */
+    W25Q_IO_ERASE_32K,  /** Erase the 32kb block that contains addr. */
+    W25Q_IO_ERASE_64K,  /** Erase the 64kb block that contains addr. */
+} w25q_io_op_t;
+
+typedef struct w25q_io_req w25q_io_req_t;
+
+/**
+ * @brief Function called from an interrupt when a request is done.
+ *
+ * The request has left the queue: it can be submitted again, and other
+ * requests can be submitted from the callback.
+ *
+ * @param req the request, with its status set.
+ * @param arg argument of the request.
+*/
+typedef void (*w25q_io_cb_t)(w25q_io_req_t *req, void *arg);
+
+/**
+ * @brief Request of the I/O engine. It belongs to the caller and must stay
+ * valid until it is done.
+*/
+struct w25q_io_req {
+    w25q_io_op_t op;        /** Operation. */
+    uint32_t addr;          /** 24-bit flash address. */
+    void *data;             /** Buffer read or programmed, word aligned. Unused by erases. */
+    uint32_t length;        /** Bytes read or programmed. Unused by erases. */
+    w25q_io_cb_t cb;        /** Function called when the request is done, or NULL. */
+    void *arg;              /** Argument of cb. */
+
+    /** Set by the engine. */
+    volatile uint8_t done;              /** 1 when the request is done. */
+    volatile w25q_error_codes_t status; /** FLASH_OK, or @ref error_codes once done. */
+    uint32_t progress;                  /** Bytes already read or programmed. */
+    uint32_t segment;                   /** Bytes of the ongoing read or program. */
+};
+
 /****************************************************************************/
 /**                                                                        **/
 /**                          EXPORTED VARIABLES                            **/
@@ -177,6 +272,27 @@ typedef uint8_t w25q_error_codes_t;
 */
 void w25q128jw_init_crt0();
 
+/**
+ * @brief Start copying from flash to RAM with the DMA, used by crt0 flash_load
+ * to load the code and the data left by the bootrom.
+ *
+ * The read uses the quad I/O mode if the QE bit of the flash is set (see
+ * W25Q_BOOT_QUAD in w25q.c), the standard mode otherwise. The previous copy,
+ * if any, is waited for first. Only the code of the .init section is used, as
+ * the rest may not be loaded yet.
+ *
+ * @param addr address to read from.
+ * @param data pointer to the destination, word aligned.
+ * @param length number of bytes to copy, multiple of 4.
+ * @return FLASH_OK if the copy started, FLASH_ERROR otherwise.
+*/
+w25q_error_codes_t w25q128jw_boot_read_dma(uint32_t addr, void *data, uint32_t length);
+
+/**
+ * @brief Wait for the end of the copy started by w25q128jw_boot_read_dma().
+*/
+void w25q128jw_boot_wait_dma(void);
+
 /**
  * @brief Power up and itialize the flash.
  *
@@ -272,6 +388,9 @@ w25q_error_codes_t w25q128jw_erase_and_write_standard(uint32_t addr, void* data,
 /**
  * @brief Read from flash at standard speed using DMA
  *
+ * If no_wait_init_dma is set, the DMA channel is kept after returning, as for
+ * w25q128jw_read_standard_dma_async().
+ *
  * @param addr 24-bit flash address to read from.
  * @param data pointer to the data buffer.
  * @param length number of bytes to read.
@@ -282,6 +401,10 @@ w25q_error_codes_t w25q128jw_read_standard_dma(uint32_t addr, void *data, uint32
 /**
  * @brief Read from flash at standard speed using DMA but wait for DMA in the application
  *
+ * The channel is acquired from the DMA channel manager and kept until
+ * w25q128jw_dma_release() or the next DMA transaction of the BSP. Wait on the
+ * channel given by w25q128jw_dma_channel().
+ *
  * @param addr 24-bit flash address to read from.
  * @param data pointer to the data buffer.
  * @param length number of bytes to read, must be multiple of 4
@@ -378,6 +501,61 @@ w25q_error_codes_t w25q128jw_read_quad_dma_async(uint32_t addr, void *data, uint
 */
 void w25q128jw_wait_quad_dma_async(void *data, uint32_t length);
 
+/**
+ * @brief DMA channel of the last DMA transaction of the BSP.
+ *
+ * @return the channel to wait on after an asynchronous read.
+*/
+uint8_t w25q128jw_dma_channel(void);
+
+/**
+ * @brief Wait for the asynchronous DMA read and give its channel back to the
+ * DMA channel manager.
+*/
+void w25q128jw_dma_release(void);
+
+/**
+ * @brief Stream flash data directly to a peripheral or an accelerator using DMA.
+ *
+ * The DMA copies the flash data from the SPI RX FIFO to the destination of
+ * the stream, without staging it in RAM. With a destination trigger slot,
+ * the DMA waits for the peripheral to accept data, and the flash is stalled
+ * in the meanwhile. The callback of the stream is called each time a chunk
+ * has been written, e.g. to start the processing of the accelerator.
+ * The DMA channel is acquired from the channel manager and released by
+ * w25q128jw_wait_stream_dma(), which must be called to end the stream.
+ *
+ * @param addr 24-bit flash address to read from.
+ * @param length number of bytes to stream, multiple of 4 and at most W25Q_STREAM_MAX_LEN.
+ * @param stream destination of the stream.
+ * @return FLASH_OK if the stream started, @ref error_codes otherwise.
+*/
+w25q_error_codes_t w25q128jw_stream_dma_async(uint32_t addr, uint32_t length, const w25q_stream_t *stream);
+
+/**
+ * @brief Wait for the end of w25q128jw_stream_dma_async().
+ *
+ * The chunks whose interrupt was not handled yet, and the last one if it is
+ * shorter than the others, are reported to the callback before returning.
+ *
+ * @return FLASH_OK.
+*/
+w25q_error_codes_t w25q128jw_wait_stream_dma(void);
+
+/**
+ * @brief Stream flash data directly to a peripheral or an accelerator using DMA.
+ *
+ * Same as w25q128jw_stream_dma_async() followed by w25q128jw_wait_stream_dma(),
+ * without limit on the length: longer streams are split into several reads,
+ * and the offsets given to the callback count from the start of the stream.
+ *
+ * @param addr 24-bit flash address to read from.
+ * @param length number of bytes to stream, multiple of 4.
+ * @param stream destination of the stream.
+ * @return FLASH_OK if the stream is done, @ref error_codes otherwise.
+*/
+w25q_error_codes_t w25q128jw_stream_dma(uint32_t addr, uint32_t length, const w25q_stream_t *stream);
+
 /**
  * @brief Write to flash at quad speed using DMA. Use this function only to write to unitialized data
  *
@@ -398,6 +576,18 @@ w25q_error_codes_t w25q128jw_write_quad_dma(uint32_t addr, void* data, uint32_t
 */
 w25q_error_codes_t w25q128jw_erase_and_write_quad_dma(uint32_t addr, void* data, uint32_t length);
 
+/**
+ * @brief Called by the write and erase functions after the flash content
+ * from addr to addr + length has been modified.
+ *
+ * The default implementation is weak and does nothing. The flash cache
+ * (w25q_cache.h) overrides it to drop the lines that became stale.
+ *
+ * @param addr 24-bit address of the first byte modified.
+ * @param length number of bytes modified.
+*/
+void w25q128jw_modified(uint32_t addr, uint32_t length);
+
 /**
  * @brief Erase a 4kb sector.
  *
@@ -465,6 +655,61 @@ void w25q128jw_reset_force(void);
 */
 void w25q128jw_power_down(void);
 
+/**
+ * @brief Set up the I/O engine, with an empty queue.
+ *
+ * The engine performs the requests one after the other, in the background:
+ * reads and page programs are moved by the DMA, and the BUSY bit of the flash
+ * is polled every W25Q_IO_POLL_US from the interrupt of the second hart of
+ * the peripheral timer (fast interrupt timer 3) while a program or an erase is
+ * ongoing. The first hart of the timer is left untouched. The handler is
+ * registered with fic_set_handler() and takes precedence over fic_irq_timer_3()
+ * until w25q128jw_io_deinit(). Without the peripheral timer, the BUSY bit is
+ * polled by w25q128jw_io_pending().
+ *
+ * The timer and DMA interrupts are enabled in mie, but interrupts are not
+ * enabled globally: the application sets mstatus.MIE when it is ready.
+ *
+ * The engine acquires a DMA channel from the channel manager and uses it
+ * through its transaction queue until w25q128jw_io_deinit().
+ * The other functions of this BSP must not be used while requests are pending.
+ *
+ * @return FLASH_OK if the engine is ready, FLASH_ERROR_DMA if no DMA channel
+ * is free, @ref error_codes otherwise.
+*/
+w25q_error_codes_t w25q128jw_io_init(void);
+
+/**
+ * @brief Stop the I/O engine: release its DMA channel and its timer interrupt.
+ *
+ * No request must be pending.
+*/
+void w25q128jw_io_deinit(void);
+
+/**
+ * @brief Add a request to the queue of the I/O engine and return.
+ *
+ * The request is started immediately if the queue is empty. When it is done,
+ * its status is set, its done flag is raised and its callback is called.
+ * Programs must target erased memory, they are not erased before.
+ *
+ * @param req request, owned by the engine until it is done.
+ * @return FLASH_OK if the request is queued, FLASH_ERROR if it is not valid
+ * or if the queue is full.
+*/
+w25q_error_codes_t w25q128jw_io_submit(w25q_io_req_t *req);
+
+/**
+ * @brief Number of requests submitted and not done yet.
+*/
+uint32_t w25q128jw_io_pending(void);
+
+/**
+ * @brief Wait for all the requests of the I/O engine to be done, sleeping
+ * between the interrupts.
+*/
+void w25q128jw_io_wait(void);
+
 /****************************************************************************/
 /**                                                                        **/
 /**                          INLINE FUNCTIONS                              **/
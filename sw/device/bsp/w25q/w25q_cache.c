@@ -0,0 +1,282 @@
+/*
+                              *******************
+******************************* C SOURCE FILE *****************************
+**                            *******************
+**
+** project  : X-HEEP
+** filename : w25q_cache.c
+** version  : 1
+**
+***************************************************************************
+**
+** Copyright (c) EPFL contributors.
+** All rights reserved.
+**
+***************************************************************************
+*/
+
+/***************************************************************************/
+/***************************************************************************/
+/**
+* @file   w25q_cache.c
+* @brief  Source file of the read cache of the W25Q128JW flash.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+/****************************************************************************/
+/**                                                                        **/
+/*                             MODULES USED                                 */
+/**                                                                        **/
+/****************************************************************************/
+#include "string.h"
+
+#include "w25q_cache.h"
+
+/****************************************************************************/
+/**                                                                        **/
+/*                        DEFINITIONS AND MACROS                            */
+/**                                                                        **/
+/****************************************************************************/
+
+/**
+ * The entries are stored way by way: the same way of consecutive sets is
+ * contiguous, so consecutive lines of the flash can be filled by a single read.
+*/
+#define ENTRY(set, way) ((uint32_t)(way) * cache.sets + (set))
+#define LINE_PTR(set, way) ((uint8_t *)cache.lines + ENTRY(set, way) * W25Q_CACHE_LINE_SIZE)
+
+/**
+ * @brief Last line of the flash.
+*/
+#define LAST_LINE (MAX_FLASH_ADDR / W25Q_CACHE_LINE_SIZE)
+
+/****************************************************************************/
+/**                                                                        **/
+/*                      PROTOTYPES OF LOCAL FUNCTIONS                       */
+/**                                                                        **/
+/****************************************************************************/
+
+/**
+ * @brief Find a line in its set.
+ *
+ * @param line flash address / W25Q_CACHE_LINE_SIZE.
+ * @return the way that holds the line, or -1 if it is not cached.
+*/
+static int32_t lookup(uint32_t line);
+
+/**
+ * @brief Pick the way of a set that receives a new line: an empty one if
+ * any, otherwise the least recently used.
+ *
+ * @param set set of the new line.
+ * @return the way to replace.
+*/
+static uint32_t victim(uint32_t set);
+
+/**
+ * @brief Fill lines from the flash with a single read.
+ *
+ * From line, fetch up to max_lines consecutive lines that are not cached,
+ * whose sets are consecutive and whose victim is the same way.
+ *
+ * @param line first line, not cached.
+ * @param max_lines maximum number of lines to fetch.
+ * @param p_way set to the way that received the lines.
+ * @return the number of lines fetched, 0 on error.
+*/
+static uint32_t fill(uint32_t line, uint32_t max_lines, uint32_t *p_way);
+
+/****************************************************************************/
+/**                                                                        **/
+/*                            GLOBAL VARIABLES                              */
+/**                                                                        **/
+/****************************************************************************/
+
+/**
+ * @brief Configuration of the cache, lines is NULL before initialization.
+*/
+static w25q_cache_config_t cache;
+
+/**
+ * @brief Time of the last access to the cache.
+*/
+static uint32_t now;
+
+/**
+ * @brief Statistics of the cache.
+*/
+static w25q_cache_stats_t stats;
+
+/****************************************************************************/
+/**                                                                        **/
+/*                           EXPORTED FUNCTIONS                             */
+/**                                                                        **/
+/****************************************************************************/
+
+w25q_error_codes_t w25q_cache_init(const w25q_cache_config_t *config) {
+    // Sanity checks
+    if (config->lines == NULL || config->tags == NULL) return FLASH_ERROR;
+    if (config->sets == 0 || config->ways == 0) return FLASH_ERROR;
+    if ((uintptr_t)config->lines % 4 != 0) return FLASH_ERROR;
+
+    cache = *config;
+    now = 0;
+    w25q_cache_invalidate_all();
+    w25q_cache_reset_stats();
+
+    return FLASH_OK;
+}
+
+w25q_error_codes_t w25q_cache_read(uint32_t addr, void *data, uint32_t length) {
+    uint8_t *dst = (uint8_t *)data;
+
+    // Sanity checks
+    if (cache.lines == NULL || data == NULL || length == 0) return FLASH_ERROR;
+    if (addr > MAX_FLASH_ADDR || addr + length > MAX_FLASH_ADDR + 1) return FLASH_ERROR;
+
+    // A read larger than the cache would evict everything
+    if (length > (uint32_t)cache.sets * cache.ways * W25Q_CACHE_LINE_SIZE) {
+        stats.bypasses++;
+        return w25q128jw_read(addr, data, length);
+    }
+
+    uint32_t line = addr / W25Q_CACHE_LINE_SIZE;
+    uint32_t last = (addr + length - 1) / W25Q_CACHE_LINE_SIZE;
+
+    while (line <= last) {
+        uint32_t set = line % cache.sets;
+        int32_t hit = lookup(line);
+        uint32_t way = hit;
+        uint32_t lines = 1;
+
+        if (hit >= 0) {
+            stats.hits++;
+        } else {
+            // Fill the missing lines of the read and the next ones
+            uint32_t requested = last - line + 1;
+            lines = fill(line, requested + cache.readahead, &way);
+            if (lines == 0) return FLASH_ERROR;
+            if (lines > requested) {
+                stats.prefetched += lines - requested;
+                lines = requested;
+            }
+            stats.misses += lines;
+        }
+
+        // Copy the part of the lines that is read
+        for (uint32_t i = 0; i < lines; i++, line++, set++) {
+            uint32_t line_addr = line * W25Q_CACHE_LINE_SIZE;
+            uint32_t start = addr > line_addr ? addr - line_addr : 0;
+            uint32_t end = addr + length < line_addr + W25Q_CACHE_LINE_SIZE ?
+                           addr + length - line_addr : W25Q_CACHE_LINE_SIZE;
+
+            memcpy(dst, LINE_PTR(set, way) + start, end - start);
+            dst += end - start;
+            cache.tags[ENTRY(set, way)].used = ++now;
+        }
+    }
+
+    return FLASH_OK;
+}
+
+void w25q_cache_invalidate(uint32_t addr, uint32_t length) {
+    uint32_t first = addr / W25Q_CACHE_LINE_SIZE;
+    uint32_t last = (addr + length - 1) / W25Q_CACHE_LINE_SIZE;
+
+    if (cache.lines == NULL || length == 0) return;
+
+    for (uint32_t i = 0; i < (uint32_t)cache.sets * cache.ways; i++) {
+        uint32_t line = cache.tags[i].line;
+        if (line != W25Q_CACHE_INVALID && line >= first && line <= last) {
+            cache.tags[i].line = W25Q_CACHE_INVALID;
+            stats.invalidations++;
+        }
+    }
+}
+
+void w25q_cache_invalidate_all(void) {
+    for (uint32_t i = 0; i < (uint32_t)cache.sets * cache.ways; i++) {
+        cache.tags[i] = (w25q_cache_tag_t){ .line = W25Q_CACHE_INVALID, .used = 0 };
+    }
+}
+
+void w25q_cache_get_stats(w25q_cache_stats_t *p_stats) {
+    *p_stats = stats;
+}
+
+void w25q_cache_reset_stats(void) {
+    stats = (w25q_cache_stats_t){0};
+}
+
+void w25q128jw_modified(uint32_t addr, uint32_t length) {
+    w25q_cache_invalidate(addr, length);
+}
+
+/****************************************************************************/
+/**                                                                        **/
+/*                            LOCAL FUNCTIONS                               */
+/**                                                                        **/
+/****************************************************************************/
+
+static int32_t lookup(uint32_t line) {
+    uint32_t set = line % cache.sets;
+
+    for (uint32_t way = 0; way < cache.ways; way++) {
+        if (cache.tags[ENTRY(set, way)].line == line) return way;
+    }
+    return -1;
+}
+
+static uint32_t victim(uint32_t set) {
+    uint32_t lru = 0;
+
+    for (uint32_t way = 0; way < cache.ways; way++) {
+        const w25q_cache_tag_t *tag = &cache.tags[ENTRY(set, way)];
+        if (tag->line == W25Q_CACHE_INVALID) return way;
+        if (tag->used < cache.tags[ENTRY(set, lru)].used) lru = way;
+    }
+    return lru;
+}
+
+static uint32_t fill(uint32_t line, uint32_t max_lines, uint32_t *p_way) {
+    uint32_t set = line % cache.sets;
+    uint32_t way = victim(set);
+    uint32_t lines = 1;
+
+    // Extend the read while the lines land next to each other
+    while (lines < max_lines && set + lines < cache.sets && line + lines <= LAST_LINE
+           && lookup(line + lines) < 0 && victim(set + lines) == way) {
+        lines++;
+    }
+
+    // The old content of the lines is overwritten, even if the read fails
+    for (uint32_t i = 0; i < lines; i++) {
+        cache.tags[ENTRY(set + i, way)].line = W25Q_CACHE_INVALID;
+    }
+
+    // The read acquires its own DMA channel and waits for the end of the transaction
+    if (w25q128jw_read_quad_dma(line * W25Q_CACHE_LINE_SIZE, LINE_PTR(set, way),
+                                lines * W25Q_CACHE_LINE_SIZE) != FLASH_OK) {
+        return 0;
+    }
+    stats.bursts++;
+
+    for (uint32_t i = 0; i < lines; i++) {
+        cache.tags[ENTRY(set + i, way)] = (w25q_cache_tag_t){ .line = line + i, .used = ++now };
+    }
+
+    *p_way = way;
+    return lines;
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif  // __cplusplus
+/****************************************************************************/
+/**                                                                        **/
+/*                                 EOF                                      */
+/**                                                                        **/
+/****************************************************************************/
@@ -0,0 +1,172 @@
+/*
+                              *******************
+******************************* H HEADER FILE *****************************
+**                            *******************
+**
+** project  : X-HEEP
+** filename : w25q_cache.h
+** version  : 1
+**
+***************************************************************************
+**
+** Copyright (c) EPFL contributors.
+** All rights reserved.
+**
+***************************************************************************
+*/
+
+/***************************************************************************/
+/***************************************************************************/
+
+/**
+* @file   w25q_cache.h
+* @brief  Read cache in RAM for the W25Q128JW flash.
+*
+* Reads are served from a set-associative cache of page-sized lines with LRU
+* replacement. The lines missing from the cache are fetched with a single
+* quad DMA read when they are consecutive in the flash, together with the
+* next readahead lines, so that small sequential reads cost one flash command.
+* The write and erase functions of the BSP invalidate the lines they modify.
+*
+*   static uint32_t lines[4 * 2 * W25Q_CACHE_LINE_SIZE / 4];
+*   static w25q_cache_tag_t tags[4 * 2];
+*   w25q_cache_config_t config = {lines, tags, 4, 2, 1};
+*   w25q_cache_init(&config);
+*   w25q_cache_read(addr, buffer, 12);
+*/
+
+#ifndef W25Q_CACHE_H
+#define W25Q_CACHE_H
+
+/****************************************************************************/
+/**                                                                        **/
+/**                            MODULES USED                                **/
+/**                                                                        **/
+/****************************************************************************/
+
+#include <stdint.h>
+
+#include "w25q128jw.h"
+
+/****************************************************************************/
+/**                                                                        **/
+/**                       DEFINITIONS AND MACROS                           **/
+/**                                                                        **/
+/****************************************************************************/
+
+/**
+ * @brief Size of a line of the cache, in bytes (a flash page).
+*/
+#define W25Q_CACHE_LINE_SIZE FLASH_PAGE_SIZE
+
+/**
+ * @brief Line of an empty entry of the cache.
+*/
+#define W25Q_CACHE_INVALID 0xffffffff
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/**                                                                        **/
+/**                       TYPEDEFS AND STRUCTURES                          **/
+/**                                                                        **/
+/****************************************************************************/
+
+/**
+ * @brief Tag of an entry of the cache.
+*/
+typedef struct {
+    uint32_t line;  /** Flash address / W25Q_CACHE_LINE_SIZE, or W25Q_CACHE_INVALID. */
+    uint32_t used;  /** Time of the last access, for the LRU replacement. */
+} w25q_cache_tag_t;
+
+/**
+ * @brief Memory and geometry of the cache.
+*/
+typedef struct {
+    void *lines;                /** sets * ways lines of W25Q_CACHE_LINE_SIZE bytes, word aligned. */
+    w25q_cache_tag_t *tags;     /** sets * ways tags. */
+    uint16_t sets;              /** Number of sets. */
+    uint8_t ways;               /** Lines per set. */
+    uint8_t readahead;          /** Lines after a miss fetched in the same read, if missing. */
+} w25q_cache_config_t;
+
+/**
+ * @brief Statistics of the cache since the last reset.
+*/
+typedef struct {
+    uint32_t hits;              /** Lines read from the cache. */
+    uint32_t misses;            /** Lines read from the flash. */
+    uint32_t prefetched;        /** Lines read ahead from the flash. */
+    uint32_t bursts;            /** Flash reads that filled lines. */
+    uint32_t bypasses;          /** Reads larger than the cache, sent to the flash. */
+    uint32_t invalidations;     /** Lines dropped because the flash was modified. */
+} w25q_cache_stats_t;
+
+/****************************************************************************/
+/**                                                                        **/
+/**                          EXPORTED FUNCTIONS                            **/
+/**                                                                        **/
+/****************************************************************************/
+
+/**
+ * @brief Set up the cache, empty. The flash must have been initialized with
+ * w25q128jw_init().
+ *
+ * @param config memory and geometry of the cache, copied.
+ * @return FLASH_OK, or FLASH_ERROR if the configuration is not valid.
+*/
+w25q_error_codes_t w25q_cache_init(const w25q_cache_config_t *config);
+
+/**
+ * @brief Read from flash through the cache.
+ *
+ * Reads larger than the whole cache bypass it, to not evict all the lines.
+ *
+ * @param addr 24-bit flash address to read from.
+ * @param data pointer to the data buffer.
+ * @param length number of bytes to read.
+ * @return FLASH_OK if the read is successful, @ref error_codes otherwise.
+*/
+w25q_error_codes_t w25q_cache_read(uint32_t addr, void *data, uint32_t length);
+
+/**
+ * @brief Drop the lines that contain bytes from addr to addr + length.
+ *
+ * The write and erase functions of the BSP call it, this is only needed if
+ * the flash is modified by other means.
+ *
+ * @param addr 24-bit flash address.
+ * @param length number of bytes.
+*/
+void w25q_cache_invalidate(uint32_t addr, uint32_t length);
+
+/**
+ * @brief Drop all the lines.
+*/
+void w25q_cache_invalidate_all(void);
+
+/**
+ * @brief Get the statistics of the cache.
+ *
+ * @param stats filled with the statistics.
+*/
+void w25q_cache_get_stats(w25q_cache_stats_t *stats);
+
+/**
+ * @brief Clear the statistics of the cache.
+*/
+void w25q_cache_reset_stats(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* W25Q_CACHE_H */
+/****************************************************************************/
+/**                                                                        **/
+/**                                EOF                                     **/
+/**                                                                        **/
+/****************************************************************************/
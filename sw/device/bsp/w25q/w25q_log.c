@@ -0,0 +1,478 @@
+/*
+                              *******************
+******************************* C SOURCE FILE *****************************
+**                            *******************
+**
+** project  : X-HEEP
+** filename : w25q_log.c
+** version  : 1
+**
+***************************************************************************
+**
+** Copyright (c) EPFL contributors.
+** All rights reserved.
+**
+***************************************************************************
+*/
+
+/***************************************************************************/
+/***************************************************************************/
+/**
+* @file   w25q_log.c
+* @brief  Source file of the log-structured key/value store on the W25Q128JW flash.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+/****************************************************************************/
+/**                                                                        **/
+/*                             MODULES USED                                 */
+/**                                                                        **/
+/****************************************************************************/
+#include "string.h"
+#include <stddef.h>
+
+#include "w25q_log.h"
+
+/* To get the target of the compilation (sim or pynq) */
+#include "x-heep.h"
+
+/****************************************************************************/
+/**                                                                        **/
+/*                        DEFINITIONS AND MACROS                            */
+/**                                                                        **/
+/****************************************************************************/
+
+/**
+ * @brief First word of the header of the sectors of a log.
+*/
+#define SECTOR_MAGIC 0x4c4f4731
+
+/**
+ * @brief Sequence number of a sector that is erased and not opened yet.
+*/
+#define SEQ_FREE 0xffffffff
+
+/**
+ * @brief Commit marker of a record: the erased value until it is committed.
+*/
+#define RECORD_COMMITTED 0x00000000
+
+/**
+ * @brief Length of the records that remove a value.
+*/
+#define LENGTH_REMOVED 0xffff
+
+#define SECTOR_ADDR(log, s) ((log)->base + (uint32_t)(s) * FLASH_SECTOR_SIZE)
+#define ALIGN4(n) (((n) + 3) & ~3u)
+
+/****************************************************************************/
+/**                                                                        **/
+/*                      TYPEDEFS AND STRUCTURES                             */
+/**                                                                        **/
+/****************************************************************************/
+
+/**
+ * @brief Header at the start of each sector.
+ *
+ * Magic and erases are programmed right after the erase, seq and seq_inv
+ * when the sector becomes the head of the log.
+*/
+typedef struct {
+    uint32_t magic;
+    uint32_t erases;
+    uint32_t seq;
+    uint32_t seq_inv;       // ~seq, to detect an interrupted program of seq
+} sector_header_t;
+
+/**
+ * @brief Header of a record, followed by the data padded to a word.
+ *
+ * Key, length and check are programmed first, then the data, then commit.
+*/
+typedef struct {
+    uint16_t key;
+    uint16_t length;
+    uint32_t check;         // ~(key | length << 16), to detect an interrupted program
+    uint32_t commit;
+} record_header_t;
+
+/****************************************************************************/
+/**                                                                        **/
+/*                      PROTOTYPES OF LOCAL FUNCTIONS                       */
+/**                                                                        **/
+/****************************************************************************/
+
+/**
+ * @brief Read the header of the record at an offset of a sector.
+ *
+ * @param log log.
+ * @param sector sector of the log.
+ * @param offset offset of the record in the sector.
+ * @param hdr filled with the header.
+ * @return the bytes taken by the record, 0 if there are no more records in
+ * the sector (erased or damaged header).
+*/
+static uint32_t read_record(w25q_log_t *log, uint16_t sector, uint32_t offset, record_header_t *hdr);
+
+/**
+ * @brief Write a record at the end of the head sector and commit it.
+ *
+ * @param log log, with enough space in its head sector.
+ * @param key key.
+ * @param length bytes of data, or LENGTH_REMOVED.
+ * @param data data in memory, or NULL to copy it from src.
+ * @param src flash address of the data, used if data is NULL.
+ * @return FLASH_OK if the record is committed, @ref error_codes otherwise.
+*/
+static w25q_error_codes_t write_record(w25q_log_t *log, uint16_t key, uint16_t length, const void *data, uint32_t src);
+
+/**
+ * @brief Make room for a record of size bytes in the head sector, opening
+ * a new one and garbage collecting the tail if needed.
+ *
+ * @return FLASH_OK if the record fits, FLASH_ERROR if the log is full.
+*/
+static w25q_error_codes_t make_room(w25q_log_t *log, uint32_t size);
+
+/**
+ * @brief Open the sector after the head, which must be free.
+*/
+static w25q_error_codes_t open_sector(w25q_log_t *log);
+
+/**
+ * @brief Move the live records of the tail to the head and free the tail.
+*/
+static w25q_error_codes_t collect(w25q_log_t *log);
+
+/**
+ * @brief Erase a sector and write its header, without sequence number.
+ *
+ * @param log log.
+ * @param sector sector of the log.
+ * @param erases erase count of the sector after the erase.
+*/
+static w25q_error_codes_t format_sector(w25q_log_t *log, uint16_t sector, uint32_t erases);
+
+/****************************************************************************/
+/**                                                                        **/
+/*                            GLOBAL VARIABLES                              */
+/**                                                                        **/
+/****************************************************************************/
+
+/**
+ * @brief Buffer of the data copied by the garbage collection.
+*/
+static uint8_t copy_buffer[FLASH_PAGE_SIZE] __attribute__((aligned(4)));
+
+/****************************************************************************/
+/**                                                                        **/
+/*                           EXPORTED FUNCTIONS                             */
+/**                                                                        **/
+/****************************************************************************/
+
+w25q_error_codes_t w25q_log_mount(w25q_log_t *log) {
+    sector_header_t hdr;
+    uint32_t min_seq = SEQ_FREE, max_seq = 0;
+
+    // Sanity checks
+    if (log->sectors < 3 || log->base % FLASH_SECTOR_SIZE != 0) return FLASH_ERROR;
+    if (log->base + (uint32_t)log->sectors * FLASH_SECTOR_SIZE - 1 > MAX_FLASH_ADDR) return FLASH_ERROR;
+
+    log->used = 0;
+    log->stats = (w25q_log_stats_t){0};
+    for (uint32_t k = 0; k < W25Q_LOG_KEYS; k++) log->index[k] = W25Q_LOG_NONE;
+
+    // Find the sectors in use, the tail has the lowest sequence number
+    for (uint16_t s = 0; s < log->sectors; s++) {
+        if (w25q128jw_read(SECTOR_ADDR(log, s), &hdr, sizeof(hdr)) != FLASH_OK) return FLASH_ERROR;
+
+        if (hdr.magic != SECTOR_MAGIC) {
+            // Not part of a log yet, or its erase was interrupted
+            if (format_sector(log, s, 0) != FLASH_OK) return FLASH_ERROR;
+        } else if (hdr.seq == SEQ_FREE && hdr.seq_inv == SEQ_FREE) {
+            // Free
+        } else if (hdr.seq != ~hdr.seq_inv) {
+            // Opened while the log was interrupted, before any record
+            if (format_sector(log, s, hdr.erases + 1) != FLASH_OK) return FLASH_ERROR;
+        } else {
+            if (hdr.seq < min_seq) {
+                min_seq = hdr.seq;
+                log->tail = s;
+            }
+            if (hdr.seq >= max_seq) {
+                max_seq = hdr.seq;
+                log->head = s;
+            }
+            log->used++;
+        }
+    }
+
+    if (log->used == 0) {
+        // New log, starting from the first sector
+        log->next_seq = 0;
+        log->head = log->sectors - 1;
+        log->tail = 0;
+        return open_sector(log);
+    }
+    log->next_seq = max_seq + 1;
+
+    // Index the records, from the oldest to the newest
+    for (uint16_t i = 0; i < log->used; i++) {
+        uint16_t s = (log->tail + i) % log->sectors;
+        uint32_t offset = W25Q_LOG_SECTOR_HEADER;
+        uint32_t size;
+        record_header_t rec;
+
+        while ((size = read_record(log, s, offset, &rec)) != 0) {
+            if (rec.commit == RECORD_COMMITTED) {
+                log->index[rec.key] = rec.length == LENGTH_REMOVED ? W25Q_LOG_NONE : SECTOR_ADDR(log, s) + offset;
+            }
+            offset += size;
+        }
+
+        // A damaged header ends the sector, new records go to the next one
+        if (s == log->head) {
+            log->head_offset = rec.key == 0xffff && rec.check == 0xffffffff ? offset : FLASH_SECTOR_SIZE;
+        }
+    }
+
+    // A garbage collection was interrupted after it used the free sector
+    if (log->used == log->sectors) return collect(log);
+
+    return FLASH_OK;
+}
+
+w25q_error_codes_t w25q_log_format(w25q_log_t *log) {
+    sector_header_t hdr;
+
+    // Erase the sectors in use, the free ones are already erased
+    for (uint16_t i = 0; i < log->used; i++) {
+        uint16_t s = (log->tail + i) % log->sectors;
+        if (w25q128jw_read(SECTOR_ADDR(log, s), &hdr, sizeof(hdr)) != FLASH_OK) return FLASH_ERROR;
+        if (format_sector(log, s, hdr.erases + 1) != FLASH_OK) return FLASH_ERROR;
+    }
+
+    // Go on from the sector after the head, to not wear the first ones
+    log->used = 0;
+    log->tail = (log->head + 1) % log->sectors;
+    for (uint32_t k = 0; k < W25Q_LOG_KEYS; k++) log->index[k] = W25Q_LOG_NONE;
+
+    return open_sector(log);
+}
+
+w25q_error_codes_t w25q_log_append(w25q_log_t *log, uint16_t key, const void *data, uint16_t length) {
+    // Sanity checks
+    if (key >= W25Q_LOG_KEYS || length > W25Q_LOG_MAX_LEN) return FLASH_ERROR;
+    if (data == NULL && length != 0) return FLASH_ERROR;
+
+    if (make_room(log, W25Q_LOG_RECORD_HEADER + ALIGN4(length)) != FLASH_OK) return FLASH_ERROR;
+
+    log->stats.appends++;
+    return write_record(log, key, length, data, 0);
+}
+
+w25q_error_codes_t w25q_log_get(w25q_log_t *log, uint16_t key, void *data, uint16_t size, uint16_t *p_length) {
+    record_header_t rec;
+
+    // Sanity checks
+    if (key >= W25Q_LOG_KEYS || log->index[key] == W25Q_LOG_NONE) return FLASH_ERROR;
+
+    if (w25q128jw_read(log->index[key], &rec, sizeof(rec)) != FLASH_OK) return FLASH_ERROR;
+    if (rec.length > size) return FLASH_ERROR;
+
+    if (rec.length > 0) {
+        if (w25q128jw_read(log->index[key] + W25Q_LOG_RECORD_HEADER, data, rec.length) != FLASH_OK) return FLASH_ERROR;
+    }
+    if (p_length != NULL) *p_length = rec.length;
+
+    return FLASH_OK;
+}
+
+w25q_error_codes_t w25q_log_remove(w25q_log_t *log, uint16_t key) {
+    // Sanity checks
+    if (key >= W25Q_LOG_KEYS) return FLASH_ERROR;
+
+    // Nothing to remove
+    if (log->index[key] == W25Q_LOG_NONE) return FLASH_OK;
+
+    if (make_room(log, W25Q_LOG_RECORD_HEADER) != FLASH_OK) return FLASH_ERROR;
+
+    log->stats.appends++;
+    return write_record(log, key, LENGTH_REMOVED, NULL, 0);
+}
+
+w25q_error_codes_t w25q_log_foreach(w25q_log_t *log, w25q_log_cb_t cb, void *arg) {
+    for (uint16_t i = 0; i < log->used; i++) {
+        uint16_t s = (log->tail + i) % log->sectors;
+        uint32_t offset = W25Q_LOG_SECTOR_HEADER;
+        uint32_t size;
+        record_header_t rec;
+
+        while ((size = read_record(log, s, offset, &rec)) != 0) {
+            if (rec.commit == RECORD_COMMITTED && rec.length != LENGTH_REMOVED) {
+                cb(rec.key, SECTOR_ADDR(log, s) + offset + W25Q_LOG_RECORD_HEADER, rec.length, arg);
+            }
+            offset += size;
+        }
+    }
+
+    return FLASH_OK;
+}
+
+/****************************************************************************/
+/**                                                                        **/
+/*                            LOCAL FUNCTIONS                               */
+/**                                                                        **/
+/****************************************************************************/
+
+static uint32_t read_record(w25q_log_t *log, uint16_t sector, uint32_t offset, record_header_t *hdr) {
+    // Mark the header as erased if there is no room for one
+    *hdr = (record_header_t){ .key = 0xffff, .length = 0xffff, .check = 0xffffffff, .commit = 0xffffffff };
+
+    if (offset + W25Q_LOG_RECORD_HEADER > FLASH_SECTOR_SIZE) return 0;
+    if (w25q128jw_read(SECTOR_ADDR(log, sector) + offset, hdr, sizeof(*hdr)) != FLASH_OK) return 0;
+
+    // Erased or damaged
+    if (hdr->check != ~(uint32_t)(hdr->key | (uint32_t)hdr->length << 16)) return 0;
+    if (hdr->key >= W25Q_LOG_KEYS) return 0;
+
+    uint32_t size = W25Q_LOG_RECORD_HEADER + (hdr->length == LENGTH_REMOVED ? 0 : ALIGN4(hdr->length));
+    if (offset + size > FLASH_SECTOR_SIZE) return 0;
+
+    return size;
+}
+
+static w25q_error_codes_t write_record(w25q_log_t *log, uint16_t key, uint16_t length, const void *data, uint32_t src) {
+    uint32_t addr = SECTOR_ADDR(log, log->head) + log->head_offset;
+    uint32_t data_length = length == LENGTH_REMOVED ? 0 : length;
+    record_header_t rec = {
+        .key = key,
+        .length = length,
+        .check = ~(uint32_t)(key | (uint32_t)length << 16),
+        .commit = RECORD_COMMITTED,
+    };
+
+    // The space is used even if the write fails
+    log->head_offset += W25Q_LOG_RECORD_HEADER + ALIGN4(data_length);
+
+    // Header without the commit marker
+    if (w25q128jw_write(addr, &rec, offsetof(record_header_t, commit), 0) != FLASH_OK) return FLASH_ERROR;
+
+    // Data, from memory or from another record
+    if (data != NULL && data_length > 0) {
+        if (w25q128jw_write(addr + W25Q_LOG_RECORD_HEADER, (void *)data, data_length, 0) != FLASH_OK) return FLASH_ERROR;
+    }
+    for (uint32_t done = 0; data == NULL && done < data_length; done += sizeof(copy_buffer)) {
+        uint32_t chunk = data_length - done < sizeof(copy_buffer) ? data_length - done : sizeof(copy_buffer);
+        if (w25q128jw_read(src + done, copy_buffer, chunk) != FLASH_OK) return FLASH_ERROR;
+        if (w25q128jw_write(addr + W25Q_LOG_RECORD_HEADER + done, copy_buffer, chunk, 0) != FLASH_OK) return FLASH_ERROR;
+    }
+
+    // The record is valid from here on
+    if (w25q128jw_write(addr + offsetof(record_header_t, commit), &rec.commit, sizeof(rec.commit), 0) != FLASH_OK) return FLASH_ERROR;
+
+    log->index[key] = length == LENGTH_REMOVED ? W25Q_LOG_NONE : addr;
+    return FLASH_OK;
+}
+
+static w25q_error_codes_t make_room(w25q_log_t *log, uint32_t size) {
+    // A free sector is kept for the garbage collection
+    for (uint16_t i = 0; i < log->sectors && log->head_offset + size > FLASH_SECTOR_SIZE
+                         && log->sectors - log->used < 2; i++) {
+        if (collect(log) != FLASH_OK) return FLASH_ERROR;
+    }
+
+    if (log->head_offset + size <= FLASH_SECTOR_SIZE) return FLASH_OK;
+
+    // Full of live records
+    if (log->sectors - log->used < 2) return FLASH_ERROR;
+
+    return open_sector(log);
+}
+
+static w25q_error_codes_t open_sector(w25q_log_t *log) {
+    uint16_t s = (log->head + 1) % log->sectors;
+    uint32_t seq[2] = { log->next_seq, ~log->next_seq };
+
+    // The tail is never overwritten
+    if (log->used == log->sectors) return FLASH_ERROR;
+
+    if (w25q128jw_write(SECTOR_ADDR(log, s) + offsetof(sector_header_t, seq), seq, sizeof(seq), 0) != FLASH_OK) {
+        return FLASH_ERROR;
+    }
+
+    log->next_seq++;
+    log->head = s;
+    log->head_offset = W25Q_LOG_SECTOR_HEADER;
+    if (log->used == 0) log->tail = s;
+    log->used++;
+
+    return FLASH_OK;
+}
+
+static w25q_error_codes_t collect(w25q_log_t *log) {
+    uint16_t s = log->tail;
+    uint32_t offset = W25Q_LOG_SECTOR_HEADER;
+    uint32_t size;
+    record_header_t rec;
+    sector_header_t hdr;
+
+    // Move the latest value of each key, the others are dropped
+    while ((size = read_record(log, s, offset, &rec)) != 0) {
+        uint32_t addr = SECTOR_ADDR(log, s) + offset;
+
+        if (rec.commit == RECORD_COMMITTED && log->index[rec.key] == addr) {
+            uint32_t rec_size = W25Q_LOG_RECORD_HEADER + ALIGN4(rec.length);
+
+            // The free sector kept by make_room() is used if needed
+            if (log->head_offset + rec_size > FLASH_SECTOR_SIZE) {
+                if (open_sector(log) != FLASH_OK) return FLASH_ERROR;
+            }
+            if (write_record(log, rec.key, rec.length, NULL, addr + W25Q_LOG_RECORD_HEADER) != FLASH_OK) {
+                return FLASH_ERROR;
+            }
+            log->stats.copied++;
+        }
+        offset += size;
+    }
+
+    // Everything is copied, the tail can be reused
+    if (w25q128jw_read(SECTOR_ADDR(log, s), &hdr, sizeof(hdr)) != FLASH_OK) return FLASH_ERROR;
+    if (format_sector(log, s, hdr.erases + 1) != FLASH_OK) return FLASH_ERROR;
+
+    log->tail = (s + 1) % log->sectors;
+    log->used--;
+    log->stats.collections++;
+
+    return FLASH_OK;
+}
+
+static w25q_error_codes_t format_sector(w25q_log_t *log, uint16_t sector, uint32_t erases) {
+    uint32_t addr = SECTOR_ADDR(log, sector);
+    uint32_t hdr[2] = { SECTOR_MAGIC, erases };
+
+    #ifndef TARGET_SIM
+    w25q128jw_4k_erase(addr);
+    #else
+    // The simulation model has no erase, but its page program overwrites
+    memset(copy_buffer, 0xff, sizeof(copy_buffer));
+    for (uint32_t i = 0; i < FLASH_SECTOR_SIZE; i += sizeof(copy_buffer)) {
+        if (w25q128jw_write(addr + i, copy_buffer, sizeof(copy_buffer), 0) != FLASH_OK) return FLASH_ERROR;
+    }
+    #endif // TARGET_SIM
+    log->stats.erases++;
+
+    return w25q128jw_write(addr, hdr, sizeof(hdr), 0);
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif  // __cplusplus
+/****************************************************************************/
+/**                                                                        **/
+/*                                 EOF                                      */
+/**                                                                        **/
+/****************************************************************************/
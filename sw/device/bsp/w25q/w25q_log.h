@@ -0,0 +1,218 @@
+/*
+                              *******************
+******************************* H HEADER FILE *****************************
+**                            *******************
+**
+** project  : X-HEEP
+** filename : w25q_log.h
+** version  : 1
+**
+***************************************************************************
+**
+** Copyright (c) EPFL contributors.
+** All rights reserved.
+**
+***************************************************************************
+*/
+
+/***************************************************************************/
+/***************************************************************************/
+
+/**
+* @file   w25q_log.h
+* @brief  Log-structured key/value store on the W25Q128JW flash.
+*
+* Records are appended one after the other in a range of sectors, so that
+* storing a value costs page programs instead of the read-erase-write of a
+* whole sector done by w25q128jw_write() with erase_before_write.
+*
+* The sectors are used as a ring: the oldest one (the tail) is garbage
+* collected by copying its live records (the latest value of each key) at the
+* end of the log, then erased and reused. Every sector is thus erased in turn,
+* which levels the wear, and its erase count is kept in its header.
+*
+* A record is valid only once its commit marker is programmed, after its
+* data: after a reset during a write or a garbage collection, the log is
+* mounted again in its last committed state.
+*
+*   static w25q_log_t log = { .base = addr, .sectors = 4 };
+*   w25q_log_mount(&log);
+*   w25q_log_append(&log, SENSOR_KEY, &sample, sizeof(sample));
+*   w25q_log_get(&log, SENSOR_KEY, &sample, sizeof(sample), NULL);
+*/
+
+#ifndef W25Q_LOG_H
+#define W25Q_LOG_H
+
+/****************************************************************************/
+/**                                                                        **/
+/**                            MODULES USED                                **/
+/**                                                                        **/
+/****************************************************************************/
+
+#include <stdint.h>
+
+#include "w25q128jw.h"
+
+/****************************************************************************/
+/**                                                                        **/
+/**                       DEFINITIONS AND MACROS                           **/
+/**                                                                        **/
+/****************************************************************************/
+
+/**
+ * @brief Number of keys of the store, the keys go from 0 to W25Q_LOG_KEYS - 1.
+*/
+#ifndef W25Q_LOG_KEYS
+#define W25Q_LOG_KEYS 32
+#endif
+
+/**
+ * @brief Bytes at the start of each sector, and before the data of each record.
+*/
+#define W25Q_LOG_SECTOR_HEADER 16
+#define W25Q_LOG_RECORD_HEADER 12
+
+/**
+ * @brief Largest value, a record must fit in a sector.
+*/
+#define W25Q_LOG_MAX_LEN (FLASH_SECTOR_SIZE - W25Q_LOG_SECTOR_HEADER - W25Q_LOG_RECORD_HEADER)
+
+/**
+ * @brief Address of a key without value in the index.
+*/
+#define W25Q_LOG_NONE 0xffffffff
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/**                                                                        **/
+/**                       TYPEDEFS AND STRUCTURES                          **/
+/**                                                                        **/
+/****************************************************************************/
+
+/**
+ * @brief Statistics of a log since it was mounted.
+*/
+typedef struct {
+    uint32_t appends;           /** Records written by w25q_log_append() and w25q_log_remove(). */
+    uint32_t collections;       /** Sectors garbage collected. */
+    uint32_t copied;            /** Live records moved by the garbage collection. */
+    uint32_t erases;            /** Sector erases. */
+} w25q_log_stats_t;
+
+/**
+ * @brief A log, in a range of sectors of the flash.
+*/
+typedef struct {
+    uint32_t base;              /** 24-bit flash address of the first sector, multiple of FLASH_SECTOR_SIZE. */
+    uint16_t sectors;           /** Number of sectors, at least 3. */
+
+    /** Set by w25q_log_mount(). */
+    uint16_t tail;              /** Oldest sector. */
+    uint16_t head;              /** Sector written. */
+    uint16_t used;              /** Sectors from the tail to the head. */
+    uint32_t head_offset;       /** First free byte of the head sector. */
+    uint32_t next_seq;          /** Sequence number of the next sector opened. */
+    uint32_t index[W25Q_LOG_KEYS]; /** Flash address of the latest record of each key, or W25Q_LOG_NONE. */
+    w25q_log_stats_t stats;
+} w25q_log_t;
+
+/**
+ * @brief Function called for each record by w25q_log_foreach().
+ *
+ * @param key key of the record.
+ * @param addr 24-bit flash address of the data of the record.
+ * @param length bytes of data.
+ * @param arg argument given to w25q_log_foreach().
+*/
+typedef void (*w25q_log_cb_t)(uint16_t key, uint32_t addr, uint16_t length, void *arg);
+
+/****************************************************************************/
+/**                                                                        **/
+/**                          EXPORTED FUNCTIONS                            **/
+/**                                                                        **/
+/****************************************************************************/
+
+/**
+ * @brief Mount a log: find its sectors and index its records.
+ *
+ * The sectors that do not belong to a log yet are erased, so a new log is
+ * created empty. The flash must have been initialized with w25q128jw_init().
+ *
+ * @param log log with its base and sectors set.
+ * @return FLASH_OK if the log is mounted, FLASH_ERROR if the range of
+ * sectors is not valid.
+*/
+w25q_error_codes_t w25q_log_mount(w25q_log_t *log);
+
+/**
+ * @brief Erase all the records of a mounted log.
+ *
+ * @param log mounted log.
+ * @return FLASH_OK if the log is empty, @ref error_codes otherwise.
+*/
+w25q_error_codes_t w25q_log_format(w25q_log_t *log);
+
+/**
+ * @brief Store a value for a key at the end of the log.
+ *
+ * Sectors are garbage collected when the log runs out of space.
+ *
+ * @param log mounted log.
+ * @param key key, lower than W25Q_LOG_KEYS.
+ * @param data value.
+ * @param length bytes of the value, at most W25Q_LOG_MAX_LEN.
+ * @return FLASH_OK if the value is committed, FLASH_ERROR if the arguments
+ * are not valid or if the log is full of live records.
+*/
+w25q_error_codes_t w25q_log_append(w25q_log_t *log, uint16_t key, const void *data, uint16_t length);
+
+/**
+ * @brief Read the latest value of a key.
+ *
+ * @param log mounted log.
+ * @param key key.
+ * @param data buffer of the value.
+ * @param size bytes of the buffer.
+ * @param p_length set to the length of the value, if not NULL.
+ * @return FLASH_OK if the value is read, FLASH_ERROR if the key has no value
+ * or if it does not fit in the buffer.
+*/
+w25q_error_codes_t w25q_log_get(w25q_log_t *log, uint16_t key, void *data, uint16_t size, uint16_t *p_length);
+
+/**
+ * @brief Remove the value of a key, by appending a record without value.
+ *
+ * @param log mounted log.
+ * @param key key.
+ * @return FLASH_OK if the removal is committed, @ref error_codes otherwise.
+*/
+w25q_error_codes_t w25q_log_remove(w25q_log_t *log, uint16_t key);
+
+/**
+ * @brief Call a function for each committed record still in the log, from
+ * the oldest to the newest, including the records replaced by a newer one.
+ *
+ * This gives the history of a key, e.g. the samples of a sensor, as far as
+ * the garbage collection did not reclaim it.
+ *
+ * @param log mounted log.
+ * @param cb function called for each record.
+ * @param arg argument of cb.
+ * @return FLASH_OK, or @ref error_codes if the flash cannot be read.
+*/
+w25q_error_codes_t w25q_log_foreach(w25q_log_t *log, w25q_log_cb_t cb, void *arg);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* W25Q_LOG_H */
+/****************************************************************************/
+/**                                                                        **/
+/**                                EOF                                     **/
+/**                                                                        **/
+/****************************************************************************/
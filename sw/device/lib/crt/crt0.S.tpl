@@ -22,6 +22,14 @@
 .type _start, @function
 
 _start:
+/* start measuring the boot time, mcycle counts from reset unless the core
+   inhibits it at reset (see heep_boot_cycles_main). With HEEP_BOOT_TIME the
+   counter is enabled here, otherwise it is left as the core reset it */
+#ifdef HEEP_BOOT_TIME
+   csrci 0x320, 0x1 /* mcountinhibit */
+#endif
+   csrr  s2, mcycle
+
 /* initialize global pointer */
 .option push
 .option norelax
@@ -45,32 +53,36 @@ _start:
 
     call w25q128jw_init_crt0
 
+    // The bootrom copied the first RAMSIZE_COPIEDBY_BOOTROM Bytes, with this code and the functions it calls
+    // (see the .init section of link_flash_load.ld). The rest is copied by the DMA, one section after the other,
+    // while the CPU clears the bss section.
     // This assumes ram base address is 0x00000000 and the section .text stars from ram0 (in the first RAMSIZE_COPIEDBY_BOOTROM Byte)
     li     s1, RAMSIZE_COPIEDBY_BOOTROM
-    li     t0, FLASH_MEM_START_ADDRESS
 
-    // copy the remaining (if any) text and data sections //
-    // Setup the in/out pointers and copy size knowing 1KiB as already been copied
-    mv     a0, t0 // src ptr (flash)
-    add   a0, a0, s1
-
-    la     a1, _etext
-    // Skip if everything has already been copied, and copy the data section
-    blt    a1, s1, _load_data_section
+    la     a2, _etext
+    // Skip if everything has already been copied
+    ble    a2, s1, _load_text_section_end
 
     // copy size in bytes, i.e. _etext - RAMSIZE_COPIEDBY_BOOTROM
-    sub   a2, a1, s1
-
+    sub    a2, a2, s1
     // dst ptr (ram)
     mv     a1, s1
+    // src ptr, relative to the start of the FLASH as required by the w25q128jw_boot_read_dma function
+    mv     a0, s1
 
-    // copy the remaining data --> w25q128jw_read_standard(a0 is src addr, a1 is dest ptr data, a2 is length)
+    // start copying the remaining text --> w25q128jw_boot_read_dma(a0 is src addr, a1 is dest ptr data, a2 is length)
+    call w25q128jw_boot_read_dma
+_load_text_section_end:
 
-    // this sub is redundat as we could have simply set a0 to RAMSIZE_COPIEDBY_BOOTROM+0x0,
-    // but like this is more readable as we set the FLASH address as memory mapped to FLASH_MEM_START_ADDRESS, and then remove the offset
-    // as required bz the w25q128jw_read_standard function
-    sub    a0,a0,t0
-    call w25q128jw_read_standard
+/* clear the bss segment while the text is copied, memset is not copied yet */
+    la     a0, __bss_start
+    la     a1, __bss_end
+    bge    a0, a1, _clear_bss_end
+_clear_bss_loop:
+    sw     zero, 0(a0)
+    addi   a0, a0, 4
+    blt    a0, a1, _clear_bss_loop
+_clear_bss_end:
 
 % for i, section in enumerate(xheep.memory_ss().iter_linker_sections()):
 % if section.name != "code":
@@ -83,17 +95,40 @@ _load_${section.name}_section:
     la     a2, _lma_${section.name}_end
     sub    a2, a2, a0
 
-    bltz   a2, _load_${section.name}_section_end // dont do anything if you do not have something in ${section.name}
+    blez   a2, _load_${section.name}_section_end // dont do anything if you do not have something in ${section.name}
 
+    // the DMA copies words, the bytes after the end of the section are not used
+    addi   a2, a2, 3
+    andi   a2, a2, -4
+    li     t0, FLASH_MEM_START_ADDRESS
     sub    a0,a0,t0
-    call w25q128jw_read_standard
+    // waits for the previous copy before starting this one
+    call w25q128jw_boot_read_dma
 _load_${section.name}_section_end:
 
 % endif
 % endfor
+    call w25q128jw_boot_wait_dma
 
 #endif
 
+#ifdef FLASH_EXEC
+/* copy the hot code from flash to ram (see hot_text.h), before any call as the
+   called function may be one of them */
+    la a0, _sihot_text
+    la a1, _shot_text
+    la a2, _ehot_text
+    bge a1, a2, end_init_hot_text
+    loop_init_hot_text:
+    lw a3, 0(a0)
+    sw a3, 0(a1)
+    addi a0, a0, 4
+    addi a1, a1, 4
+    blt a1, a2, loop_init_hot_text
+    end_init_hot_text:
+#endif
+
+#ifndef FLASH_LOAD
 /* clear the bss segment */
 _init_bss:
     la     a0, __bss_start
@@ -101,6 +136,7 @@ _init_bss:
     sub    a2, a2, a0
     li     a1, 0
     call   memset
+#endif
 
 #ifdef FLASH_EXEC
 /* copy initialized data sections from flash to ram (to be verified, copied from picosoc)*/
@@ -127,6 +163,11 @@ _init_bss:
     call atexit
     call __libc_init_array
 
+/* save the boot time */
+    csrr t0, mcycle
+    sw s2, heep_boot_cycles_start, t1
+    sw t0, heep_boot_cycles_main, t1
+
 /* call main */
     lw a0, 0(sp)                    /* a0 = argc */
     addi a1, sp, __SIZEOF_POINTER__ /* a1 = argv */
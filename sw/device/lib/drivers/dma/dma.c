@@ -93,6 +93,36 @@ extern "C"
  */
 #define DMA_DEFAULT_TRANS_TO_WIND_SIZE_RATIO_THRESHOLD 4
 
+#if (DMA_QUEUE_LEN & (DMA_QUEUE_LEN - 1)) != 0 || DMA_QUEUE_LEN > 128
+#error "DMA_QUEUE_LEN must be a power of two, at most 128"
+#endif
+
+#if DMA_CH_NUM > 32
+#error "The channel manager supports at most 32 channels"
+#endif
+
+/**
+ * Offsets of the interrupt summary registers of the DMA subsystem, located
+ * DMA_INTR_SUMMARY_OFFSET bytes after the first channel. The channels 0 to 31
+ * are in the first word of each register.
+ */
+#define DMA_INTR_SUMMARY_TRANS_DONE  0x00
+#define DMA_INTR_SUMMARY_WINDOW_DONE 0x20
+
+/**
+ * Mask of all the channels.
+ */
+#define DMA_CH_ALL_MASK ( (uint32_t)( ( 1ULL << DMA_CH_NUM ) - 1 ) )
+
+/**
+ * Mask of the channels reserved to high priority users.
+ */
+#ifdef DMA_HP_INTR_INDEX
+#define DMA_CH_HP_MASK ( (uint32_t)( ( 1ULL << ( DMA_HP_INTR_INDEX + 1 ) ) - 1 ) & DMA_CH_ALL_MASK )
+#else
+#define DMA_CH_HP_MASK 0
+#endif
+
 
 /****************************************************************************/
 /**                                                                        **/
@@ -117,6 +147,52 @@ typedef enum
     INTR_EN__size,
 } inter_en_t;
 
+/**
+ * Registers of a transaction image, in the order they are written.
+ */
+typedef enum
+{
+#if DMA_ZERO_PADDING
+    IMG_PAD_TOP,
+    IMG_PAD_BOTTOM,
+    IMG_PAD_LEFT,
+    IMG_PAD_RIGHT,
+#endif
+    IMG_SRC_PTR,
+    IMG_DST_PTR,
+#if DMA_ADDR_MODE
+    IMG_ADDR_PTR,
+#endif
+    IMG_DIM_INV,
+    IMG_SRC_INC_D1,
+    IMG_SRC_INC_D2,
+    IMG_DST_INC_D1,
+    IMG_DST_INC_D2,
+    IMG_MODE,
+    IMG_WINDOW_SIZE,
+#if DMA_HW_FIFO_MODE
+    IMG_HW_FIFO_EN,
+#endif
+    IMG_DIM_CONFIG,
+    IMG_SIGN_EXT,
+    IMG_SLOT,
+    IMG_DST_TYPE,
+    IMG_SRC_TYPE,
+    IMG_INTERRUPT_EN,
+    IMG__size,
+} img_reg_t;
+
+/**
+ * Entry of the transaction queue of a channel.
+ */
+typedef struct
+{
+    dma_trans_t*      trans;
+    dma_queue_cb_t    cb;
+    void*             arg;
+    dma_trans_image_t img;  /* Compiled when pushed. */
+}dma_queue_entry_t;
+
 /****************************************************************************/
 /**                                                                        **/
 /*                      PROTOTYPES OF LOCAL FUNCTIONS                       */
@@ -196,23 +272,90 @@ static inline uint8_t is_region_outbound_2D(   uint8_t  *p_start,
                                             uint32_t p_inc_d1_du,
                                             uint32_t p_inc_d2_du );
 
+/**
+ * @brief Computes the values of the DMA registers for a transaction
+ * (everything except the sizes, which start the transaction).
+ * @param p_trans The transaction, already validated.
+ * @param p_img Where the register values are written.
+ */
+static void compile_image( dma_trans_t *p_trans, dma_trans_image_t *p_img );
+
+/**
+ * @brief Writes the registers of an image into a channel. Registers whose
+ * value is already known to be in the DMA are skipped unless p_all is set.
+ * @param channel The channel to write.
+ * @param p_img The image to write.
+ * @param p_all Write all the registers used by the image.
+ */
+static void write_image( uint8_t channel,
+                         const dma_trans_image_t *p_img,
+                         uint8_t p_all );
+
+/**
+ * @brief Writes the configuration of the transaction loaded in a channel
+ * (everything except the sizes, which start the transaction) into the DMA
+ * registers.
+ * @param channel The channel whose transaction is written.
+ */
+static void load_trans_registers( uint8_t channel );
+
+/**
+ * @brief Returns the channels that may have raised an interrupt.
+ * @param summary_offset Offset of the summary register of the interrupt from
+ * the summary registers.
+ * @return A bit per channel, set if its IFR has to be read.
+ */
+static inline uint32_t intr_pending( uint32_t summary_offset );
+
+/**
+ * @brief Loads and launches a queued transaction. The channel must be idle and
+ * its interrupts enabled in the MIE CSR.
+ * @param channel The channel to use.
+ * @param p_entry The queue entry of the transaction, with its compiled image.
+ */
+static void queue_launch( uint8_t channel, const dma_queue_entry_t *p_entry );
+
+/**
+ * @brief Computes the channels a user of the channel manager can own.
+ * @param prio The priority class of the user.
+ * @param affinity The channels requested by the user, 0 for any.
+ * @return A mask of channels.
+ */
+static uint32_t channel_eligible( dma_ch_prio_t prio, uint32_t affinity );
+
+/**
+ * @brief Gives a channel to a user of the channel manager. Interrupts must
+ * be disabled.
+ * @param channel The channel, which must be free.
+ * @param now The current cycle.
+ */
+static void channel_grant( uint8_t channel, uint32_t now );
+
+/**
+ * @brief Called by the transaction done interrupt when the queue is not empty:
+ * removes the finished transaction, launches the next one and calls the
+ * callback of the finished one.
+ * @param channel The channel whose transaction has finished.
+ */
+static void queue_advance( uint8_t channel );
+
 /**
  * @brief Analyzes a target to determine the size of its D1 increment (in bytes).
  * @param p_tgt A pointer to the target to analyze.
- * @param channel The channel to use as target.
+ * @param p_trans The transaction the target belongs to.
  * @return The number of bytes of the increment.
  */
 static inline uint32_t get_increment_b_1D( dma_target_t * p_tgt,
-                                    uint8_t channel );
+                                    dma_trans_t  * p_trans );
 
 /**
  * @brief Analyzes a target to determine the size of its D2 increment (in bytes).
  * @param p_tgt A pointer to the target to analyze.
- * @param channel The channel to use as target.
+ * @param p_trans The transaction the target belongs to.
  * @return The number of bytes of the increment.
  */
 static inline uint32_t get_increment_b_2D( dma_target_t * p_tgt,
-                                    uint8_t channel  );
+                                    dma_trans_t  * p_trans );
 
 
 /****************************************************************************/
@@ -255,6 +398,93 @@ typedef struct
 /* Allocate the channel's memory space */
 static dma_ch_cb dma_subsys_per[DMA_CH_NUM];
 
+/**
+ * Transaction queue of a channel. The entry at head is the running
+ * transaction, the following count-1 entries are waiting to be launched by
+ * the transaction done interrupt.
+ */
+typedef struct
+{
+    dma_queue_entry_t entry[DMA_QUEUE_LEN];
+    uint8_t head;
+    volatile uint8_t count;
+    dma_queue_stats_t stats;
+}dma_queue_t;
+
+static dma_queue_t dma_queue[DMA_CH_NUM];
+
+/**
+ * Function called from the window done interrupt of a channel.
+ */
+typedef struct
+{
+    dma_window_cb_t cb;
+    void*           arg;
+}dma_window_hook_t;
+
+static dma_window_hook_t dma_window_hook[DMA_CH_NUM];
+
+/*
+ * Last value written to each image register of a channel. Only the entries
+ * whose bit is set in dma_shadow_valid are known to match the DMA.
+ */
+static uint32_t dma_shadow[DMA_CH_NUM][DMA_TRANS_IMAGE_REGS];
+static uint32_t dma_shadow_valid[DMA_CH_NUM];
+
+/* Word offset of each image register in the register file of a channel. */
+static const uint8_t dma_image_reg[IMG__size] =
+{
+#if DMA_ZERO_PADDING
+    [IMG_PAD_TOP]      = DMA_PAD_TOP_REG_OFFSET / 4,
+    [IMG_PAD_BOTTOM]   = DMA_PAD_BOTTOM_REG_OFFSET / 4,
+    [IMG_PAD_LEFT]     = DMA_PAD_LEFT_REG_OFFSET / 4,
+    [IMG_PAD_RIGHT]    = DMA_PAD_RIGHT_REG_OFFSET / 4,
+#endif
+    [IMG_SRC_PTR]      = DMA_SRC_PTR_REG_OFFSET / 4,
+    [IMG_DST_PTR]      = DMA_DST_PTR_REG_OFFSET / 4,
+#if DMA_ADDR_MODE
+    [IMG_ADDR_PTR]     = DMA_ADDR_PTR_REG_OFFSET / 4,
+#endif
+    [IMG_DIM_INV]      = DMA_DIM_INV_REG_OFFSET / 4,
+    [IMG_SRC_INC_D1]   = DMA_SRC_PTR_INC_D1_REG_OFFSET / 4,
+    [IMG_SRC_INC_D2]   = DMA_SRC_PTR_INC_D2_REG_OFFSET / 4,
+    [IMG_DST_INC_D1]   = DMA_DST_PTR_INC_D1_REG_OFFSET / 4,
+    [IMG_DST_INC_D2]   = DMA_DST_PTR_INC_D2_REG_OFFSET / 4,
+    [IMG_MODE]         = DMA_MODE_REG_OFFSET / 4,
+    [IMG_WINDOW_SIZE]  = DMA_WINDOW_SIZE_REG_OFFSET / 4,
+#if DMA_HW_FIFO_MODE
+    [IMG_HW_FIFO_EN]   = DMA_HW_FIFO_EN_REG_OFFSET / 4,
+#endif
+    [IMG_DIM_CONFIG]   = DMA_DIM_CONFIG_REG_OFFSET / 4,
+    [IMG_SIGN_EXT]     = DMA_SIGN_EXT_REG_OFFSET / 4,
+    [IMG_SLOT]         = DMA_SLOT_REG_OFFSET / 4,
+    [IMG_DST_TYPE]     = DMA_DST_DATA_TYPE_REG_OFFSET / 4,
+    [IMG_SRC_TYPE]     = DMA_SRC_DATA_TYPE_REG_OFFSET / 4,
+    [IMG_INTERRUPT_EN] = DMA_INTERRUPT_EN_REG_OFFSET / 4,
+};
+
+/**
+ * State of the channel manager: owned channels, FIFO of the pending requests
+ * and per-channel statistics.
+ */
+static uint32_t dma_ch_owned;
+static dma_ch_req_t *dma_ch_pending;
+static uint32_t dma_ch_stats_start;
+static uint32_t dma_ch_owned_since[DMA_CH_NUM];
+static dma_ch_stats_t dma_ch_stats[DMA_CH_NUM];
+
+/* Set by the first dma_init(), which resets the channel manager. */
+static uint8_t dma_initialized;
+
+/*
+ * Whether the channels are those of the integrated DMA subsystem, whose
+ * interrupt summary registers tell which channels raised an interrupt.
+ */
+static uint8_t dma_intr_summary;
+
+/* DMA_TRANS_IMAGE_REGS in dma.h must match the list of image registers. */
+typedef char dma_image_size_check[ ( IMG__size == DMA_TRANS_IMAGE_REGS ) ? 1 : -1 ];
+
 /* High priority interrupts counters */
 uint16_t dma_hp_tr_intr_counter = 0;
 uint16_t dma_hp_win_intr_counter = 0;
@@ -268,16 +498,27 @@ uint16_t dma_hp_win_intr_counter = 0;
 
 void fic_irq_dma_window(void)
 {
-    /* 
+    /*
      * Find out which channel raised the interrupt and call
      * either the weak implementation provided in this module,
      * or the non-weak implementation.
+     * The pending channels are served in increasing order so that the high
+     * priority channels come first.
      */
+    uint32_t channels = intr_pending( DMA_INTR_SUMMARY_WINDOW_DONE );
 
-    for (int i = 0; i < DMA_CH_NUM; i++)
+    while( channels != 0 )
     {
+        uint8_t i = __builtin_ctz( channels );
+        channels &= channels - 1;
+
         if (dma_subsys_per[i].peri->WINDOW_IFR == 1)
         {
+            if (dma_window_hook[i].cb != NULL)
+            {
+                dma_window_hook[i].cb(i, dma_window_hook[i].arg);
+            }
+
             dma_intr_handler_window_done(i);
 
              #ifdef DMA_HP_INTR_INDEX
@@ -311,17 +552,30 @@ void fic_irq_dma_window(void)
 
 void fic_irq_dma_done(void)
 {
-    /* 
+    /*
      * Find out which channel raised the interrupt and call
      * either the weak implementation provided in this module,
      * or the non-weak implementation.
+     * The pending channels are served in increasing order so that the high
+     * priority channels come first.
      */
-    
-    for (int i = 0; i < DMA_CH_NUM; i++)
+    uint32_t channels = intr_pending( DMA_INTR_SUMMARY_TRANS_DONE );
+
+    while( channels != 0 )
     {
+        uint8_t i = __builtin_ctz( channels );
+        channels &= channels - 1;
+
         if (dma_subsys_per[i].peri->TRANSACTION_IFR == 1)
         {
             dma_subsys_per[i].intrFlag = 1;
+
+            /* Launch the next queued transaction before anything else. */
+            if (dma_queue[i].count != 0)
+            {
+                queue_advance(i);
+            }
+
             dma_intr_handler_trans_done(i);
 
             #ifdef DMA_HP_INTR_INDEX
@@ -356,6 +610,18 @@ void fic_irq_dma_done(void)
 
 void dma_init( dma *dma_peri )
 {
+    /*
+     * The first call initializes the channel manager. Later calls only reset
+     * the channels that are not owned, so that a library calling dma_init()
+     * does not take over the channels acquired by someone else. The owned
+     * channels also keep their peripheral. dma_channel_manager_reset() frees
+     * them again.
+     */
+    if( !dma_initialized )
+    {
+        dma_channel_manager_reset();
+    }
+
     /*
      * If a DMA peripheral was provided, use that one, otherwise use the
      * integrated one.
@@ -363,11 +629,24 @@ void dma_init( dma *dma_peri )
 
     for (int i = 0; i < DMA_CH_NUM; i++)
     {
+        if( dma_ch_owned & ( 1 << i ) )
+        {
+            continue;
+        }
+
         dma_subsys_per[i].peri = dma_peri ? dma_peri : dma_peri(i);
 
         /* Clear the loaded transaction */
         dma_subsys_per[i].trans = NULL;
 
+        /* Empty the queue */
+        dma_queue[i] = (dma_queue_t){0};
+
+        dma_window_hook[i] = (dma_window_hook_t){0};
+
+        /* The registers are cleared below, but not all of them. */
+        dma_shadow_valid[i] = 0;
+
         /* Clear all values in the DMA registers. */
         dma_subsys_per[i].peri->SRC_PTR        = 0;
         dma_subsys_per[i].peri->DST_PTR        = 0;
@@ -398,6 +677,8 @@ void dma_init( dma *dma_peri )
         dma_subsys_per[i].peri->PAD_RIGHT      = 0;
         #endif
     }
+
+    dma_intr_summary = dma_peri == NULL;
 }
 
 dma_config_flags_t dma_validate_transaction(    dma_trans_t        *p_trans,
@@ -444,6 +725,8 @@ dma_config_flags_t dma_validate_transaction(    dma_trans_t        *p_trans,
      * A successful target validation has to be done before loading it to the
      * DMA.
      */
+    p_trans->validated = 0;
+
     uint8_t errorSrc = validate_target( p_trans->src, p_trans);
     uint8_t errorDst = validate_target( p_trans->dst, p_trans);
 
@@ -789,6 +1072,7 @@ dma_config_flags_t dma_validate_transaction(    dma_trans_t        *p_trans,
 
     }
 
+    p_trans->validated = 1;
     return p_trans->flags;
 }
 
@@ -834,14 +1118,13 @@ dma_config_flags_t dma_load_transaction( dma_trans_t *p_trans)
      */
 
     /*
-     * If the selected end event is polling, interrupts are disabled.
+     * If the selected end event is polling, the interrupts of the channel are
+     * disabled through its INTERRUPT_EN register, which is written with the
+     * others. The mie bits are shared by all the channels and are left
+     * untouched, as other channels may still be waiting for their interrupts.
      * Otherwise the mie.MEIE bit is set to one to enable machine-level
      * fast DMA interrupt.
      */
-    dma_subsys_per[channel].peri->INTERRUPT_EN = INTR_EN_NONE;
-    CSR_CLEAR_BITS(CSR_REG_MIE, DMA_DONE_CSR_REG_MIE_MASK );
-    CSR_CLEAR_BITS(CSR_REG_MIE, DMA_WINDOW_CSR_REG_MIE_MASK );
-
     if( dma_subsys_per[channel].trans->end != DMA_TRANS_END_POLLING )
     {
         /* Enable global interrupt. */
@@ -849,256 +1132,12 @@ dma_config_flags_t dma_load_transaction( dma_trans_t *p_trans)
         /* Enable machine-level fast interrupt. */
         CSR_SET_BITS(CSR_REG_MIE, DMA_DONE_CSR_REG_MIE_MASK );
         CSR_SET_BITS(CSR_REG_MIE, DMA_WINDOW_CSR_REG_MIE_MASK );
-
-        /* Enable the transaction interrupt for the channel by setting the corresponding bit in Transaction IFR */
-        write_register(  
-                        0x1,
-                        DMA_INTERRUPT_EN_REG_OFFSET,
-                        0xffff,
-                        DMA_INTERRUPT_EN_TRANSACTION_DONE_BIT,
-                        dma_subsys_per[channel].peri
-                    );
-
-        /* Only if a window is used should the window interrupt be set. */
-        if( p_trans->win_du > 0 )
-        {
-            write_register(  
-                        0x1,
-                        DMA_INTERRUPT_EN_REG_OFFSET,
-                        0xffff,
-                        DMA_INTERRUPT_EN_WINDOW_DONE_BIT,
-                        dma_subsys_per[channel].peri
-                    );
-        }
-    }
-
-    /*
-     * SET THE PADDING (If enabled)
-     */
-
-    /*
-    * In the case of a 1D transaction with padding enabled, the DMA has to be configured to treat
-    * the transaction as a 2D one with a second dimension of 1 du and a second dimension increment of 1 du.
-    */
-
-    #if DMA_ZERO_PADDING
-    if (p_trans->dim == DMA_DIM_CONF_1D && (p_trans->pad_left_du != 0 || p_trans->pad_right_du != 0))
-    {
-        p_trans->dim = DMA_DIM_CONF_2D;
-        /* Set the d2 size and increment to just the minimum */
-        p_trans->size_d2_du = 1;
-        p_trans->src->inc_d2_du = DMA_DATA_TYPE_2_SIZE( p_trans->dst_type );
-        
-        write_register( dma_subsys_per[channel].trans->pad_left_du,
-                        DMA_PAD_LEFT_REG_OFFSET,
-                        DMA_PAD_LEFT_PAD_MASK,
-                        DMA_PAD_LEFT_PAD_OFFSET,
-                        dma_subsys_per[channel].peri);
-
-        write_register( dma_subsys_per[channel].trans->pad_right_du,
-                        DMA_PAD_RIGHT_REG_OFFSET,
-                        DMA_PAD_RIGHT_PAD_MASK,
-                        DMA_PAD_RIGHT_PAD_OFFSET,
-                        dma_subsys_per[channel].peri);
-    }
-    else if (p_trans->dim == DMA_DIM_CONF_2D)
-    {
-        write_register( dma_subsys_per[channel].trans->pad_top_du,
-                        DMA_PAD_TOP_REG_OFFSET,
-                        DMA_PAD_TOP_PAD_MASK,
-                        DMA_PAD_TOP_PAD_OFFSET,
-                        dma_subsys_per[channel].peri);
-
-        write_register( dma_subsys_per[channel].trans->pad_bottom_du,
-                        DMA_PAD_BOTTOM_REG_OFFSET,
-                        DMA_PAD_BOTTOM_PAD_MASK,
-                        DMA_PAD_BOTTOM_PAD_OFFSET,
-                        dma_subsys_per[channel].peri);
-
-        write_register( dma_subsys_per[channel].trans->pad_left_du,
-                        DMA_PAD_LEFT_REG_OFFSET,
-                        DMA_PAD_LEFT_PAD_MASK,
-                        DMA_PAD_LEFT_PAD_OFFSET,
-                        dma_subsys_per[channel].peri);
-
-        write_register( dma_subsys_per[channel].trans->pad_right_du,
-                        DMA_PAD_RIGHT_REG_OFFSET,
-                        DMA_PAD_RIGHT_PAD_MASK,
-                        DMA_PAD_RIGHT_PAD_OFFSET,
-                        dma_subsys_per[channel].peri);
-    }
-    #endif
-
-    /*
-     * SET THE POINTERS
-     */
-    dma_subsys_per[channel].peri->SRC_PTR = (uint32_t)dma_subsys_per[channel].trans->src->ptr;
-
-    #if DMA_ADDR_MODE
-    if(dma_subsys_per[channel].trans->mode != DMA_TRANS_MODE_ADDRESS)
-    {
-        /*
-        Write to the destination pointers only if we are not in address mode,
-        otherwise the destination address is read in a separate port in parallel with the data
-        from the address port
-        */
-        dma_subsys_per[channel].peri->DST_PTR = (uint32_t)dma_subsys_per[channel].trans->dst->ptr;
-    }
-    else
-    {
-        dma_subsys_per[channel].peri->ADDR_PTR = (uint32_t)dma_subsys_per[channel].trans->src_addr->ptr;
-    }
-    #else
-    
-    dma_subsys_per[channel].peri->DST_PTR = (uint32_t)dma_subsys_per[channel].trans->dst->ptr;
-    
-    #endif
-
-    /*
-     * SET THE TRANSPOSITION MODE
-     */
-
-    write_register(dma_subsys_per[channel].trans->dim_inv,
-                   DMA_DIM_INV_REG_OFFSET,
-                   0x1 << DMA_DIM_INV_SEL_BIT,
-                   DMA_DIM_INV_SEL_BIT,
-                   dma_subsys_per[channel].peri);
-
-    /*
-     * SET THE INCREMENTS
-     */
-
-    /*
-     * The increments might have been changed (vs. the original value of
-     * the target) due to misalignment issues. If they have, use the changed
-     * values, otherwise, use the target-specific ones.
-     * Other reason to overwrite the target increment is if a trigger is used.
-     * In that case, a increment of 0 is necessary.
-     * In case of DMA Address mode transaction, the dst pointer is ignored
-     * as the values read from the second port are instead used.
-     * In case of a 2D DMA transaction, the second dimension increment is set.
-     */
-
-    write_register(  get_increment_b_1D( dma_subsys_per[channel].trans->src, channel),
-                    DMA_SRC_PTR_INC_D1_REG_OFFSET,
-                    DMA_SRC_PTR_INC_D1_INC_MASK,
-                    DMA_SRC_PTR_INC_D1_INC_OFFSET,
-                    dma_subsys_per[channel].peri);
-
-    if(dma_subsys_per[channel].trans->dim == DMA_DIM_CONF_2D)
-    {
-        write_register(  get_increment_b_2D( dma_subsys_per[channel].trans->src, channel),
-                        DMA_SRC_PTR_INC_D2_REG_OFFSET,
-                        DMA_SRC_PTR_INC_D2_INC_MASK,
-                        DMA_SRC_PTR_INC_D2_INC_OFFSET,
-                        dma_subsys_per[channel].peri );
-    }
-
-    #if DMA_ADDR_MODE
-    if(dma_subsys_per[channel].trans->mode != DMA_TRANS_MODE_ADDRESS)
-    {
-        write_register(  get_increment_b_1D( dma_subsys_per[channel].trans->dst, channel),
-                        DMA_DST_PTR_INC_D1_REG_OFFSET,
-                        DMA_DST_PTR_INC_D1_INC_MASK,
-                        DMA_DST_PTR_INC_D1_INC_OFFSET,
-                        dma_subsys_per[channel].peri );
-        
-        if(dma_subsys_per[channel].trans->dim == DMA_DIM_CONF_2D)
-        {
-            write_register(  get_increment_b_2D( dma_subsys_per[channel].trans->dst, channel),
-                        DMA_DST_PTR_INC_D2_REG_OFFSET,
-                        DMA_DST_PTR_INC_D2_INC_MASK,
-                        DMA_DST_PTR_INC_D2_INC_OFFSET,
-                        dma_subsys_per[channel].peri );
-        }
-    }
-    #else 
-    write_register(  get_increment_b_1D( dma_subsys_per[channel].trans->dst, channel),
-                        DMA_DST_PTR_INC_D1_REG_OFFSET,
-                        DMA_DST_PTR_INC_D1_INC_MASK,
-                        DMA_DST_PTR_INC_D1_INC_OFFSET,
-                        dma_subsys_per[channel].peri );
-        
-    if(dma_subsys_per[channel].trans->dim == DMA_DIM_CONF_2D)
-    {
-        write_register(  get_increment_b_2D( dma_subsys_per[channel].trans->dst, channel),
-                    DMA_DST_PTR_INC_D2_REG_OFFSET,
-                    DMA_DST_PTR_INC_D2_INC_MASK,
-                    DMA_DST_PTR_INC_D2_INC_OFFSET,
-                    dma_subsys_per[channel].peri );
-    }
-    #endif
-
-    /*
-     * SET THE OPERATION MODE AND WINDOW SIZE
-     */
-
-    dma_subsys_per[channel].peri->MODE = dma_subsys_per[channel].trans->mode;
-    /* The window size is set to the transaction size if it was set to 0 in
-    order to disable the functionality (it will never be triggered). */
-
-    dma_subsys_per[channel].peri->WINDOW_SIZE =   dma_subsys_per[channel].trans->win_du
-                            ? dma_subsys_per[channel].trans->win_du
-                            : dma_subsys_per[channel].trans->size_d1_du;
-
-    /* 
-     * ENABLE THE HW FIFO (IF ENABLED)
-     */
-    #if DMA_HW_FIFO_MODE
-    if( dma_subsys_per[channel].trans->hw_fifo_en == 1)
-    {
-      write_register(  1,
-                    DMA_HW_FIFO_EN_REG_OFFSET,
-                    0x1,
-                    DMA_HW_FIFO_EN_HW_FIFO_MODE_BIT,
-                    dma_subsys_per[channel].peri );
     }
-    #endif
-
-    /* 
-     * SET THE DIMENSIONALITY
-     */
-    write_register(  dma_subsys_per[channel].trans->dim,
-                    DMA_DIM_CONFIG_REG_OFFSET,
-                    0x1,
-                    DMA_DIM_CONFIG_DMA_DIM_BIT,
-                    dma_subsys_per[channel].peri );
-
-    /*
-     * SET THE SIGN EXTENSION BIT
-     */
-    write_register( dma_subsys_per[channel].trans->sign_ext,
-                    DMA_SIGN_EXT_REG_OFFSET,
-                    0x1 << DMA_SIGN_EXT_SIGNED_BIT,
-                    DMA_SIGN_EXT_SIGNED_BIT,
-                    dma_subsys_per[channel].peri  );
 
     /*
-     * SET TRIGGER SLOTS AND DATA TYPE
+     * SET THE REGISTERS
      */
-    write_register(  dma_subsys_per[channel].trans->src->trig,
-                    DMA_SLOT_REG_OFFSET,
-                    DMA_SLOT_RX_TRIGGER_SLOT_MASK,
-                    DMA_SLOT_RX_TRIGGER_SLOT_OFFSET,
-                    dma_subsys_per[channel].peri );
-
-    write_register(  dma_subsys_per[channel].trans->dst->trig,
-                    DMA_SLOT_REG_OFFSET,
-                    DMA_SLOT_TX_TRIGGER_SLOT_MASK,
-                    DMA_SLOT_TX_TRIGGER_SLOT_OFFSET,
-                    dma_subsys_per[channel].peri );
-
-    write_register(  dma_subsys_per[channel].trans->dst_type,
-                    DMA_DST_DATA_TYPE_REG_OFFSET,
-                    DMA_DST_DATA_TYPE_DATA_TYPE_MASK,
-                    DMA_SELECTION_OFFSET_START,
-                    dma_subsys_per[channel].peri  );
-    
-    write_register(  dma_subsys_per[channel].trans->src_type,
-                    DMA_SRC_DATA_TYPE_REG_OFFSET,
-                    DMA_SRC_DATA_TYPE_DATA_TYPE_MASK,
-                    DMA_SELECTION_OFFSET_START,
-                    dma_subsys_per[channel].peri );
+    load_trans_registers( channel );
 
     return DMA_CONFIG_OK;
 }
@@ -1202,49 +1241,441 @@ void dma_stop_circular(uint8_t channel)
      * a new one.
      */
     dma_subsys_per[channel].peri->MODE = DMA_TRANS_MODE_SINGLE;
+    dma_shadow[channel][IMG_MODE] = DMA_TRANS_MODE_SINGLE;
+    dma_shadow_valid[channel] |= 1 << IMG_MODE;
 }
 
 
-__attribute__((weak, optimize("O0"))) void dma_intr_handler_trans_done(uint8_t channel)
+void dma_set_window_callback(uint8_t channel, dma_window_cb_t p_cb, void *p_arg)
 {
-    /*
-     * The DMA transaction has finished!
-     * This is a weak implementation.
-     * Create your own function called
-     * void dma_intr_handler_trans_done()
-     * to override this one.
-     */
+    uint32_t mstatus;
+
+    /* The interrupt must not see the new function with the old argument. */
+    CSR_READ(CSR_REG_MSTATUS, &mstatus);
+    CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+    dma_window_hook[channel] = (dma_window_hook_t){ .cb = p_cb, .arg = p_arg };
+    CSR_WRITE(CSR_REG_MSTATUS, mstatus);
 }
 
-__attribute__((weak, optimize("O0"))) void dma_intr_handler_window_done(uint8_t channel)
+
+dma_config_flags_t dma_queue_push( dma_trans_t *p_trans,
+                                   dma_queue_cb_t p_cb,
+                                   void *p_arg )
 {
+    uint8_t channel = p_trans->channel;
+    dma_queue_t *q = &dma_queue[channel];
+    dma_config_flags_t ret = DMA_CONFIG_OK;
+    uint32_t mstatus;
+
     /*
-     * The DMA has copied another window.
-     * This is a weak implementation.
-     * Create your own function called
-     * void dma_intr_handler_window_done()
-     * to override this one.
+     * Only valid transactions that notify their end through the interrupt
+     * can be queued, as the interrupt is what launches the next one.
      */
+    if(     !p_trans->validated
+        ||  ( p_trans->flags & DMA_CONFIG_CRITICAL_ERROR )
+        ||  ( p_trans->end == DMA_TRANS_END_POLLING )
+        ||  ( p_trans->mode != DMA_TRANS_MODE_SINGLE ) )
+    {
+        return DMA_CONFIG_CRITICAL_ERROR;
+    }
+
+    /* The queue is also modified by the interrupt handler. */
+    CSR_READ(CSR_REG_MSTATUS, &mstatus);
+    CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+
+    if( q->count == DMA_QUEUE_LEN )
+    {
+        q->stats.rejected++;
+        ret = DMA_CONFIG_QUEUE_FULL;
+    }
+    else if( q->count == 0 && !dma_is_ready(channel) )
+    {
+        ret = DMA_CONFIG_TRANS_OVERRIDE;
+    }
+    else
+    {
+        dma_queue_entry_t *e = &q->entry[ (q->head + q->count) & (DMA_QUEUE_LEN - 1) ];
+        e->trans = p_trans;
+        e->cb    = p_cb;
+        e->arg   = p_arg;
+        compile_image( p_trans, &e->img );
+        q->count++;
+
+        q->stats.pushed++;
+        q->stats.depth_sum += q->count;
+        if( q->count > q->stats.max_depth )
+        {
+            q->stats.max_depth = q->count;
+        }
+
+        /* The channel is idle: launch it now. */
+        if( q->count == 1 )
+        {
+            CSR_SET_BITS(CSR_REG_MIE, DMA_DONE_CSR_REG_MIE_MASK );
+            if( p_trans->win_du > 0 )
+            {
+                CSR_SET_BITS(CSR_REG_MIE, DMA_WINDOW_CSR_REG_MIE_MASK );
+            }
+            queue_launch( channel, e );
+        }
+    }
+
+    CSR_WRITE(CSR_REG_MSTATUS, mstatus);
+    return ret;
 }
 
-__attribute__((weak, optimize("O0"))) uint8_t dma_window_ratio_warning_threshold()
+uint32_t dma_queue_pending(uint8_t channel)
 {
-    /*
-     * This is a weak implementation.
-     * Create your own function called
-     * void dma_window_ratio_warning_threshold()
-     * to override this one.
-     * Make it return 0 to disable this warning.
-     */
-    return DMA_DEFAULT_TRANS_TO_WIND_SIZE_RATIO_THRESHOLD;
+    return dma_queue[channel].count;
 }
 
-/****************************************************************************/
-/**                                                                        **/
-/*                            LOCAL FUNCTIONS                               */
-/**                                                                        **/
-/****************************************************************************/
-
+void dma_queue_wait(uint8_t channel)
+{
+    while( dma_queue[channel].count != 0 )
+    {
+        CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+        if( dma_queue[channel].count != 0 )
+        {
+            wait_for_interrupt();
+        }
+        CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+    }
+}
+
+void dma_queue_get_stats(uint8_t channel, dma_queue_stats_t *p_stats)
+{
+    *p_stats = dma_queue[channel].stats;
+}
+
+void dma_queue_reset_stats(uint8_t channel)
+{
+    dma_queue[channel].stats = (dma_queue_stats_t){0};
+}
+
+dma_config_flags_t dma_compile_transaction( dma_trans_t *p_trans,
+                                            dma_trans_image_t *p_img )
+{
+    if( p_trans->flags & DMA_CONFIG_CRITICAL_ERROR )
+    {
+        return DMA_CONFIG_CRITICAL_ERROR;
+    }
+
+    compile_image( p_trans, p_img );
+    return DMA_CONFIG_OK;
+}
+
+dma_config_flags_t dma_relaunch( dma_trans_image_t *p_img )
+{
+    uint8_t channel = p_img->channel;
+    volatile dma *peri = dma_subsys_per[channel].peri;
+
+    if( !dma_is_ready(channel) || dma_queue[channel].count != 0 )
+    {
+        return DMA_CONFIG_TRANS_OVERRIDE;
+    }
+
+    write_image( channel, p_img, 0 );
+
+    if( p_img->end != DMA_TRANS_END_POLLING )
+    {
+        CSR_SET_BITS(CSR_REG_MIE, DMA_DONE_CSR_REG_MIE_MASK );
+        if( p_img->regs[IMG_INTERRUPT_EN] & INTR_EN_WINDOW_DONE )
+        {
+            CSR_SET_BITS(CSR_REG_MIE, DMA_WINDOW_CSR_REG_MIE_MASK );
+        }
+        CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+    }
+
+    /* The registers no longer hold the loaded transaction, if any. */
+    dma_subsys_per[channel].trans = NULL;
+    dma_subsys_per[channel].intrFlag = 0;
+
+    if( p_img->dim == DMA_DIM_CONF_2D )
+    {
+        peri->SIZE_D2 = p_img->size_d2;
+    }
+    peri->SIZE_D1 = p_img->size_d1;
+
+    if( p_img->end == DMA_TRANS_END_INTR_WAIT )
+    {
+        /* The flag is read through a volatile pointer as the ISR sets it. */
+        volatile uint8_t *flag = &dma_subsys_per[channel].intrFlag;
+        while( *flag == 0 )
+        {
+            CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+            if( *flag == 0 )
+            {
+                wait_for_interrupt();
+            }
+            CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+        }
+    }
+
+    return DMA_CONFIG_OK;
+}
+
+dma_config_flags_t dma_relaunch_ptrs( dma_trans_image_t *p_img,
+                                      uint8_t *p_src,
+                                      uint8_t *p_dst )
+{
+    if( p_src != NULL )
+    {
+        p_img->regs[IMG_SRC_PTR] = (uint32_t)p_src;
+    }
+    if( p_dst != NULL )
+    {
+        p_img->regs[IMG_DST_PTR] = (uint32_t)p_dst;
+    }
+    return dma_relaunch( p_img );
+}
+
+void dma_shadow_invalidate(uint8_t channel)
+{
+    dma_shadow_valid[channel] = 0;
+}
+
+dma_config_flags_t dma_channel_acquire( dma_ch_prio_t prio,
+                                        uint32_t affinity,
+                                        uint8_t *p_channel )
+{
+    uint32_t eligible = channel_eligible( prio, affinity );
+    uint32_t mstatus, now, free;
+
+    if( eligible == 0 )
+    {
+        return DMA_CONFIG_CRITICAL_ERROR;
+    }
+
+    CSR_READ(CSR_REG_MSTATUS, &mstatus);
+    CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+
+    /*
+     * No pending request can use a free channel (it would have been granted
+     * on release), so the caller does not overtake anyone.
+     */
+    free = eligible & ~dma_ch_owned;
+    if( free == 0 )
+    {
+        CSR_WRITE(CSR_REG_MSTATUS, mstatus);
+        return DMA_CONFIG_CHANNEL_BUSY;
+    }
+
+    /* High priority users take their reserved channels first. */
+    if( prio == DMA_CH_PRIO_HIGH && ( free & DMA_CH_HP_MASK ) )
+    {
+        free &= DMA_CH_HP_MASK;
+    }
+    *p_channel = __builtin_ctz( free );
+
+    CSR_READ(CSR_REG_MCYCLE, &now);
+    channel_grant( *p_channel, now );
+
+    CSR_WRITE(CSR_REG_MSTATUS, mstatus);
+    return DMA_CONFIG_OK;
+}
+
+dma_config_flags_t dma_channel_request( dma_ch_req_t *p_req )
+{
+    dma_config_flags_t ret;
+    uint32_t mstatus;
+    dma_ch_req_t **pp;
+
+    ret = dma_channel_acquire( p_req->prio, p_req->affinity, &p_req->channel );
+    if( ret == DMA_CONFIG_OK )
+    {
+        p_req->cb( p_req->channel, p_req->arg );
+        return ret;
+    }
+    if( ret != DMA_CONFIG_CHANNEL_BUSY )
+    {
+        return ret;
+    }
+
+    CSR_READ(CSR_REG_MSTATUS, &mstatus);
+    CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+
+    /* A channel may have been released since the acquire. */
+    if( channel_eligible( p_req->prio, p_req->affinity ) & ~dma_ch_owned )
+    {
+        CSR_WRITE(CSR_REG_MSTATUS, mstatus);
+        return dma_channel_request( p_req );
+    }
+
+    p_req->next = NULL;
+    p_req->bypassed = 0;
+    CSR_READ(CSR_REG_MCYCLE, &p_req->since);
+    for( pp = &dma_ch_pending; *pp != NULL; pp = &(*pp)->next );
+    *pp = p_req;
+
+    CSR_WRITE(CSR_REG_MSTATUS, mstatus);
+    return DMA_CONFIG_CHANNEL_BUSY;
+}
+
+void dma_channel_cancel( dma_ch_req_t *p_req )
+{
+    uint32_t mstatus;
+    dma_ch_req_t **pp;
+
+    CSR_READ(CSR_REG_MSTATUS, &mstatus);
+    CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+
+    for( pp = &dma_ch_pending; *pp != NULL; pp = &(*pp)->next )
+    {
+        if( *pp == p_req )
+        {
+            *pp = p_req->next;
+            break;
+        }
+    }
+
+    CSR_WRITE(CSR_REG_MSTATUS, mstatus);
+}
+
+void dma_channel_release( uint8_t channel )
+{
+    uint32_t bit = 1 << channel;
+    uint32_t mstatus, now, wait;
+    dma_ch_req_t **pp, **p_oldest = NULL, **p_high = NULL, **p_winner;
+    dma_ch_req_t *winner = NULL;
+
+    CSR_READ(CSR_REG_MSTATUS, &mstatus);
+    CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+
+    if( !( dma_ch_owned & bit ) )
+    {
+        CSR_WRITE(CSR_REG_MSTATUS, mstatus);
+        return;
+    }
+
+    CSR_READ(CSR_REG_MCYCLE, &now);
+    dma_ch_stats[channel].busy_cycles += now - dma_ch_owned_since[channel];
+    dma_ch_owned &= ~bit;
+
+    /* Find the oldest request, and the oldest high priority one, that can use the channel. */
+    for( pp = &dma_ch_pending; *pp != NULL; pp = &(*pp)->next )
+    {
+        if( channel_eligible( (*pp)->prio, (*pp)->affinity ) & bit )
+        {
+            if( p_oldest == NULL )
+            {
+                p_oldest = pp;
+            }
+            if( (*pp)->prio == DMA_CH_PRIO_HIGH )
+            {
+                p_high = pp;
+                break;
+            }
+        }
+    }
+
+    if( p_oldest != NULL )
+    {
+        p_winner = p_oldest;
+        if( p_high != NULL && p_high != p_oldest
+            && (*p_oldest)->bypassed < DMA_CH_MAX_BYPASS )
+        {
+            (*p_oldest)->bypassed++;
+            p_winner = p_high;
+        }
+
+        winner = *p_winner;
+        *p_winner = winner->next;
+        winner->channel = channel;
+        channel_grant( channel, now );
+
+        wait = now - winner->since;
+        dma_ch_stats[channel].waits++;
+        dma_ch_stats[channel].wait_cycles += wait;
+        if( wait > dma_ch_stats[channel].max_wait_cycles )
+        {
+            dma_ch_stats[channel].max_wait_cycles = wait;
+        }
+    }
+
+    CSR_WRITE(CSR_REG_MSTATUS, mstatus);
+
+    if( winner != NULL )
+    {
+        winner->cb( channel, winner->arg );
+    }
+}
+
+void dma_channel_manager_reset( void )
+{
+    dma_ch_owned = 0;
+    dma_ch_pending = NULL;
+    dma_channel_reset_stats();
+    dma_initialized = 1;
+}
+
+void dma_channel_get_stats( uint8_t channel, dma_ch_stats_t *p_stats )
+{
+    uint32_t now;
+
+    CSR_READ(CSR_REG_MCYCLE, &now);
+    *p_stats = dma_ch_stats[channel];
+
+    /* Count the current ownership too. */
+    if( dma_ch_owned & ( 1 << channel ) )
+    {
+        p_stats->busy_cycles += now - dma_ch_owned_since[channel];
+    }
+    p_stats->window_cycles = now - dma_ch_stats_start;
+}
+
+void dma_channel_reset_stats( void )
+{
+    uint32_t now;
+
+    CSR_READ(CSR_REG_MCYCLE, &now);
+    dma_ch_stats_start = now;
+    for( int i = 0; i < DMA_CH_NUM; i++ )
+    {
+        dma_ch_stats[i] = (dma_ch_stats_t){0};
+        dma_ch_owned_since[i] = now;
+    }
+}
+
+__attribute__((weak, optimize("O0"))) void dma_intr_handler_trans_done(uint8_t channel)
+{
+    /*
+     * The DMA transaction has finished!
+     * This is a weak implementation.
+     * Create your own function called
+     * void dma_intr_handler_trans_done()
+     * to override this one.
+     */
+}
+
+__attribute__((weak, optimize("O0"))) void dma_intr_handler_window_done(uint8_t channel)
+{
+    /*
+     * The DMA has copied another window.
+     * This is a weak implementation.
+     * Create your own function called
+     * void dma_intr_handler_window_done()
+     * to override this one.
+     */
+}
+
+__attribute__((weak, optimize("O0"))) uint8_t dma_window_ratio_warning_threshold()
+{
+    /*
+     * This is a weak implementation.
+     * Create your own function called
+     * void dma_window_ratio_warning_threshold()
+     * to override this one.
+     * Make it return 0 to disable this warning.
+     */
+    return DMA_DEFAULT_TRANS_TO_WIND_SIZE_RATIO_THRESHOLD;
+}
+
+/****************************************************************************/
+/**                                                                        **/
+/*                            LOCAL FUNCTIONS                               */
+/**                                                                        **/
+/****************************************************************************/
+
 dma_config_flags_t validate_target( dma_target_t *p_tgt, dma_trans_t *p_trans )
 {
     /* Flags variable to pass encountered errors. */
@@ -1489,7 +1920,7 @@ static inline uint8_t is_region_outbound_2D(   uint8_t  *p_start,
 }
 
 static inline uint32_t get_increment_b_1D( dma_target_t * p_tgt,
-                                           uint8_t        channel)
+                                           dma_trans_t  * p_trans )
 {
     uint32_t inc_b = 0;
     /* If the target uses a trigger, the increment remains 0. */
@@ -1499,7 +1930,7 @@ static inline uint32_t get_increment_b_1D( dma_target_t * p_tgt,
          * If the transaction increment has been overriden (due to
          * misalignments), then that value is used (it's always set to 1).
          */
-        inc_b = dma_subsys_per[channel].trans->inc_b;
+        inc_b = p_trans->inc_b;
 
         /*
         * Otherwise, the target-specific increment is used transformed into
@@ -1515,7 +1946,7 @@ static inline uint32_t get_increment_b_1D( dma_target_t * p_tgt,
 }
 
 static inline uint32_t get_increment_b_2D( dma_target_t * p_tgt,
-                                           uint8_t channel )
+                                           dma_trans_t  * p_trans )
 {
     uint32_t inc_b = 0;
     /* If the target uses a trigger, the increment remains 0. */
@@ -1525,7 +1956,7 @@ static inline uint32_t get_increment_b_2D( dma_target_t * p_tgt,
          * If the transaction increment has been overriden (due to
          * misalignments), then that value is used (it's always set to 1).
          */
-        inc_b = dma_subsys_per[channel].trans->inc_b;
+        inc_b = p_trans->inc_b;
 
         /*
         * Otherwise, the target-specific increment is used transformed into
@@ -1540,6 +1971,272 @@ static inline uint32_t get_increment_b_2D( dma_target_t * p_tgt,
     return inc_b;
 }
 
+static void compile_image( dma_trans_t *p_trans, dma_trans_image_t *p_img )
+{
+    uint32_t *regs = p_img->regs;
+
+    /*
+     * The registers not used by the transaction (e.g. the second dimension
+     * of a 1D transaction) are left out of the mask and never written.
+     */
+    p_img->mask = ( 1 << IMG__size ) - 1;
+
+    /*
+     * SET THE PADDING (If enabled)
+     */
+
+    /*
+    * In the case of a 1D transaction with padding enabled, the DMA has to be configured to treat
+    * the transaction as a 2D one with a second dimension of 1 du and a second dimension increment of 1 du.
+    */
+
+    #if DMA_ZERO_PADDING
+    if (p_trans->dim == DMA_DIM_CONF_1D && (p_trans->pad_left_du != 0 || p_trans->pad_right_du != 0))
+    {
+        p_trans->dim = DMA_DIM_CONF_2D;
+        /* Set the d2 size and increment to just the minimum */
+        p_trans->size_d2_du = 1;
+        p_trans->src->inc_d2_du = DMA_DATA_TYPE_2_SIZE( p_trans->dst_type );
+    }
+
+    /* All the paddings are written so none is left over from a previous transaction. */
+    regs[IMG_PAD_TOP]    = p_trans->pad_top_du    & DMA_PAD_TOP_PAD_MASK;
+    regs[IMG_PAD_BOTTOM] = p_trans->pad_bottom_du & DMA_PAD_BOTTOM_PAD_MASK;
+    regs[IMG_PAD_LEFT]   = p_trans->pad_left_du   & DMA_PAD_LEFT_PAD_MASK;
+    regs[IMG_PAD_RIGHT]  = p_trans->pad_right_du  & DMA_PAD_RIGHT_PAD_MASK;
+    #endif
+
+    /*
+     * SET THE POINTERS
+     */
+    regs[IMG_SRC_PTR] = (uint32_t)p_trans->src->ptr;
+    regs[IMG_DST_PTR] = (uint32_t)p_trans->dst->ptr;
+
+    #if DMA_ADDR_MODE
+    regs[IMG_ADDR_PTR] = 0;
+    if(p_trans->mode != DMA_TRANS_MODE_ADDRESS)
+    {
+        p_img->mask &= ~( 1 << IMG_ADDR_PTR );
+    }
+    else
+    {
+        /*
+        The destination pointers are not written in address mode, as the
+        destination address is read in a separate port in parallel with the
+        data from the address port.
+        */
+        regs[IMG_ADDR_PTR] = (uint32_t)p_trans->src_addr->ptr;
+        p_img->mask &= ~( ( 1 << IMG_DST_PTR )
+                        | ( 1 << IMG_DST_INC_D1 )
+                        | ( 1 << IMG_DST_INC_D2 ) );
+    }
+    #endif
+
+    /*
+     * SET THE TRANSPOSITION MODE
+     */
+    regs[IMG_DIM_INV] = (p_trans->dim_inv & 0x1) << DMA_DIM_INV_SEL_BIT;
+
+    /*
+     * SET THE INCREMENTS
+     */
+
+    /*
+     * The increments might have been changed (vs. the original value of
+     * the target) due to misalignment issues. If they have, use the changed
+     * values, otherwise, use the target-specific ones.
+     * Other reason to overwrite the target increment is if a trigger is used.
+     * In that case, a increment of 0 is necessary.
+     * In case of a 2D DMA transaction, the second dimension increment is set.
+     */
+    regs[IMG_SRC_INC_D1] = get_increment_b_1D( p_trans->src, p_trans ) & DMA_SRC_PTR_INC_D1_INC_MASK;
+    regs[IMG_DST_INC_D1] = get_increment_b_1D( p_trans->dst, p_trans ) & DMA_DST_PTR_INC_D1_INC_MASK;
+
+    if(p_trans->dim == DMA_DIM_CONF_2D)
+    {
+        regs[IMG_SRC_INC_D2] = get_increment_b_2D( p_trans->src, p_trans ) & DMA_SRC_PTR_INC_D2_INC_MASK;
+        regs[IMG_DST_INC_D2] = get_increment_b_2D( p_trans->dst, p_trans ) & DMA_DST_PTR_INC_D2_INC_MASK;
+    }
+    else
+    {
+        regs[IMG_SRC_INC_D2] = 0;
+        regs[IMG_DST_INC_D2] = 0;
+        p_img->mask &= ~( ( 1 << IMG_SRC_INC_D2 ) | ( 1 << IMG_DST_INC_D2 ) );
+    }
+
+    /*
+     * SET THE OPERATION MODE AND WINDOW SIZE
+     */
+
+    regs[IMG_MODE] = p_trans->mode;
+    /* The window size is set to the transaction size if it was set to 0 in
+    order to disable the functionality (it will never be triggered). */
+
+    regs[IMG_WINDOW_SIZE] = p_trans->win_du ? p_trans->win_du : p_trans->size_d1_du;
+
+    /*
+     * ENABLE THE HW FIFO (IF ENABLED)
+     */
+    #if DMA_HW_FIFO_MODE
+    regs[IMG_HW_FIFO_EN] = (p_trans->hw_fifo_en & 0x1) << DMA_HW_FIFO_EN_HW_FIFO_MODE_BIT;
+    #endif
+
+    /*
+     * SET THE DIMENSIONALITY
+     */
+    regs[IMG_DIM_CONFIG] = (p_trans->dim & 0x1) << DMA_DIM_CONFIG_DMA_DIM_BIT;
+
+    /*
+     * SET THE SIGN EXTENSION BIT
+     */
+    regs[IMG_SIGN_EXT] = (p_trans->sign_ext & 0x1) << DMA_SIGN_EXT_SIGNED_BIT;
+
+    /*
+     * SET TRIGGER SLOTS AND DATA TYPE
+     */
+    regs[IMG_SLOT] = ((p_trans->src->trig & DMA_SLOT_RX_TRIGGER_SLOT_MASK) << DMA_SLOT_RX_TRIGGER_SLOT_OFFSET)
+                   | ((p_trans->dst->trig & DMA_SLOT_TX_TRIGGER_SLOT_MASK) << DMA_SLOT_TX_TRIGGER_SLOT_OFFSET);
+
+    regs[IMG_DST_TYPE] = p_trans->dst_type & DMA_DST_DATA_TYPE_DATA_TYPE_MASK;
+    regs[IMG_SRC_TYPE] = p_trans->src_type & DMA_SRC_DATA_TYPE_DATA_TYPE_MASK;
+
+    /*
+     * SET THE INTERRUPTS
+     */
+
+    /* Only if a window is used should the window interrupt be set. */
+    regs[IMG_INTERRUPT_EN] = INTR_EN_NONE;
+    if( p_trans->end != DMA_TRANS_END_POLLING )
+    {
+        regs[IMG_INTERRUPT_EN] = INTR_EN_TRANS_DONE
+                               | ( p_trans->win_du > 0 ? INTR_EN_WINDOW_DONE : INTR_EN_NONE );
+    }
+
+    /*
+     * SET THE SIZES
+     */
+    p_img->size_d1 = p_trans->size_d1_du & DMA_SIZE_D1_SIZE_MASK;
+    p_img->size_d2 = p_trans->size_d2_du & DMA_SIZE_D2_SIZE_MASK;
+    p_img->dim     = p_trans->dim;
+    p_img->end     = p_trans->end;
+    p_img->channel = p_trans->channel;
+}
+
+static void write_image( uint8_t channel,
+                         const dma_trans_image_t *p_img,
+                         uint8_t p_all )
+{
+    /*
+     * Every register holds a single field, so they are written with plain
+     * stores instead of read-modify-write accesses.
+     */
+    volatile uint32_t *peri = (volatile uint32_t *)dma_subsys_per[channel].peri;
+    uint32_t *shadow = dma_shadow[channel];
+    uint32_t known = p_all ? 0 : dma_shadow_valid[channel];
+
+    for( uint8_t i = 0; i < IMG__size; i++ )
+    {
+        uint32_t bit = 1 << i;
+        if( ( p_img->mask & bit )
+            && ( !( known & bit ) || shadow[i] != p_img->regs[i] ) )
+        {
+            peri[ dma_image_reg[i] ] = p_img->regs[i];
+            shadow[i] = p_img->regs[i];
+        }
+    }
+    dma_shadow_valid[channel] |= p_img->mask;
+}
+
+static void load_trans_registers( uint8_t channel )
+{
+    dma_trans_image_t img;
+
+    compile_image( dma_subsys_per[channel].trans, &img );
+    write_image( channel, &img, 1 );
+}
+
+static inline uint32_t intr_pending( uint32_t summary_offset )
+{
+    /*
+     * The summary has a bit per channel whose IFR is set, so only the IFR of
+     * the channels to serve are read. A DMA given to dma_init() has no
+     * summary: all its channels are read.
+     */
+    if( dma_intr_summary )
+    {
+        return *(volatile uint32_t *)( DMA_START_ADDRESS + DMA_INTR_SUMMARY_OFFSET
+                                       + summary_offset ) & DMA_CH_ALL_MASK;
+    }
+    return DMA_CH_ALL_MASK;
+}
+
+static uint32_t channel_eligible( dma_ch_prio_t prio, uint32_t affinity )
+{
+    uint32_t mask = affinity ? ( affinity & DMA_CH_ALL_MASK ) : DMA_CH_ALL_MASK;
+
+    /*
+     * Normal users cannot take the reserved channels, unless all the
+     * channels are reserved.
+     */
+    if( prio != DMA_CH_PRIO_HIGH && ( DMA_CH_ALL_MASK & ~DMA_CH_HP_MASK ) )
+    {
+        mask &= ~DMA_CH_HP_MASK;
+    }
+    return mask;
+}
+
+static void channel_grant( uint8_t channel, uint32_t now )
+{
+    dma_ch_owned |= 1 << channel;
+    dma_ch_owned_since[channel] = now;
+    dma_ch_stats[channel].grants++;
+}
+
+static void queue_launch( uint8_t channel, const dma_queue_entry_t *p_entry )
+{
+    volatile dma *peri = dma_subsys_per[channel].peri;
+    const dma_trans_image_t *img = &p_entry->img;
+
+    /*
+     * Same as dma_load_transaction() followed by dma_launch(), without the
+     * checks and the CSR accesses: the transaction was validated and compiled
+     * when pushed and the channel is known to be idle. Consecutive queued
+     * transactions usually differ only in a few registers, so only those are
+     * written.
+     */
+    dma_subsys_per[channel].trans = p_entry->trans;
+
+    write_image( channel, img, 0 );
+
+    dma_subsys_per[channel].intrFlag = 0;
+
+    if( img->dim == DMA_DIM_CONF_2D )
+    {
+        peri->SIZE_D2 = img->size_d2;
+    }
+    peri->SIZE_D1 = img->size_d1;
+}
+
+static void queue_advance( uint8_t channel )
+{
+    dma_queue_t *q = &dma_queue[channel];
+    dma_queue_entry_t done = q->entry[q->head];
+
+    q->head = ( q->head + 1 ) & ( DMA_QUEUE_LEN - 1 );
+    q->count--;
+    q->stats.completed++;
+
+    /* Keep the DMA busy: the next transaction starts before the callback. */
+    if( q->count != 0 )
+    {
+        queue_launch( channel, &q->entry[q->head] );
+    }
+
+    if( done.cb != NULL )
+    {
+        done.cb( done.trans, done.arg );
+    }
+}
 
 #ifdef __cplusplus
 }
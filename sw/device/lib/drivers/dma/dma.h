@@ -97,6 +97,22 @@
 //#define DMA_HP_INTR_INDEX 0
 //#define DMA_NUM_HP_INTR 5
 
+/**
+ * Number of transactions that can be queued on each channel with
+ * dma_queue_push(). Must be a power of two.
+ */
+#ifndef DMA_QUEUE_LEN
+#define DMA_QUEUE_LEN 8
+#endif
+
+/**
+ * Number of times the oldest pending channel request can be overtaken by
+ * high priority requests before it is served first.
+ */
+#ifndef DMA_CH_MAX_BYPASS
+#define DMA_CH_MAX_BYPASS 4
+#endif
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -301,6 +317,12 @@ typedef enum
     values cannot be modified, nor can it be re-launched. */
     DMA_CONFIG_CRITICAL_ERROR   = 0x0200, /*!< This flag determines the function
     will return without the DMA performing any actions. */
+    DMA_CONFIG_QUEUE_FULL       = 0x0400, /*!< The queue of the channel has no
+    free entry. The transaction was not queued. */
+    DMA_CONFIG_CHANNEL_BUSY     = 0x0800, /*!< All the channels that could be
+    used are owned by other users. */
+    DMA_CONFIG_OVERRUN          = 0x1000, /*!< The DMA overwrote data before
+    the application had consumed it. */
 } dma_config_flags_t;
 
 /**
@@ -387,9 +409,110 @@ typedef struct
     is launched. */
     dma_config_flags_t  flags;  /*!< A mask with possible issues aroused from
     the creation of the transaction. */
+    uint8_t             validated; /*!< Set by dma_validate_transaction()
+    when the transaction has no critical error. */
     uint8_t             channel; /*!< The channel to use. */
 } dma_trans_t;
 
+/**
+ * Function called from the transaction done interrupt when a queued
+ * transaction has finished. The next queued transaction, if any, is already
+ * running when it is called.
+ */
+typedef void (*dma_queue_cb_t)( dma_trans_t *p_trans, void *p_arg );
+
+/**
+ * Function called from the window done interrupt of a channel, before
+ * dma_intr_handler_window_done().
+ */
+typedef void (*dma_window_cb_t)( uint8_t channel, void *p_arg );
+
+/**
+ * Statistics of the transaction queue of a channel.
+ */
+typedef struct
+{
+    uint32_t pushed;    /*!< Transactions accepted in the queue. */
+    uint32_t completed; /*!< Queued transactions that have finished. */
+    uint32_t rejected;  /*!< Pushes refused because the queue was full. */
+    uint32_t max_depth; /*!< Largest number of transactions in the queue,
+    including the running one. */
+    uint32_t depth_sum; /*!< Sum of the queue depth seen by every accepted
+    push. Divided by pushed it gives the average depth. */
+} dma_queue_stats_t;
+
+/**
+ * Priority classes of the channel manager.
+ * When DMA_HP_INTR_INDEX is defined, channels 0 to DMA_HP_INTR_INDEX (whose
+ * interrupts are serviced first) are reserved to high priority users, which
+ * can also use the other channels. Otherwise all the channels are shared.
+ */
+typedef enum
+{
+    DMA_CH_PRIO_NORMAL  = 0,
+    DMA_CH_PRIO_HIGH    = 1,
+} dma_ch_prio_t;
+
+/**
+ * Function called when a channel is granted to a pending request. It can be
+ * called from an interrupt handler, as channels are often released there.
+ */
+typedef void (*dma_ch_grant_cb_t)( uint8_t channel, void *p_arg );
+
+/**
+ * A request for a channel that waits until one is released.
+ */
+typedef struct dma_ch_req
+{
+    dma_ch_prio_t       prio;     /*!< Priority class. */
+    uint32_t            affinity; /*!< Mask of the channels that can be
+    used, 0 for any channel of the class. */
+    dma_ch_grant_cb_t   cb;       /*!< Called when a channel is granted. */
+    void*               arg;      /*!< Passed to cb. */
+    uint8_t             channel;  /*!< The granted channel. */
+
+    struct dma_ch_req*  next;     /*!< Private. */
+    uint32_t            since;    /*!< Private. */
+    uint8_t             bypassed; /*!< Private. */
+} dma_ch_req_t;
+
+/**
+ * Utilization statistics of a channel, in clock cycles.
+ */
+typedef struct
+{
+    uint32_t grants;          /*!< Times the channel was acquired. */
+    uint32_t waits;           /*!< Grants to requests that had to wait. */
+    uint32_t wait_cycles;     /*!< Total waiting time of those requests. */
+    uint32_t max_wait_cycles; /*!< Longest waiting time. */
+    uint32_t busy_cycles;     /*!< Time the channel has been owned. */
+    uint32_t window_cycles;   /*!< Time since the statistics were reset.
+    busy_cycles / window_cycles is the utilization of the channel. */
+} dma_ch_stats_t;
+
+/**
+ * Number of configuration registers in a transaction image (the sizes are
+ * kept apart because writing them starts the transaction).
+ */
+#define DMA_TRANS_IMAGE_REGS ( 15 + DMA_ADDR_MODE + DMA_HW_FIFO_MODE + 4*DMA_ZERO_PADDING )
+
+/**
+ * A transaction compiled by dma_compile_transaction(): the final values of
+ * the DMA registers, ready to be written without any further check.
+ * Its content is private to the driver.
+ */
+typedef struct
+{
+    uint32_t regs[DMA_TRANS_IMAGE_REGS]; /*!< Register values. */
+    uint32_t mask;      /*!< Registers used by the transaction (one bit per
+    entry of regs). The others are ignored by the DMA. */
+    uint32_t size_d1;   /*!< Value of SIZE_D1. */
+    uint32_t size_d2;   /*!< Value of SIZE_D2, only written in 2D. */
+    uint8_t  dim;       /*!< A dma_dim_t. */
+    uint8_t  end;       /*!< A dma_trans_end_evt_t. */
+    uint8_t  channel;   /*!< The channel the image is launched on. */
+} dma_trans_image_t;
+
 /****************************************************************************/
 /**                                                                        **/
 /**                          EXPORTED VARIABLES                            **/
@@ -406,13 +529,13 @@ typedef struct
  * @brief This is a non-weak implementation of the function declared in
  * fast_intr_ctrl.c
  */
-__attribute__((optimize("O0"))) void fic_irq_dma_window(void);
+void fic_irq_dma_window(void);
 
 /**
  * @brief This is a non-weak implementation of the function declared in
  * fast_intr_ctrl.c
  */
-__attribute__((optimize("O0"))) void fic_irq_dma_done(void);
+void fic_irq_dma_done(void);
 
 /**
  * @brief Writes a given value into the specified register. Its operation
@@ -457,9 +580,14 @@ static inline void write_register( uint32_t  p_val,
 /**
  *@brief Takes all DMA configurations to a state where no accidental
  * transaction can be performed.
- * It can be called anytime to reset the DMA control block.
+ * It can be called anytime to reset the DMA control block. Only the first call
+ * frees the channels of the channel manager: later calls leave the channels
+ * owned through dma_channel_acquire() or dma_channel_request() untouched
+ * (registers, queue and peripheral). Call dma_channel_manager_reset() before
+ * to reset all the channels.
  * @param dma_peri Pointer to a register address following the dma structure. By
- * default (peri == NULL), the integrated DMA will be used.
+ * default (peri == NULL), the integrated DMA will be used. It is not applied
+ * to the owned channels.
  */
 void dma_init( dma *dma_peri);
 
@@ -538,6 +666,192 @@ uint32_t dma_get_window_count(uint8_t channel);
  */
 void dma_stop_circular(uint8_t channel);
 
+/**
+ * @brief Set a function to be called from the window done interrupt of a
+ * channel, before dma_intr_handler_window_done(). It lets a library consume
+ * the windows of a transaction while the application keeps the weak handler.
+ * It is cleared by dma_init().
+ * @param channel The channel.
+ * @param p_cb The function, or NULL to remove it.
+ * @param p_arg Passed to p_cb.
+ */
+void dma_set_window_callback(uint8_t channel, dma_window_cb_t p_cb, void *p_arg);
+
+/**
+ * @brief Appends a transaction to the queue of its channel. If the queue was
+ * empty the transaction is loaded and launched immediately, otherwise the
+ * transaction done interrupt launches it as soon as the previous one finishes,
+ * without waiting for the application.
+ * The transaction must have been validated with dma_validate_transaction().
+ * It must use DMA_TRANS_END_INTR as end event (DMA_TRANS_END_INTR_WAIT is
+ * treated as DMA_TRANS_END_INTR) and the SINGLE mode.
+ * The transaction is compiled into its register values here, so the
+ * interrupt only writes them to launch it.
+ * Queued transactions must not be modified until they have finished, and
+ * dma_load_transaction() and dma_launch() must not be used on the channel
+ * while its queue is not empty.
+ * @param p_trans Pointer to the transaction. The content of this pointer must
+ * be a static variable.
+ * @param p_cb Function called when the transaction has finished. Can be NULL.
+ * @param p_arg Argument passed to p_cb.
+ * @retval DMA_CONFIG_OK == 0 if the transaction was queued.
+ * @retval DMA_CONFIG_QUEUE_FULL if the queue has no free entry.
+ * @retval DMA_CONFIG_TRANS_OVERRIDE if the queue is empty but the channel is
+ * running a transaction launched with dma_launch().
+ * @retval DMA_CONFIG_CRITICAL_ERROR if the transaction was not validated, is
+ * not valid or does not use interrupts.
+ */
+dma_config_flags_t dma_queue_push( dma_trans_t *p_trans,
+                                   dma_queue_cb_t p_cb,
+                                   void *p_arg );
+
+/**
+ * @brief Get the number of transactions in the queue of a channel, including
+ * the running one.
+ * @param channel The channel to read from.
+ */
+uint32_t dma_queue_pending(uint8_t channel);
+
+/**
+ * @brief Wait in a wait_for_interrupt (wfi) state until all the transactions
+ * queued on a channel have finished.
+ * @param channel The channel to wait for.
+ */
+void dma_queue_wait(uint8_t channel);
+
+/**
+ * @brief Get the statistics of the queue of a channel.
+ * @param channel The channel to read from.
+ * @param p_stats Where the statistics are copied.
+ */
+void dma_queue_get_stats(uint8_t channel, dma_queue_stats_t *p_stats);
+
+/**
+ * @brief Clear the statistics of the queue of a channel.
+ * @param channel The channel to clear.
+ */
+void dma_queue_reset_stats(uint8_t channel);
+
+/**
+ * @brief Compiles a validated transaction into an image of the values of the
+ * DMA registers. The image can then be launched many times with
+ * dma_relaunch() without validating and loading the transaction again.
+ * The transaction is not loaded and can be modified or discarded afterwards.
+ * @param p_trans Pointer to a transaction validated with
+ * dma_validate_transaction().
+ * @param p_img Where the image is written.
+ * @retval DMA_CONFIG_OK == 0 if the image was compiled.
+ * @retval DMA_CONFIG_CRITICAL_ERROR if the transaction is not valid.
+ */
+dma_config_flags_t dma_compile_transaction( dma_trans_t *p_trans,
+                                            dma_trans_image_t *p_img );
+
+/**
+ * @brief Launches a compiled transaction. The driver keeps a copy of the
+ * last value written to each register of the channel, so only the registers
+ * that differ from the previous transaction are written.
+ * Interrupts are enabled as dma_load_transaction() would, and if the end
+ * event is DMA_TRANS_END_INTR_WAIT the function returns once the
+ * transaction has finished.
+ * @param p_img Pointer to the image.
+ * @retval DMA_CONFIG_OK == 0 if the transaction was launched.
+ * @retval DMA_CONFIG_TRANS_OVERRIDE if the channel is busy or its queue is
+ * not empty.
+ */
+dma_config_flags_t dma_relaunch( dma_trans_image_t *p_img );
+
+/**
+ * @brief Same as dma_relaunch() with new source and destination pointers,
+ * which are stored in the image. Nothing is checked, so the new pointers
+ * must have the same alignment as the compiled ones and leave the whole
+ * transaction inside the memory.
+ * @param p_img Pointer to the image.
+ * @param p_src New source pointer, or NULL to keep the current one.
+ * @param p_dst New destination pointer, or NULL to keep the current one.
+ * Ignored in address mode.
+ * @return The same as dma_relaunch().
+ */
+dma_config_flags_t dma_relaunch_ptrs( dma_trans_image_t *p_img,
+                                      uint8_t *p_src,
+                                      uint8_t *p_dst );
+
+/**
+ * @brief Acquires a free channel. The channel manager only keeps track of
+ * the owners, transactions are still loaded and launched with the other
+ * functions of the driver on the acquired channel.
+ * High priority users get a channel of the high priority range if one is
+ * free, and the lowest free channel otherwise.
+ * @param prio Priority class.
+ * @param affinity Mask of the channels that can be used, 0 for any channel
+ * of the class.
+ * @param p_channel Where the acquired channel is written.
+ * @retval DMA_CONFIG_OK == 0 if a channel was acquired.
+ * @retval DMA_CONFIG_CHANNEL_BUSY if all the allowed channels are owned.
+ * @retval DMA_CONFIG_CRITICAL_ERROR if no channel can ever match.
+ */
+dma_config_flags_t dma_channel_acquire( dma_ch_prio_t prio,
+                                        uint32_t affinity,
+                                        uint8_t *p_channel );
+
+/**
+ * @brief Requests a channel. If one is free it is granted immediately,
+ * otherwise the request waits in a FIFO shared by all the priority classes
+ * until a channel it can use is released. A released channel goes to the
+ * oldest request that can use it, unless a high priority request is
+ * waiting too, which is served first. The oldest request cannot be
+ * overtaken more than DMA_CH_MAX_BYPASS times.
+ * In both cases p_req->cb is called once the channel is granted.
+ * @param p_req The request. It must not be modified while it is pending.
+ * @retval DMA_CONFIG_OK == 0 if the channel was granted immediately.
+ * @retval DMA_CONFIG_CHANNEL_BUSY if the request is pending.
+ * @retval DMA_CONFIG_CRITICAL_ERROR if no channel can ever match.
+ */
+dma_config_flags_t dma_channel_request( dma_ch_req_t *p_req );
+
+/**
+ * @brief Removes a pending request. It has no effect if the request is not
+ * pending.
+ * @param p_req The request.
+ */
+void dma_channel_cancel( dma_ch_req_t *p_req );
+
+/**
+ * @brief Releases an acquired channel, which is granted to a pending request
+ * if there is one that can use it. Can be called from an interrupt handler.
+ * The channel must be idle.
+ * @param channel The channel to release.
+ */
+void dma_channel_release( uint8_t channel );
+
+/**
+ * @brief Frees all the channels of the channel manager, drops the pending
+ * requests without calling their callbacks and clears the statistics. The
+ * channels are not reset: call dma_init() afterwards. Must only be called
+ * when none of the owners uses its channel anymore.
+ */
+void dma_channel_manager_reset( void );
+
+/**
+ * @brief Get the utilization statistics of a channel. The cycles are
+ * measured with mcycle, which must be enabled.
+ * @param channel The channel to read from.
+ * @param p_stats Where the statistics are copied.
+ */
+void dma_channel_get_stats( uint8_t channel, dma_ch_stats_t *p_stats );
+
+/**
+ * @brief Clear the utilization statistics of all the channels.
+ */
+void dma_channel_reset_stats( void );
+
+/**
+ * @brief Forget the register values known by the driver for a channel, so
+ * the next launch writes every register. Must be called after writing the
+ * DMA registers of the channel without this driver.
+ * @param channel The channel whose registers were written.
+ */
+void dma_shadow_invalidate(uint8_t channel);
+
 /**
 * @brief DMA interrupt handler.
 * `dma.c` provides a weak definition of this symbol, which can be overridden
@@ -37,6 +37,7 @@ extern "C" {
 #include "core_v_mini_mcu.h"
 #include "fast_intr_ctrl_regs.h"  // Generated.
 #include "fast_intr_ctrl_structs.h"
+#include "irq_trace.h"
 
 /****************************************************************************/
 /**                                                                        **/
@@ -211,12 +212,22 @@ INTERRUPT_HANDLER_ABI void handler_irq_fast_gpio_7(void);
 /**                                                                        **/
 /****************************************************************************/
 
+#ifdef IRQ_FAST_PATH
+volatile uint32_t * const fic_irq_clear_reg = (volatile uint32_t *)
+    (FAST_INTR_CTRL_START_ADDRESS + FAST_INTR_CTRL_FAST_INTR_CLEAR_REG_OFFSET);
+#endif
+
 /****************************************************************************/
 /**                                                                        **/
 /*                            GLOBAL VARIABLES                              */
 /**                                                                        **/
 /****************************************************************************/
 
+/**
+ * Handlers registered with fic_set_handler(), one per line.
+ */
+static fic_handler_t fic_handlers[kExt_peri_fic_e + 1];
+
 /****************************************************************************/
 /**                                                                        **/
 /*                           EXPORTED FUNCTIONS                             */
@@ -251,6 +262,46 @@ fast_intr_ctrl_result_t clear_fast_interrupt(fast_intr_ctrl_fast_interrupt_t\
     return kFastIntrCtrlOk_e;
 }
 
+fast_intr_ctrl_result_t fic_set_handler(fast_intr_ctrl_fast_interrupt_t\
+ fast_interrupt, fic_handler_t handler)
+{
+    if (fast_interrupt > kExt_peri_fic_e)
+    {
+        return kFastIntrCtrlError_e;
+    }
+    fic_handlers[fast_interrupt] = handler;
+    return kFastIntrCtrlOk_e;
+}
+
+void fic_irq_dispatch(fast_intr_ctrl_fast_interrupt_t fast_interrupt)
+{
+    if (fic_handlers[fast_interrupt] != NULL)
+    {
+        fic_handlers[fast_interrupt]();
+        return;
+    }
+    switch (fast_interrupt)
+    {
+        case kTimer_1_fic_e:    fic_irq_timer_1();        break;
+        case kTimer_2_fic_e:    fic_irq_timer_2();        break;
+        case kTimer_3_fic_e:    fic_irq_timer_3();        break;
+        case kDma_done_fic_e:   fic_irq_dma_done();       break;
+        case kSpi_fic_e:        fic_irq_spi();            break;
+        case kSpiFlash_fic_e:   fic_irq_spi_flash();      break;
+        case kGpio_0_fic_e:     fic_irq_gpio_0();         break;
+        case kGpio_1_fic_e:     fic_irq_gpio_1();         break;
+        case kGpio_2_fic_e:     fic_irq_gpio_2();         break;
+        case kGpio_3_fic_e:     fic_irq_gpio_3();         break;
+        case kGpio_4_fic_e:     fic_irq_gpio_4();         break;
+        case kGpio_5_fic_e:     fic_irq_gpio_5();         break;
+        case kGpio_6_fic_e:     fic_irq_gpio_6();         break;
+        case kGpio_7_fic_e:     fic_irq_gpio_7();         break;
+        case kDma_window_fic_e: fic_irq_dma_window();     break;
+        case kExt_peri_fic_e:   fic_irq_ext_peripheral(); break;
+        default:                                          break;
+    }
+}
+
 __attribute__((weak, optimize("O0"))) void fic_irq_timer_1(void)
 {
     /* Users should implement their non-weak version */
@@ -339,130 +390,162 @@ __attribute__((weak, optimize("O0"))) void fic_irq_gpio_7(void)
 
 void handler_irq_fast_timer_1(void)
 {
+    IRQ_TRACE_ENTER(IRQ_TRACE_ID_FIC(kTimer_1_fic_e));
     // The interrupt is cleared.
     clear_fast_interrupt(kTimer_1_fic_e);
-    // call the weak fic handler
-    fic_irq_timer_1();
+    // call the registered or the weak fic handler
+    fic_irq_dispatch(kTimer_1_fic_e);
+    IRQ_TRACE_EXIT(IRQ_TRACE_ID_FIC(kTimer_1_fic_e));
 }
 
 void handler_irq_fast_timer_2(void)
 {
+    IRQ_TRACE_ENTER(IRQ_TRACE_ID_FIC(kTimer_2_fic_e));
     // The interrupt is cleared.
     clear_fast_interrupt(kTimer_2_fic_e);
-    // call the weak fic handler
-    fic_irq_timer_2();
+    // call the registered or the weak fic handler
+    fic_irq_dispatch(kTimer_2_fic_e);
+    IRQ_TRACE_EXIT(IRQ_TRACE_ID_FIC(kTimer_2_fic_e));
 }
 
 void handler_irq_fast_timer_3(void)
 {
+    IRQ_TRACE_ENTER(IRQ_TRACE_ID_FIC(kTimer_3_fic_e));
     // The interrupt is cleared.
     clear_fast_interrupt(kTimer_3_fic_e);
-    // call the weak fic handler
-    fic_irq_timer_3();
+    // call the registered or the weak fic handler
+    fic_irq_dispatch(kTimer_3_fic_e);
+    IRQ_TRACE_EXIT(IRQ_TRACE_ID_FIC(kTimer_3_fic_e));
 }
 
 void handler_irq_fast_dma_done(void)
 {
+    IRQ_TRACE_ENTER(IRQ_TRACE_ID_FIC(kDma_done_fic_e));
     // The interrupt is cleared.
     clear_fast_interrupt(kDma_done_fic_e);
-    // call the weak fic handler
-    fic_irq_dma_done();
+    // call the registered or the weak fic handler
+    fic_irq_dispatch(kDma_done_fic_e);
+    IRQ_TRACE_EXIT(IRQ_TRACE_ID_FIC(kDma_done_fic_e));
 }
 
 void handler_irq_fast_dma_window(void)
 {
+    IRQ_TRACE_ENTER(IRQ_TRACE_ID_FIC(kDma_window_fic_e));
     // The interrupt is cleared.
     clear_fast_interrupt(kDma_window_fic_e);
-    // call the weak fic handler
-    fic_irq_dma_window();
+    // call the registered or the weak fic handler
+    fic_irq_dispatch(kDma_window_fic_e);
+    IRQ_TRACE_EXIT(IRQ_TRACE_ID_FIC(kDma_window_fic_e));
 }
 
 void handler_irq_fast_external_peripheral(void)
 {
+    IRQ_TRACE_ENTER(IRQ_TRACE_ID_FIC(kExt_peri_fic_e));
     // The interrupt is cleared.
     clear_fast_interrupt(kExt_peri_fic_e);
-    // call the weak fic handler
-    fic_irq_ext_peripheral();
+    // call the registered or the weak fic handler
+    fic_irq_dispatch(kExt_peri_fic_e);
+    IRQ_TRACE_EXIT(IRQ_TRACE_ID_FIC(kExt_peri_fic_e));
 }
 
 void handler_irq_fast_spi(void)
 {
+    IRQ_TRACE_ENTER(IRQ_TRACE_ID_FIC(kSpi_fic_e));
     // The interrupt is cleared.
     clear_fast_interrupt(kSpi_fic_e);
-    // call the weak fic handler
-    fic_irq_spi();
+    // call the registered or the weak fic handler
+    fic_irq_dispatch(kSpi_fic_e);
+    IRQ_TRACE_EXIT(IRQ_TRACE_ID_FIC(kSpi_fic_e));
 }
 
 void handler_irq_fast_spi_flash(void)
 {
+    IRQ_TRACE_ENTER(IRQ_TRACE_ID_FIC(kSpiFlash_fic_e));
     // The interrupt is cleared.
     clear_fast_interrupt(kSpiFlash_fic_e);
-    // call the weak fic handler
-    fic_irq_spi_flash();
+    // call the registered or the weak fic handler
+    fic_irq_dispatch(kSpiFlash_fic_e);
+    IRQ_TRACE_EXIT(IRQ_TRACE_ID_FIC(kSpiFlash_fic_e));
 }
 
 void handler_irq_fast_gpio_0(void)
 {
+    IRQ_TRACE_ENTER(IRQ_TRACE_ID_FIC(kGpio_0_fic_e));
     // The interrupt is cleared.
     clear_fast_interrupt(kGpio_0_fic_e);
-    // call the weak fic handler
-    fic_irq_gpio_0();
+    // call the registered or the weak fic handler
+    fic_irq_dispatch(kGpio_0_fic_e);
+    IRQ_TRACE_EXIT(IRQ_TRACE_ID_FIC(kGpio_0_fic_e));
 }
 
 void handler_irq_fast_gpio_1(void)
 {
+    IRQ_TRACE_ENTER(IRQ_TRACE_ID_FIC(kGpio_1_fic_e));
     // The interrupt is cleared.
     clear_fast_interrupt(kGpio_1_fic_e);
-    // call the weak fic handler
-    fic_irq_gpio_1();
+    // call the registered or the weak fic handler
+    fic_irq_dispatch(kGpio_1_fic_e);
+    IRQ_TRACE_EXIT(IRQ_TRACE_ID_FIC(kGpio_1_fic_e));
 }
 
 void handler_irq_fast_gpio_2(void)
 {
+    IRQ_TRACE_ENTER(IRQ_TRACE_ID_FIC(kGpio_2_fic_e));
     // The interrupt is cleared.
     clear_fast_interrupt(kGpio_2_fic_e);
-    // call the weak fic handler
-    fic_irq_gpio_2();
+    // call the registered or the weak fic handler
+    fic_irq_dispatch(kGpio_2_fic_e);
+    IRQ_TRACE_EXIT(IRQ_TRACE_ID_FIC(kGpio_2_fic_e));
 }
 
 void handler_irq_fast_gpio_3(void)
 {
+    IRQ_TRACE_ENTER(IRQ_TRACE_ID_FIC(kGpio_3_fic_e));
     // The interrupt is cleared.
     clear_fast_interrupt(kGpio_3_fic_e);
-    // call the weak fic handler
-    fic_irq_gpio_3();
+    // call the registered or the weak fic handler
+    fic_irq_dispatch(kGpio_3_fic_e);
+    IRQ_TRACE_EXIT(IRQ_TRACE_ID_FIC(kGpio_3_fic_e));
 }
 
 void handler_irq_fast_gpio_4(void)
 {
+    IRQ_TRACE_ENTER(IRQ_TRACE_ID_FIC(kGpio_4_fic_e));
     // The interrupt is cleared.
     clear_fast_interrupt(kGpio_4_fic_e);
-    // call the weak fic handler
-    fic_irq_gpio_4();
+    // call the registered or the weak fic handler
+    fic_irq_dispatch(kGpio_4_fic_e);
+    IRQ_TRACE_EXIT(IRQ_TRACE_ID_FIC(kGpio_4_fic_e));
 }
 
 void handler_irq_fast_gpio_5(void)
 {
+    IRQ_TRACE_ENTER(IRQ_TRACE_ID_FIC(kGpio_5_fic_e));
     // The interrupt is cleared.
     clear_fast_interrupt(kGpio_5_fic_e);
-    // call the weak fic handler
-    fic_irq_gpio_5();
+    // call the registered or the weak fic handler
+    fic_irq_dispatch(kGpio_5_fic_e);
+    IRQ_TRACE_EXIT(IRQ_TRACE_ID_FIC(kGpio_5_fic_e));
 }
 
 void handler_irq_fast_gpio_6(void)
 {
+    IRQ_TRACE_ENTER(IRQ_TRACE_ID_FIC(kGpio_6_fic_e));
     // The interrupt is cleared.
     clear_fast_interrupt(kGpio_6_fic_e);
-    // call the weak fic handler
-    fic_irq_gpio_6();
+    // call the registered or the weak fic handler
+    fic_irq_dispatch(kGpio_6_fic_e);
+    IRQ_TRACE_EXIT(IRQ_TRACE_ID_FIC(kGpio_6_fic_e));
 }
 
 void handler_irq_fast_gpio_7(void)
 {
+    IRQ_TRACE_ENTER(IRQ_TRACE_ID_FIC(kGpio_7_fic_e));
     // The interrupt is cleared.
     clear_fast_interrupt(kGpio_7_fic_e);
-    // call the weak fic handler
-    fic_irq_gpio_7();
+    // call the registered or the weak fic handler
+    fic_irq_dispatch(kGpio_7_fic_e);
+    IRQ_TRACE_EXIT(IRQ_TRACE_ID_FIC(kGpio_7_fic_e));
 }
 #ifdef __cplusplus
 }
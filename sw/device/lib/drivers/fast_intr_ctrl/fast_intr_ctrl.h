@@ -85,12 +85,26 @@ typedef enum fast_intr_ctrl_fast_interrupt {
   kExt_peri_fic_e   = 15,  /*!< External peripheral interrupt*/
 } fast_intr_ctrl_fast_interrupt_t;
 
+/**
+ * Handler of a fast interrupt line registered at run time with
+ * fic_set_handler().
+ */
+typedef void (*fic_handler_t)(void);
+
 /****************************************************************************/
 /**                                                                        **/
 /**                          EXPORTED VARIABLES                            **/
 /**                                                                        **/
 /****************************************************************************/
 
+#ifdef IRQ_FAST_PATH
+/**
+ * Address of the FAST_INTR_CLEAR register, used by the fast-path interrupt
+ * entry in vectors.S to acknowledge fast interrupts.
+ */
+extern volatile uint32_t * const fic_irq_clear_reg;
+#endif
+
 /****************************************************************************/
 /**                                                                        **/
 /**                          EXPORTED FUNCTIONS                            **/
@@ -128,6 +142,26 @@ fast_intr_ctrl_result_t enable_all_fast_interrupts(bool enable);
 fast_intr_ctrl_result_t clear_fast_interrupt(fast_intr_ctrl_fast_interrupt_t\
  fast_interrupt);
 
+/**
+ * @brief Register a handler called for a fast interrupt line instead of its
+ * fic_irq_* function, so that a library can serve a line at run time without
+ * defining the fic_irq_* symbol of the application.
+ * @param fast_interrupt specify the line
+ * @param handler the handler, or NULL to call the fic_irq_* function again
+ * @retval kFastIntrCtrlOk_e (= 0) if successfully registered
+ * @retval kFastIntrCtrlError_e (= 1) if the line does not exist
+ */
+fast_intr_ctrl_result_t fic_set_handler(fast_intr_ctrl_fast_interrupt_t\
+ fast_interrupt, fic_handler_t handler);
+
+/**
+ * @brief Call the handler of a fast interrupt line: the one registered with
+ * fic_set_handler(), otherwise its fic_irq_* function. Called by the
+ * interrupt entry points once the line is cleared.
+ * @param fast_interrupt specify the line
+ */
+void fic_irq_dispatch(fast_intr_ctrl_fast_interrupt_t fast_interrupt);
+
 /**
  * @brief fast interrupt controller irq for timer 1
  * `fast_intr_ctrl.c` provides a weak definition of this symbol, which can
@@ -248,6 +282,14 @@ void fic_irq_gpio_6(void);
  */
 void fic_irq_gpio_7(void);
 
+/**
+ * @brief fast interrupt controller irq for the external peripheral
+ * `fast_intr_ctrl.c` provides a weak definition of this symbol, which can
+ * be overridden at link-time by providing an additional non-weak definition
+ * inside peripherals connected through FIC
+ */
+void fic_irq_ext_peripheral(void);
+
 
 /****************************************************************************/
 /**                                                                        **/
@@ -44,6 +44,7 @@ extern "C" {
 #include "bitfield.h"
 #include "rv_plic_regs.h"  // Generated.
 #include "handler.h"
+#include "irq_trace.h"
 
 // Peripheral modules from where to obtain the irq handlers
 #include "uart.h"
@@ -140,12 +141,25 @@ handler_funct_t handlers[QTY_INTR];
 
 void handler_irq_external(void)
 {
+  IRQ_TRACE_ENTER(IRQ_TRACE_ID_EXTERNAL);
   uint32_t int_id = NULL_INTR;
   plic_result_t res = plic_irq_claim(&int_id);
 
     // Calls the proper handler
+    IRQ_TRACE_ENTER(IRQ_TRACE_ID_PLIC(int_id));
     handlers[int_id](int_id);
+    IRQ_TRACE_EXIT(IRQ_TRACE_ID_PLIC(int_id));
     plic_irq_complete(&int_id);
+  IRQ_TRACE_EXIT(IRQ_TRACE_ID_EXTERNAL);
+}
+
+void plic_irq_fast_handler(uint32_t irq)
+{
+  uint32_t int_id = rv_plic_peri->CC0;
+  IRQ_TRACE_ENTER(IRQ_TRACE_ID_PLIC(int_id));
+  handlers[int_id](int_id);
+  IRQ_TRACE_EXIT(IRQ_TRACE_ID_PLIC(int_id));
+  rv_plic_peri->CC0 = int_id;
 }
 
 /*!
@@ -371,7 +385,7 @@ plic_result_t plic_software_irq_is_pending(void)
 
 plic_result_t plic_assign_external_irq_handler( uint32_t id, void *handler )                                             
 {
-  if( id >= EXT_IRQ_START && id <= QTY_INTR )
+  if( id >= EXT_IRQ_START && id < QTY_INTR )
   {
     handlers[ id ] = (handler_funct_t) handler;
     return kPlicOk;
@@ -380,6 +394,17 @@ plic_result_t plic_assign_external_irq_handler( uint32_t id, void *handler )
 }
 
 
+plic_result_t plic_assign_irq_handler_direct( uint32_t id, void *handler )
+{
+  if( id == NULL_INTR || id >= QTY_INTR || handler == NULL )
+  {
+    return kPlicBadArg;
+  }
+  handlers[ id ] = (handler_funct_t) handler;
+  return kPlicOk;
+}
+
+
 void plic_reset_handlers_list(void)
 {
   handlers[NULL_INTR] = &handler_irq_dummy;
@@ -174,6 +174,16 @@ typedef enum plic_irq_trigger {
 */
 void handler_irq_external(void);
 
+/**
+ * Fast-path version of handler_irq_external(), called from the fast-path
+ * interrupt entry when IRQ_FAST_PATH is defined (see handler.h).
+ * It claims the interrupt reading CC0 directly, calls the handler stored in
+ * the flat handlers table and completes the interrupt, without going through
+ * plic_irq_claim() and plic_irq_complete().
+ * @param irq The interrupt ID as seen by the core (unused).
+*/
+void plic_irq_fast_handler(uint32_t irq);
+
 /**
  * Initilises the PLIC peripheral's registers with default values.
  *
@@ -343,6 +353,20 @@ plic_result_t plic_software_irq_is_pending(void);
 plic_result_t plic_assign_external_irq_handler( uint32_t id,
                                                 void  *handler );
 
+/**
+ * Registers a handler for any PLIC source directly into the flat handlers
+ * table, replacing the handler of the peripheral driver (e.g.
+ * handler_irq_gpio()) for that source. This removes the second dispatch
+ * level of the driver, but the handler becomes responsible for clearing the
+ * interrupt status inside the peripheral.
+ * @param id The interrupt ID of the source (from core_v_mini_mcu.h)
+ * @param handler A pointer to a function that will be called upon interrupt.
+ * It receives the interrupt ID as argument.
+ * @return The result of the operation
+*/
+plic_result_t plic_assign_irq_handler_direct( uint32_t id,
+                                              void  *handler );
+
 /**
  * Resets all peripheral handlers to their pre-set ones. All external handlers
  * are re-set to the dummy handler.
@@ -18,6 +18,10 @@ uint32_t * heep_get_flash_address_offset(uint32_t* data_address_lma){
 
 }
 
+// mcycle when entering the crt0 and main, saved by the crt0
+uint32_t heep_boot_cycles_start;
+uint32_t heep_boot_cycles_main;
+
 //get random values
 uint32_t lfsr;
 
@@ -64,6 +64,7 @@ extern "C" {
 
 #define DMA_CH_NUM ${hex(dma.get_num_channels())[2:]}
 #define DMA_CH_SIZE 0x${hex(dma.get_ch_length())[2:]}
+#define DMA_INTR_SUMMARY_OFFSET 0x${hex(dma.get_ch_length() * dma.get_num_channels())[2:]}
 #define DMA_NUM_MASTER_PORTS ${hex(dma.get_num_master_ports())[2:]}
 #define DMA_ADDR_MODE ${dma.get_addr_mode()}
 #define DMA_SUBADDR_MODE ${dma.get_subaddr_mode()}
@@ -140,6 +141,15 @@ extern "C" {
 uint32_t * heep_get_flash_address_offset(uint32_t* data_address_lma);
 void heep_init_lfsr();
 uint32_t heep_rand_lfsr();
+
+// Boot time: mcycle when the crt0 starts and when it calls main. On the cores
+// that do not inhibit mcycle at reset (e.g. cv32e20) heep_boot_cycles_main is
+// the number of cycles from reset to main, bootrom and loading from the flash
+// included. The others only count if the application is built with
+// COMPILER_FLAGS=-DHEEP_BOOT_TIME, which lets the crt0 enable mcycle, and then
+// count from the start of the crt0.
+extern uint32_t heep_boot_cycles_start;
+extern uint32_t heep_boot_cycles_main;
 #endif // __ASSEMBLER__
 
 #ifdef __cplusplus
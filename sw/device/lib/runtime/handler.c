@@ -11,6 +11,47 @@ extern "C" {
 #include "stdasm.h"
 #include "syscalls.h"
 
+#ifdef IRQ_FAST_PATH
+#include "fast_intr_ctrl.h"
+#include "rv_plic.h"
+#include "irq_trace.h"
+
+/**
+ * Fast interrupt IDs in mcause.
+ */
+#define IRQ_FAST_ID_EXTERNAL  11
+#define IRQ_FAST_ID_FIC_START 16
+#define IRQ_FAST_ID_FIC_END   31
+
+void irq_fast_fic_default(uint32_t id) {
+  fic_irq_dispatch((fast_intr_ctrl_fast_interrupt_t)(id - IRQ_FAST_ID_FIC_START));
+}
+
+uint32_t irq_fast_set_handler(uint32_t id, irq_fast_handler_t handler) {
+  if (id == IRQ_FAST_ID_EXTERNAL) {
+    irq_fast_table[id] = handler ? handler : plic_irq_fast_handler;
+    return 0;
+  }
+  if (id >= IRQ_FAST_ID_FIC_START && id <= IRQ_FAST_ID_FIC_END) {
+    irq_fast_table[id] = handler ? handler : irq_fast_fic_default;
+    return 0;
+  }
+  return 1;
+}
+
+#ifdef IRQ_TRACE
+/**
+ * Called by the fast-path entry instead of the table lookup when tracing is
+ * enabled, so that every interrupt is traced with its mcause ID.
+ */
+void irq_fast_dispatch_traced(uint32_t id) {
+  IRQ_TRACE_ENTER(id);
+  irq_fast_table[id](id);
+  IRQ_TRACE_EXIT(id);
+}
+#endif  // IRQ_TRACE
+#endif  // IRQ_FAST_PATH
+
 /**
  * Default Error Handling
  * @param msg error message supplied by caller
@@ -5,6 +5,8 @@
 #ifndef OPENTITAN_SW_DEVICE_LIB_HANDLER_H_
 #define OPENTITAN_SW_DEVICE_LIB_HANDLER_H_
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif  // __cplusplus
@@ -38,6 +40,55 @@ typedef enum exc_id {
 // calling convention.
 #define INTERRUPT_HANDLER_ABI __attribute__((aligned(4), interrupt))
 
+// When `IRQ_FAST_PATH` is defined (e.g. COMPILER_FLAGS=-DIRQ_FAST_PATH), the
+// machine external interrupt (11) and the fast interrupts (16-31) no longer
+// jump to their INTERRUPT_HANDLER_ABI entry points. They go through a single
+// assembly entry in `vectors.S` that only saves the caller-saved integer
+// registers, acknowledges the FIC and calls the handler registered in
+// `irq_fast_table` with the interrupt ID as argument.
+//
+// By default the table points to `irq_fast_fic_default()`, which calls the
+// handler registered with `fic_set_handler()` or the `fic_irq_*` function of
+// the line in `fast_intr_ctrl.c`, and to
+// `plic_irq_fast_handler()` of `rv_plic.c`, so link-time overrides keep
+// working. Handlers are regular C functions. With an FPU (`__riscv_flen`),
+// the entry also saves the caller-saved floating-point registers and fcsr.
+#ifdef IRQ_FAST_PATH
+
+/**
+ * Number of entries of the fast-path jump table (one per mcause ID).
+ */
+#define IRQ_FAST_TABLE_SIZE 32
+
+/**
+ * Fast-path handler. Receives the interrupt ID (mcause) that triggered it.
+ */
+typedef void (*irq_fast_handler_t)(uint32_t);
+
+/**
+ * Flat jump table used by the fast-path entry. Defined in `vectors.S`.
+ */
+extern irq_fast_handler_t irq_fast_table[IRQ_FAST_TABLE_SIZE];
+
+/**
+ * Registers a handler in the fast-path jump table.
+ *
+ * @param id The interrupt ID (11 for external, 16-31 for fast interrupts).
+ * @param handler The function to be called, or NULL to restore the default.
+ * @return 0 if the handler was registered, 1 if the ID is not routed through
+ * the fast path.
+ */
+uint32_t irq_fast_set_handler(uint32_t id, irq_fast_handler_t handler);
+
+/**
+ * Default fast-path handler of the fast interrupts (16-31): calls the handler
+ * of the FIC line of the interrupt ID with `fic_irq_dispatch()`.
+ * @param id The interrupt ID.
+ */
+void irq_fast_fic_default(uint32_t id);
+
+#endif  // IRQ_FAST_PATH
+
 // The following `handler_*` functions have weak definitions, provided by
 // `handler.c`. This weak definition can be overriden at link-time by providing
 // an additional non-weak definition of each function. Executables and libraries
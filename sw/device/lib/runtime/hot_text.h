@@ -0,0 +1,33 @@
+// Copyright 2025 EPFL contributors
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+//
+// File: hot_text.h
+// Description: Functions executed from the RAM when the rest of the code is
+// executed from the flash.
+//
+// With the flash_exec linker script, the functions marked with HOT_TEXT (or
+// with __attribute__((hot))) are linked in the .hot_text section, stored in the
+// flash and copied to the RAM by the crt0 before main(). They keep running at
+// the speed of the RAM (e.g. the inner loops of DSP code, or the ISRs), while
+// the bulk of the code stays in the flash.
+//
+// Functions can also be relocated without changing their source: the linker
+// script includes hot_functions.ld, searched first in the folder of the
+// application, then in sw/linker (empty). util/profile/hot_functions.py
+// generates it from a profile of the application.
+//
+// With the other linker scripts all the code is in the RAM already and the
+// attribute has no effect.
+
+#ifndef HOT_TEXT_H_
+#define HOT_TEXT_H_
+
+/**
+ * Place a function in the .hot_text section, e.g.
+ *   HOT_TEXT void fft_butterfly(int32_t* x);
+ * A hot function that is inlined in a cold one runs from the flash.
+ */
+#define HOT_TEXT __attribute__((hot, section(".xheep_hot_text")))
+
+#endif  // HOT_TEXT_H_
@@ -0,0 +1,188 @@
+// Copyright 2025 EPFL contributors
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+//
+// File: irq_trace.c
+// Description: Lightweight interrupt latency and ISR duration tracing.
+
+#include "irq_trace.h"
+
+#ifdef IRQ_TRACE
+
+#include <stdio.h>
+
+#include "csr.h"
+#include "csr_registers.h"
+
+#if (IRQ_TRACE_BUF_LEN & (IRQ_TRACE_BUF_LEN - 1)) != 0
+#error "IRQ_TRACE_BUF_LEN must be a power of two"
+#endif
+
+/******************************/
+/* ---- GLOBAL VARIABLES ---- */
+/******************************/
+
+static irq_trace_event_t irq_trace_buf[IRQ_TRACE_BUF_LEN];
+static uint32_t irq_trace_head;   // total number of events recorded
+
+static irq_trace_stats_t irq_trace_stats[IRQ_TRACE_NUM_IDS];
+static uint32_t irq_trace_enter_cycle[IRQ_TRACE_NUM_IDS];
+static uint32_t irq_trace_mark_cycle[IRQ_TRACE_NUM_IDS];
+static uint8_t irq_trace_marked[IRQ_TRACE_NUM_IDS];
+
+/************************************/
+/* ---- FUNCTION IMPLEMENTATIONS ---- */
+/************************************/
+
+static inline uint32_t irq_trace_cycle(void)
+{
+    uint32_t cycle;
+    CSR_READ(CSR_REG_MCYCLE, &cycle);
+    return cycle;
+}
+
+// Disable interrupts while the trace is accessed from thread context and
+// return the previous mstatus value.
+static inline uint32_t irq_trace_lock(void)
+{
+    uint32_t mstatus;
+    CSR_READ(CSR_REG_MSTATUS, &mstatus);
+    CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+    return mstatus;
+}
+
+static inline void irq_trace_unlock(uint32_t mstatus)
+{
+    if (mstatus & 0x8) CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+}
+
+static inline void irq_trace_push(uint32_t cycle, uint32_t id, irq_trace_event_type_t type)
+{
+    irq_trace_event_t *ev = &irq_trace_buf[irq_trace_head & (IRQ_TRACE_BUF_LEN - 1)];
+    ev->cycle = cycle;
+    ev->id = (uint16_t)id;
+    ev->type = (uint16_t)type;
+    irq_trace_head++;
+}
+
+void irq_trace_init(void)
+{
+    uint32_t mstatus = irq_trace_lock();
+    irq_trace_head = 0;
+    for (uint32_t i = 0; i < IRQ_TRACE_NUM_IDS; i++)
+    {
+        irq_trace_stats[i] = (irq_trace_stats_t){0};
+        irq_trace_stats[i].dur_min = UINT32_MAX;
+        irq_trace_stats[i].lat_min = UINT32_MAX;
+        irq_trace_marked[i] = 0;
+    }
+    // Enable mcycle
+    CSR_CLEAR_BITS(CSR_REG_MCOUNTINHIBIT, 0x1);
+    irq_trace_unlock(mstatus);
+}
+
+void irq_trace_enter(uint32_t id)
+{
+    uint32_t now = irq_trace_cycle();
+    if (id >= IRQ_TRACE_NUM_IDS) return;
+
+    irq_trace_push(now, id, kIrqTraceEnter_e);
+    irq_trace_enter_cycle[id] = now;
+
+    if (irq_trace_marked[id])
+    {
+        irq_trace_stats_t *s = &irq_trace_stats[id];
+        uint32_t lat = now - irq_trace_mark_cycle[id];
+        irq_trace_marked[id] = 0;
+        s->lat_count++;
+        s->lat_sum += lat;
+        if (lat < s->lat_min) s->lat_min = lat;
+        if (lat > s->lat_max) s->lat_max = lat;
+    }
+}
+
+void irq_trace_exit(uint32_t id)
+{
+    uint32_t now = irq_trace_cycle();
+    if (id >= IRQ_TRACE_NUM_IDS) return;
+
+    irq_trace_push(now, id, kIrqTraceExit_e);
+
+    irq_trace_stats_t *s = &irq_trace_stats[id];
+    uint32_t dur = now - irq_trace_enter_cycle[id];
+    s->count++;
+    s->dur_sum += dur;
+    if (dur < s->dur_min) s->dur_min = dur;
+    if (dur > s->dur_max) s->dur_max = dur;
+}
+
+void irq_trace_mark(uint32_t id)
+{
+    if (id >= IRQ_TRACE_NUM_IDS) return;
+
+    // The mark is recorded from thread context: keep ISRs out while the ring
+    // buffer is updated.
+    uint32_t mstatus = irq_trace_lock();
+    uint32_t now = irq_trace_cycle();
+    irq_trace_push(now, id, kIrqTraceMark_e);
+    irq_trace_mark_cycle[id] = now;
+    irq_trace_marked[id] = 1;
+    irq_trace_unlock(mstatus);
+}
+
+uint32_t irq_trace_get_stats(uint32_t id, irq_trace_stats_t *stats)
+{
+    if (id >= IRQ_TRACE_NUM_IDS) return 1;
+
+    uint32_t mstatus = irq_trace_lock();
+    *stats = irq_trace_stats[id];
+    irq_trace_unlock(mstatus);
+    return 0;
+}
+
+uint32_t irq_trace_read(irq_trace_event_t *events, uint32_t max_events)
+{
+    uint32_t mstatus = irq_trace_lock();
+    uint32_t head = irq_trace_head;
+    uint32_t n = head < IRQ_TRACE_BUF_LEN ? head : IRQ_TRACE_BUF_LEN;
+    if (n > max_events) n = max_events;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        events[i] = irq_trace_buf[(head - n + i) & (IRQ_TRACE_BUF_LEN - 1)];
+    }
+    irq_trace_unlock(mstatus);
+    return n;
+}
+
+void irq_trace_dump(void)
+{
+    irq_trace_event_t ev;
+    irq_trace_stats_t s;
+    uint32_t head = irq_trace_head;
+    uint32_t n = head < IRQ_TRACE_BUF_LEN ? head : IRQ_TRACE_BUF_LEN;
+
+    printf("IRQTRACE_BEGIN,%u,%u\n", (unsigned)n, (unsigned)(head - n));
+    for (uint32_t i = 0; i < n; i++)
+    {
+        ev = irq_trace_buf[(head - n + i) & (IRQ_TRACE_BUF_LEN - 1)];
+        printf("IRQTRACE,%u,%u,%u\n", (unsigned)ev.cycle, ev.id, ev.type);
+    }
+
+    for (uint32_t id = 0; id < IRQ_TRACE_NUM_IDS; id++)
+    {
+        irq_trace_get_stats(id, &s);
+        if (s.count == 0 && s.lat_count == 0) continue;
+        printf("IRQSTAT,%u,%u,%u,%u,%u,%u,%u,%u,%u\n", (unsigned)id,
+               (unsigned)s.count,
+               (unsigned)(s.count ? s.dur_min : 0),
+               (unsigned)(s.count ? s.dur_sum / s.count : 0),
+               (unsigned)s.dur_max,
+               (unsigned)s.lat_count,
+               (unsigned)(s.lat_count ? s.lat_min : 0),
+               (unsigned)(s.lat_count ? s.lat_sum / s.lat_count : 0),
+               (unsigned)s.lat_max);
+    }
+    printf("IRQTRACE_END\n");
+}
+
+#endif  // IRQ_TRACE
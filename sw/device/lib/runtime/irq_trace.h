@@ -0,0 +1,167 @@
+// Copyright 2025 EPFL contributors
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+//
+// File: irq_trace.h
+// Description: Lightweight interrupt latency and ISR duration tracing.
+//
+// The tracing layer is compiled in only when `IRQ_TRACE` is defined (e.g.
+// COMPILER_FLAGS=-DIRQ_TRACE). Otherwise all the IRQ_TRACE_* macros expand
+// to nothing and no memory is reserved.
+//
+// Every traced ISR stores an entry and an exit event, timestamped with
+// `mcycle`, in a ring buffer of IRQ_TRACE_BUF_LEN entries. For each trace ID
+// the number of calls and the min/avg/max duration are kept. If the code that
+// triggers an interrupt calls irq_trace_mark() just before, the time between
+// the mark and the ISR entry is accounted as latency as well.
+//
+// Trace IDs 0-31 are the mcause interrupt IDs (7: machine timer,
+// 11: machine external, 16-31: fast interrupts), while PLIC sources are
+// traced as IRQ_TRACE_ID_PLIC(source). The machine timer handler is defined by
+// the applications, which have to wrap it with IRQ_TRACE_ENTER/EXIT themselves.
+//
+// The ring buffer and the statistics are printed with irq_trace_dump(), whose
+// output can be turned into a timeline with util/profile/irq_trace_timeline.py.
+
+#ifndef IRQ_TRACE_H_
+#define IRQ_TRACE_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+/**
+ * Trace ID of the machine timer interrupt.
+ */
+#define IRQ_TRACE_ID_TIMER      7
+
+/**
+ * Trace ID of the machine external interrupt (PLIC claim/complete included).
+ */
+#define IRQ_TRACE_ID_EXTERNAL   11
+
+/**
+ * Trace ID of the fast interrupt line `fic` (see fast_intr_ctrl_fast_interrupt_t).
+ */
+#define IRQ_TRACE_ID_FIC(fic)   (16 + (fic))
+
+/**
+ * Trace ID of the PLIC source `src`.
+ */
+#define IRQ_TRACE_ID_PLIC(src)  (32 + (src))
+
+#ifdef IRQ_TRACE
+
+#include "core_v_mini_mcu.h"
+
+/**
+ * Number of events of the ring buffer. Must be a power of two.
+ */
+#ifndef IRQ_TRACE_BUF_LEN
+#define IRQ_TRACE_BUF_LEN 128
+#endif
+
+/**
+ * Number of trace IDs for which statistics are kept.
+ */
+#define IRQ_TRACE_NUM_IDS (32 + QTY_INTR)
+
+/**
+ * Type of a trace event.
+ */
+typedef enum
+{
+  kIrqTraceEnter_e = 0,  // ISR entry
+  kIrqTraceExit_e  = 1,  // ISR exit
+  kIrqTraceMark_e  = 2,  // Interrupt expected (see irq_trace_mark())
+} irq_trace_event_type_t;
+
+/**
+ * A ring buffer entry.
+ */
+typedef struct
+{
+  uint32_t cycle;  // mcycle value when the event was recorded
+  uint16_t id;     // trace ID
+  uint16_t type;   // irq_trace_event_type_t
+} irq_trace_event_t;
+
+/**
+ * Statistics of a trace ID. All values are in clock cycles.
+ */
+typedef struct
+{
+  uint32_t count;         // number of completed ISR calls
+  uint32_t dur_min;       // shortest ISR
+  uint32_t dur_max;       // longest ISR
+  uint64_t dur_sum;       // sum of all ISR durations
+  uint32_t lat_count;     // number of entries preceded by irq_trace_mark()
+  uint32_t lat_min;       // lowest mark-to-entry latency
+  uint32_t lat_max;       // highest mark-to-entry latency
+  uint64_t lat_sum;       // sum of all mark-to-entry latencies
+} irq_trace_stats_t;
+
+/**
+ * Clear the ring buffer and the statistics and make sure mcycle is counting.
+ */
+void irq_trace_init(void);
+
+/**
+ * Record the entry of the ISR of `id`. Called from the interrupt handlers.
+ */
+void irq_trace_enter(uint32_t id);
+
+/**
+ * Record the exit of the ISR of `id`. Called from the interrupt handlers.
+ */
+void irq_trace_exit(uint32_t id);
+
+/**
+ * Record that the interrupt `id` is about to be triggered, so that the next
+ * entry of its ISR is accounted for latency.
+ * @param id trace ID of the expected interrupt.
+ */
+void irq_trace_mark(uint32_t id);
+
+/**
+ * Get the statistics of a trace ID.
+ * @param id trace ID.
+ * @param stats where the statistics are copied.
+ * @return 0 on success, 1 if `id` is out of range.
+ */
+uint32_t irq_trace_get_stats(uint32_t id, irq_trace_stats_t *stats);
+
+/**
+ * Copy the ring buffer content, oldest event first.
+ * @param events destination buffer.
+ * @param max_events size of `events`.
+ * @return number of events copied.
+ */
+uint32_t irq_trace_read(irq_trace_event_t *events, uint32_t max_events);
+
+/**
+ * Print the ring buffer (`IRQTRACE,<cycle>,<id>,<type>` lines) followed by
+ * the statistics of every ID that was hit (`IRQSTAT,<id>,<count>,<min>,<avg>,
+ * <max>,<lat_count>,<lat_min>,<lat_avg>,<lat_max>` lines).
+ */
+void irq_trace_dump(void);
+
+#define IRQ_TRACE_ENTER(id) irq_trace_enter(id)
+#define IRQ_TRACE_EXIT(id)  irq_trace_exit(id)
+#define IRQ_TRACE_MARK(id)  irq_trace_mark(id)
+
+#else
+
+#define IRQ_TRACE_ENTER(id)
+#define IRQ_TRACE_EXIT(id)
+#define IRQ_TRACE_MARK(id)
+
+#endif  // IRQ_TRACE
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // IRQ_TRACE_H_
@@ -58,6 +58,7 @@ extern "C"
     void dma_copy(uint32_t dst_ptr, uint32_t src_ptr, uint32_t size, uint8_t channel, dma_data_type_t src_type, dma_data_type_t dst_type, uint8_t signed_data)
     {
         volatile dma *the_dma = dma_peri(channel);
+        dma_shadow_invalidate(channel);
         DMA_COPY(dst_ptr, src_ptr, size, src_type, dst_type, signed_data, the_dma);
         dma_start(the_dma, size, src_type);
         DMA_WAIT(channel);
@@ -68,6 +69,7 @@ extern "C"
     void dma_copy_to_addr(uint32_t addr_ptr, uint32_t src_ptr, uint32_t size, uint8_t channel)
     {
         volatile dma *the_dma = dma_peri(channel);
+        dma_shadow_invalidate(channel);
         DMA_COPY_ADDR(addr_ptr, src_ptr, size, the_dma);
         dma_start(the_dma, size, DMA_DATA_TYPE_WORD);
         DMA_WAIT(channel);
@@ -78,6 +80,7 @@ extern "C"
     void dma_fill(uint32_t dst_ptr, uint32_t value_ptr, uint32_t size, uint8_t channel, dma_data_type_t src_type, dma_data_type_t dst_type, uint8_t signed_data)
     {
         volatile dma *the_dma = dma_peri(channel);
+        dma_shadow_invalidate(channel);
         DMA_FILL(dst_ptr, value_ptr, size, src_type, dst_type, signed_data, the_dma);
         dma_start(the_dma, size, src_type);
         DMA_WAIT(channel);
@@ -87,6 +90,7 @@ extern "C"
     void __attribute__ ((noinline)) dma_copy_async(uint32_t dst_ptr, uint32_t src_ptr, uint32_t size, uint8_t channel, dma_data_type_t src_type, dma_data_type_t dst_type, uint8_t signed_data)
     {
         volatile dma *the_dma = dma_peri(channel);
+        dma_shadow_invalidate(channel);
         DMA_COPY(dst_ptr, src_ptr, size, src_type, dst_type, signed_data, the_dma);
         dma_start(the_dma, size, src_type);
         return;
@@ -95,6 +99,7 @@ extern "C"
     void __attribute__ ((noinline)) dma_fill_async(uint32_t dst_ptr, uint32_t value_ptr, uint32_t size, uint8_t channel, dma_data_type_t src_type, dma_data_type_t dst_type, uint8_t signed_data)
     {
         volatile dma *the_dma = dma_peri(channel);
+        dma_shadow_invalidate(channel);
         DMA_FILL(dst_ptr, value_ptr, size, src_type, dst_type, signed_data, the_dma);
         dma_start(the_dma, size, src_type);
         return;
@@ -106,6 +111,841 @@ extern "C"
         return;
     }
 
+    /* ---- Streams ---- */
+
+    static inline uint32_t stream_cycles(void)
+    {
+        uint32_t cycles;
+        CSR_READ(CSR_REG_MCYCLE, &cycles);
+        return cycles;
+    }
+
+    static uint8_t *stream_tile_ptr(const dma_stream_tensor_t *tensor, uint32_t tile)
+    {
+        uint32_t tiles_per_row = tensor->row_du / tensor->tile_d1_du;
+        uint32_t row = (tile / tiles_per_row) * tensor->tile_d2_du;
+        uint32_t col = (tile % tiles_per_row) * tensor->tile_d1_du;
+        return tensor->ptr + (row * tensor->row_du + col) * DMA_DATA_TYPE_2_SIZE(tensor->type);
+    }
+
+    static void stream_in_done(dma_trans_t *p_trans, void *p_arg)
+    {
+        ((dma_stream_t *)p_arg)->loaded++;
+    }
+
+    static void stream_out_done(dma_trans_t *p_trans, void *p_arg)
+    {
+        ((dma_stream_t *)p_arg)->stored++;
+    }
+
+    // Wait in wfi until *count reaches target, return the cycles waited
+    static uint32_t stream_wait(volatile uint32_t *count, uint32_t target)
+    {
+        uint32_t start = stream_cycles();
+        while (*count < target)
+        {
+            CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+            if (*count < target)
+            {
+                wait_for_interrupt();
+            }
+            CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+        }
+        return stream_cycles() - start;
+    }
+
+    static dma_config_flags_t stream_push(dma_stream_t *stream, dma_trans_t *trans, dma_queue_cb_t cb)
+    {
+        dma_config_flags_t res;
+        while ((res = dma_queue_push(trans, cb, stream)) == DMA_CONFIG_QUEUE_FULL)
+        {
+            CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+            if (dma_queue_pending(trans->channel) == DMA_QUEUE_LEN)
+            {
+                wait_for_interrupt();
+            }
+            CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+        }
+        return res;
+    }
+
+    // Read tile into the input buffer b
+    static dma_config_flags_t stream_read(dma_stream_t *stream, uint32_t tile, uint8_t b)
+    {
+        stream->in_src[b].ptr = stream_tile_ptr(&stream->src, tile);
+        return stream_push(stream, &stream->in_trans[b], stream_in_done);
+    }
+
+    // Write the output buffer b back into tile
+    static dma_config_flags_t stream_write(dma_stream_t *stream, uint32_t tile, uint8_t b)
+    {
+        stream->out_dst[b].ptr = stream_tile_ptr(&stream->dst, tile);
+        return stream_push(stream, &stream->out_trans[b], stream_out_done);
+    }
+
+    dma_config_flags_t dma_stream_init(dma_stream_t *stream)
+    {
+        dma_config_flags_t res;
+
+        if (stream->n_bufs < 2 || stream->n_bufs > DMA_STREAM_MAX_BUFS ||
+            stream->in_channel >= DMA_CH_NUM || stream->out_channel >= DMA_CH_NUM)
+        {
+            return DMA_CONFIG_CRITICAL_ERROR;
+        }
+
+        /*
+         * Tile origins are multiples of the element size away from the first
+         * one, so a transaction validated on the first tile is valid for all
+         * of them.
+         */
+        for (uint8_t b = 0; b < stream->n_bufs; b++)
+        {
+            stream->in_src[b] = (dma_target_t){
+                .ptr = stream_tile_ptr(&stream->src, 0),
+                .inc_d1_du = 1,
+                .inc_d2_du = stream->src.row_du - stream->src.tile_d1_du + 1,
+                .type = stream->src.type,
+                .trig = DMA_TRIG_MEMORY,
+            };
+            stream->in_dst[b] = (dma_target_t){
+                .ptr = stream->in_buf[b],
+                .inc_d1_du = 1,
+                .inc_d2_du = 1,
+                .type = stream->src.type,
+                .trig = DMA_TRIG_MEMORY,
+            };
+            stream->in_trans[b] = (dma_trans_t){
+                .src = &stream->in_src[b],
+                .dst = &stream->in_dst[b],
+                .size_d1_du = stream->src.tile_d1_du,
+                .size_d2_du = stream->src.tile_d2_du,
+                .dim = DMA_DIM_CONF_2D,
+                .src_type = stream->src.type,
+                .dst_type = stream->src.type,
+                .mode = DMA_TRANS_MODE_SINGLE,
+                .end = DMA_TRANS_END_INTR,
+                .channel = stream->in_channel,
+            };
+            res = dma_validate_transaction(&stream->in_trans[b], DMA_ENABLE_REALIGN, DMA_PERFORM_CHECKS_INTEGRITY);
+            if (res & DMA_CONFIG_CRITICAL_ERROR)
+            {
+                return res;
+            }
+
+            if (stream->dst.ptr == NULL)
+            {
+                continue;
+            }
+
+            stream->out_src[b] = (dma_target_t){
+                .ptr = stream->out_buf[b],
+                .inc_d1_du = 1,
+                .inc_d2_du = 1,
+                .type = stream->dst.type,
+                .trig = DMA_TRIG_MEMORY,
+            };
+            stream->out_dst[b] = (dma_target_t){
+                .ptr = stream_tile_ptr(&stream->dst, 0),
+                .inc_d1_du = 1,
+                .inc_d2_du = stream->dst.row_du - stream->dst.tile_d1_du + 1,
+                .type = stream->dst.type,
+                .trig = DMA_TRIG_MEMORY,
+            };
+            stream->out_trans[b] = (dma_trans_t){
+                .src = &stream->out_src[b],
+                .dst = &stream->out_dst[b],
+                .size_d1_du = stream->dst.tile_d1_du,
+                .size_d2_du = stream->dst.tile_d2_du,
+                .dim = DMA_DIM_CONF_2D,
+                .src_type = stream->dst.type,
+                .dst_type = stream->dst.type,
+                .mode = DMA_TRANS_MODE_SINGLE,
+                .end = DMA_TRANS_END_INTR,
+                .channel = stream->out_channel,
+            };
+            res = dma_validate_transaction(&stream->out_trans[b], DMA_ENABLE_REALIGN, DMA_PERFORM_CHECKS_INTEGRITY);
+            if (res & DMA_CONFIG_CRITICAL_ERROR)
+            {
+                return res;
+            }
+        }
+
+        dma_stream_reset_stats(stream);
+
+        /* The stages are timed with mcycle */
+        CSR_CLEAR_BITS(CSR_REG_MCOUNTINHIBIT, 0x1);
+
+        return DMA_CONFIG_OK;
+    }
+
+    dma_config_flags_t dma_stream_run(dma_stream_t *stream, uint32_t n_tiles)
+    {
+        dma_config_flags_t res = DMA_CONFIG_OK;
+        uint8_t n_bufs = stream->n_bufs;
+        uint8_t write_back = stream->dst.ptr != NULL;
+        uint32_t start = stream_cycles();
+        uint32_t t0;
+
+        stream->loaded = 0;
+        stream->stored = 0;
+
+        /* Fill all the input buffers */
+        for (uint32_t t = 0; t < n_tiles && t < n_bufs; t++)
+        {
+            res |= stream_read(stream, t, t);
+        }
+
+        for (uint32_t t = 0; t < n_tiles && res == DMA_CONFIG_OK; t++)
+        {
+            uint8_t b = t % n_bufs;
+
+            stream->stats.in_stall_cycles += stream_wait(&stream->loaded, t + 1);
+
+            /* The output buffer was last used by tile t - n_bufs */
+            if (write_back && t >= n_bufs)
+            {
+                stream->stats.out_stall_cycles += stream_wait(&stream->stored, t - n_bufs + 1);
+            }
+
+            t0 = stream_cycles();
+            stream->compute(stream->in_buf[b], write_back ? stream->out_buf[b] : NULL, t, stream->arg);
+            stream->stats.compute_cycles += stream_cycles() - t0;
+            stream->stats.tiles++;
+
+            if (write_back)
+            {
+                res |= stream_write(stream, t, b);
+            }
+
+            /* The input buffer is free again */
+            if (t + n_bufs < n_tiles)
+            {
+                res |= stream_read(stream, t + n_bufs, b);
+            }
+        }
+
+        /* On error, let the transactions already queued finish */
+        dma_queue_wait(stream->in_channel);
+        if (write_back)
+        {
+            t0 = stream_cycles();
+            dma_queue_wait(stream->out_channel);
+            stream->stats.out_stall_cycles += stream_cycles() - t0;
+        }
+
+        stream->stats.total_cycles += stream_cycles() - start;
+        return res;
+    }
+
+    void dma_stream_reset_stats(dma_stream_t *stream)
+    {
+        stream->stats = (dma_stream_stats_t){0};
+    }
+
+    static uint8_t *ring_window_ptr(const dma_ring_t *ring, uint32_t window)
+    {
+        uint32_t slot = window % ring->n_windows;
+        return ring->buf + slot * ring->win_du * DMA_DATA_TYPE_2_SIZE(ring->type);
+    }
+
+    // Window done interrupt of the channel of a ring
+    static void ring_window_done(uint8_t channel, void *p_arg)
+    {
+        dma_ring_t *ring = (dma_ring_t *)p_arg;
+        uint32_t fill;
+
+        /*
+         * One window per interrupt: the WINDOW_COUNT register counts the
+         * data units of the current window, not the windows, so the
+         * interrupts merged because the CPU was late cannot be told apart.
+         */
+        ring->produced++;
+        ring->stats.windows++;
+
+        fill = ring->produced - ring->consumed;
+        if (fill > ring->stats.max_fill)
+        {
+            ring->stats.max_fill = fill;
+        }
+
+        if (ring->cb != NULL)
+        {
+            uint32_t window = ring->produced - 1;
+            ring->cb(ring_window_ptr(ring, window), window, ring->arg);
+        }
+    }
+
+    dma_config_flags_t dma_ring_init(dma_ring_t *ring)
+    {
+        dma_config_flags_t res;
+        uint32_t size_du = (uint32_t)ring->n_windows * ring->win_du;
+
+        if (ring->n_windows < 2 || ring->win_du == 0 || ring->channel >= DMA_CH_NUM ||
+            ring->win_du > DMA_WINDOW_SIZE_WINDOW_SIZE_MASK || size_du > DMA_SIZE_D1_SIZE_MASK)
+        {
+            return DMA_CONFIG_CRITICAL_ERROR;
+        }
+
+        ring->tgt_src = (dma_target_t){
+            .ptr = ring->src,
+            .inc_d1_du = 0,
+            .type = ring->type,
+            .trig = ring->trig,
+        };
+        ring->tgt_dst = (dma_target_t){
+            .ptr = ring->buf,
+            .inc_d1_du = 1,
+            .type = ring->type,
+            .trig = DMA_TRIG_MEMORY,
+        };
+        ring->trans = (dma_trans_t){
+            .src = &ring->tgt_src,
+            .dst = &ring->tgt_dst,
+            .size_d1_du = size_du,
+            .dim = DMA_DIM_CONF_1D,
+            .src_type = ring->type,
+            .dst_type = ring->type,
+            .mode = DMA_TRANS_MODE_CIRCULAR,
+            .win_du = ring->win_du,
+            .end = DMA_TRANS_END_INTR,
+            .channel = ring->channel,
+        };
+        res = dma_validate_transaction(&ring->trans, DMA_ENABLE_REALIGN, DMA_PERFORM_CHECKS_INTEGRITY);
+        if (res & DMA_CONFIG_CRITICAL_ERROR)
+        {
+            return res;
+        }
+
+        dma_ring_reset_stats(ring);
+        return DMA_CONFIG_OK;
+    }
+
+    dma_config_flags_t dma_ring_start(dma_ring_t *ring)
+    {
+        dma_config_flags_t res;
+
+        ring->produced = 0;
+        ring->consumed = 0;
+        ring->held = 0;
+
+        res = dma_load_transaction(&ring->trans);
+        if (res != DMA_CONFIG_OK)
+        {
+            return res;
+        }
+
+        dma_set_window_callback(ring->channel, ring_window_done, ring);
+
+        return dma_launch(&ring->trans);
+    }
+
+    void dma_ring_stop(dma_ring_t *ring)
+    {
+        dma_stop_circular(ring->channel);
+        DMA_WAIT(ring->channel);
+        dma_set_window_callback(ring->channel, NULL, NULL);
+    }
+
+    const void *dma_ring_acquire(dma_ring_t *ring, uint8_t wait)
+    {
+        uint32_t lag;
+
+        while (wait && ring->produced == ring->consumed)
+        {
+            CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+            if (ring->produced == ring->consumed)
+            {
+                wait_for_interrupt();
+            }
+            CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+        }
+
+        lag = ring->produced - ring->consumed;
+        if (lag == 0)
+        {
+            return NULL;
+        }
+
+        /*
+         * The DMA is filling the slot of window produced - n_windows: that
+         * window and the older ones are lost.
+         */
+        if (!ring->held)
+        {
+            if (lag >= ring->n_windows)
+            {
+                ring->stats.overruns += lag - ring->n_windows + 1;
+                ring->consumed += lag - ring->n_windows + 1;
+            }
+            ring->held = 1;
+        }
+        return ring_window_ptr(ring, ring->consumed);
+    }
+
+    dma_config_flags_t dma_ring_release(dma_ring_t *ring)
+    {
+        dma_config_flags_t res = DMA_CONFIG_OK;
+
+        if (!ring->held)
+        {
+            return DMA_CONFIG_OK;
+        }
+
+        if (ring->produced - ring->consumed >= ring->n_windows)
+        {
+            ring->stats.overruns++;
+            res = DMA_CONFIG_OVERRUN;
+        }
+        ring->consumed++;
+        ring->held = 0;
+        ring->stats.released++;
+        return res;
+    }
+
+    uint32_t dma_ring_pending(dma_ring_t *ring)
+    {
+        uint32_t lag = ring->produced - ring->consumed;
+
+        /* At most n_windows - 1 windows are intact */
+        return lag < ring->n_windows ? lag : ring->n_windows - 1;
+    }
+
+    void dma_ring_reset_stats(dma_ring_t *ring)
+    {
+        ring->stats = (dma_ring_stats_t){0};
+    }
+
+    // Queue a leg of size_du elements whose memory side starts at ptr
+    static dma_config_flags_t pipe_push(dma_pipe_t *pipe, dma_trans_t *trans, dma_target_t *mem,
+                                        uint8_t *ptr, uint32_t size_du, dma_perf_checks_t checks)
+    {
+        dma_config_flags_t res;
+        uint8_t channel = trans->channel;
+
+        /* The transaction of this entry may still be in the queue */
+        while (dma_queue_pending(channel) == DMA_QUEUE_LEN)
+        {
+            CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+            if (dma_queue_pending(channel) == DMA_QUEUE_LEN)
+            {
+                wait_for_interrupt();
+            }
+            CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+        }
+
+        mem->ptr = ptr;
+        trans->size_d1_du = size_du;
+        res = dma_validate_transaction(trans, DMA_DO_NOT_ENABLE_REALIGN, checks);
+        if (res & DMA_CONFIG_CRITICAL_ERROR)
+        {
+            return res;
+        }
+
+        res = dma_queue_push(trans, NULL, NULL);
+        if (res == DMA_CONFIG_OK)
+        {
+            pipe->stats.transactions++;
+        }
+        return res;
+    }
+
+    dma_config_flags_t dma_pipe_init(dma_pipe_t *pipe)
+    {
+        if (pipe->tx_channel >= DMA_CH_NUM || pipe->rx_channel >= DMA_CH_NUM)
+        {
+            return DMA_CONFIG_CRITICAL_ERROR;
+        }
+
+        if (pipe->kind == DMA_PIPE_HW_FIFO)
+        {
+#if !DMA_HW_FIFO_MODE
+            return DMA_CONFIG_CRITICAL_ERROR;
+#endif
+        }
+        else if (pipe->kind == DMA_PIPE_BUS_FIFO)
+        {
+            /* On a single channel, a chunk holds at least one block */
+            if (pipe->in_block_du == 0 || pipe->out_block_du == 0 ||
+                (pipe->tx_channel == pipe->rx_channel && pipe->fifo_depth_du < pipe->in_block_du))
+            {
+                return DMA_CONFIG_CRITICAL_ERROR;
+            }
+        }
+        else
+        {
+            return DMA_CONFIG_CRITICAL_ERROR;
+        }
+
+        pipe->fifo_in_tgt = (dma_target_t){
+            .ptr = pipe->fifo_in,
+            .inc_d1_du = 0,
+            .type = pipe->in_type,
+            .trig = DMA_TRIG_SLOT_EXT_TX,
+        };
+        pipe->fifo_out_tgt = (dma_target_t){
+            .ptr = pipe->fifo_out,
+            .inc_d1_du = 0,
+            .type = pipe->out_type,
+            .trig = DMA_TRIG_SLOT_EXT_RX,
+        };
+
+        for (uint32_t i = 0; i < DMA_QUEUE_LEN; i++)
+        {
+            pipe->in_tgt[i] = (dma_target_t){
+                .inc_d1_du = 1,
+                .type = pipe->in_type,
+                .trig = DMA_TRIG_MEMORY,
+            };
+            pipe->out_tgt[i] = (dma_target_t){
+                .inc_d1_du = 1,
+                .type = pipe->out_type,
+                .trig = DMA_TRIG_MEMORY,
+            };
+            pipe->tx_trans[i] = (dma_trans_t){
+                .src = &pipe->in_tgt[i],
+                .dst = &pipe->fifo_in_tgt,
+                .dim = DMA_DIM_CONF_1D,
+                .src_type = pipe->in_type,
+                .dst_type = pipe->in_type,
+                .mode = DMA_TRANS_MODE_SINGLE,
+                .end = DMA_TRANS_END_INTR,
+                .channel = pipe->tx_channel,
+            };
+            pipe->rx_trans[i] = (dma_trans_t){
+                .src = &pipe->fifo_out_tgt,
+                .dst = &pipe->out_tgt[i],
+                .dim = DMA_DIM_CONF_1D,
+                .src_type = pipe->out_type,
+                .dst_type = pipe->out_type,
+                .mode = DMA_TRANS_MODE_SINGLE,
+                .end = DMA_TRANS_END_INTR,
+                .channel = pipe->rx_channel,
+            };
+
+#if DMA_HW_FIFO_MODE
+            /* Both legs in a single transaction, through the accelerator */
+            if (pipe->kind == DMA_PIPE_HW_FIFO)
+            {
+                pipe->tx_trans[i].dst = &pipe->out_tgt[i];
+                pipe->tx_trans[i].dst_type = pipe->out_type;
+                pipe->tx_trans[i].hw_fifo_en = 1;
+            }
+#endif
+        }
+
+        pipe->tx_next = 0;
+        pipe->rx_next = 0;
+        dma_pipe_reset_stats(pipe);
+
+        /* Queued transactions are launched by the interrupt handler */
+        CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+        CSR_CLEAR_BITS(CSR_REG_MCOUNTINHIBIT, 0x1);
+
+        return DMA_CONFIG_OK;
+    }
+
+    dma_config_flags_t dma_pipe_run(dma_pipe_t *pipe, const void *p_in, uint32_t in_du,
+                                    void *p_out, uint32_t out_du)
+    {
+        uint8_t *in = (uint8_t *)p_in;
+        uint8_t *out = (uint8_t *)p_out;
+        uint32_t in_size = DMA_DATA_TYPE_2_SIZE(pipe->in_type);
+        uint32_t out_size = DMA_DATA_TYPE_2_SIZE(pipe->out_type);
+        dma_perf_checks_t checks = DMA_PERFORM_CHECKS_INTEGRITY;
+        dma_config_flags_t res = DMA_CONFIG_OK;
+        uint32_t start = stream_cycles();
+        uint32_t blocks, chunk_blocks;
+        uint32_t i;
+
+        if (pipe->kind == DMA_PIPE_HW_FIFO)
+        {
+            /* The RX leg writes up to as many outputs as there are inputs */
+            if (in_du == 0 || in_du > DMA_SIZE_D1_SIZE_MASK || out_du < in_du)
+            {
+                return DMA_CONFIG_CRITICAL_ERROR;
+            }
+
+            /* The queue is empty between runs: the entry is free */
+            i = pipe->tx_next++ % DMA_QUEUE_LEN;
+            pipe->out_tgt[i].ptr = out;
+            res = pipe_push(pipe, &pipe->tx_trans[i], &pipe->in_tgt[i], in, in_du, checks);
+        }
+        else
+        {
+            if (in_du == 0 || in_du % pipe->in_block_du != 0 ||
+                out_du < in_du / pipe->in_block_du * pipe->out_block_du)
+            {
+                return DMA_CONFIG_CRITICAL_ERROR;
+            }
+
+            /*
+             * On a single channel the RX leg of a chunk only starts once its
+             * TX leg is over: the accelerator must be able to take the whole
+             * chunk. On two channels, the legs are only split to fit the
+             * size register.
+             */
+            if (pipe->tx_channel == pipe->rx_channel)
+            {
+                chunk_blocks = pipe->fifo_depth_du / pipe->in_block_du;
+            }
+            else
+            {
+                uint32_t block_du = pipe->in_block_du > pipe->out_block_du ? pipe->in_block_du : pipe->out_block_du;
+                chunk_blocks = DMA_SIZE_D1_SIZE_MASK / block_du;
+            }
+
+            /*
+             * On two channels, the RX leg of a chunk is queued before its TX
+             * leg, so that it drains the accelerator from the first output.
+             */
+            for (blocks = in_du / pipe->in_block_du; blocks > 0 && res == DMA_CONFIG_OK;)
+            {
+                uint32_t n = blocks < chunk_blocks ? blocks : chunk_blocks;
+                uint32_t rx = pipe->rx_next++ % DMA_QUEUE_LEN;
+                uint32_t tx = pipe->tx_next++ % DMA_QUEUE_LEN;
+
+                if (pipe->tx_channel == pipe->rx_channel)
+                {
+                    res |= pipe_push(pipe, &pipe->tx_trans[tx], &pipe->in_tgt[tx], in,
+                                     n * pipe->in_block_du, checks);
+                    if (res == DMA_CONFIG_OK)
+                    {
+                        res |= pipe_push(pipe, &pipe->rx_trans[rx], &pipe->out_tgt[rx], out,
+                                         n * pipe->out_block_du, checks);
+                    }
+                }
+                else
+                {
+                    res |= pipe_push(pipe, &pipe->rx_trans[rx], &pipe->out_tgt[rx], out,
+                                     n * pipe->out_block_du, checks);
+                    if (res == DMA_CONFIG_OK)
+                    {
+                        res |= pipe_push(pipe, &pipe->tx_trans[tx], &pipe->in_tgt[tx], in,
+                                         n * pipe->in_block_du, checks);
+                    }
+                }
+
+                /* The following chunks only differ by their pointers and sizes */
+                checks = DMA_PERFORM_CHECKS_ONLY_SANITY;
+                in += n * pipe->in_block_du * in_size;
+                out += n * pipe->out_block_du * out_size;
+                blocks -= n;
+            }
+        }
+
+        /* On error, let the transactions already queued finish */
+        dma_queue_wait(pipe->tx_channel);
+        dma_queue_wait(pipe->rx_channel);
+
+        pipe->stats.runs++;
+        pipe->stats.cycles += stream_cycles() - start;
+        return res;
+    }
+
+    void dma_pipe_reset_stats(dma_pipe_t *pipe)
+    {
+        pipe->stats = (dma_pipe_stats_t){0};
+    }
+
+    /*
+     * Whether rows of len_du elements of size bytes that start stride_du
+     * elements apart can be walked by the D2 increment, which is applied after
+     * the last element of a row. The increment register holds bytes, in the
+     * field given by inc_mask.
+     */
+    static uint8_t batch_stride_fits(uint32_t stride_du, uint32_t len_du, uint32_t size, uint32_t inc_mask)
+    {
+        return stride_du >= len_du && stride_du - len_du + 1 <= inc_mask / size;
+    }
+
+    dma_config_flags_t dma_batch_init(dma_batch_t *batch)
+    {
+        if (batch->channel >= DMA_CH_NUM || batch->type >= DMA_DATA_TYPE__size)
+        {
+            return DMA_CONFIG_CRITICAL_ERROR;
+        }
+
+        batch->rows = 0;
+        batch->next = 0;
+        dma_batch_reset_stats(batch);
+
+        /* Queued transactions are launched by the interrupt handler */
+        CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+
+        return DMA_CONFIG_OK;
+    }
+
+    dma_config_flags_t dma_batch_flush(dma_batch_t *batch)
+    {
+        uint32_t i = batch->next % DMA_QUEUE_LEN;
+        dma_config_flags_t res;
+
+        if (batch->rows == 0)
+        {
+            return DMA_CONFIG_OK;
+        }
+
+        /* The transaction of entry i may still be in the queue */
+        while (dma_queue_pending(batch->channel) == DMA_QUEUE_LEN)
+        {
+            CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+            if (dma_queue_pending(batch->channel) == DMA_QUEUE_LEN)
+            {
+                wait_for_interrupt();
+            }
+            CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+        }
+
+        batch->src_tgt[i] = (dma_target_t){
+            .ptr = (uint8_t *)batch->src,
+            .inc_d1_du = 1,
+            .inc_d2_du = batch->src_stride_du - batch->len_du + 1,
+            .type = batch->type,
+            .trig = DMA_TRIG_MEMORY,
+        };
+        batch->dst_tgt[i] = (dma_target_t){
+            .ptr = batch->dst,
+            .inc_d1_du = 1,
+            .inc_d2_du = batch->dst_stride_du - batch->len_du + 1,
+            .type = batch->type,
+            .trig = DMA_TRIG_MEMORY,
+        };
+        batch->trans[i] = (dma_trans_t){
+            .src = &batch->src_tgt[i],
+            .dst = &batch->dst_tgt[i],
+            .size_d1_du = batch->len_du,
+            .size_d2_du = batch->rows,
+            .dim = batch->rows > 1 ? DMA_DIM_CONF_2D : DMA_DIM_CONF_1D,
+            .src_type = batch->type,
+            .dst_type = batch->type,
+            .mode = DMA_TRANS_MODE_SINGLE,
+            .end = DMA_TRANS_END_INTR,
+            .channel = batch->channel,
+        };
+        batch->rows = 0;
+
+        /* The copies were checked when they were requested */
+        res = dma_validate_transaction(&batch->trans[i], DMA_DO_NOT_ENABLE_REALIGN,
+                                       DMA_PERFORM_CHECKS_ONLY_SANITY);
+        if (res & DMA_CONFIG_CRITICAL_ERROR)
+        {
+            return res;
+        }
+        res = dma_queue_push(&batch->trans[i], NULL, NULL);
+        if (res == DMA_CONFIG_OK)
+        {
+            batch->next++;
+            batch->stats.launches++;
+        }
+        return res;
+    }
+
+    /*
+     * Merges a copy into the pending transaction, returns 0 if it does not
+     * line up with it.
+     */
+    static uint8_t batch_merge(dma_batch_t *batch, uint8_t *dst, const uint8_t *src, uint32_t len_du, uint32_t size)
+    {
+        if (batch->rows == 1 && len_du == batch->len_du && src > batch->src && dst > batch->dst)
+        {
+            /* A second row: its position gives the strides */
+            uint32_t src_stride_du = (src - batch->src) / size;
+            uint32_t dst_stride_du = (dst - batch->dst) / size;
+            if (batch_stride_fits(src_stride_du, len_du, size, DMA_SRC_PTR_INC_D2_INC_MASK) &&
+                batch_stride_fits(dst_stride_du, len_du, size, DMA_DST_PTR_INC_D2_INC_MASK))
+            {
+                batch->src_stride_du = src_stride_du;
+                batch->dst_stride_du = dst_stride_du;
+                batch->rows = 2;
+                return 1;
+            }
+        }
+        else if (batch->rows > 1 && len_du == batch->len_du && batch->rows < DMA_SIZE_D2_SIZE_MASK &&
+                 src == batch->src + batch->rows * batch->src_stride_du * size &&
+                 dst == batch->dst + batch->rows * batch->dst_stride_du * size)
+        {
+            batch->rows++;
+            return 1;
+        }
+
+        /* Continues the pending copy on both sides */
+        if (batch->rows == 1 && batch->len_du + len_du <= DMA_SIZE_D1_SIZE_MASK &&
+            src == batch->src + batch->len_du * size && dst == batch->dst + batch->len_du * size)
+        {
+            batch->len_du += len_du;
+            return 1;
+        }
+        return 0;
+    }
+
+    dma_config_flags_t dma_batch_copy(dma_batch_t *batch, void *p_dst, const void *p_src, uint32_t len_du)
+    {
+        const uint8_t *src = (const uint8_t *)p_src;
+        uint8_t *dst = (uint8_t *)p_dst;
+        uint32_t size = DMA_DATA_TYPE_2_SIZE(batch->type);
+        dma_config_flags_t res = DMA_CONFIG_OK;
+
+        if ((uint32_t)src % size != 0 || (uint32_t)dst % size != 0)
+        {
+            return DMA_CONFIG_MISALIGN | DMA_CONFIG_CRITICAL_ERROR;
+        }
+        if (len_du == 0)
+        {
+            return DMA_CONFIG_OK;
+        }
+        batch->stats.requests++;
+
+        if (!batch_merge(batch, dst, src, len_du, size))
+        {
+            res = dma_batch_flush(batch);
+            if (res & DMA_CONFIG_CRITICAL_ERROR)
+            {
+                return res;
+            }
+
+            /* Long copies are split, the last part becomes the pending one */
+            while (len_du > DMA_SIZE_D1_SIZE_MASK)
+            {
+                batch->src = src;
+                batch->dst = dst;
+                batch->len_du = DMA_SIZE_D1_SIZE_MASK;
+                batch->rows = 1;
+                res = dma_batch_flush(batch);
+                if (res & DMA_CONFIG_CRITICAL_ERROR)
+                {
+                    return res;
+                }
+                src += DMA_SIZE_D1_SIZE_MASK * size;
+                dst += DMA_SIZE_D1_SIZE_MASK * size;
+                len_du -= DMA_SIZE_D1_SIZE_MASK;
+            }
+            batch->src = src;
+            batch->dst = dst;
+            batch->len_du = len_du;
+            batch->rows = 1;
+        }
+
+        if (batch->threshold_du != 0 && batch->len_du * batch->rows >= batch->threshold_du)
+        {
+            res = dma_batch_flush(batch);
+        }
+        return res;
+    }
+
+    dma_config_flags_t dma_batch_barrier(dma_batch_t *batch)
+    {
+        dma_config_flags_t res = dma_batch_flush(batch);
+
+        /* On error, let the transactions already queued finish */
+        dma_queue_wait(batch->channel);
+        return res;
+    }
+
+    void dma_batch_reset_stats(dma_batch_t *batch)
+    {
+        batch->stats = (dma_batch_stats_t){0};
+    }
+
 #ifdef __cplusplus
 }
 #endif
@@ -66,6 +66,243 @@ extern "C"
         CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);   \
     }
 
+/**
+ * Maximum number of buffers of a stream (triple buffering).
+ */
+#define DMA_STREAM_MAX_BUFS 3
+
+    /******************************/
+    /* ---- TYPE DEFINITIONS ---- */
+    /******************************/
+
+    /**
+     * Function that processes a tile of a stream.
+     *
+     * @param p_in   Buffer holding the input tile (tile_d1_du x tile_d2_du
+     *               elements, without gaps).
+     * @param p_out  Buffer where the output tile is written, NULL if the
+     *               stream has no destination.
+     * @param tile   Index of the tile.
+     * @param p_arg  Argument given in the stream.
+     */
+    typedef void (*dma_stream_compute_t)(const void *p_in, void *p_out, uint32_t tile, void *p_arg);
+
+    /**
+     * A 2D tensor in memory, walked tile by tile in row-major order: tile t
+     * starts at row (t / tiles per row) * tile_d2_du and column
+     * (t % tiles per row) * tile_d1_du, with row_du / tile_d1_du tiles per row.
+     */
+    typedef struct
+    {
+        uint8_t *ptr;           /*!< First element of the tensor. */
+        uint32_t row_du;        /*!< Elements in a row of the tensor. */
+        uint32_t tile_d1_du;    /*!< Elements in a row of a tile. */
+        uint32_t tile_d2_du;    /*!< Rows of a tile. */
+        dma_data_type_t type;   /*!< Type of the elements. */
+    } dma_stream_tensor_t;
+
+    /**
+     * Time spent in each stage of a stream, in clock cycles.
+     */
+    typedef struct
+    {
+        uint32_t tiles;             /*!< Tiles processed. */
+        uint32_t total_cycles;      /*!< Duration of dma_stream_run(). */
+        uint32_t compute_cycles;    /*!< Spent in the compute function. */
+        uint32_t in_stall_cycles;   /*!< Waiting for a tile to be read. */
+        uint32_t out_stall_cycles;  /*!< Waiting for an output buffer to be
+                                         written back, including the last ones. */
+    } dma_stream_stats_t;
+
+    /**
+     * A stream: the DMA reads the tiles of src into the input buffers while
+     * the CPU processes the previous tiles, and writes the output buffers
+     * back into the tiles of dst.
+     * The fields up to arg are set by the application, the others are
+     * private.
+     */
+    typedef struct
+    {
+        dma_stream_tensor_t src;    /*!< Tensor read by the stream. */
+        dma_stream_tensor_t dst;    /*!< Tensor written by the stream. dst.ptr
+                                         can be NULL if nothing is written back. */
+        uint8_t *in_buf[DMA_STREAM_MAX_BUFS];   /*!< Input buffers, of one
+                                                     src tile each. */
+        uint8_t *out_buf[DMA_STREAM_MAX_BUFS];  /*!< Output buffers, of one
+                                                     dst tile each. */
+        uint8_t n_bufs;             /*!< Buffers per direction: 2 (double
+                                         buffering) or 3 (triple buffering). */
+        uint8_t in_channel;         /*!< DMA channel reading the tiles. */
+        uint8_t out_channel;        /*!< DMA channel writing the tiles back,
+                                         can be in_channel. */
+        dma_stream_compute_t compute;   /*!< Processes a tile. */
+        void *arg;                  /*!< Passed to compute. */
+
+        dma_target_t in_src[DMA_STREAM_MAX_BUFS];
+        dma_target_t in_dst[DMA_STREAM_MAX_BUFS];
+        dma_target_t out_src[DMA_STREAM_MAX_BUFS];
+        dma_target_t out_dst[DMA_STREAM_MAX_BUFS];
+        dma_trans_t in_trans[DMA_STREAM_MAX_BUFS];
+        dma_trans_t out_trans[DMA_STREAM_MAX_BUFS];
+        volatile uint32_t loaded;
+        volatile uint32_t stored;
+        dma_stream_stats_t stats;
+    } dma_stream_t;
+
+    /**
+     * Function called from the window done interrupt of a ring, once a
+     * window has been filled.
+     *
+     * @param p_window  The newest filled window.
+     * @param window    Its number, counted from the start of the ring.
+     * @param p_arg     Argument given in the ring.
+     */
+    typedef void (*dma_ring_cb_t)(const void *p_window, uint32_t window, void *p_arg);
+
+    /**
+     * Statistics of a ring.
+     */
+    typedef struct
+    {
+        uint32_t windows;   /*!< Windows filled by the DMA. */
+        uint32_t released;  /*!< Windows released by the consumer. */
+        uint32_t overruns;  /*!< Windows overwritten before being released. */
+        uint32_t max_fill;  /*!< Largest number of filled windows waiting to
+                                 be released. */
+    } dma_ring_stats_t;
+
+    /**
+     * A ring: the DMA copies the samples of a peripheral into a buffer of
+     * n_windows windows in circular mode, without ever stopping. The consumer
+     * acquires the filled windows in order and reads them in place, then
+     * releases them. A window that has not been released when the DMA comes
+     * back to it is overwritten: it is counted as an overrun.
+     * The fields up to arg are set by the application, the others are
+     * private.
+     */
+    typedef struct
+    {
+        uint8_t *src;               /*!< Data register of the peripheral. */
+        dma_trigger_slot_mask_t trig;   /*!< Trigger slot of the peripheral. */
+        dma_data_type_t type;       /*!< Type of the samples. */
+        uint8_t *buf;               /*!< Buffer of n_windows * win_du samples. */
+        uint16_t win_du;            /*!< Samples per window. */
+        uint8_t n_windows;          /*!< Windows in the buffer, at least 2. */
+        uint8_t channel;            /*!< DMA channel. */
+        dma_ring_cb_t cb;           /*!< Called for each filled window, can
+                                         be NULL. */
+        void *arg;                  /*!< Passed to cb. */
+
+        dma_target_t tgt_src;
+        dma_target_t tgt_dst;
+        dma_trans_t trans;
+        volatile uint32_t produced;
+        uint32_t consumed;
+        uint8_t held;
+        dma_ring_stats_t stats;
+    } dma_ring_t;
+
+    /**
+     * How the accelerator of a pipeline is connected to the DMA.
+     */
+    typedef enum
+    {
+        DMA_PIPE_HW_FIFO = 0,   /*!< On the HW FIFO interface of a channel
+                                     (DMA_HW_FIFO_MODE). A single transaction
+                                     feeds and drains it. */
+        DMA_PIPE_BUS_FIFO,      /*!< Input and output FIFO registers on the
+                                     bus, whose state drives the external
+                                     trigger slots of the channels. */
+    } dma_pipe_kind_t;
+
+    /**
+     * Statistics of a pipeline.
+     */
+    typedef struct
+    {
+        uint32_t runs;          /*!< Calls to dma_pipe_run(). */
+        uint32_t transactions;  /*!< Transactions of both legs. */
+        uint32_t cycles;        /*!< Duration of dma_pipe_run(). */
+    } dma_pipe_stats_t;
+
+    /**
+     * A pipeline: the DMA streams a buffer through an accelerator with FIFO
+     * interfaces and writes the outputs to another buffer. The TX leg
+     * (memory to accelerator) and the RX leg (accelerator to memory) run at
+     * the same time, paced by the accelerator.
+     * The fields up to rx_channel are set by the application, the others are
+     * private.
+     */
+    typedef struct
+    {
+        dma_pipe_kind_t kind;       /*!< How the accelerator is connected. */
+        dma_data_type_t in_type;    /*!< Type of the inputs. */
+        dma_data_type_t out_type;   /*!< Type of the outputs. */
+        uint8_t *fifo_in;           /*!< BUS_FIFO: input register. */
+        uint8_t *fifo_out;          /*!< BUS_FIFO: output register. */
+        uint16_t in_block_du;       /*!< BUS_FIFO: inputs consumed to
+                                         produce out_block_du outputs. */
+        uint16_t out_block_du;      /*!< BUS_FIFO: see in_block_du. */
+        uint16_t fifo_depth_du;     /*!< BUS_FIFO: inputs accepted while no
+                                         output is read. Only used when both
+                                         legs share a channel. */
+        uint8_t tx_channel;         /*!< Channel feeding the accelerator, the
+                                         one it is attached to for HW_FIFO. */
+        uint8_t rx_channel;         /*!< BUS_FIFO: channel draining the
+                                         accelerator, can be tx_channel. */
+
+        dma_target_t fifo_in_tgt;
+        dma_target_t fifo_out_tgt;
+        dma_target_t in_tgt[DMA_QUEUE_LEN];
+        dma_target_t out_tgt[DMA_QUEUE_LEN];
+        dma_trans_t tx_trans[DMA_QUEUE_LEN];
+        dma_trans_t rx_trans[DMA_QUEUE_LEN];
+        uint32_t tx_next;
+        uint32_t rx_next;
+        dma_pipe_stats_t stats;
+    } dma_pipe_t;
+
+    /**
+     * Launches of a batch. requests - launches is the number of launches
+     * saved by merging copies.
+     */
+    typedef struct
+    {
+        uint32_t requests;  /*!< Copies requested. */
+        uint32_t launches;  /*!< Transactions launched. */
+    } dma_batch_stats_t;
+
+    /**
+     * A batch: consecutive memory copies of the same length whose sources and
+     * destinations are evenly spaced are merged into a single 2D
+     * transaction, and copies that continue the previous one on both sides
+     * are merged into a longer 1D transaction. The pending transaction is
+     * launched when a copy cannot be merged, when it reaches threshold_du
+     * elements, or on dma_batch_flush() and dma_batch_barrier().
+     * The fields up to threshold_du are set by the application, the others
+     * are private.
+     */
+    typedef struct
+    {
+        dma_data_type_t type;       /*!< Type of the elements copied. */
+        uint8_t channel;            /*!< DMA channel. */
+        uint32_t threshold_du;      /*!< Elements after which the pending
+                                         transaction is launched, 0 for no
+                                         limit other than the registers. */
+
+        const uint8_t *src;
+        uint8_t *dst;
+        uint32_t len_du;
+        uint32_t rows;
+        uint32_t src_stride_du;
+        uint32_t dst_stride_du;
+        dma_target_t src_tgt[DMA_QUEUE_LEN];
+        dma_target_t dst_tgt[DMA_QUEUE_LEN];
+        dma_trans_t trans[DMA_QUEUE_LEN];
+        uint32_t next;
+        dma_batch_stats_t stats;
+    } dma_batch_t;
+
     /********************************/
     /* ---- EXPORTED VARIABLES ---- */
     /********************************/
@@ -121,6 +358,205 @@ extern "C"
 
     void __attribute__((noinline)) dma_wait(uint8_t channel);
 
+    /**
+     * @brief Prepares a stream. The transactions of every buffer are
+     * validated once here, dma_stream_run() only changes their pointers.
+     * The DMA must have been initialized with dma_init() or dma_sdk_init().
+     *
+     * @param stream    The stream, with its configuration fields set.
+     * @return DMA_CONFIG_OK, or the flags of the transaction that failed the
+     *         validation (DMA_CONFIG_CRITICAL_ERROR if n_bufs is not valid).
+     */
+    dma_config_flags_t dma_stream_init(dma_stream_t *stream);
+
+    /**
+     * @brief Processes tiles 0 to n_tiles-1 of a stream. While the CPU
+     * processes tile t, the DMA reads the following n_bufs-1 tiles on
+     * in_channel and writes back the previous outputs on out_channel, using
+     * the transaction queue of the DMA driver. Returns once the last tile has
+     * been written back. The stage statistics are updated in stream->stats.
+     * The channels must not be used by other code while the stream runs.
+     *
+     * @param stream    The stream, prepared with dma_stream_init().
+     * @param n_tiles   Number of tiles to process. All of them must be inside
+     *                  the tensors.
+     * @return DMA_CONFIG_OK, or the error returned by the queue of a channel.
+     */
+    dma_config_flags_t dma_stream_run(dma_stream_t *stream, uint32_t n_tiles);
+
+    /**
+     * @brief Clears the statistics of a stream.
+     *
+     * @param stream    The stream.
+     */
+    void dma_stream_reset_stats(dma_stream_t *stream);
+
+    /**
+     * @brief Prepares a ring. Its circular transaction is validated once
+     * here. The DMA must have been initialized with dma_init() or
+     * dma_sdk_init().
+     *
+     * @param ring      The ring, with its configuration fields set.
+     * @return DMA_CONFIG_OK, or the flags of the transaction
+     *         (DMA_CONFIG_CRITICAL_ERROR if the windows are not valid).
+     */
+    dma_config_flags_t dma_ring_init(dma_ring_t *ring);
+
+    /**
+     * @brief Starts filling the windows of a ring from its first one. The
+     * peripheral can be started before or after. The window and transaction
+     * done interrupts are enabled: dma_intr_handler_trans_done() is called
+     * each time the DMA wraps around the buffer.
+     *
+     * @param ring      The ring, prepared with dma_ring_init().
+     * @return DMA_CONFIG_OK, or DMA_CONFIG_TRANS_OVERRIDE if the channel is
+     *         busy.
+     */
+    dma_config_flags_t dma_ring_start(dma_ring_t *ring);
+
+    /**
+     * @brief Stops a ring at the end of the buffer. The DMA finishes filling
+     * it, so the peripheral must keep producing samples until this returns.
+     *
+     * @param ring      The ring.
+     */
+    void dma_ring_stop(dma_ring_t *ring);
+
+    /**
+     * @brief Gets the oldest filled window that has not been released,
+     * without copying it. The windows that were overwritten before being
+     * acquired are skipped and counted as overruns. Acquiring again before
+     * releasing returns the same window.
+     *
+     * @param ring      The ring.
+     * @param wait      If not 0, sleep until a window is filled.
+     * @return The window, or NULL if there is none and wait is 0.
+     */
+    const void *dma_ring_acquire(dma_ring_t *ring, uint8_t wait);
+
+    /**
+     * @brief Gives the acquired window back to the DMA.
+     *
+     * @param ring      The ring.
+     * @return DMA_CONFIG_OK, or DMA_CONFIG_OVERRUN if the DMA started to
+     *         overwrite the window while it was held: its content may be
+     *         mixed with newer samples.
+     */
+    dma_config_flags_t dma_ring_release(dma_ring_t *ring);
+
+    /**
+     * @brief Gets the number of filled windows waiting to be released.
+     *
+     * @param ring      The ring.
+     */
+    uint32_t dma_ring_pending(dma_ring_t *ring);
+
+    /**
+     * @brief Clears the statistics of a ring.
+     *
+     * @param ring      The ring.
+     */
+    void dma_ring_reset_stats(dma_ring_t *ring);
+
+    /**
+     * @brief Prepares the transactions of a pipeline. The DMA must have been
+     * initialized with dma_init() or dma_sdk_init().
+     *
+     * @param pipe      The pipeline, with its configuration fields set.
+     * @return DMA_CONFIG_OK, or DMA_CONFIG_CRITICAL_ERROR if the
+     *         configuration is not valid.
+     */
+    dma_config_flags_t dma_pipe_init(dma_pipe_t *pipe);
+
+    /**
+     * @brief Streams in_du inputs through the accelerator. Returns once the
+     * outputs have been written.
+     *
+     * The transfers are sized so that the accelerator cannot stall the DMA
+     * forever: with HW_FIFO, a single transaction of in_du elements is used
+     * and the accelerator may end it early with its done signal. With
+     * BUS_FIFO on two channels, both legs are queued for the whole length at
+     * once. On a single channel, the legs alternate in chunks of at most
+     * fifo_depth_du inputs, so that the TX leg never waits for a FIFO that
+     * only the next RX leg would drain.
+     * The first transaction of each leg is fully validated, the following
+     * ones only differ by their pointers and sizes. The buffers must be
+     * aligned to their type.
+     *
+     * @param pipe      The pipeline, prepared with dma_pipe_init().
+     * @param p_in      Inputs.
+     * @param in_du     Number of inputs. A multiple of in_block_du for
+     *                  BUS_FIFO.
+     * @param p_out     Outputs.
+     * @param out_du    Size of p_out. At least in_du for HW_FIFO, and
+     *                  in_du / in_block_du * out_block_du for BUS_FIFO.
+     * @return DMA_CONFIG_OK, DMA_CONFIG_CRITICAL_ERROR if the sizes are not
+     *         valid, or the flags of the transaction that could not be
+     *         validated or queued.
+     */
+    dma_config_flags_t dma_pipe_run(dma_pipe_t *pipe, const void *p_in, uint32_t in_du,
+                                    void *p_out, uint32_t out_du);
+
+    /**
+     * @brief Clears the statistics of a pipeline.
+     *
+     * @param pipe      The pipeline.
+     */
+    void dma_pipe_reset_stats(dma_pipe_t *pipe);
+
+    /**
+     * @brief Prepares a batch. The DMA must have been initialized with
+     * dma_init() or dma_sdk_init().
+     *
+     * @param batch     The batch, with its configuration fields set.
+     * @return DMA_CONFIG_OK, or DMA_CONFIG_CRITICAL_ERROR if the channel or
+     *         the type is not valid.
+     */
+    dma_config_flags_t dma_batch_init(dma_batch_t *batch);
+
+    /**
+     * @brief Requests a copy of len_du elements. The copy is merged with the
+     * pending transaction if possible, otherwise the pending transaction is
+     * launched and the copy becomes the pending one. The copy is only
+     * guaranteed to be done after dma_batch_barrier(): the source must not
+     * be modified and the destination must not be read before.
+     *
+     * @param batch     The batch, prepared with dma_batch_init().
+     * @param p_dst     Destination, aligned to the type.
+     * @param p_src     Source, aligned to the type.
+     * @param len_du    Elements to copy.
+     * @return DMA_CONFIG_OK, DMA_CONFIG_MISALIGN | DMA_CONFIG_CRITICAL_ERROR
+     *         if a pointer is not aligned, or the flags of the transaction
+     *         that could not be launched.
+     */
+    dma_config_flags_t dma_batch_copy(dma_batch_t *batch, void *p_dst, const void *p_src, uint32_t len_du);
+
+    /**
+     * @brief Launches the pending transaction, without waiting for it.
+     *
+     * @param batch     The batch.
+     * @return DMA_CONFIG_OK, or the flags of the transaction that could not
+     *         be launched.
+     */
+    dma_config_flags_t dma_batch_flush(dma_batch_t *batch);
+
+    /**
+     * @brief Launches the pending transaction and waits until all the copies
+     * requested are done.
+     *
+     * @param batch     The batch.
+     * @return DMA_CONFIG_OK, or the flags of the transaction that could not
+     *         be launched.
+     */
+    dma_config_flags_t dma_batch_barrier(dma_batch_t *batch);
+
+    /**
+     * @brief Clears the statistics of a batch.
+     *
+     * @param batch     The batch.
+     */
+    void dma_batch_reset_stats(dma_batch_t *batch);
+
 #ifdef __cplusplus
 }
 #endif // __cplusplus
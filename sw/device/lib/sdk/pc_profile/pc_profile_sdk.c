@@ -0,0 +1,168 @@
+// Copyright 2025 EPFL and Politecnico di Torino.
+// Solderpad Hardware License, Version 2.1, see LICENSE.md for details.
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// File: pc_profile_sdk.c
+// Description: Statistical PC-sampling profiler.
+
+#include "pc_profile_sdk.h"
+
+#ifdef PC_PROFILE
+
+#include <stdio.h>
+
+#include "csr.h"
+#include "core_v_mini_mcu.h"
+#include "fast_intr_ctrl.h"
+#include "rv_timer.h"
+
+#if RV_TIMER_START_ADDRESS == 0
+#error "PC_PROFILE needs the rv_timer peripheral"
+#endif
+
+#if (PC_PROFILE_BUCKETS & (PC_PROFILE_BUCKETS - 1)) != 0
+#error "PC_PROFILE_BUCKETS must be a power of two"
+#endif
+
+// Linear probing gives up after this many occupied buckets
+#define PC_PROFILE_MAX_PROBES 8
+
+// mie bit of the timer_2 fast interrupt
+#define PC_PROFILE_MIE_MASK (1 << (16 + kTimer_2_fic_e))
+
+/******************************/
+/* ---- GLOBAL VARIABLES ---- */
+/******************************/
+
+static pc_profile_bucket_t pc_profile_hist[PC_PROFILE_BUCKETS];
+static uint32_t pc_profile_samples;
+static uint32_t pc_profile_dropped;
+static uint32_t pc_profile_period;
+static uint64_t pc_profile_next;
+
+static rv_timer_t pc_profile_timer;
+
+/************************************/
+/* ---- FUNCTION IMPLEMENTATIONS ---- */
+/************************************/
+
+static inline void pc_profile_record(uint32_t pc)
+{
+    // Fibonacci hashing of the (half-word aligned) PC
+    uint32_t idx = ((pc >> 1) * 2654435761u) & (PC_PROFILE_BUCKETS - 1);
+
+    pc_profile_samples++;
+    for (uint32_t i = 0; i < PC_PROFILE_MAX_PROBES; i++)
+    {
+        pc_profile_bucket_t *b = &pc_profile_hist[idx];
+        if (b->pc == pc)
+        {
+            b->count++;
+            return;
+        }
+        if (b->pc == 0)
+        {
+            b->pc = pc;
+            b->count = 1;
+            return;
+        }
+        idx = (idx + 1) & (PC_PROFILE_BUCKETS - 1);
+    }
+    pc_profile_dropped++;
+}
+
+void fic_irq_timer_2(void)
+{
+    uint32_t mepc;
+    uint64_t now;
+
+    CSR_READ(CSR_REG_MEPC, &mepc);
+    pc_profile_record(mepc);
+
+    // Re-arm before clearing, as the interrupt stays asserted while the
+    // counter is above the threshold
+    pc_profile_next += pc_profile_period;
+    rv_timer_counter_read(&pc_profile_timer, 0, &now);
+    if (pc_profile_next <= now)
+    {
+        pc_profile_next = now + pc_profile_period;
+    }
+    rv_timer_arm(&pc_profile_timer, 0, 0, pc_profile_next);
+    rv_timer_irq_clear(&pc_profile_timer, 0, 0);
+}
+
+void pc_profile_start(uint32_t period)
+{
+    for (uint32_t i = 0; i < PC_PROFILE_BUCKETS; i++)
+    {
+        pc_profile_hist[i] = (pc_profile_bucket_t){0};
+    }
+    pc_profile_samples = 0;
+    pc_profile_dropped = 0;
+    pc_profile_period = period;
+
+    /*
+     * Count clock cycles on hart 0 of the timer. rv_timer_init() would reset
+     * both harts, and hart 1 may be used by someone else (the flash I/O
+     * engine): set up the driver structure by hand and only touch hart 0,
+     * whose counter is not reset.
+     */
+    pc_profile_timer.base_addr = mmio_region_from_addr(RV_TIMER_START_ADDRESS);
+    pc_profile_timer.config = (rv_timer_config_t){.hart_count = 2, .comparator_count = 1};
+    rv_timer_set_tick_params(&pc_profile_timer, 0,
+                             (rv_timer_tick_params_t){.prescale = 0, .tick_step = 1});
+    rv_timer_counter_read(&pc_profile_timer, 0, &pc_profile_next);
+    pc_profile_next += period;
+    rv_timer_arm(&pc_profile_timer, 0, 0, pc_profile_next);
+    rv_timer_irq_clear(&pc_profile_timer, 0, 0);
+    rv_timer_irq_enable(&pc_profile_timer, 0, 0, kRvTimerEnabled);
+
+    enable_fast_interrupt(kTimer_2_fic_e, true);
+    CSR_SET_BITS(CSR_REG_MIE, PC_PROFILE_MIE_MASK);
+    CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+
+    rv_timer_counter_set_enabled(&pc_profile_timer, 0, kRvTimerEnabled);
+}
+
+void pc_profile_stop(void)
+{
+    rv_timer_counter_set_enabled(&pc_profile_timer, 0, kRvTimerDisabled);
+    rv_timer_irq_enable(&pc_profile_timer, 0, 0, kRvTimerDisabled);
+    rv_timer_irq_clear(&pc_profile_timer, 0, 0);
+    CSR_CLEAR_BITS(CSR_REG_MIE, PC_PROFILE_MIE_MASK);
+    enable_fast_interrupt(kTimer_2_fic_e, false);
+}
+
+void pc_profile_dump(void)
+{
+    printf("PCPROF_BEGIN,%u,%u,%u\n", (unsigned)pc_profile_samples,
+           (unsigned)pc_profile_dropped, (unsigned)pc_profile_period);
+    for (uint32_t i = 0; i < PC_PROFILE_BUCKETS; i++)
+    {
+        if (pc_profile_hist[i].pc == 0) continue;
+        printf("PCPROF,%08x,%u\n", (unsigned)pc_profile_hist[i].pc,
+               (unsigned)pc_profile_hist[i].count);
+    }
+    printf("PCPROF_END\n");
+}
+
+const pc_profile_bucket_t *pc_profile_get(uint32_t *samples)
+{
+    *samples = pc_profile_samples;
+    return pc_profile_hist;
+}
+
+// Profile the whole application when PC_PROFILE is defined: sampling starts
+// before main() and the histogram is dumped by exit().
+__attribute__((constructor)) static void pc_profile_auto_start(void)
+{
+    pc_profile_start(PC_PROFILE_PERIOD);
+}
+
+__attribute__((destructor)) static void pc_profile_auto_dump(void)
+{
+    pc_profile_stop();
+    pc_profile_dump();
+}
+
+#endif  // PC_PROFILE
@@ -0,0 +1,90 @@
+// Copyright 2025 EPFL and Politecnico di Torino.
+// Solderpad Hardware License, Version 2.1, see LICENSE.md for details.
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// File: pc_profile_sdk.h
+// Description: Statistical PC-sampling profiler.
+//
+// A periodic interrupt of the peripheral-domain rv_timer (timer 2, fast
+// interrupt line kTimer_2_fic_e) samples `mepc`, i.e. the PC of the code that
+// was interrupted, into a RAM histogram. At the end of the run the histogram is
+// printed on the UART and util/profile/pc_sample_profile.py symbolizes it
+// against main.elf into folded stacks and a flamegraph. No waveform is needed,
+// so it works on FPGA boards as well as in simulation.
+//
+// The profiler is compiled in only when `PC_PROFILE` is defined, because it
+// owns `fic_irq_timer_2()`. Any application can then be profiled without
+// changes (e.g. make app PROJECT=<app> COMPILER_FLAGS=-DPC_PROFILE): sampling
+// starts before main() and the histogram is dumped when main() returns or
+// exit() is called. Applications can also call pc_profile_start(),
+// pc_profile_stop() and pc_profile_dump() to profile a specific section.
+//
+// Since interrupts are disabled while an ISR runs, time spent in other ISRs is
+// not sampled.
+
+#ifndef PC_PROFILE_SDK_H_
+#define PC_PROFILE_SDK_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+#ifdef PC_PROFILE
+
+/**
+ * Number of distinct PCs that can be recorded. Must be a power of two.
+ */
+#ifndef PC_PROFILE_BUCKETS
+#define PC_PROFILE_BUCKETS 512
+#endif
+
+/**
+ * Default sampling period in clock cycles.
+ */
+#ifndef PC_PROFILE_PERIOD
+#define PC_PROFILE_PERIOD 2000
+#endif
+
+/**
+ * A histogram entry.
+ */
+typedef struct
+{
+  uint32_t pc;     // sampled mepc, 0 if the bucket is free
+  uint32_t count;  // number of samples
+} pc_profile_bucket_t;
+
+/**
+ * Clear the histogram and start sampling.
+ * @param period sampling period in clock cycles.
+ */
+void pc_profile_start(uint32_t period);
+
+/**
+ * Stop sampling. The histogram is kept.
+ */
+void pc_profile_stop(void);
+
+/**
+ * Print the histogram on the UART as `PCPROF,<pc>,<count>` lines between a
+ * `PCPROF_BEGIN,<samples>,<dropped>,<period>` and a `PCPROF_END` line.
+ * Dropped samples are the ones that did not fit in the histogram.
+ */
+void pc_profile_dump(void);
+
+/**
+ * Get the histogram.
+ * @param samples total number of samples taken, including the dropped ones.
+ * @return pointer to the PC_PROFILE_BUCKETS entries.
+ */
+const pc_profile_bucket_t *pc_profile_get(uint32_t *samples);
+
+#endif  // PC_PROFILE
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // PC_PROFILE_SDK_H_
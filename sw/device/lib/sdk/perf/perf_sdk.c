@@ -0,0 +1,278 @@
+// Copyright 2025 EPFL and Politecnico di Torino.
+// Solderpad Hardware License, Version 2.1, see LICENSE.md for details.
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// File: perf_sdk.c
+// Description: Hardware performance counter profiling of code regions.
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "perf_sdk.h"
+#include "csr.h"
+
+#if PERF_MAX_HPM_COUNTERS > 8
+#error "PERF_MAX_HPM_COUNTERS must be at most 8"
+#endif
+
+/******************************/
+/* ---- GLOBAL VARIABLES ---- */
+/******************************/
+
+typedef struct
+{
+    uint8_t region;
+    uint32_t start[PERF_NUM_SLOTS];
+} perf_frame_t;
+
+static perf_region_t perf_regions[PERF_MAX_REGIONS];
+static uint32_t perf_num_regions;
+
+static perf_frame_t perf_stack[PERF_MAX_DEPTH];
+static uint32_t perf_depth;
+
+// Number of implemented mhpmcounters and events assigned to them
+static uint32_t perf_num_hpm;
+static uint32_t perf_num_hpm_hw;
+static uint8_t perf_events[PERF_MAX_HPM_COUNTERS];
+
+static const perf_event_t perf_default_events[] = {
+    kPerfEvLdStall_e,
+    kPerfEvJmpStall_e,
+    kPerfEvImiss_e,
+    kPerfEvBranchTaken_e,
+};
+
+static const char * const perf_event_names[] = {
+    "cycles", "instr", "ld_stall", "jmp_stall", "imiss", "loads", "stores",
+    "jumps", "branches", "br_taken", "compressed", "pipe_stall", "apu_type",
+    "apu_cont", "apu_dep", "apu_wb",
+};
+
+/************************************/
+/* ---- FUNCTION IMPLEMENTATIONS ---- */
+/************************************/
+
+// CSR addresses must be immediates, hence the switches below.
+#define PERF_HPM_CASE_READ(n)   case n: CSR_READ(CSR_REG_MHPMCOUNTER##n, &val); break;
+#define PERF_HPM_CASE_WRITE(n)  case n: CSR_WRITE(CSR_REG_MHPMCOUNTER##n, val); break;
+#define PERF_HPM_CASE_EVENT(n)  case n: CSR_WRITE(CSR_REG_MHPMEVENT##n, val); break;
+
+static inline uint32_t perf_hpm_read(uint32_t i)
+{
+    uint32_t val = 0;
+    switch (i + 3)
+    {
+        PERF_HPM_CASE_READ(3)
+        PERF_HPM_CASE_READ(4)
+        PERF_HPM_CASE_READ(5)
+        PERF_HPM_CASE_READ(6)
+        PERF_HPM_CASE_READ(7)
+        PERF_HPM_CASE_READ(8)
+        PERF_HPM_CASE_READ(9)
+        PERF_HPM_CASE_READ(10)
+        default: break;
+    }
+    return val;
+}
+
+static void perf_hpm_write(uint32_t i, uint32_t val)
+{
+    switch (i + 3)
+    {
+        PERF_HPM_CASE_WRITE(3)
+        PERF_HPM_CASE_WRITE(4)
+        PERF_HPM_CASE_WRITE(5)
+        PERF_HPM_CASE_WRITE(6)
+        PERF_HPM_CASE_WRITE(7)
+        PERF_HPM_CASE_WRITE(8)
+        PERF_HPM_CASE_WRITE(9)
+        PERF_HPM_CASE_WRITE(10)
+        default: break;
+    }
+}
+
+static void perf_hpm_event(uint32_t i, uint32_t val)
+{
+    switch (i + 3)
+    {
+        PERF_HPM_CASE_EVENT(3)
+        PERF_HPM_CASE_EVENT(4)
+        PERF_HPM_CASE_EVENT(5)
+        PERF_HPM_CASE_EVENT(6)
+        PERF_HPM_CASE_EVENT(7)
+        PERF_HPM_CASE_EVENT(8)
+        PERF_HPM_CASE_EVENT(9)
+        PERF_HPM_CASE_EVENT(10)
+        default: break;
+    }
+}
+
+static inline void perf_sample(uint32_t *s)
+{
+    CSR_READ(CSR_REG_MCYCLE, &s[0]);
+    CSR_READ(CSR_REG_MINSTRET, &s[1]);
+    for (uint32_t i = 0; i < perf_num_hpm; i++)
+    {
+        s[2 + i] = perf_hpm_read(i);
+    }
+}
+
+static int32_t perf_find(const char *name)
+{
+    for (uint32_t i = 0; i < perf_num_regions; i++)
+    {
+        if (strncmp(perf_regions[i].name, name, PERF_NAME_LEN - 1) == 0) return i;
+    }
+    return -1;
+}
+
+void perf_reset(void)
+{
+    memset(perf_regions, 0, sizeof(perf_regions));
+    perf_num_regions = 0;
+    perf_depth = 0;
+}
+
+uint32_t perf_init(void)
+{
+    // Unimplemented mhpmcounters are hardwired to zero.
+    perf_num_hpm_hw = 0;
+    for (uint32_t i = 0; i < PERF_MAX_HPM_COUNTERS; i++)
+    {
+        perf_hpm_write(i, 1);
+        if (perf_hpm_read(i) == 0) break;
+        perf_num_hpm_hw++;
+    }
+
+    return perf_config(perf_default_events,
+                       sizeof(perf_default_events) / sizeof(perf_default_events[0]));
+}
+
+uint32_t perf_config(const perf_event_t *events, uint32_t n)
+{
+    uint32_t inhibit = 0;
+
+    perf_num_hpm = n < perf_num_hpm_hw ? n : perf_num_hpm_hw;
+    for (uint32_t i = 0; i < PERF_MAX_HPM_COUNTERS; i++)
+    {
+        perf_events[i] = i < perf_num_hpm ? (uint8_t)events[i] : kPerfEvNone_e;
+        if (i < perf_num_hpm_hw)
+        {
+            perf_hpm_event(i, i < perf_num_hpm ? (1u << events[i]) : 0);
+            perf_hpm_write(i, 0);
+        }
+    }
+
+    // Enable mcycle (bit 0), minstret (bit 2) and the mhpmcounters in use
+    inhibit = 0x5 | (((1u << perf_num_hpm) - 1) << 3);
+    CSR_CLEAR_BITS(CSR_REG_MCOUNTINHIBIT, inhibit);
+
+    perf_reset();
+    return perf_num_hpm;
+}
+
+perf_result_t perf_region_begin(const char *name)
+{
+    if (perf_depth >= PERF_MAX_DEPTH) return kPerfErrDepth_e;
+
+    int32_t r = perf_find(name);
+    if (r < 0)
+    {
+        if (perf_num_regions >= PERF_MAX_REGIONS) return kPerfErrNoRegion_e;
+        r = perf_num_regions++;
+        strncpy(perf_regions[r].name, name, PERF_NAME_LEN - 1);
+        perf_regions[r].depth = perf_depth;
+        perf_regions[r].parent = perf_depth ? perf_stack[perf_depth - 1].region : 0xFF;
+    }
+
+    perf_frame_t *f = &perf_stack[perf_depth++];
+    f->region = r;
+    perf_sample(f->start);
+    return kPerfOk_e;
+}
+
+perf_result_t perf_region_end(const char *name)
+{
+    uint32_t now[PERF_NUM_SLOTS];
+    perf_sample(now);
+
+    if (perf_depth == 0) return kPerfErrMismatch_e;
+
+    perf_frame_t *f = &perf_stack[perf_depth - 1];
+    perf_region_t *r = &perf_regions[f->region];
+    if (strncmp(r->name, name, PERF_NAME_LEN - 1) != 0) return kPerfErrMismatch_e;
+
+    for (uint32_t i = 0; i < 2 + perf_num_hpm; i++)
+    {
+        r->count[i] += now[i] - f->start[i];
+    }
+    r->calls++;
+    perf_depth--;
+    return kPerfOk_e;
+}
+
+const perf_region_t *perf_get_region(const char *name)
+{
+    int32_t r = perf_find(name);
+    return r < 0 ? NULL : &perf_regions[r];
+}
+
+uint64_t perf_get_count(const char *name, uint32_t slot)
+{
+    const perf_region_t *r = perf_get_region(name);
+    return (r == NULL || slot >= PERF_NUM_SLOTS) ? 0 : r->count[slot];
+}
+
+void perf_print_summary(void)
+{
+    for (uint32_t i = 0; i < perf_num_regions; i++)
+    {
+        const perf_region_t *r = &perf_regions[i];
+        uint32_t cycles = (uint32_t)r->count[0];
+        uint32_t instr = (uint32_t)r->count[1];
+
+        printf("%*s[%s] calls %u, cycles %u, instr %u, IPC %u.%02u\n",
+               2 * r->depth, "", r->name, (unsigned)r->calls, (unsigned)cycles,
+               (unsigned)instr,
+               cycles ? (unsigned)(instr / cycles) : 0,
+               cycles ? (unsigned)((100ull * instr / cycles) % 100) : 0);
+
+        for (uint32_t e = 0; e < perf_num_hpm; e++)
+        {
+            uint32_t val = (uint32_t)r->count[2 + e];
+            uint8_t ev = perf_events[e];
+            printf("%*s  %-10s %u", 2 * r->depth, "", perf_event_names[ev], (unsigned)val);
+            // Stall events are cycles: report them also as share of the total
+            if (cycles && (ev == kPerfEvLdStall_e || ev == kPerfEvJmpStall_e ||
+                           ev == kPerfEvImiss_e || ev == kPerfEvPipeStall_e))
+            {
+                printf(" (%u.%u%%)", (unsigned)(100ull * val / cycles),
+                       (unsigned)((1000ull * val / cycles) % 10));
+            }
+            printf("\n");
+        }
+    }
+}
+
+perf_result_t perf_export(void *buf, uint32_t size, uint32_t *written)
+{
+    uint32_t len = sizeof(perf_export_header_t) + perf_num_regions * sizeof(perf_region_t);
+    perf_export_header_t *h = (perf_export_header_t *)buf;
+
+    *written = 0;
+    if (size < len) return kPerfErrSize_e;
+
+    h->magic = PERF_EXPORT_MAGIC;
+    h->version = PERF_EXPORT_VERSION;
+    h->num_slots = PERF_NUM_SLOTS;
+    h->num_hpm = perf_num_hpm;
+    h->num_regions = perf_num_regions;
+    memcpy(h->event, perf_events, sizeof(perf_events));
+    memcpy((uint8_t *)buf + sizeof(perf_export_header_t), perf_regions,
+           perf_num_regions * sizeof(perf_region_t));
+
+    *written = len;
+    return kPerfOk_e;
+}
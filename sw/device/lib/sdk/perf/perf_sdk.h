@@ -0,0 +1,226 @@
+// Copyright 2025 EPFL and Politecnico di Torino.
+// Solderpad Hardware License, Version 2.1, see LICENSE.md for details.
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// File: perf_sdk.h
+// Description: Hardware performance counter profiling of code regions.
+//
+// The SDK uses mcycle, minstret and the mhpmcounters of the cv32e40p and
+// cv32e40px cores. The number of mhpmcounters implemented by the core is set by
+// the `num_mhpmcounters` parameter of the CPU configuration (1 by default) and
+// is detected by perf_init(): events that do not fit in the available counters
+// are simply not reported.
+//
+// Regions are identified by a name, can be nested and can be entered several
+// times. Each region accumulates the counter deltas between its begin and end,
+// inclusive of the nested regions.
+//
+//   perf_init();
+//   PERF_REGION_BEGIN("matmul");
+//   ...
+//   PERF_REGION_END("matmul");
+//   perf_print_summary();
+//
+// Defining PERF_SDK_DISABLE compiles the region macros out.
+
+#ifndef PERF_SDK_H_
+#define PERF_SDK_H_
+
+#include <stdint.h>
+
+#include "x-heep.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+/**
+ * Maximum number of mhpmcounters used by the SDK (at most 8).
+ */
+#ifndef PERF_MAX_HPM_COUNTERS
+#define PERF_MAX_HPM_COUNTERS 4
+#endif
+
+/**
+ * Maximum number of distinct regions.
+ */
+#ifndef PERF_MAX_REGIONS
+#define PERF_MAX_REGIONS 8
+#endif
+
+/**
+ * Maximum nesting depth of regions.
+ */
+#ifndef PERF_MAX_DEPTH
+#define PERF_MAX_DEPTH 4
+#endif
+
+/**
+ * Number of characters of a region name that are kept in the summary.
+ */
+#define PERF_NAME_LEN 16
+
+/**
+ * Number of counters of each region: mcycle, minstret and the mhpmcounters.
+ */
+#define PERF_NUM_SLOTS (2 + PERF_MAX_HPM_COUNTERS)
+
+/**
+ * Events of the cv32e40p/cv32e40px performance counters (bit index in
+ * mhpmevent).
+ */
+typedef enum
+{
+  kPerfEvCycles_e       = 0,   // cycles
+  kPerfEvInstr_e        = 1,   // retired instructions
+  kPerfEvLdStall_e      = 2,   // load-use hazards
+  kPerfEvJmpStall_e     = 3,   // jump register hazards
+  kPerfEvImiss_e        = 4,   // cycles waiting for instruction fetches
+  kPerfEvLoad_e         = 5,   // loads
+  kPerfEvStore_e        = 6,   // stores
+  kPerfEvJump_e         = 7,   // unconditional jumps
+  kPerfEvBranch_e       = 8,   // conditional branches
+  kPerfEvBranchTaken_e  = 9,   // taken conditional branches
+  kPerfEvCompressed_e   = 10,  // compressed instructions
+  kPerfEvPipeStall_e    = 11,  // extra cycles from cv.elw
+  kPerfEvApuType_e      = 12,  // APU type conflicts
+  kPerfEvApuCont_e      = 13,  // APU contentions
+  kPerfEvApuDep_e       = 14,  // APU dependency stalls
+  kPerfEvApuWb_e        = 15,  // APU write-back conflicts
+  kPerfEvNone_e         = 0xFF,
+} perf_event_t;
+
+/**
+ * Return codes.
+ */
+typedef enum
+{
+  kPerfOk_e           = 0,
+  kPerfErrNoRegion_e  = 1,  // all the regions are already in use
+  kPerfErrDepth_e     = 2,  // too many nested regions
+  kPerfErrMismatch_e  = 3,  // end does not match the innermost begin
+  kPerfErrSize_e      = 4,  // export buffer too small
+} perf_result_t;
+
+/**
+ * Accumulated counters of a region.
+ */
+typedef struct
+{
+  char name[PERF_NAME_LEN];         // region name, truncated
+  uint32_t calls;                   // number of begin/end pairs
+  uint8_t depth;                    // nesting depth of the first call
+  uint8_t parent;                   // index of the enclosing region, 0xFF if none
+  uint8_t reserved[2];
+  uint64_t count[PERF_NUM_SLOTS];   // cycles, instructions, then one per event
+} perf_region_t;
+
+/**
+ * Header of the binary export, followed by `num_regions` perf_region_t.
+ */
+typedef struct
+{
+  uint32_t magic;                           // PERF_EXPORT_MAGIC
+  uint8_t version;                          // PERF_EXPORT_VERSION
+  uint8_t num_slots;                        // PERF_NUM_SLOTS
+  uint8_t num_hpm;                          // mhpmcounters actually in use
+  uint8_t num_regions;
+  uint8_t event[PERF_MAX_HPM_COUNTERS];     // event of each mhpmcounter
+} perf_export_header_t;
+
+#define PERF_EXPORT_MAGIC   0x46524550  // "PERF"
+#define PERF_EXPORT_VERSION 1
+
+/**
+ * Detect the available mhpmcounters, assign them the default events
+ * (load stalls, jump stalls, instruction misses, taken branches), enable all
+ * the counters and clear the regions.
+ * @return number of mhpmcounters in use.
+ */
+uint32_t perf_init(void);
+
+/**
+ * Assign events to the mhpmcounters, in order. Events beyond the number of
+ * available counters are ignored. The regions are cleared.
+ * @param events events to count.
+ * @param n number of events.
+ * @return number of events actually counted.
+ */
+uint32_t perf_config(const perf_event_t *events, uint32_t n);
+
+/**
+ * Clear the statistics of all the regions.
+ */
+void perf_reset(void);
+
+/**
+ * Start a region. The counters are sampled as the last operation.
+ * @param name region name (compared as string).
+ */
+perf_result_t perf_region_begin(const char *name);
+
+/**
+ * End the innermost region. The counters are sampled as the first operation.
+ * @param name region name, must match the one of the innermost begin.
+ */
+perf_result_t perf_region_end(const char *name);
+
+/**
+ * Get a region by name.
+ * @return pointer to the region or NULL if not found.
+ */
+const perf_region_t *perf_get_region(const char *name);
+
+/**
+ * Get a counter of a region by name.
+ * @param name region name.
+ * @param slot 0 for the cycles, 1 for the instructions, then one per event.
+ * @return the accumulated count, 0 if the region or the slot does not exist.
+ */
+uint64_t perf_get_count(const char *name, uint32_t slot);
+
+/**
+ * Print, for each region, the number of calls, cycles, instructions, IPC and
+ * the counted events (stalls also as percentage of the cycles).
+ */
+void perf_print_summary(void);
+
+/**
+ * Export the regions in binary form (perf_export_header_t followed by the
+ * perf_region_t entries).
+ * @param buf destination buffer.
+ * @param size size of buf in bytes.
+ * @param written number of bytes written.
+ */
+perf_result_t perf_export(void *buf, uint32_t size, uint32_t *written);
+
+#ifndef PERF_SDK_DISABLE
+#define PERF_REGION_BEGIN(name) perf_region_begin(name)
+#define PERF_REGION_END(name)   perf_region_end(name)
+#else
+#define PERF_REGION_BEGIN(name)
+#define PERF_REGION_END(name)
+#endif
+
+/**
+ * Print the summary where the examples print by default: on FPGA, and in
+ * simulation only if PERF_PRINT_IN_SIM is set to 1.
+ */
+#ifndef PERF_PRINT_IN_FPGA
+#define PERF_PRINT_IN_FPGA 1
+#endif
+#ifndef PERF_PRINT_IN_SIM
+#define PERF_PRINT_IN_SIM 0
+#endif
+
+#if !defined(PERF_SDK_DISABLE) && ((TARGET_SIM && PERF_PRINT_IN_SIM) || (PERF_PRINT_IN_FPGA && !TARGET_SIM))
+#define PERF_PRINT_SUMMARY() perf_print_summary()
+#else
+#define PERF_PRINT_SUMMARY()
+#endif
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
+#endif  // PERF_SDK_H_
@@ -38,6 +38,13 @@
 #include "soc_ctrl_structs.h"
 #include "bitfield.h"
 #include "csr.h"
+#include "dma.h"
+#include "rv_timer.h"
+#include "rv_timer_regs.h"
+#include "fast_intr_ctrl.h"
+#include "fast_intr_ctrl_structs.h"
+#include "hart.h"
+#include "core_v_mini_mcu.h"
 
 /****************************************************************************/
 /**                                                                        **/
@@ -66,6 +73,11 @@
 #define SPD_INDEX    2
 
 #define TRIGGERING_EVENTS (SPI_EVENT_IDLE | SPI_EVENT_READY | SPI_EVENT_TXWM | SPI_EVENT_RXWM)
+#define DMA_TRIGGERING_EVENTS (SPI_EVENT_IDLE | SPI_EVENT_READY)
+
+// Bits of spi_dma_t.running
+#define SPI_DMA_TX 0x1
+#define SPI_DMA_RX 0x2
 
 // The standard watermark for all transactions (seems reasonable)
 #define TXWM_DEFAULT (SPI_HOST_PARAM_TX_DEPTH / 4)  // Arbirarily chosen
@@ -73,6 +85,19 @@
 
 #define NULL_CALLBACKS (spi_callbacks_t) {NULL, NULL, NULL, NULL}
 
+// Hart of the always-on timer whose alarm ends the blocking transactions that
+// time out. Its fast interrupt only wakes up the core and is never taken.
+// The hart may be used by the application too, hence it is given back as found.
+#define SPI_TIMER_HART     1
+#define SPI_TIMER_MIE_MASK (1 << (16 + kTimer_1_fic_e))
+#define SPI_TIMER_FIC_MASK (1 << kTimer_1_fic_e)
+// Registers of that hart the driver has no getter or setter for
+#define SPI_TIMER_CFG_REG     RV_TIMER_CFG1_REG_OFFSET
+#define SPI_TIMER_CMP_LO_REG  RV_TIMER_COMPARE_LOWER1_0_REG_OFFSET
+#define SPI_TIMER_CMP_HI_REG  RV_TIMER_COMPARE_UPPER1_0_REG_OFFSET
+#define SPI_TIMER_V_LO_REG    RV_TIMER_TIMER_V_LOWER1_REG_OFFSET
+#define SPI_TIMER_V_HI_REG    RV_TIMER_TIMER_V_UPPER1_REG_OFFSET
+
 // SPI peripheral busy checks
 #define SPI_BUSY(peri)     (peri.state == SPI_STATE_BUSY)
 #define SPI_NOT_BUSY(peri) (peri.state != SPI_STATE_BUSY)
@@ -144,8 +169,29 @@ typedef struct {
     uint32_t             txlen;     // Size of TX array/buffer
     uint32_t*            rxbuffer;  // Pointer to array/buffer for RX data
     uint32_t             rxlen;     // Size of RX array/buffer
+    const uint32_t*      commands;  // Encoded segments of a program (or NULL)
+    const uint32_t*      words;     // TX words sent before txbuffer (program)
+    uint8_t              wordlen;   // Number of TX words sent before txbuffer
 } spi_transaction_t;
 
+/**
+ * @brief DMA transfers moving the data of a transaction between the buffers and
+ *  the FIFOs. They must outlive the call that launches them, hence they are kept
+ *  in the spi_peripheral_t. The DMA cannot be stopped, so the transfers of an
+ *  aborted transaction run until they end: they are not overwritten before,
+ *  and their seq tells their completion apart from the current transaction's.
+ */
+typedef struct {
+    dma_target_t mem_tx;   // TX buffer
+    dma_target_t fifo_tx;  // TX FIFO
+    dma_target_t fifo_rx;  // RX FIFO
+    dma_target_t mem_rx;   // RX buffer
+    dma_trans_t  tx;       // TX buffer to TX FIFO
+    dma_trans_t  rx;       // RX FIFO to RX buffer
+    uint32_t     seq;      // Sequence number of the transaction of the transfers
+    uint8_t      running;  // Transfers still holding their channel (SPI_DMA_TX/RX)
+} spi_dma_t;
+
 /**
  * @brief Structure to hold all relative information about a particular peripheral.
  *  peripherals variable in this file holds an instance of this structure for every
@@ -164,6 +210,12 @@ typedef struct {
     uint32_t          txcnt;     // Counter to track TX word being processed
     uint32_t          rxcnt;     // Counter to track RX word being processed
     spi_callbacks_t   callbacks; // Callback functions to call
+    uint8_t           dma_tx_slot; // DMA trigger slot of the TX fifo (0 if none)
+    uint8_t           dma_rx_slot; // DMA trigger slot of the RX fifo (0 if none)
+    spi_dma_t         dma;       // DMA transfers of the current transaction
+    uint8_t           dma_pending; // Number of DMA transfers not finished yet
+    uint32_t          dma_seq;   // Sequence number of the current transaction
+    bool              spi_done;  // SPI is idle but waits for the DMA to finish
 } spi_peripheral_t;
 
 /****************************************************************************/
@@ -227,6 +279,26 @@ uint32_t spi_true_slave_freq(uint32_t freq);
 bool spi_validate_segments(const spi_segment_t* segments, uint32_t segments_len, 
                            uint32_t* tx_count, uint32_t* rx_count);
 
+/**
+ * @brief Counts the number of words for TX and RX buffers of a program from its
+ *  encoded segments.
+ * 
+ * @param program Pointer to the program whose counters are updated
+ */
+void spi_program_count(spi_program_t* program);
+
+/**
+ * @brief Creates the transaction that runs a program.
+ * 
+ * @param program Pointer to the program
+ * @param src_buffer TX data that follows the words stored in the program
+ * @param dest_buffer Buffer for RX data
+ * @param txn Variable to store the transaction
+ * @return SPI_CODE_TXN_LEN_INVAL if TX data is missing, SPI_CODE_OK otherwise
+ */
+spi_codes_e spi_program_txn(const spi_program_t* program, const uint32_t* src_buffer, 
+                            uint32_t* dest_buffer, spi_transaction_t* txn);
+
 /**
  * @brief Fills the TX FIFO until no more space or no more data.
  * 
@@ -258,9 +330,28 @@ void spi_launch(spi_peripheral_t* peri, spi_t* spi, spi_transaction_t txn,
                 spi_callbacks_t callbacks);
 
 /**
- * @brief Issues a command segment and increments counter (post inc.).
- *  Determines value of CSAAT bit based on if it is last segment of transaction 
- *  or not.
+ * @brief Acquires DMA channels and queues the transfers moving the data of the
+ *  current transaction between its buffers and the FIFOs.
+ * 
+ * @param peri Pointer to the relevant spi_peripheral_t instance
+ * @return true if the DMA moves the data
+ * @return false if the CPU has to (no free channel, no trigger slot or no data)
+ */
+bool spi_launch_dma(spi_peripheral_t* peri);
+
+/**
+ * @brief Called by the DMA when a transfer of the current transaction is over.
+ * 
+ * @param trans The DMA transfer that is over
+ * @param arg Pointer to the relevant spi_peripheral_t instance
+ */
+void spi_dma_done(dma_trans_t* trans, void* arg);
+
+/**
+ * @brief Sleeps until the transaction of the peripheral is over, or until the
+ *  alarm of the always-on timer signals its timeout, in which case the 
+ *  peripheral is reset and its state set to SPI_STATE_TIMEOUT. The timer hart
+ *  and its fast interrupt are restored as they were before the wait.
  * 
  * @param peri Pointer to the relevant spi_peripheral_t instance
  */
@@ -275,6 +366,14 @@ void spi_wait_transaction_done(spi_peripheral_t* peri);
  */
 void spi_issue_next_seg(spi_peripheral_t* peri);
 
+/**
+ * @brief Issues command segments as long as the command queue accepts them, so
+ *  that the next segments are already queued when the current one ends.
+ * 
+ * @param peri Pointer to the relevant spi_peripheral_t instance
+ */
+void spi_issue_segments(spi_peripheral_t* peri);
+
 /**
  * @brief Resets the entire peripheral, hardware included
  * 
@@ -290,6 +389,14 @@ void spi_reset_peri(spi_peripheral_t* peri);
  */
 void spi_reset_transaction(spi_peripheral_t* peri);
 
+/**
+ * @brief Ends the current transaction successfully: reads the last data, sets
+ *  the state, calls the done callback and resets the transaction variables.
+ * 
+ * @param peri Pointer to the relevant spi_peripheral_t instance
+ */
+void spi_end_transaction(spi_peripheral_t* peri);
+
 /**
  * @brief Function that gets called on each Event Interrupt. Handles all the logic
  *  of a transacton since all transactions use the interrupt.
@@ -343,7 +450,9 @@ static volatile spi_peripheral_t peripherals[] = {
         .scnt      = 0,
         .txcnt     = 0,
         .rxcnt     = 0,
-        .callbacks = {0}
+        .callbacks = {0},
+        .dma_tx_slot = DMA_TRIG_SLOT_SPI_FLASH_TX,
+        .dma_rx_slot = DMA_TRIG_SLOT_SPI_FLASH_RX
     },
     (spi_peripheral_t) {
         .instance  = spi_host1,
@@ -356,7 +465,9 @@ static volatile spi_peripheral_t peripherals[] = {
         .scnt      = 0,
         .txcnt     = 0,
         .rxcnt     = 0,
-        .callbacks = {0}
+        .callbacks = {0},
+        .dma_tx_slot = DMA_TRIG_SLOT_SPI_TX,
+        .dma_rx_slot = DMA_TRIG_SLOT_SPI_RX
     },
     (spi_peripheral_t) {
         .instance  = spi_host2,
@@ -369,10 +480,20 @@ static volatile spi_peripheral_t peripherals[] = {
         .scnt      = 0,
         .txcnt     = 0,
         .rxcnt     = 0,
-        .callbacks = {0}
+        .callbacks = {0},
+        .dma_tx_slot = 0,
+        .dma_rx_slot = 0
     }
 };
 
+/**
+ * @brief Always-on timer, only its hart SPI_TIMER_HART is used.
+ */
+static rv_timer_t spi_timer = {
+    .base_addr = { .base = (void*) RV_TIMER_AO_START_ADDRESS },
+    .config    = { .hart_count = RV_TIMER_PARAM_N_HARTS, .comparator_count = RV_TIMER_PARAM_N_TIMERS }
+};
+
 /****************************************************************************/
 /**                                                                        **/
 /**                          EXPORTED FUNCTIONS                            **/
@@ -393,7 +514,8 @@ spi_t spi_init(spi_idx_e idx, spi_slave_t slave)
             .idx   = UINT32_MAX,
             .id    = 0,
             .init  = false,
-            .slave = (spi_slave_t) {0}
+            .slave = (spi_slave_t) {0},
+            .dma   = false
         };
     // Enable SPI peripheral. We do not check return value since we know here that
     // it will never return an error.
@@ -415,7 +537,8 @@ spi_t spi_init(spi_idx_e idx, spi_slave_t slave)
         .idx   = idx,
         .id    = ++global_id, // Pre-increment because id 0 defined as invalid
         .init  = true,
-        .slave = slave
+        .slave = slave,
+        .dma   = false
     };
 }
 
@@ -426,6 +549,7 @@ void spi_deinit(spi_t* spi)
     spi->id    = 0;
     spi->init  = false;
     spi->slave = (spi_slave_t) {0};
+    spi->dma   = false;
 }
 
 spi_codes_e spi_reset(spi_t* spi) 
@@ -488,6 +612,18 @@ spi_codes_e spi_get_rxwm(spi_t* spi, uint8_t* watermark)
     return SPI_CODE_OK;
 }
 
+spi_codes_e spi_set_dma(spi_t* spi, bool enable)
+{
+    spi_codes_e error = spi_check_valid(spi);
+    if (error) return error;
+    // SPI HOST2 has no DMA trigger slots
+    if (enable && peripherals[spi->idx].dma_tx_slot == 0) return SPI_CODE_DMA_INVAL;
+
+    spi->dma = enable;
+
+    return SPI_CODE_OK;
+}
+
 spi_codes_e spi_set_timeout(spi_t* spi, uint32_t timeout)
 {
     spi_codes_e error = spi_check_valid(spi);
@@ -552,7 +688,6 @@ spi_codes_e spi_transmit(spi_t* spi, const uint32_t* src_buffer, uint32_t len)
     spi_launch(&peripherals[spi->idx], spi, txn, NULL_CALLBACKS);
 
     spi_wait_transaction_done(&peripherals[spi->idx]);
-    // while (SPI_BUSY(peripherals[spi->idx])) wait_for_interrupt();
 
     return SPI_CODE_OK;
 }
@@ -575,7 +710,6 @@ spi_codes_e spi_receive(spi_t* spi, uint32_t* dest_buffer, uint32_t len)
     spi_launch(&peripherals[spi->idx], spi, txn, NULL_CALLBACKS);
 
     spi_wait_transaction_done(&peripherals[spi->idx]);
-    // while (SPI_BUSY(peripherals[spi->idx])) wait_for_interrupt();
 
     return SPI_CODE_OK;
 }
@@ -599,7 +733,6 @@ spi_codes_e spi_transceive(spi_t* spi, const uint32_t* src_buffer,
     spi_launch(&peripherals[spi->idx], spi, txn, NULL_CALLBACKS);
 
     spi_wait_transaction_done(&peripherals[spi->idx]);
-    // while (SPI_BUSY(peripherals[spi->idx])) wait_for_interrupt();
 
     return SPI_CODE_OK;
 }
@@ -626,7 +759,6 @@ spi_codes_e spi_execute(spi_t* spi, const spi_segment_t* segments,
     spi_launch(&peripherals[spi->idx], spi, txn, NULL_CALLBACKS);
 
     spi_wait_transaction_done(&peripherals[spi->idx]);
-    // while (SPI_BUSY(peripherals[spi->idx])) wait_for_interrupt();
 
     return SPI_CODE_OK;
 }
@@ -719,6 +851,123 @@ spi_codes_e spi_execute_nb(spi_t* spi, const spi_segment_t* segments,
     return SPI_CODE_OK;
 }
 
+spi_codes_e spi_program_build(spi_program_t* program, const spi_segment_t* segments, 
+                              uint32_t segments_len, const uint32_t* words, 
+                              uint32_t words_len)
+{
+    uint32_t tx_count, rx_count;
+
+    if (segments_len > SPI_PROGRAM_MAX_SEGMENTS) return SPI_CODE_SEGMENT_INVAL;
+    // Same checks as for spi_execute, done once for all the runs
+    if (!spi_validate_segments(segments, segments_len, &tx_count, &rx_count)) 
+        return SPI_CODE_SEGMENT_INVAL;
+    if (words_len > SPI_PROGRAM_MAX_WORDS || words_len > tx_count) 
+        return SPI_CODE_TXN_LEN_INVAL;
+
+    for (int i = 0; i < segments_len; i++)
+    {
+        if (SPI_INVALID_LEN(segments[i].len)) return SPI_CODE_TXN_LEN_INVAL;
+        program->commands[i] = spi_create_command((spi_command_t) {
+            .len       = segments[i].len - 1, // -1 because of SPI Host IP specifications
+            .csaat     = i != segments_len - 1,
+            .speed     = bitfield_read(segments[i].mode, DIR_SPD_MASK, SPD_INDEX),
+            .direction = bitfield_read(segments[i].mode, DIR_SPD_MASK, DIR_INDEX),
+        });
+    }
+    for (int i = 0; i < words_len; i++) program->words[i] = words[i];
+
+    program->seglen  = segments_len;
+    program->wordlen = words_len;
+    program->txlen   = tx_count;
+    program->rxlen   = rx_count;
+
+    return SPI_CODE_OK;
+}
+
+spi_codes_e spi_program_set_word(spi_program_t* program, uint32_t index, uint32_t word)
+{
+    if (index >= program->wordlen) return SPI_CODE_TXN_LEN_INVAL;
+
+    program->words[index] = word;
+
+    return SPI_CODE_OK;
+}
+
+spi_codes_e spi_program_set_len(spi_program_t* program, uint32_t segment, uint32_t len)
+{
+    if (segment >= program->seglen) return SPI_CODE_SEGMENT_INVAL;
+    if (SPI_INVALID_LEN(len))       return SPI_CODE_TXN_LEN_INVAL;
+
+    // The stored words must stay in the segments they were built for
+    uint8_t direction = bitfield_read(program->commands[segment], SPI_HOST_COMMAND_DIRECTION_MASK, 
+                                      SPI_HOST_COMMAND_DIRECTION_OFFSET);
+    if (direction == SPI_DIR_TX_ONLY || direction == SPI_DIR_BIDIR)
+    {
+        spi_program_t head = *program;
+        head.seglen = segment;
+        spi_program_count(&head);
+        if (head.txlen < program->wordlen) return SPI_CODE_SEGMENT_INVAL;
+    }
+
+    // Only the length field changes, the segment was already validated
+    program->commands[segment] = bitfield_write(program->commands[segment], 
+                                                SPI_HOST_COMMAND_LEN_MASK, 
+                                                SPI_HOST_COMMAND_LEN_OFFSET, len - 1);
+    spi_program_count(program);
+
+    return SPI_CODE_OK;
+}
+
+spi_codes_e spi_program_run(spi_t* spi, const spi_program_t* program, 
+                            const uint32_t* src_buffer, uint32_t* dest_buffer)
+{
+    // Make validity checks and set the slave at hardware level
+    spi_codes_e error = spi_prepare_transfer(spi);
+    if (error) return error;
+
+    spi_transaction_t txn;
+    error = spi_program_txn(program, src_buffer, dest_buffer, &txn);
+    if (error) return error;
+
+    // The program was validated when built. No callbacks since function is blocking.
+    spi_launch(&peripherals[spi->idx], spi, txn, NULL_CALLBACKS);
+
+    spi_wait_transaction_done(&peripherals[spi->idx]);
+
+    return SPI_CODE_OK;
+}
+
+spi_codes_e spi_program_run_nb(spi_t* spi, const spi_program_t* program, 
+                               const uint32_t* src_buffer, uint32_t* dest_buffer,
+                               spi_callbacks_t callbacks)
+{
+    // Make validity checks and set the slave at hardware level
+    spi_codes_e error = spi_prepare_transfer(spi);
+    if (error) return error;
+
+    spi_transaction_t txn;
+    error = spi_program_txn(program, src_buffer, dest_buffer, &txn);
+    if (error) return error;
+
+    // The program was validated when built. Here user callbacks are used because 
+    // non-blocking function.
+    spi_launch(&peripherals[spi->idx], spi, txn, callbacks);
+
+    return SPI_CODE_OK;
+}
+
+void spi_program_issue(spi_host_t* host, const spi_program_t* program)
+{
+    // The caller made room in the TX FIFO, no need to check its depth
+    for (int i = 0; i < program->wordlen; i++) SPI_HW(host)->TXDATA = program->words[i];
+    // The segments are already valid, only wait for room in the command queue
+    for (int i = 0; i < program->seglen; i++)
+    {
+        while (spi_get_ready(host) != SPI_TRISTATE_TRUE);
+        SPI_HW(host)->COMMAND = program->commands[i];
+    }
+}
+
 /****************************************************************************/
 /**                                                                        **/
 /*                            LOCAL FUNCTIONS                               */
@@ -850,16 +1099,60 @@ bool spi_validate_segments(const spi_segment_t* segments, uint32_t segments_len,
     return true;
 }
 
+void spi_program_count(spi_program_t* program) 
+{
+    program->txlen = 0;
+    program->rxlen = 0;
+
+    for (int i = 0; i < program->seglen; i++)
+    {
+        uint8_t direction = bitfield_read(program->commands[i], SPI_HOST_COMMAND_DIRECTION_MASK, 
+                                          SPI_HOST_COMMAND_DIRECTION_OFFSET);
+        uint32_t len      = bitfield_read(program->commands[i], SPI_HOST_COMMAND_LEN_MASK, 
+                                          SPI_HOST_COMMAND_LEN_OFFSET) + 1;
+        // Same counting as spi_validate_segments
+        if (direction == SPI_DIR_TX_ONLY || direction == SPI_DIR_BIDIR) 
+            program->txlen += LEN_WORDS(len);
+        if (direction == SPI_DIR_RX_ONLY || direction == SPI_DIR_BIDIR) 
+            program->rxlen += LEN_WORDS(len);
+    }
+}
+
+spi_codes_e spi_program_txn(const spi_program_t* program, const uint32_t* src_buffer, 
+                            uint32_t* dest_buffer, spi_transaction_t* txn) 
+{
+    // Without src_buffer only the stored words can be sent
+    if (src_buffer == NULL && program->txlen > program->wordlen) 
+        return SPI_CODE_TXN_LEN_INVAL;
+
+    *txn = (spi_transaction_t) {
+        .segments = NULL,
+        .seglen   = program->seglen,
+        .txbuffer = src_buffer,
+        .txlen    = program->txlen,
+        .rxbuffer = dest_buffer,
+        .rxlen    = program->rxlen,
+        .commands = program->commands,
+        .words    = program->words,
+        .wordlen  = program->wordlen
+    };
+
+    return SPI_CODE_OK;
+}
+
 bool spi_fill_tx(spi_peripheral_t* peri) 
 {
     // If we have a TX buffer and didn't exceed the count then fill the TX FIFO
-    if (peri->txn.txbuffer != NULL && peri->txcnt < peri->txn.txlen) {
+    if ((peri->txn.txbuffer != NULL || peri->txn.wordlen != 0) 
+        && peri->txcnt < peri->txn.txlen) {
         // While there is still data to be fed and there wasn't an error from HAL
         // continue. HAL error in this case means that the fifo is full since
-        // it's the only possibility.
+        // it's the only possibility. The words of a program come first.
         while (
             peri->txcnt < peri->txn.txlen 
-            && !spi_write_word(peri->instance, peri->txn.txbuffer[peri->txcnt])
+            && !spi_write_word(peri->instance, peri->txcnt < peri->txn.wordlen 
+                               ? peri->txn.words[peri->txcnt] 
+                               : peri->txn.txbuffer[peri->txcnt - peri->txn.wordlen])
         ) peri->txcnt++; // Keep track of counter
         return true;
     }
@@ -894,53 +1187,244 @@ void spi_launch(spi_peripheral_t* peri, spi_t* spi, spi_transaction_t txn,
     // Indicate the callbacks that should be called
     peri->callbacks = callbacks;
 
-    // Fill the TX fifo before starting so there is data once command launched
-    spi_fill_tx(peri);
+    // Either let the DMA move the data (the words stored in a program cannot),
+    // or fill the TX fifo before starting so there is data once command launched
+    bool dma = spi->dma && txn.wordlen == 0 && spi_launch_dma(peri);
+    if (!dma) spi_fill_tx(peri);
+
+    // The event handler also issues segments, it must not run while we do
+    uint32_t mstatus;
+    CSR_READ(CSR_REG_MSTATUS, &mstatus);
+    CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
 
-    // Enable event interrupts since they are enabled only during a transaction
-    spi_set_events_enabled(peri->instance, TRIGGERING_EVENTS, true);
+    // Enable event interrupts since they are enabled only during a transaction.
+    // The watermarks are of no use when the DMA moves the data.
+    spi_set_events_enabled(peri->instance, dma ? DMA_TRIGGERING_EVENTS : TRIGGERING_EVENTS, true);
     spi_enable_evt_intr   (peri->instance, true);
 
     // Wait for the SPI peripheral to be ready before writing a command segment.
     spi_wait_for_ready(peri->instance);
-    // Write command segment. This immediately triggers the SPI peripheral into action.
-    spi_issue_next_seg(peri);
+    // Write command segments. This immediately triggers the SPI peripheral into action.
+    spi_issue_segments(peri);
+
+    CSR_WRITE(CSR_REG_MSTATUS, mstatus);
+}
+
+bool spi_launch_dma(spi_peripheral_t* peri) 
+{
+    bool tx = peri->txn.txbuffer != NULL && peri->txn.txlen > 0;
+    bool rx = peri->txn.rxbuffer != NULL && peri->txn.rxlen > 0;
+    uint8_t tx_ch = 0;
+    uint8_t rx_ch = 0;
+
+    if (peri->dma_tx_slot == 0 || (!tx && !rx)) return false;
+    // The transfers of an aborted transaction are still running
+    if (peri->dma.running) return false;
+    // One channel per direction, otherwise the CPU moves all the data
+    if (tx && dma_channel_acquire(DMA_CH_PRIO_NORMAL, 0, &tx_ch) != DMA_CONFIG_OK) return false;
+    if (rx && dma_channel_acquire(DMA_CH_PRIO_NORMAL, 0, &rx_ch) != DMA_CONFIG_OK)
+    {
+        if (tx) dma_channel_release(tx_ch);
+        return false;
+    }
+
+    if (tx)
+    {
+        peri->dma.mem_tx  = (dma_target_t) {
+            .ptr       = (uint8_t*) peri->txn.txbuffer,
+            .inc_d1_du = 1, // Increment by 1 data unit (word)
+            .type      = DMA_DATA_TYPE_WORD,
+            .trig      = DMA_TRIG_MEMORY,
+        };
+        peri->dma.fifo_tx = (dma_target_t) {
+            .ptr       = (uint8_t*) peri->instance + SPI_HOST_TXDATA_REG_OFFSET,
+            .inc_d1_du = 0, // Target is peripheral, no increment
+            .type      = DMA_DATA_TYPE_WORD,
+            .trig      = peri->dma_tx_slot,
+        };
+        peri->dma.tx = (dma_trans_t) {
+            .src        = &peri->dma.mem_tx,
+            .dst        = &peri->dma.fifo_tx,
+            .size_d1_du = peri->txn.txlen,
+            .mode       = DMA_TRANS_MODE_SINGLE,
+            .end        = DMA_TRANS_END_INTR,
+            .channel    = tx_ch,
+        };
+    }
+    if (rx)
+    {
+        peri->dma.fifo_rx = (dma_target_t) {
+            .ptr       = (uint8_t*) peri->instance + SPI_HOST_RXDATA_REG_OFFSET,
+            .inc_d1_du = 0, // Target is peripheral, no increment
+            .type      = DMA_DATA_TYPE_WORD,
+            .trig      = peri->dma_rx_slot,
+        };
+        peri->dma.mem_rx  = (dma_target_t) {
+            .ptr       = (uint8_t*) peri->txn.rxbuffer,
+            .inc_d1_du = 1, // Increment by 1 data unit (word)
+            .type      = DMA_DATA_TYPE_WORD,
+            .trig      = DMA_TRIG_MEMORY,
+        };
+        peri->dma.rx = (dma_trans_t) {
+            .src        = &peri->dma.fifo_rx,
+            .dst        = &peri->dma.mem_rx,
+            .size_d1_du = peri->txn.rxlen,
+            .mode       = DMA_TRANS_MODE_SINGLE,
+            .end        = DMA_TRANS_END_INTR,
+            .channel    = rx_ch,
+        };
+    }
+
+    // Nothing is queued before both transfers are known to be valid
+    if ((tx && dma_validate_transaction(&peri->dma.tx, DMA_ENABLE_REALIGN, 
+                                        DMA_PERFORM_CHECKS_INTEGRITY) != DMA_CONFIG_OK)
+        || (rx && dma_validate_transaction(&peri->dma.rx, DMA_ENABLE_REALIGN, 
+                                           DMA_PERFORM_CHECKS_INTEGRITY) != DMA_CONFIG_OK))
+    {
+        if (tx) dma_channel_release(tx_ch);
+        if (rx) dma_channel_release(rx_ch);
+        return false;
+    }
+
+    peri->dma.seq     = peri->dma_seq;
+    peri->dma.running = (tx ? SPI_DMA_TX : 0) | (rx ? SPI_DMA_RX : 0);
+    peri->dma_pending = tx + rx;
+    peri->spi_done    = false;
+    // The channels are ours, so their queues are empty and accept the transfers
+    if (rx) dma_queue_push(&peri->dma.rx, spi_dma_done, peri);
+    if (tx) dma_queue_push(&peri->dma.tx, spi_dma_done, peri);
+    return true;
+}
+
+void spi_dma_done(dma_trans_t* trans, void* arg) 
+{
+    spi_peripheral_t* peri = (spi_peripheral_t*) arg;
+
+    // The transfer was not overwritten while running, its channel is the right one
+    dma_channel_release(trans->channel);
+    peri->dma.running &= trans == &peri->dma.tx ? ~SPI_DMA_TX : ~SPI_DMA_RX;
+    // Transfer of a transaction that was aborted (error or timeout)
+    if (peri->dma.seq != peri->dma_seq || peri->dma_pending == 0) return;
+
+    if (trans == &peri->dma.tx) peri->txcnt = peri->txn.txlen;
+    else                        peri->rxcnt = peri->txn.rxlen;
+    peri->dma_pending--;
+    // The SPI was already idle, waiting for this last transfer
+    if (peri->dma_pending == 0 && peri->spi_done) spi_end_transaction(peri);
 }
 
 void spi_wait_transaction_done(spi_peripheral_t* peri) 
 {
     // Convert ms timeout to clock ticks
     uint64_t timeout_ticks = ((uint64_t) peri->timeout) * (SYS_FREQ / 1000);
-    uint32_t start[2];
-    uint32_t end[2];
+    uint64_t deadline;
+    uint64_t now;
+    bool     timeout = false;
+    uint32_t mstatus;
+    uint32_t mie;
+
+    // Interrupts are only taken between two sleeps, otherwise the end of the
+    // transaction could slip in between the busy check and the wfi
+    CSR_READ(CSR_REG_MSTATUS, &mstatus);
+    CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+    CSR_READ(CSR_REG_MIE, &mie);
+
+    // Save the state of the timer hart, which the application may be using
+    mmio_region_t base     = spi_timer.base_addr;
+    uint32_t      cfg      = mmio_region_read32(base, SPI_TIMER_CFG_REG);
+    uint64_t      compare  = ((uint64_t) mmio_region_read32(base, SPI_TIMER_CMP_HI_REG) << 32)
+                             | mmio_region_read32(base, SPI_TIMER_CMP_LO_REG);
+    uint32_t      step     = bitfield_field32_read(cfg, RV_TIMER_CFG1_STEP_FIELD);
+    uint32_t      prescale = bitfield_field32_read(cfg, RV_TIMER_CFG1_PRESCALE_FIELD);
+    bool          counting = step != 0
+                             && mmio_region_get_bit32(base, RV_TIMER_CTRL_REG_OFFSET, SPI_TIMER_HART);
+    bool          fic_en   = fast_intr_ctrl_peri->FAST_INTR_ENABLE & SPI_TIMER_FIC_MASK;
+    bool          pending;
+    uint32_t      timer_irq;
+    uint64_t      start;
+
+    rv_timer_irq_get(&spi_timer, SPI_TIMER_HART, 0, &pending);
+    rv_timer_irq_disable(&spi_timer, SPI_TIMER_HART, &timer_irq);
+    rv_timer_counter_read(&spi_timer, SPI_TIMER_HART, &start);
+    if (counting)
+    {
+        // Keep the pace of the counter, the timeout is converted to its ticks
+        timeout_ticks = (timeout_ticks * step + prescale) / (prescale + 1);
+    }
+    else
+    {
+        // The counter is free, make it count clock ticks during the wait
+        rv_timer_set_tick_params(&spi_timer, SPI_TIMER_HART, 
+                                 (rv_timer_tick_params_t) { .prescale = 0, .tick_step = 1 });
+        rv_timer_counter_set_enabled(&spi_timer, SPI_TIMER_HART, kRvTimerEnabled);
+    }
 
-    // Enable tick counter
-    CSR_CLEAR_BITS(CSR_REG_MCOUNTINHIBIT, 0x1);
-    // Record start tick counter value
-    CSR_READ(CSR_REG_MCYCLE,  &start[0]);
-    CSR_READ(CSR_REG_MCYCLEH, &start[1]);
+    // Arm the alarm
+    rv_timer_counter_read(&spi_timer, SPI_TIMER_HART, &now);
+    deadline = now + timeout_ticks;
+    rv_timer_arm(&spi_timer, SPI_TIMER_HART, 0, deadline);
+    rv_timer_irq_enable(&spi_timer, SPI_TIMER_HART, 0, kRvTimerEnabled);
+    enable_fast_interrupt(kTimer_1_fic_e, true);
 
-    // Wait until transaction has finished or timed-out
-    do
+    // Sleep until the transaction has finished or timed-out
+    while (SPI_BUSY((*peri)))
     {
-        // Read tick counter value
-        CSR_READ(CSR_REG_MCYCLE,  &end[0]);
-        CSR_READ(CSR_REG_MCYCLEH, &end[1]);
-        // If ticks elapsed exceed timeout ticks, cancel transaction and return
-        if (*((uint64_t*)end) - *((uint64_t*)start) > timeout_ticks)
+        // Woken up by the SPI events, the DMA or the alarm. The alarm is masked
+        // again before interrupts are taken, so that its handler never runs.
+        CSR_SET_BITS(CSR_REG_MIE, SPI_TIMER_MIE_MASK);
+        wait_for_interrupt();
+        CSR_CLEAR_BITS(CSR_REG_MIE, SPI_TIMER_MIE_MASK);
+
+        rv_timer_counter_read(&spi_timer, SPI_TIMER_HART, &now);
+        if (now >= deadline)
         {
-            // Fully reset spi peripheral to cancel transaction, empty fifos, etc.
-            spi_reset_peri(peri);
-            // Indicate to user the transaction has timed-out
-            peri->state = SPI_STATE_TIMEOUT;
+            timeout = true;
             break;
         }
-        
-    } while (SPI_BUSY((*peri)));
+        // Let the pending interrupts be handled, if the caller allowed them
+        CSR_WRITE(CSR_REG_MSTATUS, mstatus);
+        CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+    }
+
+    // Give the timer hart back as it was. An alarm of the application that was
+    // already pending is kept, otherwise the one of the wait is cleared.
+    rv_timer_arm(&spi_timer, SPI_TIMER_HART, 0, compare);
+    if (!counting)
+    {
+        rv_timer_counter_set_enabled(&spi_timer, SPI_TIMER_HART, kRvTimerDisabled);
+        mmio_region_write32(base, SPI_TIMER_V_LO_REG, (uint32_t) start);
+        mmio_region_write32(base, SPI_TIMER_V_HI_REG, (uint32_t) (start >> 32));
+        mmio_region_write32(base, SPI_TIMER_CFG_REG, cfg);
+    }
+    if (!pending)
+    {
+        rv_timer_irq_clear(&spi_timer, SPI_TIMER_HART, 0);
+        clear_fast_interrupt(kTimer_1_fic_e);
+    }
+    rv_timer_irq_restore(&spi_timer, SPI_TIMER_HART, timer_irq);
+    enable_fast_interrupt(kTimer_1_fic_e, fic_en);
+    CSR_WRITE(CSR_REG_MIE, mie);
+
+    // The transaction may have ended right at the deadline
+    if (timeout && SPI_BUSY((*peri)))
+    {
+        // Fully reset spi peripheral to cancel transaction, empty fifos, etc.
+        spi_reset_peri(peri);
+        // Indicate to user the transaction has timed-out
+        peri->state = SPI_STATE_TIMEOUT;
+    }
+    CSR_WRITE(CSR_REG_MSTATUS, mstatus);
 }
 
 void spi_issue_next_seg(spi_peripheral_t* peri) 
 {
+    // Segments of a program are already encoded
+    if (peri->txn.commands != NULL)
+    {
+        SPI_HW(peri->instance)->COMMAND = peri->txn.commands[peri->scnt];
+        peri->scnt++;
+        return;
+    }
     const spi_segment_t seg = peri->txn.segments[peri->scnt];
     peri->scnt++;
     // Construct our word command to be passed to HAL
@@ -954,6 +1438,13 @@ void spi_issue_next_seg(spi_peripheral_t* peri)
     spi_set_command(peri->instance, cmd_reg);
 }
 
+void spi_issue_segments(spi_peripheral_t* peri) 
+{
+    while (peri->scnt < peri->txn.seglen 
+           && spi_get_ready(peri->instance) == SPI_TRISTATE_TRUE) 
+        spi_issue_next_seg(peri);
+}
+
 void spi_reset_peri(spi_peripheral_t* peri) 
 {
     // Reset static peripheral variables
@@ -986,6 +1477,26 @@ void spi_reset_transaction(spi_peripheral_t* peri)
     peri->rxcnt     = 0;
     peri->txn       = (spi_transaction_t) {0};
     peri->callbacks = NULL_CALLBACKS;
+    peri->dma_pending = 0;
+    peri->spi_done  = false;
+    // The DMA transfers still running, if any, now belong to an old transaction
+    peri->dma_seq++;
+}
+
+void spi_end_transaction(spi_peripheral_t* peri) 
+{
+    // Read the last data from the RX fifo
+    spi_empty_rx(peri);
+    // Set the state to Transaction is done (meaning successful)
+    peri->state = SPI_STATE_DONE;
+    // If there is a callback defined call it
+    if (peri->callbacks.done_cb != NULL) 
+    {
+        peri->callbacks.done_cb(peri->txn.txbuffer, peri->txcnt, 
+                                peri->txn.rxbuffer, peri->rxcnt);
+    }
+    // Reset all transaction related variables
+    spi_reset_transaction(peri);
 }
 
 void spi_event_handler(spi_peripheral_t* peri, spi_event_e events) 
@@ -996,10 +1507,10 @@ void spi_event_handler(spi_peripheral_t* peri, spi_event_e events)
     //  2) It is ready and idle
     if (events & SPI_EVENT_READY) 
     {
-        // If SPI is ready and there are still commands to execute, issue next command
-        if (peri->txn.segments != NULL && peri->scnt < peri->txn.seglen) 
+        // If SPI is ready and there are still commands to execute, issue them
+        if (peri->scnt < peri->txn.seglen) 
         {
-            spi_issue_next_seg(peri);
+            spi_issue_segments(peri);
         }
         // If no more commands and SPI is idle, it means the transaction is over
         else if (events & SPI_EVENT_IDLE) 
@@ -1007,18 +1518,10 @@ void spi_event_handler(spi_peripheral_t* peri, spi_event_e events)
             // Disable all event interrupts
             spi_set_events_enabled(peri->instance, SPI_EVENT_ALL, false);
             spi_enable_evt_intr   (peri->instance, false);
-            // Read the last data from the RX fifo
-            spi_empty_rx(peri);
-            // Set the state to Transaction is done (meaning successful)
-            peri->state = SPI_STATE_DONE;
-            // If there is a callback defined call it
-            if (peri->callbacks.done_cb != NULL) 
-            {
-                peri->callbacks.done_cb(peri->txn.txbuffer, peri->txcnt, 
-                                        peri->txn.rxbuffer, peri->rxcnt);
-            }
-            // Reset all transaction related variables
-            spi_reset_transaction(peri);
+            // The DMA may still be moving the last words to the RX buffer, the
+            // transaction then ends with its last transfer
+            if (peri->dma_pending) peri->spi_done = true;
+            else                   spi_end_transaction(peri);
             return;
         }
     }
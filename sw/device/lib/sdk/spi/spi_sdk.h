@@ -38,6 +38,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "spi_host.h"
+
 /****************************************************************************/
 /**                                                                        **/
 /**                       DEFINITIONS AND MACROS                           **/
@@ -49,6 +51,16 @@
 // Default timeout for blocking transactions in milliseconds
 #define SPI_TIMEOUT_DEFAULT   100
 
+// Maximum number of segments of a spi_program_t. Default is the depth of the
+// command queue, so that a whole program is queued at once.
+#ifndef SPI_PROGRAM_MAX_SEGMENTS
+#define SPI_PROGRAM_MAX_SEGMENTS SPI_HOST_PARAM_CMD_DEPTH
+#endif
+// Maximum number of TX words stored in a spi_program_t (opcode, address, ...)
+#ifndef SPI_PROGRAM_MAX_WORDS
+#define SPI_PROGRAM_MAX_WORDS    4
+#endif
+
 /**
  * @brief Macro to create a Slave SPI device with standard parameters.
  */
@@ -158,7 +170,8 @@ typedef enum {
     SPI_CODE_SEGMENT_INVAL      = 0x0100, // The spi_mode_e of the segment was invalid
     SPI_CODE_IS_BUSY            = 0x0200, // The SPI device is busy
     SPI_CODE_TXN_LEN_INVAL      = 0x0400, // The transaction length is 0 or too long
-    SPI_CODE_TIMEOUT_INVAL      = 0x0800  // The specified timeout is invalid
+    SPI_CODE_TIMEOUT_INVAL      = 0x0800, // The specified timeout is invalid
+    SPI_CODE_DMA_INVAL          = 0x1000  // The SPI device has no DMA trigger slots
 } spi_codes_e;
 
 typedef enum {
@@ -247,6 +260,21 @@ typedef struct {
     spi_cb_t error_cb;  // Called when there was an error during transaction
 } spi_callbacks_t;
 
+/**
+ * @brief Prebuilt transaction that can be replayed many times. The command
+ *        segments are encoded once in the COMMAND register format, and the
+ *        first TX words (typically opcode and address) are stored with them.
+ *        The other TX words and the RX words are given at each run.
+ */
+typedef struct {
+    uint32_t commands[SPI_PROGRAM_MAX_SEGMENTS]; // COMMAND register of each segment
+    uint32_t words[SPI_PROGRAM_MAX_WORDS];       // TX words stored in the program
+    uint8_t  seglen;                             // Number of segments
+    uint8_t  wordlen;                            // Number of TX words stored
+    uint32_t txlen;                              // TX words of all the segments
+    uint32_t rxlen;                              // RX words of all the segments
+} spi_program_t;
+
 /**
  * @brief Type holding Information to use SDK.
  */
@@ -255,6 +283,7 @@ typedef struct {
     uint32_t    id;    // spi_t instance ID
     bool        init;  // Indicates if initialization was successful
     spi_slave_t slave; // The slave with whom to communicate configuration 
+    bool        dma;   // Indicates if the DMA moves the data (spi_set_dma)
 } spi_t;
 
 /****************************************************************************/
@@ -353,6 +382,11 @@ spi_codes_e spi_get_rxwm(spi_t* spi, uint8_t* watermark);
  * @brief Set the timeout in milliseconds for blocking transactions for the 
  *        specific SPI Host peripheral.
  *        Maximum is UINT32_MAX * 1000 / core_frequency.
+ *        Blocking transactions sleep (wfi) until their end, the timeout being
+ *        an alarm of the hart 1 of the always-on timer (fast interrupt
+ *        kTimer_1_fic_e, whose handler is never called). The application may
+ *        use that hart too: its configuration, alarm and interrupt enables are
+ *        restored after each wait, and a running counter keeps its pace.
  * 
  * @param spi Pointer to spi_t structure obtained through spi_init call
  * @param watermark The desired new watermark
@@ -375,6 +409,30 @@ spi_codes_e spi_set_timeout(spi_t* spi, uint32_t timeout);
  */
 spi_codes_e spi_get_timeout(spi_t* spi, uint32_t* timeout);
 
+/**
+ * @brief Select who moves the data between the buffers and the FIFOs during the
+ *        transactions of this spi_t: the CPU, from the event interrupt (default),
+ *        or the DMA, paced by the TX/RX trigger slots of the SPI device.
+ *        This applies to spi_transmit, spi_receive, spi_transceive, spi_execute,
+ *        their non-blocking variants and the programs without stored words.
+ *        A DMA channel is acquired for each direction at the start of a
+ *        transaction and released at its end. If no channel is free the CPU
+ *        moves the data of that transaction.
+ *        /!\ dma_init() must have been called once before, and the txwm_cb and
+ *            rxwm_cb callbacks are not called in DMA mode.
+ *        /!\ If a transaction fails or times out, its DMA transfers cannot be
+ *            aborted: they keep their channels until they end, and the
+ *            transactions of the same SPI device do not use the DMA until then.
+ * 
+ * @param spi Pointer to spi_t structure obtained through spi_init call
+ * @param enable true to move the data with the DMA, false with the CPU
+ * @return SPI_CODE_IDX_INVAL if spi.idx not valid
+ * @return SPI_CODE_NOT_INIT  if spi.init false (indicates if spi was initialized)
+ * @return SPI_CODE_DMA_INVAL if the SPI device has no DMA trigger slots (HOST2)
+ * @return SPI_CODE_OK        if success
+ */
+spi_codes_e spi_set_dma(spi_t* spi, bool enable);
+
 /**
  * @brief Change the communication frequency of the slave
  *        /!\ If the frequency is higher than the maximum frequency it will just
@@ -556,6 +614,105 @@ spi_codes_e spi_execute_nb(spi_t* spi, const spi_segment_t* segments,
                            uint32_t segments_len, const uint32_t* src_buffer, 
                            uint32_t* dest_buffer, spi_callbacks_t callbacks);
 
+/**
+ * @brief Builds a program from command segments, to run it later any number of
+ *        times with spi_program_run, spi_program_run_nb or spi_program_issue.
+ *        The segments are validated and encoded here, so running the program
+ *        only pushes words to the peripheral.
+ *        /!\ Caution: words are the first TX words of the transaction, the
+ *                     remaining ones are given when the program is run.
+ * 
+ * @param program The program to build
+ * @param segments An array of command segments
+ * @param segments_len The size of segments array, at most SPI_PROGRAM_MAX_SEGMENTS
+ * @param words The TX words to store in the program (may be NULL if words_len is 0)
+ * @param words_len The number of TX words to store, at most SPI_PROGRAM_MAX_WORDS
+ * @return SPI_CODE_SEGMENT_INVAL if segments contains an invalid segment or too many
+ * @return SPI_CODE_TXN_LEN_INVAL if a segment length is 0 or too long, or if 
+ *                                there are more words than TX words
+ * @return SPI_CODE_OK            if success
+ */
+spi_codes_e spi_program_build(spi_program_t* program, const spi_segment_t* segments, 
+                              uint32_t segments_len, const uint32_t* words, 
+                              uint32_t words_len);
+
+/**
+ * @brief Changes one of the TX words stored in a program (e.g. an address).
+ * 
+ * @param program A program built with spi_program_build
+ * @param index The index of the word in the words given to spi_program_build
+ * @param word The new value of the word
+ * @return SPI_CODE_TXN_LEN_INVAL if index is not a stored word
+ * @return SPI_CODE_OK            if success
+ */
+spi_codes_e spi_program_set_word(spi_program_t* program, uint32_t index, uint32_t word);
+
+/**
+ * @brief Changes the length of one of the segments of a program (e.g. the 
+ *        number of bytes to read).
+ *        /!\ Caution: the segment must not carry stored TX words.
+ * 
+ * @param program A program built with spi_program_build
+ * @param segment The index of the segment
+ * @param len The new length in bytes (or cycles for dummy segments)
+ * @return SPI_CODE_SEGMENT_INVAL if segment is not a segment of the program, or
+ *                                if it carries stored TX words
+ * @return SPI_CODE_TXN_LEN_INVAL if len is 0 or too long
+ * @return SPI_CODE_OK            if success
+ */
+spi_codes_e spi_program_set_len(spi_program_t* program, uint32_t segment, uint32_t len);
+
+/**
+ * @brief Executes a program. All its segments are queued back-to-back, without
+ *        waiting for the interrupt of each segment.
+ * 
+ * @param spi Pointer to spi_t structure obtained through spi_init call
+ * @param program A program built with spi_program_build
+ * @param src_buffer The TX data that follows the words stored in the program
+ *                   (may be NULL if the program has no other TX data)
+ * @param dest_buffer An initialized buffer/array to store the received data
+ * @return SPI_CODE_IDX_INVAL     if spi.idx not valid
+ * @return SPI_CODE_NOT_INIT      if spi.init false (indicates if spi was initialized)
+ * @return SPI_CODE_TXN_LEN_INVAL if src_buffer is NULL but TX data is missing
+ * @return SPI_CODE_OK            if success
+ */
+spi_codes_e spi_program_run(spi_t* spi, const spi_program_t* program, 
+                            const uint32_t* src_buffer, uint32_t* dest_buffer);
+
+/**
+ * @brief Executes a program. This is Non-Blocking, the function will return 
+ *        immediately.
+ * 
+ * @param spi Pointer to spi_t structure obtained through spi_init call
+ * @param program A program built with spi_program_build, it must not change
+ *                until the transaction is done
+ * @param src_buffer The TX data that follows the words stored in the program
+ *                   (may be NULL if the program has no other TX data)
+ * @param dest_buffer An initialized buffer/array to store the received data
+ * @param callbacks The callbacks of the transaction
+ * @return SPI_CODE_IDX_INVAL     if spi.idx not valid
+ * @return SPI_CODE_NOT_INIT      if spi.init false (indicates if spi was initialized)
+ * @return SPI_CODE_TXN_LEN_INVAL if src_buffer is NULL but TX data is missing
+ * @return SPI_CODE_OK            if success
+ */
+spi_codes_e spi_program_run_nb(spi_t* spi, const spi_program_t* program, 
+                               const uint32_t* src_buffer, uint32_t* dest_buffer,
+                               spi_callbacks_t callbacks);
+
+/**
+ * @brief Pushes a program directly to an SPI host: the stored TX words, then
+ *        the command segments. Returns as soon as the last segment is queued.
+ *        This is meant for drivers that manage the peripheral themselves (e.g.
+ *        the flash BSP): no SDK state is used, and the remaining TX data and
+ *        the RX data are moved by the caller, with the CPU or the DMA.
+ *        /!\ Caution: the host must be configured for the slave and its TX
+ *                     FIFO must have room for the stored words.
+ * 
+ * @param host The SPI host peripheral
+ * @param program A program built with spi_program_build
+ */
+void spi_program_issue(spi_host_t* host, const spi_program_t* program);
+
 /****************************************************************************/
 /**                                                                        **/
 /**                          INLINE FUNCTIONS                              **/
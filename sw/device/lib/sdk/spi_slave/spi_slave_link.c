@@ -0,0 +1,299 @@
+// Copyright 2025 EPFL
+// Solderpad Hardware License, Version 2.1, see LICENSE.md for details.
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// File: spi_slave_link.c
+// Description: Streaming link layer over the SPI slave. See spi_slave_link.h.
+
+
+#include "spi_slave_link.h"
+#include "spi_host_regs.h"
+#include "csr.h"
+#include "hart.h"
+
+
+/** Bytes of the command header of a chunk, before its data. */
+#define LINK_HEADER_WRITE_B     9   // wrap length (4), direction (1), address (4)
+#define LINK_HEADER_READ_B      11  // dummy cycles (2), then as a write
+#define LINK_HEADER_MAX_W       3
+
+
+/** CRC-32 (reflected 0xEDB88320) of each nibble. */
+static const uint32_t crc_nibble[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+static inline uint32_t crc_word(uint32_t crc, uint32_t word) {
+    for (int i = 0; i < 8; i++) {
+        crc = (crc >> 4) ^ crc_nibble[(crc ^ word) & 0xF];
+        word >>= 4;
+    }
+    return crc;
+}
+
+uint32_t spi_link_crc32(uint32_t crc, const uint32_t* words, uint32_t length_w) {
+    crc = ~crc;
+    for (uint32_t i = 0; i < length_w; i++) crc = crc_word(crc, words[i]);
+    return ~crc;
+}
+
+
+spi_flags_e spi_link_init(spi_link_t* link, spi_host_t* host, uint8_t csid) {
+    // The DMA trigger slots of the SPI host are the ones of SPI HOST 1
+    if (host != spi_host1) return SPI_LINK_FLAG_DMA_UNAVAILABLE;
+
+    spi_flags_e flag = spi_host_init(host, csid);
+    if (flag != SPI_FLAG_SUCCESS) return flag;
+
+    link->host          = host;
+    link->chunk_w       = SPI_LINK_MAX_CHUNK_W;
+    link->dummy_cycles  = SPI_LINK_DUMMY_CYCLES;
+    link->swap          = true;
+    link->crc           = false;
+    return SPI_FLAG_SUCCESS;
+}
+
+/**
+ * @brief Build the command header of a chunk, in the order of the bytes on the
+ * wire: (dummy cycles,) wrap length, direction and address, MSB first.
+ * @return The number of bytes of the header.
+*/
+static uint8_t link_header(spi_link_t* link, uint32_t* words, uint8_t dir, uint32_t addr, uint16_t length_w) {
+    uint8_t bytes[LINK_HEADER_MAX_W * 4] = {0};
+    uint8_t n = 0;
+
+    if (dir == SPI_SLAVE_CMD_READ) {
+        bytes[n++] = WRITE_SPI_SLAVE_REG_0;
+        bytes[n++] = link->dummy_cycles;
+    }
+    bytes[n++] = WRITE_SPI_SLAVE_REG_1;
+    bytes[n++] = length_w & 0xFF;
+    bytes[n++] = WRITE_SPI_SLAVE_REG_2;
+    bytes[n++] = length_w >> 8;
+    bytes[n++] = dir;
+    bytes[n++] = addr >> 24;
+    bytes[n++] = addr >> 16;
+    bytes[n++] = addr >> 8;
+    bytes[n++] = addr;
+
+    // The first byte sent is the least significant one of a TX word
+    for (int i = 0; i < LINK_HEADER_MAX_W; i++) {
+        words[i] = bytes[4*i] | bytes[4*i+1] << 8 | bytes[4*i+2] << 16 | (uint32_t)bytes[4*i+3] << 24;
+    }
+    return n;
+}
+
+/**
+ * @brief Queue the header and the commands of a chunk. The data of a write is
+ * pushed by the DMA, or by the CPU if data is not NULL.
+*/
+static void link_issue_chunk(spi_link_t* link, uint8_t dir, uint32_t addr, uint16_t length_w, const uint32_t* data) {
+    uint32_t header[LINK_HEADER_MAX_W];
+    uint8_t header_b = link_header(link, header, dir, addr, length_w);
+
+    // The header follows the data of the previous chunk in the TX FIFO
+    for (int i = 0; i < (header_b + 3) / 4; i++) {
+        spi_wait_for_tx_not_full(link->host);
+        spi_write_word(link->host, header[i]);
+    }
+    if (data != NULL) {
+        for (uint16_t i = 0; i < length_w; i++) {
+            spi_wait_for_tx_not_full(link->host);
+            spi_write_word(link->host, data[i]);
+        }
+    }
+
+    send_command_to_spi_host(link->host, header_b, true, SPI_DIR_TX_ONLY);
+    if (dir == SPI_SLAVE_CMD_READ) {
+        send_command_to_spi_host(link->host, link->dummy_cycles, true, SPI_DIR_DUMMY);
+        send_command_to_spi_host(link->host, length_w * 4, false, SPI_DIR_RX_ONLY);
+    } else {
+        send_command_to_spi_host(link->host, length_w * 4, false, SPI_DIR_TX_ONLY);
+    }
+}
+
+/**
+ * @brief Queue the DMA transfer of the data of a chunk, in the slot i of the link.
+*/
+static spi_flags_e link_push_dma(spi_link_t* link, int i, uint8_t dir, uint32_t* mem, uint16_t length_w) {
+    link->mem[i] = (dma_target_t){
+        .ptr        = (uint8_t*)mem,
+        .inc_d1_du  = 1,
+        .type       = DMA_DATA_TYPE_WORD,
+        .trig       = DMA_TRIG_MEMORY,
+    };
+    link->fifo[i] = (dma_target_t){
+        .inc_d1_du  = 0,
+        .type       = DMA_DATA_TYPE_WORD,
+    };
+    if (dir == SPI_SLAVE_CMD_READ) {
+        link->fifo[i].ptr   = (uint8_t*)link->host + SPI_HOST_RXDATA_REG_OFFSET;
+        link->fifo[i].trig  = DMA_TRIG_SLOT_SPI_RX;
+        link->trans[i]      = (dma_trans_t){ .src = &link->fifo[i], .dst = &link->mem[i] };
+    } else {
+        link->fifo[i].ptr   = (uint8_t*)link->host + SPI_HOST_TXDATA_REG_OFFSET;
+        link->fifo[i].trig  = DMA_TRIG_SLOT_SPI_TX;
+        link->trans[i]      = (dma_trans_t){ .src = &link->mem[i], .dst = &link->fifo[i] };
+    }
+    link->trans[i].size_d1_du   = length_w;
+    link->trans[i].mode         = DMA_TRANS_MODE_SINGLE;
+    link->trans[i].end          = DMA_TRANS_END_INTR;
+    link->trans[i].channel      = link->channel;
+
+    if (dma_validate_transaction(&link->trans[i], DMA_ENABLE_REALIGN, DMA_PERFORM_CHECKS_INTEGRITY) != DMA_CONFIG_OK
+        || dma_queue_push(&link->trans[i], NULL, NULL) != DMA_CONFIG_OK) {
+        return SPI_LINK_FLAG_DMA_UNAVAILABLE;
+    }
+    return SPI_FLAG_SUCCESS;
+}
+
+/**
+ * @brief Sleep until at most pending transfers are left on the channel of the link.
+*/
+static void link_wait_dma(spi_link_t* link, uint32_t pending) {
+    while (dma_queue_pending(link->channel) > pending) {
+        CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+        if (dma_queue_pending(link->channel) > pending) {
+            wait_for_interrupt();
+        }
+        CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+    }
+}
+
+static void link_wait_idle(spi_host_t* host) {
+    spi_status_t status;
+    do {
+        status = spi_get_status(host);
+    } while (status.active || status.cmdqd || !status.txempty);
+}
+
+static spi_flags_e link_check(spi_link_t* link, uint8_t* addr) {
+    if ((uintptr_t)addr & 0x3) return SPI_SLAVE_FLAG_ADDRESS_INVALID;
+    if (link->chunk_w == 0 || (link->swap && link->chunk_w > SPI_LINK_MAX_CHUNK_W)) {
+        return SPI_SLAVE_FLAG_SIZE_OF_DATA_EXCEEDED;
+    }
+    if (dma_channel_acquire(DMA_CH_PRIO_NORMAL, 0, &link->channel) != DMA_CONFIG_OK) {
+        return SPI_LINK_FLAG_DMA_UNAVAILABLE;
+    }
+    return SPI_FLAG_SUCCESS;
+}
+
+/**
+ * @brief Word of the slave memory for a word of the user buffers: the SPI slave
+ * reverses the bytes of each word, unless the CPU does it first.
+*/
+static inline uint32_t link_slave_word(spi_link_t* link, uint32_t word) {
+    return link->swap ? word : REVERT_ENDIANNESS(word);
+}
+
+spi_flags_e spi_link_write(spi_link_t* link, uint8_t* write_addr, const uint32_t* src, uint32_t length_w) {
+    spi_flags_e flag = link_check(link, write_addr);
+    if (flag != SPI_FLAG_SUCCESS) return flag;
+
+    uint32_t addr = (uintptr_t)write_addr;
+    uint32_t crc = ~0u;
+    uint32_t done = 0;
+    int slot = 0;
+
+    while (done < length_w) {
+        uint16_t chunk = (length_w - done < link->chunk_w) ? length_w - done : link->chunk_w;
+        uint32_t* mem = (uint32_t*)&src[done];
+
+        // Prepare the chunk while the previous one is still pushed by the DMA
+        if (link->swap || link->crc) {
+            for (uint16_t i = 0; i < chunk; i++) {
+                uint32_t word = src[done + i];
+                if (link->crc) crc = crc_word(crc, link_slave_word(link, word));
+                if (link->swap) link->stage[slot][i] = REVERT_ENDIANNESS(word);
+            }
+            if (link->swap) mem = link->stage[slot];
+        }
+
+        // Its header must come after the data of the previous chunk in the TX FIFO
+        link_wait_dma(link, 0);
+        link_issue_chunk(link, SPI_SLAVE_CMD_WRITE, addr + done * 4, chunk, NULL);
+        flag = link_push_dma(link, slot, SPI_SLAVE_CMD_WRITE, mem, chunk);
+        if (flag != SPI_FLAG_SUCCESS) break;
+
+        done += chunk;
+        slot ^= 1;
+    }
+    link_wait_dma(link, 0);
+    dma_channel_release(link->channel);
+
+    // The CRC is a native word of the slave memory
+    if (flag == SPI_FLAG_SUCCESS && link->crc) {
+        uint32_t trailer = REVERT_ENDIANNESS(~crc);
+        link_issue_chunk(link, SPI_SLAVE_CMD_WRITE, addr + length_w * 4, 1, &trailer);
+    }
+    link_wait_idle(link->host);
+    return flag;
+}
+
+spi_flags_e spi_link_read(spi_link_t* link, uint8_t* read_addr, uint32_t* dst, uint32_t length_w) {
+    spi_flags_e flag = link_check(link, read_addr);
+    if (flag != SPI_FLAG_SUCCESS) return flag;
+
+    uint32_t addr = (uintptr_t)read_addr;
+    uint32_t crc = ~0u;
+    uint32_t issued = 0;
+    uint32_t done = 0;
+    uint16_t chunks[2] = {0};
+    int next = 0;
+    int oldest = 0;
+    int in_flight = 0;
+
+    while (done < length_w) {
+        // Queue the command of the next chunk before waiting for the data of
+        // the current one, so that it follows it on the wire
+        if (issued < length_w && in_flight < 2 && flag == SPI_FLAG_SUCCESS) {
+            uint16_t chunk = (length_w - issued < link->chunk_w) ? length_w - issued : link->chunk_w;
+            uint32_t* mem = link->swap ? link->stage[next] : &dst[issued];
+
+            link_issue_chunk(link, SPI_SLAVE_CMD_READ, addr + issued * 4, chunk, NULL);
+            flag = link_push_dma(link, next, SPI_SLAVE_CMD_READ, mem, chunk);
+            if (flag != SPI_FLAG_SUCCESS) {
+                // The chunk is on the wire anyway, drop its data
+                spi_status_t status;
+                do {
+                    uint32_t word;
+                    status = spi_get_status(link->host);
+                    if (!status.rxempty) spi_read_word(link->host, &word);
+                } while (status.active || status.cmdqd || !status.rxempty);
+            } else {
+                chunks[next] = chunk;
+                issued += chunk;
+                next ^= 1;
+                in_flight++;
+                if (in_flight < 2 && issued < length_w) continue;
+            }
+        }
+        if (in_flight == 0) break;
+
+        // The oldest chunk is done when only the other one may be pending
+        link_wait_dma(link, in_flight - 1);
+        if (link->swap || link->crc) {
+            for (uint16_t i = 0; i < chunks[oldest]; i++) {
+                uint32_t word = link->swap ? REVERT_ENDIANNESS(link->stage[oldest][i]) : dst[done + i];
+                if (link->swap) dst[done + i] = word;
+                if (link->crc) crc = crc_word(crc, link_slave_word(link, word));
+            }
+        }
+        done += chunks[oldest];
+        oldest ^= 1;
+        in_flight--;
+    }
+    link_wait_dma(link, 0);
+    dma_channel_release(link->channel);
+    link_wait_idle(link->host);
+
+    if (flag == SPI_FLAG_SUCCESS && link->crc) {
+        uint32_t trailer;
+        link_issue_chunk(link, SPI_SLAVE_CMD_READ, addr + length_w * 4, 1, NULL);
+        link_wait_idle(link->host);
+        spi_read_word(link->host, &trailer);
+        if (REVERT_ENDIANNESS(trailer) != ~crc) flag = SPI_LINK_FLAG_CRC_MISMATCH;
+    }
+    return flag;
+}
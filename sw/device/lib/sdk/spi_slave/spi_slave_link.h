@@ -0,0 +1,112 @@
+// Copyright 2025 EPFL
+// Solderpad Hardware License, Version 2.1, see LICENSE.md for details.
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// File: spi_slave_link.h
+// Description: Streaming link layer over the SPI slave, used from the SPI host
+// of the X-HEEP (or any SPI master) that drives the SPI slave of another one,
+// e.g. when X-HEEP is used as a coprocessor.
+//
+// A transfer is split into chunks, each one being a command of the SPI slave
+// (wrap length, direction, address, then the data) in its own chip-select
+// frame. The data phases are moved between the buffers and the FIFOs of the
+// SPI host by the DMA, and the command of the next chunk is queued while the
+// data of the current one is still on the wire, so that there is no gap
+// between the chunks.
+//
+// The SPI slave stores each word it receives with its bytes reversed (and
+// sends them reversed too). By default the CPU restores the byte order of a
+// chunk in one of two staging buffers while the other one is on the wire.
+// Without it (swap = false) the DMA moves the data directly from/to the user
+// buffers, and the words reach the slave memory byte-reversed.
+//
+// With crc = true, the CRC-32 of the data is written in the word following it
+// in the slave memory, and checked against that word when reading: the
+// software of the slave side computes or checks it with spi_link_crc32().
+//
+// The DMA must have been initialized with dma_init(), and the interrupts
+// enabled (mstatus.MIE), as the chunks are chained from the DMA interrupt.
+// Only SPI HOST 1 has DMA trigger slots.
+
+#ifndef SPI_SLAVE_LINK_H_
+#define SPI_SLAVE_LINK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "spi_host.h"
+#include "spi_slave_sdk.h"
+#include "dma.h"
+
+/** Maximum number of words of a chunk, which sets the size of the staging buffers. */
+#ifndef SPI_LINK_MAX_CHUNK_W
+#define SPI_LINK_MAX_CHUNK_W    256
+#endif
+
+/** Default number of SCK cycles the SPI slave waits before sending data. */
+#define SPI_LINK_DUMMY_CYCLES   32
+
+
+/** A link to an SPI slave. Must be static, the DMA uses it in the background. */
+typedef struct {
+    spi_host_t*     host;           // SPI host wired to the SPI slave
+    uint16_t        chunk_w;        // Words of a chunk, at most SPI_LINK_MAX_CHUNK_W
+    uint8_t         dummy_cycles;   // SCK cycles before the SPI slave sends data (7-255)
+    bool            swap;           // The CPU restores the byte order of the words
+    bool            crc;            // A CRC-32 follows the data in the slave memory
+
+    /** Private, set up by the transfers. */
+    uint8_t         channel;
+    dma_target_t    mem[2];
+    dma_target_t    fifo[2];
+    dma_trans_t     trans[2];
+    uint32_t        stage[2][SPI_LINK_MAX_CHUNK_W];
+} spi_link_t;
+
+
+/**
+ * @brief Initialize the SPI host and a link with the default settings: chunks
+ * of SPI_LINK_MAX_CHUNK_W words, SPI_LINK_DUMMY_CYCLES, byte order restored,
+ * no CRC. The settings can be changed in the structure afterwards.
+ * @param link The link.
+ * @param host The SPI host wired to the SPI slave.
+ * @param csid The chip select of the SPI slave.
+ * @return SPI_FLAG_SUCCESS, SPI_LINK_FLAG_DMA_UNAVAILABLE if the SPI host has no
+ * DMA trigger slots, or the error of spi_host_init().
+*/
+spi_flags_e spi_link_init(spi_link_t* link, spi_host_t* host, uint8_t csid);
+
+/**
+ * @brief Write data in the memory of the SPI slave.
+ * @param link The link.
+ * @param write_addr Word-aligned address in the slave's memory where the data will be written.
+ * @param src Data to write.
+ * @param length_w Length in 32-bit words of the data.
+ * @return SPI_FLAG_SUCCESS, SPI_SLAVE_FLAG_ADDRESS_INVALID if write_addr is not
+ * word-aligned, SPI_SLAVE_FLAG_SIZE_OF_DATA_EXCEEDED if the chunk length is not
+ * valid, SPI_LINK_FLAG_DMA_UNAVAILABLE if no DMA channel is free.
+*/
+spi_flags_e spi_link_write(spi_link_t* link, uint8_t* write_addr, const uint32_t* src, uint32_t length_w);
+
+/**
+ * @brief Read data from the memory of the SPI slave.
+ * @param link The link.
+ * @param read_addr Word-aligned address in the slave's memory from where to read.
+ * @param dst Buffer for the data read.
+ * @param length_w Length in 32-bit words of the data.
+ * @return SPI_FLAG_SUCCESS, SPI_LINK_FLAG_CRC_MISMATCH if the CRC does not match
+ * the data read, or the errors of spi_link_write().
+*/
+spi_flags_e spi_link_read(spi_link_t* link, uint8_t* read_addr, uint32_t* dst, uint32_t length_w);
+
+/**
+ * @brief CRC-32 (IEEE 802.3) of words, as stored in memory. Calls can be chained
+ * by passing the result of the previous one, starting from 0.
+ * @param crc CRC of the previous words, or 0.
+ * @param words The words.
+ * @param length_w Number of words.
+ * @return The CRC.
+*/
+uint32_t spi_link_crc32(uint32_t crc, const uint32_t* words, uint32_t length_w);
+
+#endif // SPI_SLAVE_LINK_H_
@@ -8,6 +8,8 @@
 // software. This "misleading file" is using the SPI Host SDK to read and write 
 // to the SPI slave.
 
+#ifndef SPI_SLAVE_SDK_H_
+#define SPI_SLAVE_SDK_H_
 
 #include "spi_host.h"
 
@@ -39,6 +41,10 @@ typedef enum {
     SPI_HOST_FLAG_CSID_INVALID              = 0x0003,    
     //The amount of data exceeds the memory capacity of the SPI SLAVE (X-HEEP)
     SPI_SLAVE_FLAG_SIZE_OF_DATA_EXCEEDED    = 0x0004, 
+    // The SPI host has no DMA trigger slots, or no DMA channel is free
+    SPI_LINK_FLAG_DMA_UNAVAILABLE           = 0x0005,
+    // The CRC of the data read does not match the one stored by the SPI SLAVE side
+    SPI_LINK_FLAG_CRC_MISMATCH              = 0x0006,
 } spi_flags_e;
 
 spi_flags_e spi_host_init(spi_host_t* host, uint8_t csid);
@@ -51,4 +57,6 @@ void spi_slave_send_address( spi_host_t* host, uint8_t* address );
 void spi_copy_words( spi_host_t* host, uint32_t* write_ptr, uint16_t words);
 uint32_t spi_copy_word( spi_host_t* host);
 uint8_t spi_copy_byte(spi_host_t* host, uint8_t index);
-void send_command_to_spi_host(spi_host_t* host, uint32_t len, bool csaat, spi_dir_e direction);
\ No newline at end of file
+void send_command_to_spi_host(spi_host_t* host, uint32_t len, bool csaat, spi_dir_e direction);
+
+#endif // SPI_SLAVE_SDK_H_
@@ -0,0 +1,462 @@
+// Copyright 2025 EPFL and Politecnico di Torino.
+// Solderpad Hardware License, Version 2.1, see LICENSE.md for details.
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// File: tensor_sdk.c
+// Description: Tensor layout operations on 2D DMA transactions.
+
+#include <stddef.h>
+#include <string.h>
+
+#include "tensor_sdk.h"
+#include "dma.h"
+#include "csr.h"
+
+/* Range of the DMA registers */
+#define TENSOR_MAX_SIZE     0xffff              // SIZE_D1, SIZE_D2
+#define TENSOR_MAX_INC_D1_B 31                  // Signed, 6 bits
+#define TENSOR_MAX_INC_D2_B ((1 << 22) - 1)     // Signed, 23 bits
+#define TENSOR_MAX_PAD      63
+
+/******************************/
+/* ---- TYPE DEFINITIONS ---- */
+/******************************/
+
+/*
+ * A block reads d2 rows of d1 elements from the source and writes them
+ * contiguously into the destination, surrounded by the padding.
+ */
+typedef struct
+{
+    const uint8_t *src;     // First element read
+    uint8_t *dst;           // First element written, padding included
+    uint32_t d1;            // Elements read per row
+    uint32_t d2;            // Rows read
+    int32_t step_d1;        // Source elements between two elements of a row
+    int32_t step_d2;        // Source elements between the starts of two rows
+    uint32_t top;           // Zeros around the rows in the destination
+    uint32_t bottom;
+    uint32_t left;
+    uint32_t right;
+} tensor_block_t;
+
+/******************************/
+/* ---- GLOBAL VARIABLES ---- */
+/******************************/
+
+static uint8_t tensor_channel;
+static tensor_backend_t tensor_backend;
+static tensor_stats_t tensor_stats;
+
+/*
+ * Transactions handed to the queue of the channel, used in turn: the one of
+ * block n is overwritten by block n + DMA_QUEUE_LEN, once the queue has a free
+ * entry.
+ */
+static dma_target_t tensor_src[DMA_QUEUE_LEN];
+static dma_target_t tensor_dst[DMA_QUEUE_LEN];
+static dma_trans_t tensor_trans[DMA_QUEUE_LEN];
+static uint32_t tensor_next;
+
+/**********************************/
+/* ---- FUNCTION DEFINITIONS ---- */
+/**********************************/
+
+#define TENSOR_CPU_BLOCK(T)                                                     \
+    static void cpu_block_##T(const tensor_block_t *b)                         \
+    {                                                                           \
+        const T *row = (const T *)b->src;                                       \
+        T *dst = (T *)b->dst;                                                   \
+        uint32_t len = b->left + b->d1 + b->right;                              \
+                                                                                \
+        for (uint32_t i = 0; i < b->top * len; i++)                             \
+        {                                                                       \
+            *dst++ = 0;                                                         \
+        }                                                                       \
+        for (uint32_t r = 0; r < b->d2; r++, row += b->step_d2)                 \
+        {                                                                       \
+            const T *src = row;                                                 \
+            for (uint32_t i = 0; i < b->left; i++)                              \
+            {                                                                   \
+                *dst++ = 0;                                                     \
+            }                                                                   \
+            for (uint32_t i = 0; i < b->d1; i++, src += b->step_d1)             \
+            {                                                                   \
+                *dst++ = *src;                                                  \
+            }                                                                   \
+            for (uint32_t i = 0; i < b->right; i++)                             \
+            {                                                                   \
+                *dst++ = 0;                                                     \
+            }                                                                   \
+        }                                                                       \
+        for (uint32_t i = 0; i < b->bottom * len; i++)                          \
+        {                                                                       \
+            *dst++ = 0;                                                         \
+        }                                                                       \
+    }
+
+TENSOR_CPU_BLOCK(uint32_t)
+TENSOR_CPU_BLOCK(uint16_t)
+TENSOR_CPU_BLOCK(uint8_t)
+
+static void cpu_block(const tensor_block_t *b, dma_data_type_t type)
+{
+    switch (type)
+    {
+    case DMA_DATA_TYPE_WORD:
+        cpu_block_uint32_t(b);
+        break;
+    case DMA_DATA_TYPE_HALF_WORD:
+        cpu_block_uint16_t(b);
+        break;
+    default:
+        cpu_block_uint8_t(b);
+        break;
+    }
+    tensor_stats.cpu_blocks++;
+}
+
+// Only positive D2 increments are used, blocks needing a negative one go to the CPU
+static inline uint8_t fits_inc_d2(int32_t inc_b)
+{
+    return inc_b >= 0 && inc_b <= TENSOR_MAX_INC_D2_B;
+}
+
+// Describe the block as a 2D transaction, return 0 if the DMA cannot perform it
+static uint8_t block_to_trans(const tensor_block_t *b, dma_data_type_t type,
+                              dma_target_t *src, dma_target_t *dst, dma_trans_t *trans)
+{
+    int32_t size = DMA_DATA_TYPE_2_SIZE(type);
+    int32_t inc_d2 = b->step_d2 - (int32_t)(b->d1 - 1) * b->step_d1;
+    uint8_t padded = (b->top | b->bottom | b->left | b->right) != 0;
+
+    if (b->d1 == 0 || b->d2 == 0 || b->d1 > TENSOR_MAX_SIZE || b->d2 > TENSOR_MAX_SIZE ||
+        (((uint32_t)b->src | (uint32_t)b->dst) & (size - 1)))
+    {
+        return 0;
+    }
+
+#if DMA_ZERO_PADDING
+    if (b->top > TENSOR_MAX_PAD || b->bottom > TENSOR_MAX_PAD ||
+        b->left > TENSOR_MAX_PAD || b->right > TENSOR_MAX_PAD)
+    {
+        return 0;
+    }
+#else
+    if (padded)
+    {
+        return 0;
+    }
+#endif
+
+    *src = (dma_target_t){
+        .ptr = (uint8_t *)b->src,
+        .type = type,
+        .trig = DMA_TRIG_MEMORY,
+    };
+    *dst = (dma_target_t){
+        .ptr = b->dst,
+        .inc_d1_du = 1,
+        .inc_d2_du = 1,
+        .type = type,
+        .trig = DMA_TRIG_MEMORY,
+    };
+    *trans = (dma_trans_t){
+        .src = src,
+        .dst = dst,
+        .size_d1_du = b->d1,
+        .size_d2_du = b->d2,
+        .dim = DMA_DIM_CONF_2D,
+        .src_type = type,
+        .dst_type = type,
+        .mode = DMA_TRANS_MODE_SINGLE,
+        .end = DMA_TRANS_END_INTR,
+        .channel = tensor_channel,
+    };
+
+#if DMA_ZERO_PADDING
+    trans->pad_top_du = b->top;
+    trans->pad_bottom_du = b->bottom;
+    trans->pad_left_du = b->left;
+    trans->pad_right_du = b->right;
+#endif
+
+    /* The D2 increment goes from the last element of a row to the next row */
+    if (b->step_d1 >= 0 && b->step_d1 * size <= TENSOR_MAX_INC_D1_B && fits_inc_d2(inc_d2 * size))
+    {
+        src->inc_d1_du = b->step_d1;
+        src->inc_d2_du = inc_d2;
+        return 1;
+    }
+
+    /*
+     * With DIM_INV the DMA walks a row with the D2 increment, and starts each
+     * row at the start of the previous one plus the D1 increment.
+     */
+    if (!padded && b->step_d2 >= 0 && b->step_d2 * size <= TENSOR_MAX_INC_D1_B &&
+        fits_inc_d2(b->step_d1 * size))
+    {
+        src->inc_d1_du = b->step_d2;
+        src->inc_d2_du = b->step_d1;
+        trans->dim_inv = 1;
+        return 1;
+    }
+
+    return 0;
+}
+
+// Wait in wfi until the queue of the channel has a free entry
+static void wait_queue_entry(void)
+{
+    while (dma_queue_pending(tensor_channel) == DMA_QUEUE_LEN)
+    {
+        CSR_CLEAR_BITS(CSR_REG_MSTATUS, 0x8);
+        if (dma_queue_pending(tensor_channel) == DMA_QUEUE_LEN)
+        {
+            wait_for_interrupt();
+        }
+        CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+    }
+}
+
+// Queue the block on the DMA, or perform it with the CPU
+static dma_config_flags_t run_block(const tensor_block_t *b, dma_data_type_t type)
+{
+    uint32_t i = tensor_next % DMA_QUEUE_LEN;
+    dma_target_t src, dst;
+    dma_trans_t trans;
+    dma_config_flags_t res;
+
+    if (tensor_backend == TENSOR_BACKEND_AUTO && block_to_trans(b, type, &src, &dst, &trans))
+    {
+        /* The transaction of entry i may still be in the queue */
+        wait_queue_entry();
+
+        tensor_src[i] = src;
+        tensor_dst[i] = dst;
+        tensor_trans[i] = trans;
+        tensor_trans[i].src = &tensor_src[i];
+        tensor_trans[i].dst = &tensor_dst[i];
+
+        /* The blocks are built valid: only fill in the derived fields */
+        res = dma_validate_transaction(&tensor_trans[i], DMA_DO_NOT_ENABLE_REALIGN,
+                                       DMA_PERFORM_CHECKS_ONLY_SANITY);
+        res |= dma_queue_push(&tensor_trans[i], NULL, NULL);
+        if (res != DMA_CONFIG_OK)
+        {
+            return res;
+        }
+        tensor_next++;
+        tensor_stats.dma_blocks++;
+        return DMA_CONFIG_OK;
+    }
+
+    cpu_block(b, type);
+    return DMA_CONFIG_OK;
+}
+
+static dma_config_flags_t run_end(dma_config_flags_t res)
+{
+    /* On error, let the transactions already queued finish */
+    dma_queue_wait(tensor_channel);
+    return res;
+}
+
+dma_config_flags_t tensor_init(uint8_t channel, tensor_backend_t backend)
+{
+    if (channel >= DMA_CH_NUM || backend >= TENSOR_BACKEND__size)
+    {
+        return DMA_CONFIG_CRITICAL_ERROR;
+    }
+
+    tensor_channel = channel;
+    tensor_backend = backend;
+    tensor_reset_stats();
+
+    /* Queued transactions are launched by the interrupt handler */
+    CSR_SET_BITS(CSR_REG_MSTATUS, 0x8);
+
+    return DMA_CONFIG_OK;
+}
+
+dma_config_flags_t tensor_transpose(const void *p_src, void *p_dst,
+                                    uint32_t rows, uint32_t cols,
+                                    dma_data_type_t type)
+{
+    /* Each row of the destination is a column of the source */
+    tensor_block_t b = {
+        .src = p_src,
+        .dst = p_dst,
+        .d1 = rows,
+        .d2 = cols,
+        .step_d1 = cols,
+        .step_d2 = 1,
+    };
+
+    if (rows == 0 || cols == 0 || type > DMA_DATA_TYPE_BYTE)
+    {
+        return DMA_CONFIG_CRITICAL_ERROR;
+    }
+    return run_end(run_block(&b, type));
+}
+
+dma_config_flags_t tensor_hwc_to_chw(const void *p_src, void *p_dst,
+                                     uint32_t h, uint32_t w, uint32_t c,
+                                     dma_data_type_t type)
+{
+    return tensor_transpose(p_src, p_dst, h * w, c, type);
+}
+
+dma_config_flags_t tensor_chw_to_hwc(const void *p_src, void *p_dst,
+                                     uint32_t h, uint32_t w, uint32_t c,
+                                     dma_data_type_t type)
+{
+    return tensor_transpose(p_src, p_dst, c, h * w, type);
+}
+
+dma_config_flags_t tensor_slice(const void *p_src, void *p_dst,
+                                uint32_t src_cols, uint32_t rows, uint32_t cols,
+                                uint32_t stride_r, uint32_t stride_c,
+                                dma_data_type_t type)
+{
+    tensor_block_t b = {
+        .src = p_src,
+        .dst = p_dst,
+        .d1 = cols,
+        .d2 = rows,
+        .step_d1 = stride_c,
+        .step_d2 = stride_r * src_cols,
+    };
+
+    if (rows == 0 || cols == 0 || type > DMA_DATA_TYPE_BYTE)
+    {
+        return DMA_CONFIG_CRITICAL_ERROR;
+    }
+    return run_end(run_block(&b, type));
+}
+
+dma_config_flags_t tensor_pad(const void *p_src, void *p_dst,
+                              uint32_t rows, uint32_t cols,
+                              uint8_t top, uint8_t bottom,
+                              uint8_t left, uint8_t right,
+                              dma_data_type_t type)
+{
+    tensor_block_t b = {
+        .src = p_src,
+        .dst = p_dst,
+        .d1 = cols,
+        .d2 = rows,
+        .step_d1 = 1,
+        .step_d2 = cols,
+        .top = top,
+        .bottom = bottom,
+        .left = left,
+        .right = right,
+    };
+
+    if (rows == 0 || cols == 0 || type > DMA_DATA_TYPE_BYTE)
+    {
+        return DMA_CONFIG_CRITICAL_ERROR;
+    }
+    return run_end(run_block(&b, type));
+}
+
+// First and last outputs whose input, out * stride + offset, is in [0, in_len)
+static int32_t valid_range(int32_t offset, int32_t in_len, int32_t out_len,
+                           int32_t stride, int32_t *p_first)
+{
+    int32_t first = offset >= 0 ? 0 : (-offset + stride - 1) / stride;
+    int32_t last;
+
+    if (in_len - 1 - offset < 0)
+    {
+        return 0;
+    }
+    last = (in_len - 1 - offset) / stride;
+    if (last > out_len - 1)
+    {
+        last = out_len - 1;
+    }
+    *p_first = first;
+    return last - first + 1;
+}
+
+dma_config_flags_t tensor_im2col(const void *p_src, void *p_dst,
+                                 uint32_t h, uint32_t w, uint32_t c,
+                                 const tensor_im2col_t *p_conv,
+                                 dma_data_type_t type)
+{
+    uint32_t size = DMA_DATA_TYPE_2_SIZE(type);
+    int32_t padded_h = h + p_conv->pad_top + p_conv->pad_bottom;
+    int32_t padded_w = w + p_conv->pad_left + p_conv->pad_right;
+    int32_t out_h, out_w;
+    uint8_t *dst = p_dst;
+    dma_config_flags_t res = DMA_CONFIG_OK;
+
+    if (h == 0 || w == 0 || c == 0 || type > DMA_DATA_TYPE_BYTE ||
+        p_conv->kernel_h == 0 || p_conv->kernel_w == 0 ||
+        p_conv->stride_h == 0 || p_conv->stride_w == 0 ||
+        padded_h < p_conv->kernel_h || padded_w < p_conv->kernel_w)
+    {
+        return DMA_CONFIG_CRITICAL_ERROR;
+    }
+
+    out_h = (padded_h - p_conv->kernel_h) / p_conv->stride_h + 1;
+    out_w = (padded_w - p_conv->kernel_w) / p_conv->stride_w + 1;
+
+    for (uint32_t ch = 0; ch < c && res == DMA_CONFIG_OK; ch++)
+    {
+        const uint8_t *plane = (const uint8_t *)p_src + ch * h * w * size;
+
+        for (int32_t ky = 0; ky < p_conv->kernel_h && res == DMA_CONFIG_OK; ky++)
+        {
+            int32_t y0 = 0, rows;
+            rows = valid_range(ky - p_conv->pad_top, h, out_h, p_conv->stride_h, &y0);
+
+            for (int32_t kx = 0; kx < p_conv->kernel_w && res == DMA_CONFIG_OK; kx++)
+            {
+                int32_t x0 = 0, cols;
+                cols = valid_range(kx - p_conv->pad_left, w, out_w, p_conv->stride_w, &x0);
+
+                /* The element of the kernel only sees padding */
+                if (rows <= 0 || cols <= 0)
+                {
+                    memset(dst, 0, out_h * out_w * size);
+                    tensor_stats.cpu_blocks++;
+                    dst += out_h * out_w * size;
+                    continue;
+                }
+
+                /* Input pixel seen by the first output pixel that is not padding */
+                int32_t y = y0 * p_conv->stride_h + ky - p_conv->pad_top;
+                int32_t x = x0 * p_conv->stride_w + kx - p_conv->pad_left;
+                tensor_block_t b = {
+                    .src = plane + (y * w + x) * size,
+                    .dst = dst,
+                    .d1 = cols,
+                    .d2 = rows,
+                    .step_d1 = p_conv->stride_w,
+                    .step_d2 = p_conv->stride_h * w,
+                    .top = y0,
+                    .bottom = out_h - y0 - rows,
+                    .left = x0,
+                    .right = out_w - x0 - cols,
+                };
+                res = run_block(&b, type);
+                dst += out_h * out_w * size;
+            }
+        }
+    }
+
+    return run_end(res);
+}
+
+void tensor_get_stats(tensor_stats_t *p_stats)
+{
+    *p_stats = tensor_stats;
+}
+
+void tensor_reset_stats(void)
+{
+    tensor_stats = (tensor_stats_t){0};
+}
@@ -0,0 +1,184 @@
+// Copyright 2025 EPFL and Politecnico di Torino.
+// Solderpad Hardware License, Version 2.1, see LICENSE.md for details.
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+//
+// File: tensor_sdk.h
+// Description: Tensor layout operations on 2D DMA transactions.
+//
+// Transposition, HWC <-> CHW conversion, strided slicing, zero padding and
+// im2col are split into 2D blocks: each block reads a strided 2D region of the
+// source and writes it, optionally surrounded by zeros, contiguously into the
+// destination. A block becomes one 2D DMA transaction, using the transposition
+// (DIM_INV) of the DMA when the stride between rows does not fit the D1
+// increment and the zero padding when it is synthesized (DMA_ZERO_PADDING).
+// The blocks of an operation are chained on the transaction queue of the
+// channel, so the DMA runs them back to back.
+//
+// Blocks that the DMA cannot perform (padding not synthesized, strides or
+// sizes out of the range of the registers, misaligned pointers, or a region
+// that is only padding) are performed by the CPU, while the DMA works on the
+// others.
+//
+//   dma_init(NULL);
+//   tensor_init(0, TENSOR_BACKEND_AUTO);
+//   tensor_hwc_to_chw(hwc, chw, H, W, C, DMA_DATA_TYPE_WORD);
+//
+// The operations return when the destination has been written. They are not
+// reentrant and must not be called from interrupt handlers.
+
+#ifndef TENSOR_SDK_H_
+#define TENSOR_SDK_H_
+
+#include <stdint.h>
+
+#include "dma.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+/******************************/
+/* ---- TYPE DEFINITIONS ---- */
+/******************************/
+
+/**
+ * Who performs the operations.
+ */
+typedef enum
+{
+    TENSOR_BACKEND_AUTO = 0,    /*!< The DMA, except for the blocks it cannot
+                                     perform. */
+    TENSOR_BACKEND_CPU,         /*!< Always the CPU, e.g. to compare. */
+    TENSOR_BACKEND__size,
+} tensor_backend_t;
+
+/**
+ * Parameters of an im2col (the input of a 2D convolution, unrolled).
+ */
+typedef struct
+{
+    uint16_t kernel_h;      /*!< Rows of the kernel. */
+    uint16_t kernel_w;      /*!< Columns of the kernel. */
+    uint16_t stride_h;      /*!< Vertical stride of the kernel. */
+    uint16_t stride_w;      /*!< Horizontal stride of the kernel. */
+    uint8_t pad_top;        /*!< Rows of zeros added above the input. */
+    uint8_t pad_bottom;     /*!< Rows of zeros added below the input. */
+    uint8_t pad_left;       /*!< Columns of zeros added left of the input. */
+    uint8_t pad_right;      /*!< Columns of zeros added right of the input. */
+} tensor_im2col_t;
+
+/**
+ * Blocks performed by each backend since the last reset.
+ */
+typedef struct
+{
+    uint32_t dma_blocks;    /*!< Blocks performed by the DMA. */
+    uint32_t cpu_blocks;    /*!< Blocks performed by the CPU. */
+} tensor_stats_t;
+
+/**********************************/
+/* ---- FUNCTION DECLARATIONS ---- */
+/**********************************/
+
+/**
+ * @brief Set the DMA channel and the backend used by the operations. The DMA
+ * must have been initialized with dma_init().
+ * @param channel DMA channel. It must not be used by anything else during the
+ * operations.
+ * @param backend Who performs the operations.
+ * @retval DMA_CONFIG_OK == 0
+ * @retval DMA_CONFIG_CRITICAL_ERROR if the channel or the backend is not valid.
+ */
+dma_config_flags_t tensor_init(uint8_t channel, tensor_backend_t backend);
+
+/**
+ * @brief Transpose a matrix: dst[c][r] = src[r][c].
+ * @param p_src Matrix of rows x cols elements.
+ * @param p_dst Matrix of cols x rows elements. Must not overlap p_src.
+ * @param rows Rows of p_src.
+ * @param cols Columns of p_src.
+ * @param type Type of the elements.
+ * @retval DMA_CONFIG_OK == 0
+ * @retval DMA_CONFIG_CRITICAL_ERROR if the arguments are not valid.
+ */
+dma_config_flags_t tensor_transpose(const void *p_src, void *p_dst,
+                                    uint32_t rows, uint32_t cols,
+                                    dma_data_type_t type);
+
+/**
+ * @brief Convert a tensor from the HWC to the CHW layout. This is the
+ * transposition of a (h * w) x c matrix.
+ */
+dma_config_flags_t tensor_hwc_to_chw(const void *p_src, void *p_dst,
+                                     uint32_t h, uint32_t w, uint32_t c,
+                                     dma_data_type_t type);
+
+/**
+ * @brief Convert a tensor from the CHW to the HWC layout. This is the
+ * transposition of a c x (h * w) matrix.
+ */
+dma_config_flags_t tensor_chw_to_hwc(const void *p_src, void *p_dst,
+                                     uint32_t h, uint32_t w, uint32_t c,
+                                     dma_data_type_t type);
+
+/**
+ * @brief Copy a strided slice of a matrix into a contiguous one:
+ * dst[r][c] = src[r * stride_r][c * stride_c].
+ * @param p_src First element of the slice.
+ * @param p_dst Matrix of rows x cols elements.
+ * @param src_cols Columns of the matrix the slice is taken from.
+ * @param rows Rows of the slice.
+ * @param cols Columns of the slice.
+ * @param stride_r Rows of the matrix between two rows of the slice.
+ * @param stride_c Columns of the matrix between two columns of the slice.
+ * @param type Type of the elements.
+ */
+dma_config_flags_t tensor_slice(const void *p_src, void *p_dst,
+                                uint32_t src_cols, uint32_t rows, uint32_t cols,
+                                uint32_t stride_r, uint32_t stride_c,
+                                dma_data_type_t type);
+
+/**
+ * @brief Copy a matrix surrounded by zeros: p_dst has
+ * (top + rows + bottom) x (left + cols + right) elements.
+ * @param p_src Matrix of rows x cols elements.
+ * @param p_dst Padded matrix.
+ */
+dma_config_flags_t tensor_pad(const void *p_src, void *p_dst,
+                              uint32_t rows, uint32_t cols,
+                              uint8_t top, uint8_t bottom,
+                              uint8_t left, uint8_t right,
+                              dma_data_type_t type);
+
+/**
+ * @brief Unroll a CHW tensor for a 2D convolution. p_dst is a matrix with a
+ * row for each channel and element of the kernel (c * kernel_h * kernel_w
+ * rows, in this order) and a column for each output pixel
+ * (out_h * out_w columns), with
+ * out_h = (h + pad_top + pad_bottom - kernel_h) / stride_h + 1 and
+ * out_w = (w + pad_left + pad_right - kernel_w) / stride_w + 1.
+ * Each row of p_dst is a block.
+ * @param p_src Tensor of c x h x w elements.
+ * @param p_dst Unrolled matrix.
+ * @param p_conv Kernel, strides and padding.
+ */
+dma_config_flags_t tensor_im2col(const void *p_src, void *p_dst,
+                                 uint32_t h, uint32_t w, uint32_t c,
+                                 const tensor_im2col_t *p_conv,
+                                 dma_data_type_t type);
+
+/**
+ * @brief Get the number of blocks performed by the DMA and by the CPU.
+ */
+void tensor_get_stats(tensor_stats_t *p_stats);
+
+/**
+ * @brief Clear the block counters.
+ */
+void tensor_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // TENSOR_SDK_H_
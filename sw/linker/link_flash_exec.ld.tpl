@@ -40,6 +40,22 @@ SECTIONS {
 	KEEP (*(.text.start))
     } >FLASH
 
+    /* Hot code, executed from the RAM: the functions marked with HOT_TEXT or
+    __attribute__((hot)) and the ones listed in hot_functions.ld (see hot_text.h).
+    It must come before .text to take these functions out of it.
+    The loader puts it in the FLASH and the startup copies it to the RAM, as .data */
+    .hot_text :
+    {
+        . = ALIGN(4);
+        _sihot_text = LOADADDR(.hot_text);
+        _shot_text = .;
+        *(.xheep_hot_text .xheep_hot_text.*)
+        *(.text.hot .text.hot.*)
+        INCLUDE hot_functions.ld
+        . = ALIGN(4);
+        _ehot_text = .;
+    } >RAM AT >FLASH
+
     /* The program code and other data goes into FLASH */
     .text :
     {
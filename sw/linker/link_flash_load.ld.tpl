@@ -59,11 +59,12 @@ SECTIONS {
         KEEP (*(.text.spi_set_rx_watermark*))
         KEEP (*(.text.spi_wait_for_rx_watermark*))
         KEEP (*(.text.spi_read_word*))
-        KEEP (*(.text.memcpy))
-        KEEP (*(.text.w25q128jw_read_standard)) /* as this function is used in the crt0, link it in the top, should be before 1024 Bytes loaded by the bootrom */
-        KEEP (*(.text.w25q128jw_read_standard.*)) /* sometimes the function is renamed as  w25q128jw_read_standard.part */
+        KEEP (*(.text.w25q128jw_boot_read_dma)) /* as these functions are used in the crt0, link them in the top, should be before 2048 Bytes loaded by the bootrom */
+        KEEP (*(.text.w25q128jw_boot_read_dma.*)) /* sometimes the function is renamed as w25q128jw_boot_read_dma.part */
+        KEEP (*(.text.w25q128jw_boot_wait_dma))
+        KEEP (*(.text.w25q128jw_boot_wait_dma.*))
         *(.xheep_init_data_crt0) /* this global variables are used in the crt0 */
-        KEEP (*_bswapsi2*(.text)) /* this function is used in the w25q128jw_read_standard */
+        KEEP (*_bswapsi2*(.text)) /* this function is used in the w25q128jw_boot_read_dma */
     } >ram0 AT >FLASH0
 
     /* The program code and other data goes into FLASH */
@@ -73,6 +74,7 @@ SECTIONS {
         __text_start = .; /* define a global symbol at data end; used by startup code in order to initialise the .data section in RAM */
         *(.text)           /* .text sections (code) */
         *(.text*)          /* .text* sections (code) */
+        *(.xheep_hot_text*) /* all the code is in the RAM already, see hot_text.h */
         *(.rodata)         /* .rodata sections (constants, strings, etc.) */
         *(.rodata*)        /* .rodata* sections (constants, strings, etc.) */
         *(.srodata)        /* .rodata sections (constants, strings, etc.) */
@@ -127,7 +129,8 @@ SECTIONS {
         __BSS_END__ = .;
     } >ram1 AT >FLASH1
 
-    _lma_data_end = _lma_data_start + SIZEOF(.data) + SIZEOF(.power_manager) + SIZEOF(.bss);
+    /* the crt0 loads only .data, .power_manager is scratch space and .bss is cleared */
+    _lma_data_end = _lma_data_start + SIZEOF(.data);
     _lma_vma_data_offset = _lma_data_start - __data_start;
 
     _lma_text_end = _lma_text_start + SIZEOF(.vectors) + SIZEOF(.init) + SIZEOF(.text) + SIZEOF(.data) + SIZEOF(.power_manager) + SIZEOF(.bss);
@@ -109,3 +109,47 @@ unsigned int XHEEP_CmdLineOptions::get_boot_sel()
 
   return boot_sel;
 }
+
+unsigned int XHEEP_CmdLineOptions::get_execute_from_flash()
+{
+  std::string arg_execute_from_flash = this->getCmdOption(this->argc, this->argv, "+execute_from_flash=");
+  unsigned int execute_from_flash = 0;
+
+  if(arg_execute_from_flash.compare("1") == 0) {
+    execute_from_flash = 1;
+    std::cout<<"[TESTBENCH]: Executing from flash"<<std::endl;
+  } else if(!arg_execute_from_flash.empty() && arg_execute_from_flash.compare("0") != 0) {
+    std::cout<<"[TESTBENCH]: Wrong Execute from Flash Option specified (0, 1) - using 0"<<std::endl;
+  }
+
+  return execute_from_flash;
+}
+
+std::string XHEEP_CmdLineOptions::get_pc_profile()
+{
+  // +pc_profile or +pc_profile=<output prefix>
+  std::string prefix;
+  for(int i = 0; i < this->argc; ++i) {
+    std::string arg = this->argv[i];
+    if(arg == "+pc_profile") prefix = "pc_profile";
+    else if(arg.find("+pc_profile=") == 0) prefix = arg.substr(12);
+  }
+
+  if(!prefix.empty()) {
+    std::cout<<"[TESTBENCH]: PC profile written to "<<prefix<<".{bin,folded}"<<std::endl;
+  }
+
+  return prefix;
+}
+
+bool XHEEP_CmdLineOptions::get_no_waves()
+{
+  for(int i = 0; i < this->argc; ++i) {
+    if(std::string(this->argv[i]) == "+no_waves") {
+      std::cout<<"[TESTBENCH]: Waveform dump disabled"<<std::endl;
+      return true;
+    }
+  }
+
+  return false;
+}
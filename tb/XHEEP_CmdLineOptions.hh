@@ -17,6 +17,9 @@ class XHEEP_CmdLineOptions // declare Calculator class
     std::string get_firmware();
     unsigned long long get_max_sim_time(bool& run_all);
     unsigned int get_boot_sel();
+    unsigned int get_execute_from_flash();
+    std::string get_pc_profile();
+    bool get_no_waves();
     int argc;
     char** argv;
 
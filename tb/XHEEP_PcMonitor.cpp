@@ -0,0 +1,139 @@
+// Copyright 2025 EPFL contributors
+// Solderpad Hardware License, Version 2.1, see LICENSE.md for details.
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+
+#include "XHEEP_PcMonitor.hh"
+
+#include <elf.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <vector>
+
+#include "svdpi.h"
+
+// Binary histogram: header followed by num_entries records sorted by PC
+struct PcMonitorHeader {
+  char     magic[4];     // "XHPC"
+  uint32_t version;      // 1
+  uint32_t num_entries;
+  uint32_t reserved;
+};
+
+struct PcMonitorRecord {
+  uint32_t pc;
+  uint32_t instr;
+  uint64_t cycles;
+  uint64_t count;
+};
+
+XHEEP_PcMonitor& XHEEP_PcMonitor::get()
+{
+  static XHEEP_PcMonitor monitor;
+  return monitor;
+}
+
+void XHEEP_PcMonitor::retire(uint32_t pc, uint32_t instr, uint32_t cycles)
+{
+  // The cycles since the previous retirement are charged to this instruction,
+  // so the stalls are charged to the instruction that waited
+  Entry& e = hist[pc];
+  e.instr = instr;
+  e.cycles += cycles;
+  e.count++;
+}
+
+// Function symbols of a 32-bit ELF, sorted by address
+static std::vector<std::pair<uint32_t, std::string>> read_symbols(const std::string& elf)
+{
+  std::vector<std::pair<uint32_t, std::string>> syms;
+  std::ifstream f(elf, std::ios::binary);
+  if (!f) return syms;
+  std::vector<char> buf((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+  if (buf.size() < sizeof(Elf32_Ehdr) || memcmp(buf.data(), ELFMAG, SELFMAG) != 0 ||
+      buf[EI_CLASS] != ELFCLASS32) return syms;
+
+  const Elf32_Ehdr* eh = reinterpret_cast<const Elf32_Ehdr*>(buf.data());
+  if (eh->e_shoff + (size_t)eh->e_shnum * sizeof(Elf32_Shdr) > buf.size()) return syms;
+  const Elf32_Shdr* sh = reinterpret_cast<const Elf32_Shdr*>(buf.data() + eh->e_shoff);
+
+  for (unsigned s = 0; s < eh->e_shnum; s++) {
+    if (sh[s].sh_type != SHT_SYMTAB || sh[s].sh_link >= eh->e_shnum) continue;
+    const Elf32_Shdr& strtab = sh[sh[s].sh_link];
+    if (sh[s].sh_offset + sh[s].sh_size > buf.size() ||
+        strtab.sh_offset + strtab.sh_size > buf.size()) continue;
+
+    const Elf32_Sym* sym = reinterpret_cast<const Elf32_Sym*>(buf.data() + sh[s].sh_offset);
+    for (size_t i = 0; i < sh[s].sh_size / sizeof(Elf32_Sym); i++) {
+      unsigned type = ELF32_ST_TYPE(sym[i].st_info);
+      unsigned shndx = sym[i].st_shndx;
+      if (shndx == SHN_UNDEF || shndx >= eh->e_shnum || sym[i].st_name >= strtab.sh_size) continue;
+      // Functions, and labels of assembly code (e.g. crt0, vectors)
+      if (type != STT_FUNC && !(type == STT_NOTYPE && (sh[shndx].sh_flags & SHF_EXECINSTR))) continue;
+      const char* name = buf.data() + strtab.sh_offset + sym[i].st_name;
+      if (name[0] == '\0' || name[0] == '$' || strncmp(name, ".L", 2) == 0) continue;
+      syms.emplace_back(sym[i].st_value, name);
+    }
+  }
+  std::sort(syms.begin(), syms.end());
+  return syms;
+}
+
+bool XHEEP_PcMonitor::write(const std::string& prefix, const std::string& elf)
+{
+  std::map<uint32_t, Entry> sorted(hist.begin(), hist.end());
+
+  std::ofstream bin(prefix + ".bin", std::ios::binary);
+  if (!bin) {
+    std::cout<<"[TESTBENCH]: ERROR: cannot write "<<prefix<<".bin"<<std::endl;
+    return false;
+  }
+  PcMonitorHeader h = {{'X', 'H', 'P', 'C'}, 1, (uint32_t)sorted.size(), 0};
+  bin.write(reinterpret_cast<const char*>(&h), sizeof(h));
+  for (const auto& e : sorted) {
+    PcMonitorRecord r = {e.first, e.second.instr, e.second.cycles, e.second.count};
+    bin.write(reinterpret_cast<const char*>(&r), sizeof(r));
+  }
+
+  std::vector<std::pair<uint32_t, std::string>> syms = read_symbols(elf);
+  if (syms.empty()) {
+    std::cout<<"[TESTBENCH]: WARNING: no symbols in "<<elf<<", PCs are not symbolized"<<std::endl;
+  }
+
+  std::map<std::string, uint64_t> funcs;
+  uint64_t total = 0;
+  for (const auto& e : sorted) {
+    auto it = std::upper_bound(syms.begin(), syms.end(), e.first,
+        [](uint32_t pc, const std::pair<uint32_t, std::string>& s) { return pc < s.first; });
+    if (it != syms.begin()) {
+      funcs[std::prev(it)->second] += e.second.cycles;
+    } else {
+      char pc[16];
+      snprintf(pc, sizeof(pc), "0x%08x", e.first);
+      funcs[pc] += e.second.cycles;
+    }
+    total += e.second.cycles;
+  }
+
+  std::ofstream folded(prefix + ".folded");
+  if (!folded) {
+    std::cout<<"[TESTBENCH]: ERROR: cannot write "<<prefix<<".folded"<<std::endl;
+    return false;
+  }
+  for (const auto& f : funcs) folded<<f.first<<" "<<f.second<<"\n";
+
+  std::cout<<"[TESTBENCH]: PC profile of "<<total<<" cycles written to "
+           <<prefix<<".bin and "<<prefix<<".folded"<<std::endl;
+  return true;
+}
+
+extern "C" void tb_pc_monitor_retire(int pc, int instr, int cycles)
+{
+  XHEEP_PcMonitor::get().retire((uint32_t)pc, (uint32_t)instr, (uint32_t)cycles);
+}
@@ -0,0 +1,44 @@
+// Copyright 2025 EPFL contributors
+// Solderpad Hardware License, Version 2.1, see LICENSE.md for details.
+// SPDX-License-Identifier: Apache-2.0 WITH SHL-2.1
+
+// PC monitor: the testharness calls tb_pc_monitor_retire() through DPI for
+// every instruction retired by the core (only when the simulation is started
+// with +pc_profile), with the cycles since the previous retirement. The
+// monitor keeps a per-PC histogram in memory and writes it when the simulation
+// ends, so programs can be profiled without dumping the waveform.
+
+#ifndef XHEEP_PC_MONITOR_H
+#define XHEEP_PC_MONITOR_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+class XHEEP_PcMonitor
+{
+
+  public:
+    struct Entry {
+      uint32_t instr;   // last instruction seen at this PC
+      uint64_t cycles;  // cycles up to the retirement of this PC, stalls included
+      uint64_t count;   // number of times this PC retired
+    };
+
+    static XHEEP_PcMonitor& get();
+
+    void retire(uint32_t pc, uint32_t instr, uint32_t cycles);
+
+    // Write <prefix>.bin (raw histogram) and <prefix>.folded (cycles per
+    // function, symbolized with the symbol table of elf if it can be read).
+    // Returns false if a file cannot be written.
+    bool write(const std::string& prefix, const std::string& elf);
+
+    bool empty() const { return hist.empty(); }
+
+  private:
+    std::unordered_map<uint32_t, Entry> hist;
+
+};
+
+#endif
@@ -11,6 +11,7 @@
 #include <iostream>
 #include <sys/stat.h>
 #include "XHEEP_CmdLineOptions.hh"
+#include "XHEEP_PcMonitor.hh"
 
 sc_event reset_done_event;
 sc_event obi_new_gnt;
@@ -188,10 +189,10 @@ SC_MODULE(testbench)
 int sc_main (int argc, char * argv[])
 {
 
-  std::string firmware;
+  std::string firmware, pc_profile;
   unsigned long long max_sim_time;
   unsigned int boot_sel, exit_val;
-  bool use_openocd;
+  bool use_openocd, no_waves;
   bool run_all = false;
   Verilated::commandArgs(argc, argv);
   Verilated::traceEverOn(true);
@@ -210,6 +211,9 @@ int sc_main (int argc, char * argv[])
 
   boot_sel     = cmd_lines_options->get_boot_sel();
 
+  no_waves     = cmd_lines_options->get_no_waves();
+  pc_profile   = cmd_lines_options->get_pc_profile();
+
   if(use_openocd) {
     std::cout<<"[TESTBENCH]: ERROR: Executing from OpenOCD in SystemC is not supported (yet) in X-HEEP"<<std::endl;
     std::cout<<"exit simulation..."<<std::endl;
@@ -315,9 +319,11 @@ int sc_main (int argc, char * argv[])
 
 
   VerilatedFstSc* tfp = nullptr;
-  tfp = new VerilatedFstSc;
-  dut.trace(tfp, 99);  // Trace 99 levels of hierarchy
-  tfp->open("waveform.fst");
+  if (!no_waves) {
+    tfp = new VerilatedFstSc;
+    dut.trace(tfp, 99);  // Trace 99 levels of hierarchy
+    tfp->open("waveform.fst");
+  }
 
   // Simulate until $finish
   while (!Verilated::gotFinish() && exit_valid !=1 ) {
@@ -336,6 +342,11 @@ int sc_main (int argc, char * argv[])
   // Final model cleanup
   dut.final();
 
+  if (!pc_profile.empty()) {
+    std::string elf = firmware.substr(0, firmware.rfind('.')) + ".elf";
+    XHEEP_PcMonitor::get().write(pc_profile, elf);
+  }
+
   // Close trace if opened
   if (tfp) {
       tfp->close();
@@ -11,6 +11,7 @@
 #include <iostream>
 
 #include "XHEEP_CmdLineOptions.hh"
+#include "XHEEP_PcMonitor.hh"
 
 vluint64_t sim_time = 0;
 
@@ -19,17 +20,17 @@ void runCycles(unsigned int ncycles, Vtestharness *dut, VerilatedFstC *m_trace){
     sim_time += CLK_PERIOD_ps/2;
     dut->clk_i ^= 1;
     dut->eval();
-    m_trace->dump(sim_time);
+    if (m_trace) m_trace->dump(sim_time);
   }
 }
 
 int main (int argc, char * argv[])
 {
 
-  std::string firmware;
+  std::string firmware, pc_profile;
   vluint64_t max_sim_time;
-  unsigned int boot_sel, exit_val;
-  bool use_openocd;
+  unsigned int boot_sel, execute_from_flash, exit_val;
+  bool use_openocd, no_waves;
   bool run_all = false;
 
   Verilated::commandArgs(argc, argv);
@@ -37,14 +38,20 @@ int main (int argc, char * argv[])
   // Instantiate the model
   Vtestharness *dut = new Vtestharness;
 
-  // Open VCD
-  Verilated::traceEverOn (true);
-  VerilatedFstC *m_trace = new VerilatedFstC;
-  dut->trace (m_trace, 99);
-  m_trace->open ("waveform.fst");
-
   XHEEP_CmdLineOptions* cmd_lines_options = new XHEEP_CmdLineOptions(argc,argv);
 
+  no_waves   = cmd_lines_options->get_no_waves();
+  pc_profile = cmd_lines_options->get_pc_profile();
+
+  // Open VCD
+  VerilatedFstC *m_trace = nullptr;
+  if (!no_waves) {
+    Verilated::traceEverOn (true);
+    m_trace = new VerilatedFstC;
+    dut->trace (m_trace, 99);
+    m_trace->open ("waveform.fst");
+  }
+
   use_openocd = cmd_lines_options->get_use_openocd();
   firmware = cmd_lines_options->get_firmware();
 
@@ -56,6 +63,7 @@ int main (int argc, char * argv[])
   max_sim_time = cmd_lines_options->get_max_sim_time(run_all);
 
   boot_sel     = cmd_lines_options->get_boot_sel();
+  execute_from_flash = cmd_lines_options->get_execute_from_flash();
 
   svSetScope(svGetScopeFromName("TOP.testharness"));
   svScope scope = svGetScope();
@@ -73,10 +81,11 @@ int main (int argc, char * argv[])
   dut->execute_from_flash_i = 0;
 
   dut->eval();
-  m_trace->dump(sim_time);
+  if (m_trace) m_trace->dump(sim_time);
 
   dut->rst_ni               = 1;
   dut->boot_select_i        = boot_sel;
+  dut->execute_from_flash_i = execute_from_flash;
 
   //this creates the negedge
   runCycles(20, dut, m_trace);
@@ -129,7 +138,12 @@ int main (int argc, char * argv[])
     exit_val = 2; // exit 2 to indicate successful run but premature termination
   }
 
-  m_trace->close();
+  if (!pc_profile.empty()) {
+    std::string elf = firmware.substr(0, firmware.rfind('.')) + ".elf";
+    XHEEP_PcMonitor::get().write(pc_profile, elf);
+  }
+
+  if (m_trace) m_trace->close();
   delete dut;
   delete cmd_lines_options;
 
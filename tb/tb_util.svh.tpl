@@ -4,6 +4,7 @@
 
 <%
     memory_ss = xheep.memory_ss()
+    cpu_name = xheep.cpu().get_name()
 %>
 
 `ifndef SYNTHESIS
@@ -119,6 +120,49 @@ task tb_set_exit_loop;
 endtask
 `endif
 
+`ifdef VERILATOR
+// PC monitor (tb/XHEEP_PcMonitor.cpp): with +pc_profile, the PC and instruction
+// of each retired instruction are sent to the C++ testbench, with the cycles
+// since the previous one, to profile programs without dumping the waveform.
+// The retirement is taken where the core counts minstret, so the instructions
+// flushed from the pipeline are not counted.
+import "DPI-C" function void tb_pc_monitor_retire(input int pc, input int instr, input int cycles);
+
+<%
+    cpu_path = "x_heep_system_i.core_v_mini_mcu_i.cpu_subsystem_i"
+    if cpu_name == "cv32e20":
+        # Single-cycle writeback in ID
+        core = cpu_path + ".gen_cv32e20.cv32e20_i.u_cve2_top.u_cve2_core"
+        ret_valid, ret_pc, ret_instr = core + ".perf_instr_ret_wb", core + ".pc_id", core + ".instr_rdata_id"
+    elif cpu_name == "cv32e40x":
+        # Retirement in WB, as for the debug_pc_o interface
+        core = cpu_path + ".gen_cv32e40x.cv32e40x_core_i"
+        ret_valid, ret_pc, ret_instr = core + ".ctrl_fsm.mhpmevent.minstret", core + ".ex_wb_pipe.pc", core + ".ex_wb_pipe.instr.bus_resp.rdata"
+    else:
+        # Instructions leaving ID are not flushed anymore
+        core = cpu_path + ".gen_" + cpu_name + "." + cpu_name + "_top_i.core_i"
+        ret_valid, ret_pc, ret_instr = "(" + core + ".id_valid & " + core + ".is_decoding)", core + ".pc_id", core + ".instr_rdata_id"
+%>
+bit tb_pc_monitor_en;
+int unsigned tb_pc_monitor_cycles;
+
+initial begin
+  tb_pc_monitor_en = $test$plusargs("pc_profile");
+  tb_pc_monitor_cycles = 0;
+end
+
+always_ff @(posedge x_heep_system_i.core_v_mini_mcu_i.clk_i) begin
+  if (tb_pc_monitor_en) begin
+    if (${ret_valid}) begin
+      tb_pc_monitor_retire(${ret_pc}, ${ret_instr}, tb_pc_monitor_cycles + 1);
+      tb_pc_monitor_cycles <= 0;
+    end else begin
+      tb_pc_monitor_cycles <= tb_pc_monitor_cycles + 1;
+    end
+  end
+end
+`endif
+
 task load_flash_hex;
     input string firmware_file;
     int i;
@@ -45,6 +45,10 @@
 // Memory Init is done in a separated task not part of this file
 // CAREFULL!!!! DUAL and QUAD SPI Flash Model doesnt work with Verilator
 // This is because it requires to model Hi-Z, which are not supported (yet?)
+// With the +flash_stats plusarg, the read traffic is reported at the end of the
+// simulation: every read command (including the XIP continuations) costs the
+// command, address and dummy cycles, so the bytes per command tell how well the
+// accesses are streamed, e.g. by the prefetch buffer of obi_spimemio.
 
 module spiflash (
     input wire csb,
@@ -85,6 +89,13 @@ module spiflash (
   logic [3:0] mode = 0;
   logic [3:0] next_mode = 0;
 
+  bit stats_en;
+  longint stat_frames = 0;
+  longint stat_read_cmds = 0;
+  longint stat_read_bytes = 0;
+
+  initial stats_en = $test$plusargs("flash_stats");
+
   logic io0_oe = 0;
   logic io1_oe = 0;
   logic io2_oe = 0;
@@ -127,6 +138,9 @@ module spiflash (
         if (spi_cmd == 8'hff) xip_cmd = 0;
 
         if (spi_cmd == 8'h06) write_enable = 1;
+
+        if (powered_up && (spi_cmd == 8'h03 || spi_cmd == 8'hbb || spi_cmd == 8'heb || spi_cmd == 8'hed))
+          stat_read_cmds = stat_read_cmds + 1;
       end
 
       if (powered_up && spi_cmd == 'h03) begin
@@ -139,6 +153,7 @@ module spiflash (
         if (bytecount >= 4) begin
           buffer   = memory[spi_addr];
           spi_addr = spi_addr + 1;
+          stat_read_bytes = stat_read_bytes + 1;
         end
       end
 
@@ -175,6 +190,7 @@ module spiflash (
         if (bytecount >= 5) begin
           buffer   = memory[spi_addr];
           spi_addr = spi_addr + 1;
+          stat_read_bytes = stat_read_bytes + 1;
         end
       end
 
@@ -196,6 +212,7 @@ module spiflash (
         if (bytecount >= 5) begin
           buffer   = memory[spi_addr];
           spi_addr = spi_addr + 1;
+          stat_read_bytes = stat_read_bytes + 1;
         end
       end
 
@@ -235,6 +252,7 @@ module spiflash (
         if (bytecount >= 5) begin
           buffer   = memory[spi_addr];
           spi_addr = spi_addr + 1;
+          stat_read_bytes = stat_read_bytes + 1;
         end
       end
 
@@ -284,6 +302,7 @@ module spiflash (
   endtask
 
   always @(posedge csb or negedge csb) begin
+    if (!csb) stat_frames = stat_frames + 1;
     if (csb) begin
       if (verbose) begin
         $display("");
@@ -438,4 +457,12 @@ module spiflash (
     end
   end
 
+  final begin
+    if (stats_en) begin
+      $display("[FLASH] %0d frames, %0d read commands, %0d bytes read (%0d bytes per command)",
+               stat_frames, stat_read_cmds, stat_read_bytes,
+               stat_read_cmds ? stat_read_bytes / stat_read_cmds : 0);
+    end
+  end
+
 endmodule
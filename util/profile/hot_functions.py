@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+# Copyright 2025 EPFL contributors
+# Licensed under the Apache License, Version 2.0, see LICENSE for details.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Turn a PC-sampling profile into the list of functions that the flash_exec
+# linker script relocates to the RAM (see sw/device/lib/runtime/hot_text.h).
+#
+# The profile is the UART log of an application built with -DPC_PROFILE (see
+# pc_sample_profile.py), or the folded stacks written by pc_sample_profile.py.
+# The functions are taken by decreasing number of samples until they cover
+# --coverage of the samples, as long as their code fits in --budget bytes of
+# RAM. The result is a linker script fragment to put in the folder of the
+# application, as hot_functions.ld.
+#
+# Usage:
+#   hot_functions.py --elf sw/build/main.elf uart0.log \
+#       --out sw/applications/<app>/hot_functions.ld
+#   hot_functions.py --elf sw/build/main.elf --folded util/profile/pc_samples.folded
+
+import argparse
+import os
+import subprocess
+import sys
+from collections import Counter
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from pc_sample_profile import find_tool, parse_log  # noqa: E402
+
+# Code run before the hot code is copied, or that must stay where it is
+EXCLUDE = {"_start", "_init", "_fini"}
+
+
+def load_functions(nm, elf):
+    """Address, size and name of the functions of the ELF, by address."""
+    out = subprocess.run([nm, "-n", "-S", "--defined-only", elf],
+                         capture_output=True, text=True, check=True).stdout
+    funcs = []
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) == 4 and parts[2] in "tTwW":
+            funcs.append((int(parts[0], 16), int(parts[1], 16), parts[3]))
+    return funcs
+
+
+def samples_per_function(hist, funcs):
+    per_func = Counter()
+    for pc, count in hist.items():
+        for addr, size, name in funcs:
+            if addr <= pc < addr + size:
+                per_func[name] += count
+                break
+    return per_func
+
+
+def read_folded(path):
+    per_func = Counter()
+    with open(path) as f:
+        for line in f:
+            stack, _, count = line.rstrip().rpartition(" ")
+            if stack:
+                per_func[stack.split(";")[0]] += int(count)
+    return per_func
+
+
+def section_name(symbol):
+    # Clones (foo.part.0, foo.constprop.0, foo.lto_priv.0) are in .text.foo.*
+    return symbol.split(".")[0]
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Generate the hot function list of the flash_exec linker script")
+    parser.add_argument("log", nargs="?", default="-",
+                        help="UART log containing the PC samples (default: stdin)")
+    parser.add_argument("--folded", help="folded stacks of pc_sample_profile.py instead of the log")
+    parser.add_argument("--elf", default="sw/build/main.elf", help="profiled ELF")
+    parser.add_argument("--nm", help="nm executable of the RISC-V toolchain")
+    parser.add_argument("--coverage", type=float, default=0.9,
+                        help="share of the samples to cover (default: 0.9)")
+    parser.add_argument("--budget", type=int, default=8192,
+                        help="maximum size in bytes of the relocated code (default: 8192)")
+    parser.add_argument("--out", default="hot_functions.ld", help="output linker script fragment")
+    args = parser.parse_args()
+
+    funcs = load_functions(find_tool("nm", args.nm), args.elf)
+    sizes = {name: size for _, size, name in funcs}
+    if args.folded:
+        per_func = read_folded(args.folded)
+    else:
+        hist, _, _, _ = parse_log(args.log)
+        per_func = samples_per_function(hist, funcs)
+    if not per_func:
+        sys.exit("No PC samples found")
+
+    total = sum(per_func.values())
+    selected, covered, used = [], 0, 0
+    for name, count in per_func.most_common():
+        if covered >= args.coverage * total:
+            break
+        if name in EXCLUDE or name not in sizes:
+            continue
+        if used + sizes[name] > args.budget:
+            print("{}: {} bytes, over the budget".format(name, sizes[name]))
+            continue
+        selected.append((name, count))
+        covered += count
+        used += sizes[name]
+
+    sections = []
+    for name, _ in selected:
+        if section_name(name) not in sections:
+            sections.append(section_name(name))
+
+    with open(args.out, "w") as f:
+        f.write("/* Generated by util/profile/hot_functions.py from {}:\n".format(
+            args.folded or args.log))
+        f.write("   {} functions, {} bytes, {:.1f}% of the samples */\n".format(
+            len(selected), used, 100.0 * covered / total))
+        for name in sections:
+            f.write("*(.text.{0} .text.{0}.*)\n".format(name))
+
+    print("{:>8} {:>7} {:>7}  {}".format("samples", "%", "bytes", "function"))
+    for name, count in selected:
+        print("{:>8} {:>6.2f}% {:>7}  {}".format(count, 100.0 * count / total, sizes[name], name))
+    print("\n{} functions, {} bytes, {:.1f}% of the samples: {}".format(
+        len(selected), used, 100.0 * covered / total, args.out))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
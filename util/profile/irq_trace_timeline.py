@@ -0,0 +1,201 @@
+#!/usr/bin/env python3
+# Copyright 2025 EPFL contributors
+# Licensed under the Apache License, Version 2.0, see LICENSE for details.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Render the output of irq_trace_dump() (sw/device/lib/runtime/irq_trace.h)
+# as a per-IRQ statistics table and a text timeline, and optionally export it
+# in the Chrome trace event format (open with https://ui.perfetto.dev).
+#
+# Usage:
+#   irq_trace_timeline.py uart0.log
+#   irq_trace_timeline.py uart.log --json trace.json --freq 20e6
+
+import argparse
+import json
+import sys
+
+MCAUSE_NAMES = {
+    3: "software",
+    7: "mtimer",
+    11: "external",
+    16: "fic_timer_1",
+    17: "fic_timer_2",
+    18: "fic_timer_3",
+    19: "fic_dma_done",
+    20: "fic_spi",
+    21: "fic_spi_flash",
+    22: "fic_gpio_0",
+    23: "fic_gpio_1",
+    24: "fic_gpio_2",
+    25: "fic_gpio_3",
+    26: "fic_gpio_4",
+    27: "fic_gpio_5",
+    28: "fic_gpio_6",
+    29: "fic_gpio_7",
+    30: "fic_dma_window",
+    31: "fic_ext_peripheral",
+}
+
+ENTER, EXIT, MARK = 0, 1, 2
+
+
+def irq_name(irq_id):
+    if irq_id >= 32:
+        return "plic_{}".format(irq_id - 32)
+    return MCAUSE_NAMES.get(irq_id, "irq_{}".format(irq_id))
+
+
+def parse(lines):
+    events = []
+    stats = []
+    lost = 0
+    for line in lines:
+        line = line.strip()
+        # The UART log may prefix lines with other text
+        for tag in ("IRQTRACE_BEGIN,", "IRQTRACE,", "IRQSTAT,"):
+            pos = line.find(tag)
+            if pos >= 0:
+                fields = [int(f) for f in line[pos + len(tag):].split(",")]
+                if tag == "IRQTRACE_BEGIN,":
+                    events = []
+                    stats = []
+                    lost = fields[1]
+                elif tag == "IRQTRACE,":
+                    events.append(tuple(fields[:3]))
+                else:
+                    stats.append(fields)
+                break
+    return events, stats, lost
+
+
+def unwrap(events):
+    """Make the 32-bit mcycle timestamps monotonic."""
+    out = []
+    base = 0
+    prev = None
+    for cycle, irq_id, kind in events:
+        if prev is not None and cycle < prev:
+            base += 1 << 32
+        prev = cycle
+        out.append((base + cycle, irq_id, kind))
+    return out
+
+
+def build_spans(events):
+    """Pair entry and exit events into (start, end, id, depth) spans."""
+    spans = []
+    open_spans = {}
+    depth = 0
+    for cycle, irq_id, kind in events:
+        if kind == ENTER:
+            open_spans[irq_id] = (cycle, depth)
+            depth += 1
+        elif kind == EXIT and irq_id in open_spans:
+            start, d = open_spans.pop(irq_id)
+            depth = max(depth - 1, 0)
+            spans.append((start, cycle, irq_id, d))
+    return spans
+
+
+def print_stats(stats, freq):
+    unit = "us" if freq else "cycles"
+    scale = 1e6 / freq if freq else 1.0
+    hdr = "{:<20} {:>7} {:>10} {:>10} {:>10} {:>7} {:>10} {:>10} {:>10}"
+    row = "{:<20} {:>7} {:>10.2f} {:>10.2f} {:>10.2f} {:>7} {:>10.2f} {:>10.2f} {:>10.2f}"
+    print("ISR duration and latency ({})".format(unit))
+    print(hdr.format("irq", "count", "dur_min", "dur_avg", "dur_max",
+                     "marks", "lat_min", "lat_avg", "lat_max"))
+    for s in sorted(stats, key=lambda s: -s[1] * s[3]):
+        irq_id = s[0]
+        print(row.format(irq_name(irq_id), s[1], s[2] * scale, s[3] * scale,
+                         s[4] * scale, s[5], s[6] * scale, s[7] * scale,
+                         s[8] * scale))
+    print()
+
+
+def print_timeline(events, spans, width):
+    if not events:
+        print("No events recorded")
+        return
+    t0 = events[0][0]
+    t1 = events[-1][0]
+    span = max(t1 - t0, 1)
+    ids = sorted({e[1] for e in events})
+    print("Timeline: {} cycles, {} cycles per column".format(span, max(span // width, 1)))
+    for irq_id in ids:
+        line = [" "] * (width + 1)
+        for start, end, sid, _ in spans:
+            if sid != irq_id:
+                continue
+            a = (start - t0) * width // span
+            b = (end - t0) * width // span
+            for i in range(a, b + 1):
+                line[i] = "#"
+        for cycle, eid, kind in events:
+            if eid == irq_id and kind == MARK:
+                line[(cycle - t0) * width // span] = "|"
+        print("{:<20}{}".format(irq_name(irq_id), "".join(line)))
+    print()
+
+
+def write_json(path, events, spans, freq):
+    scale = 1e6 / freq if freq else 1.0
+    trace = []
+    for start, end, irq_id, depth in spans:
+        trace.append({
+            "name": irq_name(irq_id),
+            "ph": "X",
+            "ts": start * scale,
+            "dur": (end - start) * scale,
+            "pid": 0,
+            "tid": depth,
+        })
+    for cycle, irq_id, kind in events:
+        if kind == MARK:
+            trace.append({
+                "name": "mark " + irq_name(irq_id),
+                "ph": "i",
+                "s": "g",
+                "ts": cycle * scale,
+                "pid": 0,
+                "tid": 0,
+            })
+    with open(path, "w") as f:
+        json.dump({"traceEvents": trace, "displayTimeUnit": "ns"}, f)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Render the IRQ trace dumped by irq_trace_dump()")
+    parser.add_argument("log", nargs="?", default="-",
+                        help="UART log containing the dump (default: stdin)")
+    parser.add_argument("--freq", type=float, default=0,
+                        help="core clock frequency in Hz, to report times in us")
+    parser.add_argument("--width", type=int, default=100,
+                        help="width of the text timeline in columns")
+    parser.add_argument("--json", help="write a Chrome/Perfetto trace file")
+    args = parser.parse_args()
+
+    f = sys.stdin if args.log == "-" else open(args.log, errors="replace")
+    events, stats, lost = parse(f)
+    if f is not sys.stdin:
+        f.close()
+
+    if not events and not stats:
+        print("No IRQ trace found in the log", file=sys.stderr)
+        return 1
+    if lost:
+        print("Warning: {} older events were overwritten in the ring buffer\n".format(lost))
+
+    events = unwrap(events)
+    spans = build_spans(events)
+    print_stats(stats, args.freq)
+    print_timeline(events, spans, args.width)
+    if args.json:
+        write_json(args.json, events, spans, args.freq)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,189 @@
+#!/usr/bin/env python3
+# Copyright 2025 EPFL contributors
+# Licensed under the Apache License, Version 2.0, see LICENSE for details.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Symbolize the PC histogram dumped on the UART by the on-device sampling
+# profiler (sw/device/lib/sdk/pc_profile, built with -DPC_PROFILE) and emit:
+#  - a per-function report on stdout
+#  - folded stacks (<out-dir>/pc_samples.folded), compatible with flamegraph.pl
+#    and speedscope
+#  - a flamegraph (<out-dir>/pc_samples.svg)
+#
+# Usage:
+#   pc_sample_profile.py --elf sw/build/main.elf uart0.log
+#   pc_sample_profile.py --elf sw/build/main.elf --lines uart.log
+
+import argparse
+import bisect
+import glob
+import html
+import os
+import shutil
+import subprocess
+import sys
+from collections import Counter
+
+
+def find_tool(name, explicit):
+    if explicit:
+        return explicit
+    for var in ("RISCV_XHEEP", "RISCV"):
+        root = os.environ.get(var)
+        if root:
+            found = sorted(glob.glob(os.path.join(root, "bin", "riscv32-*-" + name)))
+            if found:
+                return found[0]
+    for prefix in ("riscv32-corev-elf-", "riscv32-unknown-elf-", "riscv64-unknown-elf-"):
+        path = shutil.which(prefix + name)
+        if path:
+            return path
+    sys.exit("Cannot find a RISC-V '{}', use --{}".format(name, name))
+
+
+def parse_log(path):
+    hist = Counter()
+    samples = dropped = period = 0
+    f = sys.stdin if path == "-" else open(path, errors="replace")
+    for line in f:
+        pos = line.find("PCPROF_BEGIN,")
+        if pos >= 0:
+            samples, dropped, period = (int(x) for x in line[pos + 13:].strip().split(","))
+            hist = Counter()
+            continue
+        pos = line.find("PCPROF,")
+        if pos >= 0:
+            pc, count = line[pos + 7:].strip().split(",")
+            hist[int(pc, 16)] += int(count)
+    if f is not sys.stdin:
+        f.close()
+    return hist, samples, dropped, period
+
+
+def load_symbols(nm, elf):
+    out = subprocess.run([nm, "-n", "-C", "--defined-only", elf],
+                         capture_output=True, text=True, check=True).stdout
+    addrs, names = [], []
+    for line in out.splitlines():
+        parts = line.split(None, 2)
+        if len(parts) == 3 and parts[1] in "tTwW":
+            addrs.append(int(parts[0], 16))
+            names.append(parts[2])
+    return addrs, names
+
+
+def symbolize(pc, addrs, names):
+    i = bisect.bisect_right(addrs, pc) - 1
+    return names[i] if i >= 0 else "0x{:08x}".format(pc)
+
+
+def source_lines(addr2line, elf, pcs):
+    if not pcs:
+        return {}
+    out = subprocess.run([addr2line, "-e", elf] + ["0x{:x}".format(pc) for pc in pcs],
+                         capture_output=True, text=True, check=True).stdout.splitlines()
+    res = {}
+    for pc, loc in zip(pcs, out):
+        path, _, line = loc.rpartition(":")
+        res[pc] = "{}:{}".format(os.path.basename(path), line.split()[0]) if path else loc
+    return res
+
+
+def render_svg(folded, path, title):
+    """Minimal flamegraph renderer for folded stacks."""
+    tree = {}
+    total = 0
+    for stack, count in folded.items():
+        total += count
+        node = tree
+        for frame in stack.split(";"):
+            child = node.setdefault(frame, [0, {}])
+            child[0] += count
+            node = child[1]
+
+    width, row, pad = 1200, 18, 10
+    rects = []
+
+    def walk(node, x, depth):
+        for name, (count, children) in sorted(node.items()):
+            w = (width - 2 * pad) * count / total
+            rects.append((x, depth, w, name, count))
+            walk(children, x, depth + 1)
+            x += w
+
+    walk(tree, pad, 0)
+    depth = max((r[1] for r in rects), default=0) + 1
+    height = depth * row + 3 * row
+    svg = ['<svg xmlns="http://www.w3.org/2000/svg" width="{}" height="{}" '
+           'font-family="monospace" font-size="11">'.format(width, height),
+           '<rect width="100%" height="100%" fill="#f8f8f8"/>',
+           '<text x="{}" y="{}" font-size="14">{}</text>'.format(pad, row, html.escape(title))]
+    for x, d, w, name, count in rects:
+        y = height - (d + 1) * row - pad
+        hue = (sum(name.encode()) % 40) + 10
+        label = name if len(name) * 7 < w else name[:max(int(w / 7) - 2, 0)] + ".." if w > 21 else ""
+        svg.append('<g><title>{} ({} samples, {:.2f}%)</title>'
+                   '<rect x="{:.1f}" y="{}" width="{:.1f}" height="{}" fill="hsl({},90%,60%)" '
+                   'stroke="#fff"/><text x="{:.1f}" y="{}">{}</text></g>'.format(
+                       html.escape(name), count, 100.0 * count / total, x, y, w, row - 1,
+                       hue, x + 2, y + row - 5, html.escape(label)))
+    svg.append("</svg>")
+    with open(path, "w") as f:
+        f.write("\n".join(svg))
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Symbolize the PC samples of the on-device profiler")
+    parser.add_argument("log", nargs="?", default="-",
+                        help="UART log containing the dump (default: stdin)")
+    parser.add_argument("--elf", default="sw/build/main.elf", help="profiled ELF")
+    parser.add_argument("--nm", help="nm executable of the RISC-V toolchain")
+    parser.add_argument("--addr2line", help="addr2line executable of the RISC-V toolchain")
+    parser.add_argument("--lines", action="store_true",
+                        help="add the source line as second stack level")
+    parser.add_argument("--out-dir", default="util/profile", help="output directory")
+    parser.add_argument("--top", type=int, default=20, help="functions to report")
+    args = parser.parse_args()
+
+    hist, samples, dropped, period = parse_log(args.log)
+    if not hist:
+        sys.exit("No PC samples found in the log")
+
+    addrs, names = load_symbols(find_tool("nm", args.nm), args.elf)
+    lines = source_lines(find_tool("addr2line", args.addr2line), args.elf,
+                         sorted(hist)) if args.lines else {}
+
+    folded = Counter()
+    per_func = Counter()
+    for pc, count in hist.items():
+        func = symbolize(pc, addrs, names)
+        per_func[func] += count
+        stack = func + (";" + lines[pc] if pc in lines else "")
+        folded[stack] += count
+
+    recorded = sum(hist.values())
+    print("{} samples every {} cycles, {} dropped".format(samples, period, dropped))
+    print("{:>8} {:>7}  {}".format("samples", "%", "function"))
+    for func, count in per_func.most_common(args.top):
+        print("{:>8} {:>6.2f}%  {}".format(count, 100.0 * count / recorded, func))
+
+    os.makedirs(args.out_dir, exist_ok=True)
+    folded_path = os.path.join(args.out_dir, "pc_samples.folded")
+    with open(folded_path, "w") as f:
+        for stack, count in sorted(folded.items()):
+            f.write("{} {}\n".format(stack, count))
+
+    svg_path = os.path.join(args.out_dir, "pc_samples.svg")
+    flamegraph = shutil.which("flamegraph.pl")
+    if flamegraph:
+        with open(svg_path, "w") as f:
+            subprocess.run([flamegraph, folded_path], stdout=f, check=True)
+    else:
+        render_svg(folded, svg_path, "{} samples, {} cycles period".format(recorded, period))
+    print("\nFolded stacks: {}\nFlamegraph: {}".format(folded_path, svg_path))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
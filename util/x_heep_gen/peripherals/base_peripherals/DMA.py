@@ -239,7 +239,7 @@ class DMA(BasePeripheral):
 
     def validate(self):
         """
-        Checks if the DMA peripheral is valid (number of channels between 0 and 256, master ports between 0 and number of channels, channels per master port between 0 and number of channels, number of channels per master port is not 0 if number of channels is not 1).
+        Checks if the DMA peripheral is valid (number of channels between 0 and 256, master ports between 0 and number of channels, channels per master port between 0 and number of channels, number of channels per master port is not 0 if number of channels is not 1, room for the interrupt summary registers after the channels).
         """
         valid = True
         if self.get_num_channels() > 256 or self.get_num_channels() == 0:
@@ -268,4 +268,14 @@ class DMA(BasePeripheral):
             )
             valid = False
 
+        if (
+            self.get_length() is not None
+            and self.get_num_channels() * self.get_ch_length() + 0x100
+            > min(self.get_length(), 0x10000)
+        ):
+            print(
+                "The DMA length has to leave 0x100 bytes after the channels for the interrupt summary registers"
+            )
+            valid = False
+
         return valid
@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+# Copyright 2025 EPFL contributors
+# Licensed under the Apache License, Version 2.0, see LICENSE for details.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Build an application with each linker script (on_chip, flash_load,
+# flash_exec), run it on the Verilator model and compare:
+#  - the total simulated cycles, boot included,
+#  - the cycles reported by the application (coremark's "Total ticks", or the
+#    lines of example_xip_bench),
+#  - the cycles from reset to main, if the application prints them (e.g.
+#    example_boot_time),
+#  - the read traffic of the flash model (+flash_stats).
+#
+# The Verilator model must have been built (make verilator-build).
+#
+# Usage:
+#   xip_bench.py                        # coremark
+#   xip_bench.py --project example_xip_bench --linkers flash_load flash_exec
+#   xip_bench.py --project example_boot_time
+
+import argparse
+import glob
+import os
+import re
+import subprocess
+import sys
+
+# Simulation arguments of each linker script: boot from the flash, then
+# execute from it or copy the code to the RAM first
+SIM_ARGS = {
+    "on_chip": "",
+    "flash_load": "+boot_sel=1 +execute_from_flash=0",
+    "flash_exec": "+boot_sel=1 +execute_from_flash=1",
+}
+
+SIM_CYCLES = re.compile(r"Simulation finished after (\d+) clock cycles")
+EXIT_VALUE = re.compile(r"Program Finished with value (\d+)")
+FLASH_STATS = re.compile(r"\[FLASH\] (.*)")
+COREMARK_TICKS = re.compile(r"Total ticks\s*:\s*(\d+)")
+BOOT_CYCLES = re.compile(r"Boot cycles\s*:\s*(\d+)")
+KERNEL_LINE = re.compile(r"^(\w+)\s*\|\s*(\d+)\s*\|\s*(\d+)\s*$", re.M)
+
+
+def uart_log(root):
+    logs = glob.glob(os.path.join(root, "build", "openhwgroup.org_systems_core-v-mini-mcu_*",
+                                  "sim-verilator", "uart0.log"))
+    if not logs:
+        return ""
+    with open(sorted(logs)[0], encoding="utf-8", errors="replace") as f:
+        return f.read()
+
+
+def boot_time_args(make_args):
+    # Let the crt0 enable mcycle, which some cores inhibit at reset
+    for i, arg in enumerate(make_args):
+        if arg.startswith("COMPILER_FLAGS="):
+            return make_args[:i] + [f"{arg} -DHEEP_BOOT_TIME"] + make_args[i + 1:]
+    return make_args + ["COMPILER_FLAGS=-DHEEP_BOOT_TIME"]
+
+
+def run(root, project, linker, make_args, timeout):
+    subprocess.run(["make", "app", f"PROJECT={project}", f"LINKER={linker}"] + boot_time_args(make_args),
+                   cwd=root, check=True, capture_output=True)
+    sim_args = f"SIM_ARGS={SIM_ARGS[linker]} +flash_stats"
+    out = subprocess.run(["make", "verilator-run", sim_args], cwd=root, check=False,
+                         capture_output=True, timeout=timeout).stdout.decode("utf-8", "replace")
+
+    result = {"linker": linker}
+    match = SIM_CYCLES.search(out)
+    result["sim_cycles"] = int(match.group(1)) if match else None
+    match = EXIT_VALUE.search(out)
+    result["exit"] = int(match.group(1)) if match else None
+    match = FLASH_STATS.search(out)
+    result["flash"] = match.group(1) if match else "-"
+
+    log = uart_log(root)
+    match = COREMARK_TICKS.search(log)
+    result["ticks"] = int(match.group(1)) if match else None
+    match = BOOT_CYCLES.search(log)
+    result["boot"] = int(match.group(1)) if match else None
+    result["kernels"] = {m.group(1): (int(m.group(2)), int(m.group(3)))
+                         for m in KERNEL_LINE.finditer(log)}
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--project", default="coremark")
+    parser.add_argument("--linkers", nargs="+", default=list(SIM_ARGS), choices=list(SIM_ARGS))
+    parser.add_argument("--timeout", type=int, default=3600, help="Seconds per simulation")
+    parser.add_argument("make_args", nargs="*", help="Extra arguments of make app, e.g. COMPILER=clang")
+    args = parser.parse_args()
+
+    root = subprocess.run(["git", "rev-parse", "--show-toplevel"], check=True,
+                          capture_output=True).stdout.decode().strip()
+
+    results = []
+    for linker in args.linkers:
+        print(f"Running {args.project} with {linker}...", flush=True)
+        results.append(run(root, args.project, linker, args.make_args, args.timeout))
+
+    print(f"\n{'linker':<11} | {'exit':>4} | {'sim cycles':>12} | {'boot cycles':>12} | {'app cycles':>12} | flash")
+    for r in results:
+        app = r["ticks"] if r["ticks"] is not None else "-"
+        boot = r["boot"] if r["boot"] is not None else "-"
+        print(f"{r['linker']:<11} | {r['exit'] if r['exit'] is not None else '-':>4} | "
+              f"{r['sim_cycles'] if r['sim_cycles'] is not None else '-':>12} | {boot:>12} | {app:>12} | {r['flash']}")
+
+    kernels = sorted({k for r in results for k in r["kernels"]})
+    if kernels:
+        print(f"\n{'kernel':<10} | " + " | ".join(f"{r['linker'] + ' cold/warm':>25}" for r in results))
+        for k in kernels:
+            cells = []
+            for r in results:
+                cold, warm = r["kernels"].get(k, ("-", "-"))
+                cells.append(f"{f'{cold}/{warm}':>25}")
+            print(f"{k:<10} | " + " | ".join(cells))
+
+    return 0 if all(r["exit"] == 0 for r in results) else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())